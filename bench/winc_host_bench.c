@@ -0,0 +1,994 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "bsp/include/nm_bsp.h"
+#include "bsp/include/nm_bsp_host.h"
+#include "common/include/nm_common.h"
+#include "common/include/nm_crc16.h"
+#include "driver/source/nmbus.h"
+#include "driver/source/nmspi.h"
+#include "driver/source/m2m_hif.h"
+#include "driver/include/m2m_types.h"
+#include "winc_sim_loopback.h"
+#include "winc_sim_memmap.h"
+#include "winc_sim_hif.h"
+#include "winc_sim_socket.h"
+#include "winc_sim_wifi.h"
+#include "winc_sim_traffic.h"
+#include "winc_sim_latency.h"
+#include "sim_log.h"
+#include "winc_socket_bench.h"
+#include "driver/include/m2m_wifi.h"
+#include "socket/include/socket.h"
+#include "config/conf_simulator.h"
+
+// Host benchmark: the unmodified driver stack talking to the simulator engine
+// through the loopback bus wrapper. Times are wall clock on the build machine,
+// so they measure the software cost of each layer, not SPI clock time.
+//
+// Layers:
+//   driver    - nmbus/nmspi/m2m_hif, everything above nm_bus_ioctl()
+//   transport - nm_spi_rw() and the loopback byte shuffling
+//   engine    - the simulator command engine
+
+#define SCRATCH_REG         0x20000
+#define BLOCK_ADDR          0x20000
+#define REG_ITERATIONS      20000
+#define BLOCK_BYTES_TARGET  (4 * 1024 * 1024)
+#define HIF_MESSAGES        2000
+#define MAP_ITERATIONS      2000000
+#define TRACE_ITERATIONS    2000000
+#define SOCKET_ITERATIONS   1000
+#define WIFI_ITERATIONS     200
+#define WIFI_TIMEOUT_US     5000000
+#define TRAFFIC_SOCKETS     4
+#define TRAFFIC_RUN_US      500000
+#define TRAFFIC_DRAIN_US    50000
+#define INSTANCE_ITERATIONS 200000
+#define RECOVERY_ITERATIONS 20000
+#define INSTANCE_THREADS    4
+
+// The modelled link: above LINK_STABLE_HZ MISO takes a bit error every
+// LINK_FAULT_BYTES bytes, so calibration and error recovery have something
+// to find (winc_sim_loopback_set_faults())
+#define LINK_STABLE_HZ      24000000
+#define LINK_FAULT_BYTES    97
+
+// The 19.3.0 driver (WiFi101 port) renamed connect() to avoid the libc name
+#ifdef M2M_DRIVER_VERSION_MINOR_NO
+#define sock_connect connectSocket
+#else
+#define sock_connect connect
+#endif
+
+static const uint32 block_sizes[] = {4, 16, 64, 256, 1024, 4096, 16384, 65536};
+
+static uint8 block_buf[65536];
+static uint8 verify_buf[65536];
+
+// The chip behind the driver, see nm_bsp_host_loopback()
+static winc_sim_loopback_t *lb;
+static winc_sim_t *sim;
+
+static void bus_poll(void)
+{
+    winc_sim_loopback_poll(lb);
+}
+
+typedef struct {
+    uint64_t total_ns;
+    uint64_t ops;
+    winc_sim_loopback_stats_t bus;
+} bench_sample_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sample_begin(bench_sample_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    winc_sim_loopback_reset_stats(lb);
+    s->total_ns = now_ns();
+}
+
+static void sample_end(bench_sample_t *s, uint64_t ops)
+{
+    s->total_ns = now_ns() - s->total_ns;
+    s->ops = ops;
+    winc_sim_loopback_get_stats(lb, &s->bus);
+}
+
+static void print_layers(const bench_sample_t *s)
+{
+    double total = (double)s->total_ns;
+    double engine = (double)s->bus.engine_ns;
+    double transport = (double)s->bus.rw_ns - engine;
+    double driver = total - (double)s->bus.rw_ns;
+
+    if (total <= 0) return;
+    printf("    layers: driver %5.1f%%  transport %5.1f%%  engine %5.1f%%  (%.1f transfers/op)\n",
+           100.0 * driver / total, 100.0 * transport / total, 100.0 * engine / total,
+           s->ops ? (double)s->bus.transfers / (double)s->ops : 0.0);
+}
+
+static int bench_registers(void)
+{
+    bench_sample_t s;
+    uint32 val = 0;
+
+    printf("Register access (%d iterations)\n", REG_ITERATIONS);
+
+    sample_begin(&s);
+    for (int i = 0; i < REG_ITERATIONS; i++) {
+        if (nm_write_reg(SCRATCH_REG, (uint32)i) != M2M_SUCCESS) {
+            printf("  nm_write_reg failed at %d\n", i);
+            return -1;
+        }
+    }
+    sample_end(&s, REG_ITERATIONS);
+    printf("  nm_write_reg: %8.0f ns/op\n", (double)s.total_ns / s.ops);
+    print_layers(&s);
+
+    sample_begin(&s);
+    for (int i = 0; i < REG_ITERATIONS; i++) {
+        if (nm_read_reg_with_ret(SCRATCH_REG, &val) != M2M_SUCCESS) {
+            printf("  nm_read_reg failed at %d\n", i);
+            return -1;
+        }
+    }
+    sample_end(&s, REG_ITERATIONS);
+    printf("  nm_read_reg:  %8.0f ns/op\n", (double)s.total_ns / s.ops);
+    print_layers(&s);
+
+    if (val != REG_ITERATIONS - 1) {
+        printf("  readback mismatch: %x\n", (unsigned)val);
+        return -1;
+    }
+
+    // Write, read back and modify, as one nm_reg_batch() of 4 ops
+    sample_begin(&s);
+    for (int i = 0; i < REG_ITERATIONS; i++) {
+        tstrNmRegOp ops[] = {
+            {NM_REG_OP_WRITE, SCRATCH_REG, (uint32)i},
+            {NM_REG_OP_WRITE, SCRATCH_REG + 4, (uint32)~i},
+            {NM_REG_OP_READ, SCRATCH_REG},
+            {NM_REG_OP_RMW, SCRATCH_REG + 4, 0, 0xff},
+        };
+        if (nm_reg_batch(ops, 4) != M2M_SUCCESS || ops[2].u32Rd != (uint32)i) {
+            printf("  nm_reg_batch failed at %d\n", i);
+            return -1;
+        }
+    }
+    sample_end(&s, REG_ITERATIONS * 4);
+    printf("  nm_reg_batch: %8.0f ns/op\n", (double)s.total_ns / s.ops);
+    print_layers(&s);
+    return 0;
+}
+
+// Register traffic with the HIGH profile at twice the rate the modelled link
+// holds, so MISO takes a bit error every LINK_FAULT_BYTES bytes: what
+// the error recovery costs, and where the bus health settles the clock.
+static int bench_recovery(void)
+{
+    bench_sample_t s;
+    tstrNmSpiErrStats before, err;
+    uint32 saved = nm_bus_get_profile(1);
+    uint32 val, failed = 0, wrong = 0;
+
+    nm_bus_set_profile(1, 2 * LINK_STABLE_HZ);
+    printf("SPI error recovery (%d write+read pairs from %u Hz)\n", RECOVERY_ITERATIONS,
+           (unsigned)nm_bus_get_profile(1));
+
+    nm_spi_get_err_stats(&before);
+    sample_begin(&s);
+    for (int i = 0; i < RECOVERY_ITERATIONS; i++) {
+        if (nm_write_reg(SCRATCH_REG, (uint32)i) != M2M_SUCCESS ||
+            nm_read_reg_with_ret(SCRATCH_REG, &val) != M2M_SUCCESS) {
+            failed++;
+        } else if (val != (uint32)i) {
+            wrong++;
+        }
+    }
+    sample_end(&s, 2 * RECOVERY_ITERATIONS);
+    nm_spi_get_err_stats(&err);
+    err.u32Errors -= before.u32Errors;
+    err.u32Resyncs -= before.u32Resyncs;
+    err.u32Backoffs -= before.u32Backoffs;
+    err.u32Recovered -= before.u32Recovered;
+    err.u32Failed -= before.u32Failed;
+    err.u32Downshifts -= before.u32Downshifts;
+    err.u32RecoveryUsTotal -= before.u32RecoveryUsTotal;
+
+    printf("  %8.0f ns/op, %u pairs failed, %u read back wrong\n", (double)s.total_ns / s.ops,
+           (unsigned)failed, (unsigned)wrong);
+    printf("  errors %u: %u resyncs, %u backoffs; %u accesses recovered, %u failed\n",
+           (unsigned)err.u32Errors, (unsigned)err.u32Resyncs, (unsigned)err.u32Backoffs,
+           (unsigned)err.u32Recovered, (unsigned)err.u32Failed);
+    printf("  recovery %.1f us avg, %u us max\n",
+           err.u32Recovered ? (double)err.u32RecoveryUsTotal / err.u32Recovered : 0.0,
+           (unsigned)err.u32RecoveryUsMax);
+    printf("  clock down %u times to %u Hz, health %u\n", (unsigned)err.u32Downshifts,
+           (unsigned)nm_bus_get_profile(1), (unsigned)err.u8Health);
+
+    nm_bus_set_profile(1, saved);
+    return wrong ? -1 : 0;
+}
+
+// Simulator memory map on its own: the lookup and hook dispatch cost that every
+// SINGLE_READ/SINGLE_WRITE pays inside the engine share above.
+static void bench_memmap(void)
+{
+    static const struct {
+        const char *name;
+        uint32 addr;
+    } targets[] = {
+        {"ram",          SCRATCH_REG},
+        {"periph",       0x13f4},
+        {"spi",          0xe804},
+        {"hooked",       0x108c},
+        {"unmapped",     0x200000},
+    };
+    uint64_t t;
+    uint32_t val = 0;
+    volatile uint32_t sink = 0;
+
+    printf("Memory map (%d lookups)\n", MAP_ITERATIONS);
+    printf("  %10s %10s %10s %10s\n", "region", "ptr ns", "read ns", "write ns");
+
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        uint32 addr = targets[i].addr;
+        double ptr_ns, read_ns, write_ns;
+
+        t = now_ns();
+        for (int n = 0; n < MAP_ITERATIONS; n++) {
+            sink += (uint32_t)(uintptr_t)winc_sim_map_ptr(sim, addr + (n & 4), 4, false);
+        }
+        ptr_ns = (double)(now_ns() - t) / MAP_ITERATIONS;
+
+        t = now_ns();
+        for (int n = 0; n < MAP_ITERATIONS; n++) {
+            winc_sim_map_read32(sim, addr, &val);
+            sink += val;
+        }
+        read_ns = (double)(now_ns() - t) / MAP_ITERATIONS;
+
+        // Write back what is there so the chip state is unchanged
+        winc_sim_map_read32(sim, addr, &val);
+        t = now_ns();
+        for (int n = 0; n < MAP_ITERATIONS; n++) {
+            winc_sim_map_write32(sim, addr, val);
+        }
+        write_ns = (double)(now_ns() - t) / MAP_ITERATIONS;
+
+        printf("  %10s %10.1f %10.1f %10.1f\n", targets[i].name, ptr_ns, read_ns, write_ns);
+    }
+}
+
+// Write and read back sz bytes until BLOCK_BYTES_TARGET has been moved each way
+static int run_blocks(uint32 sz, uint8 seed, bench_sample_t *w, bench_sample_t *r)
+{
+    uint64_t iterations = BLOCK_BYTES_TARGET / sz;
+
+    for (uint32 j = 0; j < sz; j++) {
+        block_buf[j] = (uint8)(j * 7 + seed);
+    }
+
+    sample_begin(w);
+    for (uint64_t n = 0; n < iterations; n++) {
+        if (nm_write_block(BLOCK_ADDR, block_buf, sz) != M2M_SUCCESS) {
+            printf("  nm_write_block(%u) failed\n", (unsigned)sz);
+            return -1;
+        }
+    }
+    sample_end(w, iterations);
+
+    sample_begin(r);
+    for (uint64_t n = 0; n < iterations; n++) {
+        if (nm_read_block(BLOCK_ADDR, verify_buf, sz) != M2M_SUCCESS) {
+            printf("  nm_read_block(%u) failed\n", (unsigned)sz);
+            return -1;
+        }
+    }
+    sample_end(r, iterations);
+
+    if (memcmp(block_buf, verify_buf, sz) != 0) {
+        printf("  readback mismatch at size %u\n", (unsigned)sz);
+        return -1;
+    }
+    return 0;
+}
+
+static double mb_per_s(const bench_sample_t *s, uint32 sz)
+{
+    return (double)sz * (double)s->ops / ((double)s->total_ns / 1e9) / 1e6;
+}
+
+static int bench_blocks(void)
+{
+    printf("Block transfers\n");
+    printf("  %8s %12s %12s %10s\n", "size", "write MB/s", "read MB/s", "bus/data");
+
+    for (size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++) {
+        uint32 sz = block_sizes[i];
+        bench_sample_t w, r;
+
+        if (run_blocks(sz, (uint8)i, &w, &r) != 0) return -1;
+
+        double bytes = (double)sz * (double)w.ops;
+        printf("  %8u %12.2f %12.2f %10.2f\n", (unsigned)sz, mb_per_s(&w, sz), mb_per_s(&r, sz),
+               (double)(w.bus.bytes + r.bus.bytes) / (2.0 * bytes));
+        print_layers(&w);
+        print_layers(&r);
+    }
+    return 0;
+}
+
+// Cost of the data CRC16: the same transfers with CRC on and off, plus the raw
+// nm_crc16() rate. "bus" is the extra SPI bytes, which is what CRC costs on a
+// real bus where the clock and not the CPU is the limit. On the host the
+// simulator checks every CRC in software as well (the DMA sniffer does that on
+// the Pico), so the layer split of the CRC-on runs is printed too.
+static int bench_crc(void)
+{
+    static const uint32 crc_sizes[] = {256, 4096, 65536};
+    bench_sample_t w[2], r[2];
+    uint64_t t;
+    volatile uint16 crc = 0;
+
+    t = now_ns();
+    for (int n = 0; n < 64; n++) {
+        crc ^= nm_crc16(block_buf, sizeof(block_buf));
+    }
+    t = now_ns() - t;
+    printf("Data CRC16 (nm_crc16 %.0f MB/s)\n", 64.0 * sizeof(block_buf) / ((double)t / 1e9) / 1e6);
+    printf("  %8s %12s %12s %12s %12s %8s\n", "size", "write off", "write on", "read off", "read on", "bus");
+
+    for (size_t i = 0; i < sizeof(crc_sizes) / sizeof(crc_sizes[0]); i++) {
+        uint32 sz = crc_sizes[i];
+
+        for (int on = 0; on < 2; on++) {
+            if (nm_spi_set_crc((uint8)on) != M2M_SUCCESS) {
+                printf("  nm_spi_set_crc(%d) failed\n", on);
+                return -1;
+            }
+            if (run_blocks(sz, (uint8)i, &w[on], &r[on]) != 0) return -1;
+        }
+
+        printf("  %8u %12.2f %12.2f %12.2f %12.2f %+7.2f%%\n", (unsigned)sz,
+               mb_per_s(&w[0], sz), mb_per_s(&w[1], sz), mb_per_s(&r[0], sz), mb_per_s(&r[1], sz),
+               100.0 * ((double)(w[1].bus.bytes + r[1].bus.bytes) / (double)(w[0].bus.bytes + r[0].bus.bytes) - 1.0));
+        print_layers(&w[1]);
+        print_layers(&r[1]);
+    }
+
+    return nm_spi_set_crc(CONF_WINC_SPI_CRC);
+}
+
+// Data packet size sweep. Each packet costs a header and a CRC16 on the wire,
+// so "wire" is what the blocks would move at the HIGH clock, from the bytes
+// actually clocked. Larger packets need larger buffers on both sides, and the
+// host MB/s shows what the per-packet work costs the CPU.
+static int bench_pkt_sz(void)
+{
+    static const uint32 pkt_sizes[] = {256, 512, 1024, 2048, 4096, 8192};
+    static const uint32 sweep_sizes[] = {1024, 8192, 65536};
+    double hz = (double)nm_bus_get_profile(1);
+
+    printf("Data packet size (wire MB/s at %u Hz per block size, host MB/s at %u)\n",
+           (unsigned)nm_bus_get_profile(1), (unsigned)sweep_sizes[2]);
+    printf("  %8s %10u %10u %10u %12s %12s\n", "packet", (unsigned)sweep_sizes[0], (unsigned)sweep_sizes[1],
+           (unsigned)sweep_sizes[2], "host write", "host read");
+
+    for (size_t i = 0; i < sizeof(pkt_sizes) / sizeof(pkt_sizes[0]); i++) {
+        bench_sample_t w, r;
+
+        if (nm_spi_set_pkt_sz((uint16)pkt_sizes[i]) != M2M_SUCCESS) {
+            printf("  nm_spi_set_pkt_sz(%u) failed\n", (unsigned)pkt_sizes[i]);
+            return -1;
+        }
+        printf("  %8u", (unsigned)pkt_sizes[i]);
+        for (size_t j = 0; j < sizeof(sweep_sizes) / sizeof(sweep_sizes[0]); j++) {
+            uint32 sz = sweep_sizes[j];
+
+            if (run_blocks(sz, (uint8)(i + j), &w, &r) != 0) return -1;
+            printf(" %10.2f", 2.0 * (double)sz * (double)w.ops /
+                              ((double)(w.bus.bytes + r.bus.bytes) * 8.0 / hz) / 1e6);
+        }
+        printf(" %12.2f %12.2f\n", mb_per_s(&w, sweep_sizes[2]), mb_per_s(&r, sweep_sizes[2]));
+    }
+
+    return nm_spi_set_pkt_sz(CONF_WINC_SPI_PKT_SZ);
+}
+
+static volatile int hif_responses;
+static tstrM2MConnInfo hif_conn_info;
+
+static void hif_wifi_cb(uint8 u8OpCode, uint16 u16DataSize, uint32 u32Addr)
+{
+    if (u8OpCode == M2M_WIFI_RESP_CONN_INFO && u16DataSize >= sizeof(hif_conn_info)) {
+        hif_receive(u32Addr, (uint8 *)&hif_conn_info, sizeof(hif_conn_info), 1);
+    } else {
+        hif_receive(0, NULL, 0, 1);
+    }
+    hif_responses++;
+}
+
+static void bench_hif(void)
+{
+    bench_sample_t s;
+    winc_sim_hif_stats_t hif;
+    uint64_t min_ns = UINT64_MAX;
+    uint64_t max_ns = 0;
+    uint64_t send_tr = 0, send_xfers = 0;
+    int done = 0;
+    sint8 ret = M2M_SUCCESS;
+
+    printf("HIF round trip (%d x GET_CONN_INFO -> RESP_CONN_INFO)\n", HIF_MESSAGES);
+
+    if (hif_init(NULL) != M2M_SUCCESS) {
+        printf("  hif_init failed\n");
+        return;
+    }
+    hif_register_cb(M2M_REQ_GROUP_WIFI, hif_wifi_cb);
+
+    sample_begin(&s);
+    for (done = 0; done < HIF_MESSAGES; done++) {
+        uint64_t start = now_ns();
+        int expected = hif_responses + 1;
+        uint32 tr = nm_bus_host_transactions();
+        uint64_t xfers = lb->stats.transfers;
+        ret = hif_send(M2M_REQ_GROUP_WIFI, M2M_WIFI_REQ_GET_CONN_INFO, NULL, 0, NULL, 0, 0);
+        if (ret != M2M_SUCCESS) break;
+        send_tr += nm_bus_host_transactions() - tr;
+        send_xfers += lb->stats.transfers - xfers;
+        while (hif_responses != expected && ret == M2M_SUCCESS) {
+            ret = hif_handle_isr();
+        }
+        if (ret != M2M_SUCCESS) break;
+        uint64_t rtt = now_ns() - start;
+        if (rtt < min_ns) min_ns = rtt;
+        if (rtt > max_ns) max_ns = rtt;
+    }
+    sample_end(&s, done ? done : 1);
+
+    if (ret != M2M_SUCCESS) {
+        printf("  failed after %d messages (%d)\n", done, ret);
+        return;
+    }
+    printf("  %10.0f msg/s, round trip %8.0f ns avg, %8.0f min, %8.0f max\n",
+           1e9 * s.ops / (double)s.total_ns, (double)s.total_ns / s.ops, (double)min_ns, (double)max_ns);
+    print_layers(&s);
+    printf("    hif_send: %.1f SPI transactions (%.1f transfers)\n", (double)send_tr / done,
+           (double)send_xfers / done);
+
+    // The same request laid out as a small socket send: control block, a gap
+    // up to the data offset, data. The simulator ignores the payload.
+    send_tr = send_xfers = 0;
+    for (done = 0; done < HIF_MESSAGES && ret == M2M_SUCCESS; done++) {
+        static uint8 ctrl[16], data[64];
+        int expected = hif_responses + 1;
+        uint32 tr = nm_bus_host_transactions();
+        uint64_t xfers = lb->stats.transfers;
+        ret = hif_send(M2M_REQ_GROUP_WIFI, M2M_WIFI_REQ_GET_CONN_INFO, ctrl, sizeof(ctrl),
+                       data, sizeof(data), 64);
+        if (ret != M2M_SUCCESS) break;
+        send_tr += nm_bus_host_transactions() - tr;
+        send_xfers += lb->stats.transfers - xfers;
+        while (hif_responses != expected && ret == M2M_SUCCESS) {
+            ret = hif_handle_isr();
+        }
+    }
+    if (ret != M2M_SUCCESS) {
+        printf("  send with data failed after %d messages (%d)\n", done, ret);
+        return;
+    }
+    printf("    hif_send, 16 B control and 64 B data: %.1f SPI transactions (%.1f transfers)\n",
+           (double)send_tr / done, (double)send_xfers / done);
+
+    winc_sim_hif_get_stats(sim, &hif);
+    printf("    simulator: %u requests, %u responses, %u alloc failures, %u unhandled, %u irqs, SSID \"%s\"\n",
+           (unsigned)hif.requests, (unsigned)hif.responses, (unsigned)hif.alloc_failures,
+           (unsigned)hif.unhandled, (unsigned)s.bus.irqs, hif_conn_info.acSSID);
+}
+
+static uint64_t now_us(void)
+{
+    return now_ns() / 1000u;
+}
+
+// Trace ring on its own: what a SIM_LOG() costs the simulator, and what the
+// consumer pays later to take the records out and format them. SIM_LOG() is
+// compiled out in this build, so this calls sim_log_write() directly on a
+// ring of its own.
+static void bench_trace(void)
+{
+    static sim_log_t ring;
+    static sim_log_record_t out[SIM_LOG_RING_SIZE];
+    sim_log_stats_t stats;
+    uint64_t write_ns = 0, read_ns = 0, format_ns = 0;
+    char line[128];
+    volatile int sink = 0;
+
+    printf("Trace ring (%d records, %d per batch)\n", TRACE_ITERATIONS, SIM_LOG_RING_SIZE);
+    sim_log_init(&ring, now_us, 0);
+    for (int done = 0; done < TRACE_ITERATIONS; done += SIM_LOG_RING_SIZE) {
+        uint64_t t = now_ns();
+        for (uint32_t i = 0; i < SIM_LOG_RING_SIZE; i++) {
+            sim_log_write(&ring, SIM_EVENT_SINGLE_READ, 0x1000 + i, i);
+        }
+        write_ns += now_ns() - t;
+
+        t = now_ns();
+        uint32_t n = sim_log_read(&ring, out, SIM_LOG_RING_SIZE);
+        read_ns += now_ns() - t;
+
+        // Formatting is the deferred part, sample one batch in 16
+        if ((done / SIM_LOG_RING_SIZE) % 16 == 0) {
+            t = now_ns();
+            for (uint32_t i = 0; i < n; i++) {
+                sink += sim_log_format(&out[i], 0, line, sizeof(line));
+            }
+            format_ns += (now_ns() - t) * 16;
+        }
+    }
+
+    // One extra record over a full ring shows the drop counter
+    for (uint32_t i = 0; i <= SIM_LOG_RING_SIZE; i++) {
+        sim_log_write(&ring, SIM_EVENT_SINGLE_READ, i, 0);
+    }
+    sim_log_get_stats(&ring, &stats);
+    sim_log_read(&ring, out, SIM_LOG_RING_SIZE);
+
+    printf("  write  %6.1f ns/record (with the clock)\n", (double)write_ns / TRACE_ITERATIONS);
+    printf("  read   %6.1f ns/record\n", (double)read_ns / TRACE_ITERATIONS);
+    printf("  format %6.1f ns/record, e.g. \"%s\"\n", (double)format_ns / TRACE_ITERATIONS, line);
+    printf("    ring: %u records written, %u dropped\n", (unsigned)stats.written, (unsigned)stats.dropped);
+}
+
+static int bench_sockets(void)
+{
+    static const struct {
+        const char *name;
+        winc_sim_net_t net;
+        uint32 iterations;
+    } models[] = {
+        { "no delay", { 0, 0 }, SOCKET_ITERATIONS },
+        { "2 ms RTT, 10 Mbit/s", { 2000, 10000 }, SOCKET_ITERATIONS / 20 },
+    };
+    winc_socket_bench_cfg_t cfg = {
+        .now_us = now_us,
+        .idle = bus_poll,
+        .server_ip = 0x0100007f, // 127.0.0.1, any address reaches the services
+    };
+    winc_sim_socket_stats_t stats;
+
+    socketInit();
+    for (uint32 i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+        printf("Sockets, %s\n", models[i].name);
+        winc_sim_socket_set_net(sim, &models[i].net);
+        cfg.iterations = models[i].iterations;
+        if (winc_socket_bench_run(&cfg) != 0) return -1;
+    }
+
+    winc_sim_socket_get_stats(sim, &stats);
+    printf("    simulator: %u connects, %u bytes sent, %u bytes received, %u dropped, %u unhandled\n",
+           (unsigned)stats.connects, (unsigned)stats.tx_bytes, (unsigned)stats.rx_bytes,
+           (unsigned)stats.tx_dropped, (unsigned)stats.unhandled);
+    return 0;
+}
+
+// Time-to-IP follows winc_driver_app.c: scan all channels, fetch the results
+// one by one until the SSID matches, connect and wait for the DHCP lease
+static struct {
+    volatile uint64_t scan_done;
+    volatile uint64_t found;
+    volatile uint64_t connected;
+    volatile uint64_t ip;
+    volatile bool disconnected;
+    volatile bool failed;
+    uint8 num_aps;
+    uint8 index;
+    uint32 results;
+} wifi;
+
+static void bench_wifi_cb(uint8 u8MsgType, void *pvMsg)
+{
+    switch (u8MsgType) {
+    case M2M_WIFI_RESP_SCAN_DONE:
+        wifi.scan_done = now_us();
+        wifi.num_aps = ((tstrM2mScanDone *)pvMsg)->u8NumofCh;
+        wifi.index = 0;
+        if (wifi.num_aps == 0 || m2m_wifi_req_scan_result(0) != M2M_SUCCESS) wifi.failed = true;
+        break;
+    case M2M_WIFI_RESP_SCAN_RESULT: {
+        tstrM2mWifiscanResult *result = (tstrM2mWifiscanResult *)pvMsg;
+        wifi.results++;
+        if (strcmp((const char *)result->au8SSID, SIMULATOR_WIFI_SSID) == 0) {
+            wifi.found = now_us();
+            if (m2m_wifi_connect((char *)SIMULATOR_WIFI_SSID, strlen(SIMULATOR_WIFI_SSID), M2M_WIFI_SEC_WPA_PSK,
+                                 (void *)SIMULATOR_WIFI_PASSPHRASE, M2M_WIFI_CH_ALL) != M2M_SUCCESS) {
+                wifi.failed = true;
+            }
+        } else if (++wifi.index >= wifi.num_aps || m2m_wifi_req_scan_result(wifi.index) != M2M_SUCCESS) {
+            wifi.failed = true;
+        }
+        break;
+    }
+    case M2M_WIFI_RESP_CON_STATE_CHANGED:
+        if (((tstrM2mWifiStateChanged *)pvMsg)->u8CurrState == M2M_WIFI_CONNECTED) {
+            wifi.connected = now_us();
+        } else {
+            wifi.disconnected = true;
+            if (wifi.ip == 0) wifi.failed = true;
+        }
+        break;
+    case M2M_WIFI_REQ_DHCP_CONF: {
+        // Catches a tstrM2MIPConfig layout the driver does not expect
+        const uint8 *ip = (const uint8 *)&((tstrM2MIPConfig *)pvMsg)->u32StaticIP;
+        const uint8 *mask = (const uint8 *)&((tstrM2MIPConfig *)pvMsg)->u32SubnetMask;
+        if (ip[0] != 192 || mask[0] != 255 || mask[3] != 0) wifi.failed = true;
+        wifi.ip = now_us();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static int wifi_wait(volatile uint64_t *stamp, volatile bool *flag)
+{
+    uint64_t start = now_us();
+    while ((stamp ? *stamp == 0 : !*flag) && !wifi.failed) {
+        m2m_wifi_handle_events(NULL);
+        bus_poll();
+        if (now_us() - start > WIFI_TIMEOUT_US) return -1;
+    }
+    return wifi.failed ? -1 : 0;
+}
+
+static int bench_wifi(void)
+{
+    static const struct {
+        const char *name;
+        winc_sim_wifi_timing_t timing;
+        uint32 iterations;
+    } models[] = {
+        { "no delay", { 0, 0, 0 }, WIFI_ITERATIONS },
+        { "scan 14 x 2 ms, connect 20 ms, DHCP 10 ms", { 2000, 20000, 10000 }, WIFI_ITERATIONS / 20 },
+    };
+    tstrWifiInitParam param;
+    winc_sim_wifi_stats_t stats;
+
+    memset(&param, 0, sizeof(param));
+    param.pfAppWifiCb = bench_wifi_cb;
+    if (m2m_wifi_init(&param) != M2M_SUCCESS) {
+        printf("m2m_wifi_init failed\n");
+        return -1;
+    }
+
+    for (uint32 m = 0; m < sizeof(models) / sizeof(models[0]); m++) {
+        const winc_sim_wifi_timing_t *t = &models[m].timing;
+        uint64_t scan_us = 0, walk_us = 0, connect_us = 0, dhcp_us = 0;
+        uint32 results = 0;
+        bench_sample_t s;
+
+        printf("Time to IP, %s\n", models[m].name);
+        winc_sim_wifi_set_timing(sim, t);
+        sample_begin(&s);
+        for (uint32 n = 0; n < models[m].iterations; n++) {
+            memset(&wifi, 0, sizeof(wifi));
+            uint64_t start = now_us();
+            if (m2m_wifi_request_scan(M2M_WIFI_CH_ALL) != M2M_SUCCESS || wifi_wait(&wifi.ip, NULL) != 0) {
+                printf("  no IP after %u results\n", (unsigned)wifi.results);
+                return -1;
+            }
+            scan_us += wifi.scan_done - start;
+            walk_us += wifi.found - wifi.scan_done;
+            connect_us += wifi.connected - wifi.found;
+            dhcp_us += wifi.ip - wifi.connected;
+            results += wifi.results;
+
+            // Not timed, leaves the station ready for the next round. The
+            // last one stays connected for the benches that follow.
+            if (m + 1 == sizeof(models) / sizeof(models[0]) && n + 1 == models[m].iterations) break;
+            uint64_t pause = now_us();
+            if (m2m_wifi_disconnect() != M2M_SUCCESS || wifi_wait(NULL, &wifi.disconnected) != 0) {
+                printf("  disconnect failed\n");
+                return -1;
+            }
+            s.total_ns += (now_us() - pause) * 1000u;
+        }
+        sample_end(&s, models[m].iterations);
+
+        double iterations = models[m].iterations;
+        double total = (double)(scan_us + walk_us + connect_us + dhcp_us) / iterations;
+        double air = (double)t->scan_channel_us * 14 + t->connect_us + t->dhcp_us;
+        printf("  scan             %10.1f us\n", scan_us / iterations);
+        printf("  walk results     %10.1f us  (%.1f results)\n", walk_us / iterations, results / iterations);
+        printf("  connect          %10.1f us\n", connect_us / iterations);
+        printf("  DHCP             %10.1f us\n", dhcp_us / iterations);
+        printf("  time to IP       %10.1f us  (%.1f us over the modelled air time)\n", total, total - air);
+        if (air == 0) {
+            print_layers(&s);
+        }
+    }
+
+    winc_sim_wifi_get_stats(sim, &stats);
+    printf("    simulator: %u scans, %u results, %u connects, %u failed, %u leases, %u unhandled\n",
+           (unsigned)stats.scans, (unsigned)stats.scan_results, (unsigned)stats.connects,
+           (unsigned)stats.connect_failures, (unsigned)stats.leases, (unsigned)stats.unhandled);
+    return 0;
+}
+
+// Unsolicited receive traffic: the generator answers the recv() each socket
+// keeps posted and sends WIFI events in between, the callbacks count what
+// reaches the application
+static struct {
+    volatile uint32 connected;
+    volatile uint32 recv_events;
+    volatile uint32 wifi_events;
+    volatile uint32 errors;
+} traffic;
+
+static uint8 traffic_buf[SOCKET_BUFFER_MAX_LENGTH];
+
+static void traffic_socket_cb(SOCKET sock, uint8 u8Msg, void *pvMsg)
+{
+    if (u8Msg == SOCKET_MSG_CONNECT) {
+        if (((tstrSocketConnectMsg *)pvMsg)->s8Error == SOCK_ERR_NO_ERROR) traffic.connected++;
+        else traffic.errors++;
+    } else if (u8Msg == SOCKET_MSG_RECV) {
+        if (((tstrSocketRecvMsg *)pvMsg)->s16BufferSize > 0) traffic.recv_events++;
+        else traffic.errors++;
+        // All sockets share the buffer, the data is not looked at
+        if (recv(sock, traffic_buf, sizeof(traffic_buf), 0) != SOCK_ERR_NO_ERROR) traffic.errors++;
+    }
+}
+
+static void traffic_wifi_cb(uint8 u8OpCode, uint16 u16DataSize, uint32 u32Addr)
+{
+    if (u8OpCode == M2M_WIFI_RESP_GET_SYS_TIME) traffic.wifi_events++;
+    hif_receive(0, NULL, 0, 1);
+}
+
+// Pump the driver for us, or while the generator runs if us is 0. Returns the
+// longest m2m_wifi_handle_events() call: hif_handle_isr() keeps going as long
+// as interrupts arrive, so under a flood one call can take the whole run.
+static uint64_t traffic_pump(uint32 us)
+{
+    uint64_t start = now_us();
+    uint64_t longest = 0;
+    while (us ? now_us() - start < us : winc_sim_traffic_running(sim)) {
+        uint64_t call = now_us();
+        m2m_wifi_handle_events(NULL);
+        call = now_us() - call;
+        if (call > longest) longest = call;
+        bus_poll();
+    }
+    return longest;
+}
+
+static int bench_traffic(void)
+{
+    static const struct {
+        const char *name;
+        winc_sim_traffic_cfg_t cfg;
+    } models[] = {
+        { "20000 events/s in bursts of 4", { 20000, 4, 90, 64, 1400, 100000, TRAFFIC_RUN_US, 1 } },
+        { "flood, bursts of 8", { 10000000, 8, 90, 64, 1400, 100000, TRAFFIC_RUN_US, 1 } },
+    };
+    SOCKET socks[TRAFFIC_SOCKETS];
+    struct sockaddr_in addr;
+    int ret = 0;
+
+    memset(&traffic, 0, sizeof(traffic));
+    registerSocketCallback(traffic_socket_cb, NULL);
+    hif_register_cb(M2M_REQ_GROUP_WIFI, traffic_wifi_cb);
+
+    addr.sin_family = AF_INET;
+    addr.sin_port = _htons(WINC_SIM_SOCKET_PORT_DISCARD);
+    addr.sin_addr.s_addr = 0x0100007f;
+    for (uint32 i = 0; i < TRAFFIC_SOCKETS; i++) {
+        socks[i] = socket(AF_INET, SOCK_STREAM, 0);
+        if (socks[i] < 0 || sock_connect(socks[i], (struct sockaddr *)&addr, sizeof(addr)) != SOCK_ERR_NO_ERROR) {
+            printf("Traffic: socket setup failed\n");
+            return -1;
+        }
+    }
+    traffic_pump(TRAFFIC_DRAIN_US);
+    if (traffic.connected != TRAFFIC_SOCKETS) {
+        printf("Traffic: %u of %u sockets connected\n", (unsigned)traffic.connected, TRAFFIC_SOCKETS);
+        return -1;
+    }
+    for (uint32 i = 0; i < TRAFFIC_SOCKETS; i++) {
+        recv(socks[i], traffic_buf, sizeof(traffic_buf), 0);
+    }
+
+    for (uint32 m = 0; m < sizeof(models) / sizeof(models[0]) && ret == 0; m++) {
+        winc_sim_hif_stats_t hif0, hif1;
+        winc_sim_loopback_stats_t bus;
+        winc_sim_traffic_stats_t gen;
+        uint32_t taken0, dropped0, taken1, dropped1;
+        uint32 recv0 = traffic.recv_events, wifi0 = traffic.wifi_events;
+
+        printf("Unsolicited traffic, %s\n", models[m].name);
+        winc_sim_hif_get_stats(sim, &hif0);
+        nm_bsp_host_get_irq_stats(&taken0, &dropped0);
+        winc_sim_loopback_reset_stats(lb);
+
+        uint64_t start = now_us();
+        winc_sim_traffic_start(sim, &models[m].cfg);
+        uint64_t longest = traffic_pump(0);
+        winc_sim_traffic_get_stats(sim, &gen);
+        uint64_t run_us = now_us() - start;
+        traffic_pump(TRAFFIC_DRAIN_US);
+
+        winc_sim_hif_get_stats(sim, &hif1);
+        nm_bsp_host_get_irq_stats(&taken1, &dropped1);
+        winc_sim_loopback_get_stats(lb, &bus);
+
+        uint32 delivered = (traffic.recv_events - recv0) + (traffic.wifi_events - wifi0);
+        uint32 raised = hif1.irqs - hif0.irqs;
+        uint32 serviced = hif1.responses - hif0.responses;
+        double secs = (double)run_us / 1e6;
+        printf("  generated        %10.0f events/s  (%u socket, %u WIFI, %.1f MB/s socket data)\n",
+               (gen.recv_events + gen.wifi_events) / secs, (unsigned)gen.recv_events,
+               (unsigned)gen.wifi_events, gen.recv_bytes / secs / 1e6);
+        printf("  delivered        %10.0f events/s  (%u to the callbacks)\n", delivered / secs, (unsigned)delivered);
+        printf("  dropped          %u no recv posted, %u HIF pool full, %u late ticks\n",
+               (unsigned)gen.dropped_no_recv, (unsigned)gen.dropped_full, (unsigned)gen.late_ticks);
+        printf("  interrupts       %u raised, %u edges, %u ISRs, %u dropped while disabled, %u coalesced\n",
+               (unsigned)raised, (unsigned)bus.irqs, (unsigned)(taken1 - taken0), (unsigned)(dropped1 - dropped0),
+               (unsigned)(raised - (uint32)bus.irqs));
+        printf("  queueing delay   %10.1f us avg, %u us max (all messages so far), %u stalls\n",
+               serviced ? (double)(hif1.wait_total_us - hif0.wait_total_us) / serviced : 0.0,
+               (unsigned)hif1.wait_max_us, (unsigned)gen.stalls);
+        printf("  longest event loop call %8.1f us\n", (double)longest);
+
+        if (delivered != gen.recv_events + gen.wifi_events || traffic.errors != 0) {
+            printf("  %u events lost, %u errors\n", (unsigned)(gen.recv_events + gen.wifi_events - delivered),
+                   (unsigned)traffic.errors);
+            ret = -1;
+        }
+        if (winc_sim_loopback_irq_asserted(lb) || winc_sim_hif_pending_us(sim) != 0) {
+            printf("  IRQ line still asserted after the drain, interrupt lost\n");
+            ret = -1;
+        }
+    }
+
+    for (uint32 i = 0; i < TRAFFIC_SOCKETS; i++) {
+        close(socks[i]);
+    }
+    return ret;
+}
+
+// Raw single register access on a private loopback, without the driver: the
+// driver has one global bus, so it cannot show instances running side by
+// side. CRC7 is sent as zero, the simulator does not check it.
+typedef struct {
+    pthread_t thread;
+    uint8_t id;
+    uint32_t errors;
+} instance_job_t;
+
+static void *instance_run(void *arg)
+{
+    instance_job_t *job = arg;
+    winc_sim_loopback_t *chip = malloc(sizeof(*chip));
+    if (chip == NULL) {
+        job->errors = INSTANCE_ITERATIONS;
+        return NULL;
+    }
+    winc_sim_loopback_init(chip, job->id);
+
+    const uint32_t addr = SCRATCH_REG;
+    uint8_t wr[9] = {0xc9, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr};
+    uint8_t rd[5] = {0xca, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr};
+    uint8_t rsp[9];
+
+    for (uint32_t i = 0; i < INSTANCE_ITERATIONS; i++) {
+        uint32_t value = ((uint32_t)job->id << 24) | i;
+        wr[4] = (uint8_t)(value >> 24);
+        wr[5] = (uint8_t)(value >> 16);
+        wr[6] = (uint8_t)(value >> 8);
+        wr[7] = (uint8_t)value;
+        winc_sim_loopback_rw(chip, wr, NULL, sizeof(wr));
+        winc_sim_loopback_rw(chip, NULL, rsp, 2);
+        if (rsp[0] != 0xc9 || rsp[1] != 0x00) job->errors++;
+
+        winc_sim_loopback_rw(chip, rd, NULL, sizeof(rd));
+        winc_sim_loopback_rw(chip, NULL, rsp, 9);
+        uint32_t back = rsp[3] | ((uint32_t)rsp[4] << 8) | ((uint32_t)rsp[5] << 16) | ((uint32_t)rsp[6] << 24);
+        if (rsp[0] != 0xca || rsp[1] != 0x00 || rsp[2] != 0xf3 || back != value) job->errors++;
+    }
+
+    free(chip);
+    return NULL;
+}
+
+static int bench_instances(void)
+{
+    instance_job_t jobs[INSTANCE_THREADS];
+    double base = 0;
+
+    printf("Simulator instances (%d write+read pairs each, one thread per instance)\n", INSTANCE_ITERATIONS);
+    for (uint32_t threads = 1; threads <= INSTANCE_THREADS; threads *= 2) {
+        uint64_t t = now_ns();
+        for (uint32_t i = 0; i < threads; i++) {
+            jobs[i].id = (uint8_t)(i + 1);
+            jobs[i].errors = 0;
+            if (pthread_create(&jobs[i].thread, NULL, instance_run, &jobs[i]) != 0) {
+                printf("  pthread_create failed\n");
+                return -1;
+            }
+        }
+        uint32_t errors = 0;
+        for (uint32_t i = 0; i < threads; i++) {
+            pthread_join(jobs[i].thread, NULL);
+            errors += jobs[i].errors;
+        }
+        t = now_ns() - t;
+
+        if (errors != 0) {
+            printf("  %u instances: %u bad responses\n", (unsigned)threads, (unsigned)errors);
+            return -1;
+        }
+        double rate = (double)threads * INSTANCE_ITERATIONS * 2 * 1e9 / (double)t;
+        if (threads == 1) base = rate;
+        printf("  %u instances: %8.0f ops/s total (x%.2f)\n", (unsigned)threads, rate, rate / base);
+    }
+    return 0;
+}
+
+int main(void)
+{
+    lb = nm_bsp_host_loopback();
+    sim = &lb->sim;
+
+    nm_bsp_init();
+    if (nm_bus_iface_init(NULL) != M2M_SUCCESS) {
+        printf("Bus init failed\n");
+        return EXIT_FAILURE;
+    }
+    winc_sim_loopback_set_faults(lb, LINK_STABLE_HZ, LINK_FAULT_BYTES);
+    if (nm_spi_init() != M2M_SUCCESS) {
+        printf("Bus init failed\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("WINC host benchmark, chip id %08x\n", (unsigned)nm_read_reg(0x1000));
+    printf("SPI clock profiles: LOW %u Hz, HIGH %u Hz (link corrupts MISO above %u Hz)\n",
+           (unsigned)nm_bus_get_profile(0), (unsigned)nm_bus_get_profile(1), (unsigned)LINK_STABLE_HZ);
+
+    if (bench_registers() != 0) return EXIT_FAILURE;
+    bench_memmap();
+    bench_trace();
+    if (bench_blocks() != 0) return EXIT_FAILURE;
+    if (bench_crc() != 0) return EXIT_FAILURE;
+    if (bench_pkt_sz() != 0) return EXIT_FAILURE;
+    if (bench_recovery() != 0) return EXIT_FAILURE;
+    if (bench_wifi() != 0) return EXIT_FAILURE;
+    bench_hif();
+    if (bench_sockets() != 0) return EXIT_FAILURE;
+    if (bench_traffic() != 0) return EXIT_FAILURE;
+    if (bench_instances() != 0) return EXIT_FAILURE;
+
+    // Engine side of every transaction above, in loopback nanoseconds
+    winc_sim_latency_print(sim);
+
+    winc_sim_map_stats_t pages;
+    winc_sim_map_get_stats(sim, &pages);
+    printf("Simulator pages: %u of %u used (%u KB), %u allocation failures\n",
+           (unsigned)pages.pages_used, (unsigned)pages.pages_total,
+           (unsigned)(pages.pages_used * WINC_SIM_MAP_PAGE_SIZE / 1024), (unsigned)pages.alloc_failures);
+
+    nm_bus_iface_deinit();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <string.h>
+#include "m2m_wifi.h"
+#include "socket.h"
+#include "m2m_types.h"
+#include "winc_socket_bench.h"
+
+// The 19.3.0 driver (WiFi101 port) renamed connect() to avoid the libc name
+#ifdef M2M_DRIVER_VERSION_MINOR_NO
+#define sock_connect connectSocket
+#else
+#define sock_connect connect
+#endif
+
+#define PORT_ECHO           7
+#define PORT_DISCARD        9
+#define PORT_CHARGEN        19
+#define EVENT_TIMEOUT_US    2000000
+#define STREAM_BYTES        (1024 * 1024)
+
+static const uint16 echo_sizes[] = {16, 64, 256, 1024, 1400};
+
+static const winc_socket_bench_cfg_t *bench;
+static uint8 tx_buf[SOCKET_BUFFER_MAX_LENGTH];
+static uint8 rx_buf[SOCKET_BUFFER_MAX_LENGTH];
+
+// Filled by the socket callback
+static volatile sint8 connect_status;
+static volatile sint16 send_status;
+static volatile sint16 recv_status;
+static volatile uint32 recv_bytes;
+static volatile uint8 pending_msg;
+
+static void bench_socket_cb(SOCKET sock, uint8 u8Msg, void *pvMsg)
+{
+    switch (u8Msg) {
+    case SOCKET_MSG_CONNECT:
+        connect_status = ((tstrSocketConnectMsg *)pvMsg)->s8Error;
+        break;
+    case SOCKET_MSG_SEND:
+        send_status = *(sint16 *)pvMsg;
+        break;
+    case SOCKET_MSG_RECV: {
+        tstrSocketRecvMsg *msg = (tstrSocketRecvMsg *)pvMsg;
+        recv_status = msg->s16BufferSize;
+        if (msg->s16BufferSize > 0) {
+            recv_bytes += (uint32)msg->s16BufferSize;
+        }
+        break;
+    }
+    default:
+        return;
+    }
+    if (u8Msg == pending_msg) {
+        pending_msg = 0;
+    }
+}
+
+// Pump the driver until the callback has seen msg
+static int wait_for(uint8 msg)
+{
+    uint64_t start = bench->now_us();
+
+    while (pending_msg == msg) {
+        m2m_wifi_handle_events(NULL);
+        if (bench->idle) bench->idle();
+        if (bench->now_us() - start > EVENT_TIMEOUT_US) {
+            printf("  timed out waiting for socket message %u\n", msg);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static SOCKET open_tcp(uint16 port, uint64_t *connect_us)
+{
+    struct sockaddr_in addr;
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        printf("  socket() failed (%d)\n", sock);
+        return -1;
+    }
+
+    addr.sin_family = AF_INET;
+    addr.sin_port = _htons(port);
+    addr.sin_addr.s_addr = bench->server_ip;
+
+    uint64_t start = bench->now_us();
+    pending_msg = SOCKET_MSG_CONNECT;
+    if (sock_connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != SOCK_ERR_NO_ERROR || wait_for(SOCKET_MSG_CONNECT) != 0) {
+        close(sock);
+        return -1;
+    }
+    if (connect_status != SOCK_ERR_NO_ERROR) {
+        printf("  connect to port %u failed (%d)\n", port, connect_status);
+        close(sock);
+        return -1;
+    }
+    if (connect_us) *connect_us = bench->now_us() - start;
+    return sock;
+}
+
+static int send_one(SOCKET sock, uint16 len)
+{
+    pending_msg = SOCKET_MSG_SEND;
+    if (send(sock, tx_buf, len, 0) != SOCK_ERR_NO_ERROR || wait_for(SOCKET_MSG_SEND) != 0) return -1;
+    return send_status == (sint16)len ? 0 : -1;
+}
+
+// One recv() call may be answered in several pieces when the data arrives
+// in pieces, so keep asking until len bytes are in
+static int recv_all(SOCKET sock, uint16 len)
+{
+    recv_bytes = 0;
+    while (recv_bytes < len) {
+        pending_msg = SOCKET_MSG_RECV;
+        if (recv(sock, rx_buf, (uint16)(len - recv_bytes), EVENT_TIMEOUT_US / 1000) != SOCK_ERR_NO_ERROR ||
+            wait_for(SOCKET_MSG_RECV) != 0 || recv_status <= 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void print_rate(const char *what, uint32 ops, uint64_t bytes, uint64_t us)
+{
+    if (us == 0) us = 1;
+    printf("  %-16s %8.1f us/op  %8.0f ops/s  %8.2f MB/s\n", what,
+           (double)us / ops, 1e6 * ops / (double)us, (double)bytes / (double)us);
+}
+
+static int bench_echo(void)
+{
+    uint64_t connect_us = 0;
+    SOCKET sock = open_tcp(PORT_ECHO, &connect_us);
+    if (sock < 0) return -1;
+    printf("  connect          %8.1f us\n", (double)connect_us);
+
+    for (uint32 i = 0; i < sizeof(echo_sizes) / sizeof(echo_sizes[0]); i++) {
+        uint16 len = echo_sizes[i];
+        char what[32];
+        uint64_t start = bench->now_us();
+        for (uint32 n = 0; n < bench->iterations; n++) {
+            if (send_one(sock, len) != 0 || recv_all(sock, len) != 0) {
+                printf("  echo of %u bytes failed\n", len);
+                close(sock);
+                return -1;
+            }
+        }
+        if (memcmp(rx_buf, tx_buf, len) != 0) {
+            printf("  echo of %u bytes came back corrupted\n", len);
+            close(sock);
+            return -1;
+        }
+        snprintf(what, sizeof(what), "echo %u B", len);
+        print_rate(what, bench->iterations, (uint64_t)len * bench->iterations, bench->now_us() - start);
+    }
+    close(sock);
+    return 0;
+}
+
+static int bench_discard(void)
+{
+    SOCKET sock = open_tcp(PORT_DISCARD, NULL);
+    if (sock < 0) return -1;
+
+    uint32 ops = STREAM_BYTES / SOCKET_BUFFER_MAX_LENGTH;
+    uint64_t start = bench->now_us();
+    for (uint32 n = 0; n < ops; n++) {
+        if (send_one(sock, SOCKET_BUFFER_MAX_LENGTH) != 0) {
+            printf("  discard send failed\n");
+            close(sock);
+            return -1;
+        }
+    }
+    print_rate("discard send", ops, (uint64_t)ops * SOCKET_BUFFER_MAX_LENGTH, bench->now_us() - start);
+    close(sock);
+    return 0;
+}
+
+static int bench_chargen(void)
+{
+    SOCKET sock = open_tcp(PORT_CHARGEN, NULL);
+    if (sock < 0) return -1;
+
+    uint32 ops = STREAM_BYTES / SOCKET_BUFFER_MAX_LENGTH;
+    uint64_t start = bench->now_us();
+    for (uint32 n = 0; n < ops; n++) {
+        if (recv_all(sock, SOCKET_BUFFER_MAX_LENGTH) != 0) {
+            printf("  chargen recv failed\n");
+            close(sock);
+            return -1;
+        }
+    }
+    print_rate("chargen recv", ops, (uint64_t)ops * SOCKET_BUFFER_MAX_LENGTH, bench->now_us() - start);
+    close(sock);
+    return 0;
+}
+
+int winc_socket_bench_run(const winc_socket_bench_cfg_t *cfg)
+{
+    bench = cfg;
+    for (uint32 i = 0; i < sizeof(tx_buf); i++) {
+        tx_buf[i] = (uint8)(i * 7 + 1);
+    }
+    registerSocketCallback(bench_socket_cb, NULL);
+
+    if (bench_echo() != 0) return -1;
+    if (bench_discard() != 0) return -1;
+    if (bench_chargen() != 0) return -1;
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef WINC_SOCKET_BENCH_H
+#define WINC_SOCKET_BENCH_H
+
+#include <stdint.h>
+
+// Socket layer benchmark against the simulator's echo, discard and chargen
+// services (pico_winc_simulator/winc_sim_socket.h). Only uses the driver API,
+// so it runs the same in winc_host_bench and in the COMBINED app.
+
+typedef struct {
+    uint64_t (*now_us)(void);   // Microsecond clock
+    void (*idle)(void);         // Called while waiting for an event, may be NULL
+    uint32_t server_ip;         // Any address reaches the simulator's services
+    uint32_t iterations;        // Round trips per message size
+} winc_socket_bench_cfg_t;
+
+/**
+ * @brief Run connect, echo, discard and chargen measurements and print them
+ *
+ * Needs m2m_wifi_init() (or hif_init()) and socketInit(). Takes over the
+ * socket callbacks; register the application's again afterwards.
+ *
+ * @return 0 on success, -1 if a socket call failed or an event timed out
+ */
+int winc_socket_bench_run(const winc_socket_bench_cfg_t *cfg);
+
+#endif // WINC_SOCKET_BENCH_H
@@ -11,6 +11,106 @@
 #define RESET_PIN   21
 #define IRQ_PIN     22
 
+// Simulated chips on the Pico, each on a PIO block of its own, so at most 2.
+// The second one has its own bus: MOSI, CS and SCK must be consecutive.
+#ifndef SIMULATOR_INSTANCES
+#define SIMULATOR_INSTANCES 1
+#endif
+#define SIM2_MOSI_PIN   2
+#define SIM2_CS_PIN     3
+#define SIM2_SCK_PIN    4
+#define SIM2_MISO_PIN   5
+#define SIM2_IRQ_PIN    6
+
+// Simulated RAM is allocated in 4 KB pages on first write. Pages never written
+// read back as zeros and cost nothing. The pool is per instance.
+#ifndef SIMULATOR_PAGE_POOL_PAGES
+#ifdef WINC_HOST_BUILD
+#define SIMULATOR_PAGE_POOL_PAGES 256 // All of the simulated RAM
+#elif SIMULATOR_INSTANCES > 1
+#define SIMULATOR_PAGE_POOL_PAGES 12  // 48 KB each
+#else
+#define SIMULATOR_PAGE_POOL_PAGES 24  // 96 KB, leaves room for the driver in COMBINED builds
+#endif
+#endif
+
+// Network model of the emulated socket layer (winc_sim_socket.h). The
+// defaults answer immediately; set them to model a real link.
+#ifndef SIMULATOR_NET_LATENCY_US
+#define SIMULATOR_NET_LATENCY_US 0
+#endif
+#ifndef SIMULATOR_NET_BANDWIDTH_KBPS
+#define SIMULATOR_NET_BANDWIDTH_KBPS 0 // Unlimited
+#endif
+
+// Network the emulated station finds (winc_sim_wifi.h), among a few
+// neighbours. Match WIFI_SSID and WIFI_PASSWORD of the driver app.
+#ifndef SIMULATOR_WIFI_SSID
+#define SIMULATOR_WIFI_SSID "winc-sim"
+#endif
+#ifndef SIMULATOR_WIFI_PASSPHRASE
+#define SIMULATOR_WIFI_PASSPHRASE "winc-sim-pass"
+#endif
+
+// Air time of scan, connect and DHCP. The defaults answer immediately.
+#ifndef SIMULATOR_WIFI_SCAN_CHANNEL_US
+#define SIMULATOR_WIFI_SCAN_CHANNEL_US 0 // Per channel, a full scan covers 14
+#endif
+#ifndef SIMULATOR_WIFI_CONNECT_US
+#define SIMULATOR_WIFI_CONNECT_US 0
+#endif
+#ifndef SIMULATOR_WIFI_DHCP_US
+#define SIMULATOR_WIFI_DHCP_US 0
+#endif
+
+// Unsolicited HIF traffic (winc_sim_traffic.h), started with the firmware.
+// 0 events per second leaves it off.
+#ifndef SIMULATOR_TRAFFIC_RATE_HZ
+#define SIMULATOR_TRAFFIC_RATE_HZ 0
+#endif
+#ifndef SIMULATOR_TRAFFIC_BURST
+#define SIMULATOR_TRAFFIC_BURST 4
+#endif
+#ifndef SIMULATOR_TRAFFIC_RECV_PERCENT
+#define SIMULATOR_TRAFFIC_RECV_PERCENT 90 // Socket data, the rest WIFI events
+#endif
+#ifndef SIMULATOR_TRAFFIC_MIN_SIZE
+#define SIMULATOR_TRAFFIC_MIN_SIZE 64
+#endif
+#ifndef SIMULATOR_TRAFFIC_MAX_SIZE
+#define SIMULATOR_TRAFFIC_MAX_SIZE 1400
+#endif
+#ifndef SIMULATOR_TRAFFIC_STALL_US
+#define SIMULATOR_TRAFFIC_STALL_US 100000 // Interrupt pending this long counts as lost
+#endif
+
+// Period of the CPU utilization report on the Pico (winc_sim_cpu.h), in
+// multiples of 100 ms. 0 only reports when asked over stdio.
+#ifndef SIMULATOR_CPU_REPORT_MS
+#define SIMULATOR_CPU_REPORT_MS 5000
+#endif
+
+// Hardware alarm the simulator's event timer uses on the Pico. The SDK's
+// default alarm pool takes alarm 3.
+#ifndef SIMULATOR_ALARM_NUM
+#define SIMULATOR_ALARM_NUM 2
+#endif
+
+#ifndef SIMULATOR_SPI_LOG_ENABLE
 #define SIMULATOR_SPI_LOG_ENABLE 1
+#endif
+
+// Record what each instance's engine receives and sends for tools/spi_replay
+// (spi_capture.h), streamed as "#C1 ..." lines for the first instance.
+// Costs a 16 KB ring per instance.
+#ifndef SIMULATOR_CAPTURE_ENABLE
+#define SIMULATOR_CAPTURE_ENABLE 0
+#endif
+
+// Print the simulator's trace records as hex lines ("#L ...") instead of
+// text, for tools/sim_log_decode. Cheaper on the console.
+#ifndef SIMULATOR_LOG_RAW
+#define SIMULATOR_LOG_RAW 0
+#endif
 
 #endif /* _CONF_PICO_WINC_SIMULATOR_H_ */
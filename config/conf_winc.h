@@ -35,7 +35,147 @@ extern "C" {
 // <h> WINC Pico Specific Configuration
 // <q> CONF_WINC_USE_PICO
 // <i> Use Pico specific BSP and Bus Wrapper
+// <i> WINC_HOST_BUILD selects the Linux BSP and the simulator loopback instead
+#ifdef WINC_HOST_BUILD
+#define CONF_WINC_USE_HOST
+#else
 #define CONF_WINC_USE_PICO
+#endif
+// </h>
+
+// <h> WINC SPI Integrity Configuration
+// <q> CONF_WINC_SPI_CRC
+// <i> Protect commands with CRC7 and data packets with CRC16 (nm_spi_set_crc()
+// <i> switches it at runtime)
+#ifndef CONF_WINC_SPI_CRC
+#define CONF_WINC_SPI_CRC 1
+#endif
+// <q> CONF_WINC_CRC16_DMA_SNIFFER
+// <i> Compute the data CRC16 of longer packets with the RP2040 DMA sniffer
+// <i> instead of the CPU tables. Not with COMBINED_BUILD, the simulator owns
+// <i> the sniffer there.
+// #define CONF_WINC_CRC16_DMA_SNIFFER
+// </h>
+
+// <h> WINC SPI Transfer Configuration
+// <q> CONF_WINC_SPI_DMA
+// <i> Clock transfers of NM_BUS_DMA_MIN_SZ bytes and up with a TX/RX pair of
+// <i> DMA channels and sleep until the completion interrupt instead of
+// <i> spinning on the FIFOs. Data packets then run asynchronously, with the
+// <i> CRC16 computed while they are on the wire. 0 keeps the blocking SDK calls.
+#ifndef CONF_WINC_SPI_DMA
+#define CONF_WINC_SPI_DMA 1
+#endif
+// <o> CONF_WINC_SPI_MAX_TRX_SZ
+// <i> Largest SPI transaction the bus wrapper offers (tstrNmBusCapabilities).
+// <i> nm_read_block()/nm_write_block() split payloads into pieces of this size
+// <i> less 8, each with its own command, response and CS cycle. The default
+// <i> keeps a whole 8 KB data packet (CONF_WINC_SPI_PKT_SZ) in one piece.
+#ifndef CONF_WINC_SPI_MAX_TRX_SZ
+#define CONF_WINC_SPI_MAX_TRX_SZ 8192
+#endif
+// <q> CONF_WINC_SPI_PIPELINE
+// <i> Clock a register access's command and its whole expected response in
+// <i> one transfer instead of polling the response a byte at a time. The
+// <i> driver still polls if the chip answers later than expected.
+#ifndef CONF_WINC_SPI_PIPELINE
+#define CONF_WINC_SPI_PIPELINE 1
+#endif
+// <o> CONF_WINC_SPI_PKT_SZ
+// <i> Data packet size nm_spi_init() sets, 256 to 8192 bytes in powers of
+// <i> two. A block transfer sends each packet with its own header and CRC16.
+// <i> nm_spi_set_pkt_sz() changes it at runtime.
+#ifndef CONF_WINC_SPI_PKT_SZ
+#define CONF_WINC_SPI_PKT_SZ 8192
+#endif
+// </h>
+
+// <h> WINC SPI Clock Configuration
+// <o> CONF_WINC_SPI_LOW_HZ
+// <i> SCK rate of the LOW profile, nm_bus_speed(LOW) while the chip wakes up
+#ifndef CONF_WINC_SPI_LOW_HZ
+#define CONF_WINC_SPI_LOW_HZ 1000000
+#endif
+// <o> CONF_WINC_SPI_HIGH_HZ
+// <i> SCK rate of the HIGH profile until calibration picks one, and for good
+// <i> when calibration is off or fails. Defaults to the rate the driver's
+// <i> Pico bus wrapper always ran: 4 MHz for 19.7.7, 1 MHz for 19.3.0
+// <i> (nm_bsp_pico.h).
+// #define CONF_WINC_SPI_HIGH_HZ
+// <q> CONF_WINC_SPI_CAL
+// <i> Calibrate the HIGH profile in nm_spi_init(): ramp SCK from
+// <i> CONF_WINC_SPI_HIGH_HZ in CONF_WINC_SPI_CAL_STEP_HZ steps up to
+// <i> CONF_WINC_SPI_CAL_MAX_HZ, check each rate with a read-back pattern
+// <i> and keep the fastest one that passed, less CONF_WINC_SPI_CAL_MARGIN
+// <i> percent. Needs CONF_WINC_SPI_CRC, so a corrupted command is rejected
+// <i> by the chip rather than executed. Off by default: the ramp runs the
+// <i> bus up to the protocol's limit, which unknown wiring may not be rated
+// <i> for.
+#ifndef CONF_WINC_SPI_CAL
+#define CONF_WINC_SPI_CAL 0
+#endif
+// <q> CONF_WINC_SPI_CAL_STORE
+// <i> Keep the calibrated rate across boots, the next boot only checks it
+// <i> again. On the Pico it takes the flash sector at
+// <i> CONF_WINC_SPI_CAL_FLASH_OFFSET, which the application must reserve
+// <i> and which is erased and reprogrammed whenever the rate changes.
+#ifndef CONF_WINC_SPI_CAL_STORE
+#define CONF_WINC_SPI_CAL_STORE 0
+#endif
+// <o> CONF_WINC_SPI_CAL_FLASH_OFFSET
+// <i> Offset into flash of the sector CONF_WINC_SPI_CAL_STORE uses, sector
+// <i> aligned and past the image. No default, there is no sector every
+// <i> application can spare.
+// #define CONF_WINC_SPI_CAL_FLASH_OFFSET
+#ifndef CONF_WINC_SPI_CAL_MAX_HZ
+#define CONF_WINC_SPI_CAL_MAX_HZ 48000000
+#endif
+#ifndef CONF_WINC_SPI_CAL_STEP_HZ
+#define CONF_WINC_SPI_CAL_STEP_HZ 4000000
+#endif
+#ifndef CONF_WINC_SPI_CAL_MARGIN
+#define CONF_WINC_SPI_CAL_MARGIN 20
+#endif
+// <o> CONF_WINC_SPI_CAL_ADDR
+// <i> Word of chip RAM the read-back patterns go through, restored
+// <i> afterwards. The default is the start of the host shared memory
+// <i> (NMI_AHB_SHARE_MEM_BASE in m2m_hif.c), which the driver already uses
+// <i> as its buffer while the firmware is not running (HOST_SHARE_MEM_BASE
+// <i> in spi_flash.c). Calibration runs before the firmware starts.
+#ifndef CONF_WINC_SPI_CAL_ADDR
+#define CONF_WINC_SPI_CAL_ADDR 0xd0000
+#endif
+// <o> CONF_WINC_SPI_CAL_ROUNDS
+// <i> Passes of the read-back pattern (8 words written and read) per rate
+#ifndef CONF_WINC_SPI_CAL_ROUNDS
+#define CONF_WINC_SPI_CAL_ROUNDS 8
+#endif
+// </h>
+
+// <h> WINC SPI Error Recovery Configuration
+// <o> CONF_WINC_SPI_BACKOFF_MIN_US
+// <i> A failed access is resynced (CMD_RESET and idle clocks) and retried at
+// <i> once. Each further failure of the same access waits first, this long
+// <i> the first time and twice as long every time after, up to
+// <i> CONF_WINC_SPI_BACKOFF_MAX_US.
+#ifndef CONF_WINC_SPI_BACKOFF_MIN_US
+#define CONF_WINC_SPI_BACKOFF_MIN_US 50
+#endif
+#ifndef CONF_WINC_SPI_BACKOFF_MAX_US
+#define CONF_WINC_SPI_BACKOFF_MAX_US 2000
+#endif
+// <o> CONF_WINC_SPI_HEALTH_REGEN_MS
+// <i> Every failure costs the bus health a fifth of its maximum, which comes
+// <i> back a point per CONF_WINC_SPI_HEALTH_REGEN_MS without failures
+#ifndef CONF_WINC_SPI_HEALTH_REGEN_MS
+#define CONF_WINC_SPI_HEALTH_REGEN_MS 10
+#endif
+// <o> CONF_WINC_SPI_DOWNSHIFT
+// <i> Percent the HIGH clock profile is lowered by when the bus health runs
+// <i> out, not below the LOW rate. 0 keeps the clock.
+#ifndef CONF_WINC_SPI_DOWNSHIFT
+#define CONF_WINC_SPI_DOWNSHIFT 25
+#endif
 // </h>
 
 // <h> WINC Debug Configuration
@@ -43,10 +183,38 @@ extern "C" {
 // <i> Enable WINC debug prints
 
 #define CONF_WINC_DEBUG 1
-#define M2M_LOG_LEVEL 4
+// The M2M_* prints go straight to stdio. DBG and REQ are off, the bus path
+// reports through the trace below instead.
+#ifndef M2M_LOG_LEVEL
+#define M2M_LOG_LEVEL 2
+#endif
 #define CONF_WINC_PRINTF printf
 
-#define DRIVER_SPI_LOG_ENABLE 1
+// <o> DRIVER_TRACE_CATEGORIES
+// <i> NM_TRACE_SPI | NM_TRACE_BUS | NM_TRACE_HIF (nm_trace.h): trace points
+// <i> of these categories and of DRIVER_TRACE_LEVEL or lower store binary
+// <i> records in a RAM ring, printed by nm_trace_drain() from the main loop
+// <i> (the host after each transfer). The others compile to nothing; 0 also
+// <i> leaves out the ring.
+#ifndef DRIVER_TRACE_CATEGORIES
+#define DRIVER_TRACE_CATEGORIES 0
+#endif
+#ifndef DRIVER_TRACE_LEVEL
+#define DRIVER_TRACE_LEVEL M2M_LOG_DBG
+#endif
+
+// Record every nm_spi_rw() for tools/spi_replay (spi_capture.h). The Pico
+// streams the records from the driver's main loop, the host after each
+// transfer.
+#ifndef DRIVER_SPI_CAPTURE_ENABLE
+#define DRIVER_SPI_CAPTURE_ENABLE 0
+#endif
+
+// Print the SPI bus utilization (time SCK runs, from the bytes clocked and the
+// baud rate) every DRIVER_BUS_REPORT_MS, 0 (the default) disables it
+#ifndef DRIVER_BUS_REPORT_MS
+#define DRIVER_BUS_REPORT_MS 0
+#endif
 
 #ifdef __cplusplus
 }
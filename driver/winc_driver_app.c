@@ -9,6 +9,11 @@
 #include "iot/http/http_client.h" // New include for HTTP client
 #include "wifi_credentials.h"
 #include "winc_driver_app.h"
+#ifdef WINC_SOCKET_BENCH
+#include "winc_socket_bench.h"
+#endif
+#include "bsp/include/nm_bsp_pico.h"
+#include "common/include/nm_trace.h"
 
 #define MAIN_HTTP_CLIENT_URL "httpbin.org"
 #define MAIN_HTTP_CLIENT_PATH "/anything"
@@ -27,6 +32,7 @@ volatile bool is_connected = false;
 
 static uint8_t u8NumFoundAPs = 0;
 static uint8_t u8ScanResultIdx = 0;
+static uint64_t scan_start_us = 0; // First scan request, for the time to IP
 
 static void wifi_callback(uint8_t u8MsgType, void *pvMsg)
 {
@@ -55,6 +61,7 @@ static void wifi_callback(uint8_t u8MsgType, void *pvMsg)
     {
         uint8 *pu8IPAddress = (uint8 *)pvMsg;
         printf("Wi-Fi IP Address is %u.%u.%u.%u\n", pu8IPAddress[0], pu8IPAddress[1], pu8IPAddress[2], pu8IPAddress[3]);
+        printf("Time to IP: %llu us\n", (unsigned long long)(time_us_64() - scan_start_us));
         host_ip = 1; // Indicate that we have an IP address
         break;
     }
@@ -161,6 +168,31 @@ static void wrapped_socket_resolve_handler(uint8_t *doamin_name, uint32_t server
     http_client_socket_resolve_handler(doamin_name, server_ip);
 }
 
+#if DRIVER_BUS_REPORT_MS
+// Share of the time since the last report that SCK was running
+static void bus_report(void)
+{
+    static tstrNmBusStats last;
+    static uint64_t last_us;
+    tstrNmBusStats stats;
+    uint64_t now_us = time_us_64();
+
+    nm_bus_get_stats(&stats);
+    uint32_t bytes = stats.u32Bytes - last.u32Bytes;
+    // Per mille, no floating point on the M0+: bits clocked over the bits the
+    // interval had room for
+    uint64_t room = (uint64_t)stats.u32Hz * (now_us - last_us);
+    uint32_t busy = room ? (uint32_t)((uint64_t)bytes * 8u * 1000000000ull / room) : 0;
+
+    printf("[DRIVER] SPI bus: %lu transfers (%lu DMA), %lu bytes, %lu.%lu%% busy at %lu kHz\n",
+           (unsigned long)(stats.u32Transfers - last.u32Transfers),
+           (unsigned long)(stats.u32DmaTransfers - last.u32DmaTransfers), (unsigned long)bytes,
+           (unsigned long)(busy / 10), (unsigned long)(busy % 10), (unsigned long)(stats.u32Hz / 1000));
+    last = stats;
+    last_us = now_us;
+}
+#endif
+
 int winc_driver_app_main()
 {
     stdio_init_all();
@@ -184,6 +216,21 @@ int winc_driver_app_main()
     socketInit(); // Explicitly call socketInit()
 
     printf("WINC driver initialized\n");
+
+#ifdef WINC_SOCKET_BENCH
+    // Socket layer numbers against the simulator on core 1, see bench/winc_socket_bench.h
+    winc_socket_bench_cfg_t bench_cfg = {
+        .now_us = time_us_64,
+        .server_ip = 0x0100007f,
+        .iterations = 200,
+    };
+    if (winc_socket_bench_run(&bench_cfg) != 0) {
+        printf("Socket benchmark failed\n");
+    }
+#endif
+#if DRIVER_BUS_REPORT_MS
+    bus_report();
+#endif
     
     // Initialize the HTTP client module.
     struct http_client_config client_config;
@@ -202,11 +249,28 @@ int winc_driver_app_main()
 
     // Start Wi-Fi scan
     printf("Starting Wi-Fi scan...\n");
+    scan_start_us = time_us_64();
     m2m_wifi_request_scan(M2M_WIFI_CH_ALL);
 
+#if DRIVER_BUS_REPORT_MS
+    uint64_t next_report_us = time_us_64() + DRIVER_BUS_REPORT_MS * 1000ull;
+#endif
+
     while (true)
     {
         m2m_wifi_handle_events(NULL);
+#if DRIVER_SPI_CAPTURE_ENABLE
+        nm_bus_capture_drain();
+#endif
+#if DRIVER_TRACE_CATEGORIES
+        nm_trace_drain(DRIVER_TRACE_RING_SIZE);
+#endif
+#if DRIVER_BUS_REPORT_MS
+        if (time_us_64() >= next_report_us) {
+            bus_report();
+            next_report_us += DRIVER_BUS_REPORT_MS * 1000ull;
+        }
+#endif
 
 
 
@@ -107,7 +107,12 @@ typedef unsigned short	uint16;
  * @typedef      unsigned long	uint32;
  * @brief        Range of values between 0 to 4294967295
  */
+#ifdef __LP64__
+/* Host builds: long is 64 bits wide on LP64 */
+typedef unsigned int	uint32;
+#else
 typedef unsigned long	uint32;
+#endif
 
 
   /*!
@@ -130,7 +135,11 @@ typedef signed short	sint16;
  * @brief        Range of values between -2147483648 to 2147483647
  */
 
+#ifdef __LP64__
+typedef signed int		sint32;
+#else
 typedef signed long		sint32;
+#endif
  //@}
 
 #ifndef CORTUS_APP
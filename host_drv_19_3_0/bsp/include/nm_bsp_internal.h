@@ -50,6 +50,8 @@
 
 #ifdef CONF_WINC_USE_PICO
 #include "bsp/include/nm_bsp_pico.h"
+#elif defined(CONF_WINC_USE_HOST)
+#include "bsp/include/nm_bsp_host.h"
 #else
 #ifdef ARDUINO_ARCH_AVR
 #define LIMITED_RAM_DEVICE
@@ -11,4 +11,72 @@
 #define NM_DEBUG CONF_WINC_DEBUG
 #define NM_BSP_PRINTF CONF_WINC_PRINTF
 
+#ifdef CONF_WINC_CRC16_DMA_SNIFFER
+#ifdef COMBINED_BUILD
+#error "CONF_WINC_CRC16_DMA_SNIFFER: the simulator owns the DMA sniffer in COMBINED_BUILD"
+#endif
+// Blocks from this size up get their data CRC16 from the DMA sniffer
+#define NM_BSP_CRC16_MIN_SZ 64
+uint16 nm_bsp_crc16(uint16 u16Crc, const uint8 *pu8Buf, uint32 u32Sz);
+#endif
+
+#if CONF_WINC_SPI_DMA
+// Smallest transfer worth the DMA setup, shorter ones use the blocking SDK calls
+#define NM_BUS_DMA_MIN_SZ 16
+
+// Asynchronous transfers, used by nmspi.c for the data packets. Only one can
+// be in flight and nm_spi_rw() must not be called before nm_spi_rw_wait().
+#define NM_BUS_ASYNC
+// Drop CS and start the DMA, the completion interrupt releases CS
+sint8 nm_spi_rw_start(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz);
+// Bytes of the running transfer already in pu8Miso
+uint16 nm_spi_rw_progress(void);
+// Sleep until the transfer is done
+sint8 nm_spi_rw_wait(void);
+#endif
+
+typedef struct {
+    uint32 u32Transfers;    // nm_spi_rw() and nm_spi_rw_start() calls
+    uint32 u32DmaTransfers; // Of those, clocked by DMA
+    uint32 u32Bytes;        // Bytes clocked, wraps around
+    uint32 u32Hz;           // SCK rate
+} tstrNmBusStats;
+
+// Counters since nm_bus_init(). Bytes * 8 / u32Hz is the time the bus was busy.
+void nm_bus_get_stats(tstrNmBusStats *pstrStats);
+
+// HIGH profile rate this driver's bus wrapper always ran at
+#ifndef CONF_WINC_SPI_HIGH_HZ
+#define CONF_WINC_SPI_HIGH_HZ 1000000
+#endif
+
+// SCK rates of the LOW (0) and HIGH (1) profiles nm_bus_speed() switches
+// between. Setting the profile in use changes the clock at once and returns
+// the rate the SPI block can really run, otherwise the rate asked for.
+#define NM_BUS_PROFILES
+uint32 nm_bus_set_profile(uint8 u8Level, uint32 u32Hz);
+uint32 nm_bus_get_profile(uint8 u8Level);
+
+// Microsecond clock, wrapping, and delay for the SPI error recovery
+#define NM_BSP_TIME_US
+uint32 nm_bsp_time_us(void);
+void nm_bsp_sleep_us(uint32 u32TimeUsec);
+
+#if CONF_WINC_SPI_CAL
+// nm_spi_init() calibrates the HIGH profile
+#define NM_BUS_CALIBRATE
+#if CONF_WINC_SPI_CAL_STORE
+// HIGH rate calibrated for this chip id on an earlier boot, 0 if none. Kept
+// in the flash sector at CONF_WINC_SPI_CAL_FLASH_OFFSET.
+#define NM_BUS_CAL_STORE
+uint32 nm_bsp_spi_cal_load(uint32 u32ChipId);
+void nm_bsp_spi_cal_store(uint32 u32ChipId, uint32 u32Hz);
+#endif
+#endif
+
+#if DRIVER_SPI_CAPTURE_ENABLE
+// Stream the SPI transfers captured by nm_spi_rw() to stdio, see spi_capture.h
+void nm_bus_capture_drain(void);
+#endif
+
 #endif /* _NM_BSP_PICO_H_ */
@@ -0,0 +1,207 @@
+#include "bsp/include/nm_bsp.h"
+#include "common/include/nm_common.h"
+#include "bus_wrapper/include/nm_bus_wrapper.h"
+#include "bsp/include/nm_bsp_host.h"
+#include "conf_winc.h"
+#include "winc_sim_loopback.h"
+#include "sim_log.h"
+#include "spi_capture.h"
+#include "common/include/nm_trace.h"
+#include <stdio.h>
+
+// Bus wrapper for running the driver as a Linux process: every SPI transfer is
+// clocked straight through the simulator engine instead of a real SPI master.
+
+#define NM_BUS_MAX_TRX_SZ CONF_WINC_SPI_MAX_TRX_SZ
+
+tstrNmBusCapabilities egstrNmBusCapabilities = {
+    NM_BUS_MAX_TRX_SZ};
+
+// SCK rates of the LOW and HIGH profiles and the one in use. The loopback is
+// told the rate, it moves the bytes without one.
+static uint32 gau32ProfileHz[2] = {CONF_WINC_SPI_LOW_HZ, CONF_WINC_SPI_HIGH_HZ};
+static uint8 gu8Level = 1;
+
+// What the Pico would frame with CS: a transfer on its own or a whole
+// gathered one, see nm_bus_host_transactions()
+static uint32 gu32Transactions;
+static uint8 gu8InSg;
+
+#if DRIVER_SPI_CAPTURE_ENABLE
+static spi_capture_t gstrCapture;
+#endif
+#if SIMULATOR_CAPTURE_ENABLE
+// The engine's view of the same transfers, as the Pico simulator records it
+static spi_capture_t gstrSimCapture;
+#endif
+
+sint8 nm_spi_rw(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
+{
+    if (pu8Mosi == NULL && pu8Miso == NULL)
+    {
+        return M2M_ERR_BUS_FAIL;
+    }
+
+    winc_sim_loopback_t *pstrLoopback = nm_bsp_host_loopback();
+
+    if (!gu8InSg)
+    {
+        gu32Transactions++;
+    }
+    NM_TRACE(NM_TRACE_BUS, M2M_LOG_DBG, BUS_RW, u16Sz, nm_trace_be32(pu8Mosi, u16Sz));
+    winc_sim_loopback_rw(pstrLoopback, pu8Mosi, pu8Miso, u16Sz);
+
+    // Print what the driver traced up to the transfer and what the simulator
+    // logged during it
+    nm_trace_drain(UINT32_MAX);
+    sim_log_drain(&pstrLoopback->sim.log, UINT32_MAX);
+
+#if DRIVER_SPI_CAPTURE_ENABLE
+    spi_capture_write(&gstrCapture, pu8Mosi, pu8Miso, u16Sz);
+    spi_capture_drain(&gstrCapture, SPI_CAPTURE_RING_SIZE);
+#endif
+#if SIMULATOR_CAPTURE_ENABLE
+    spi_capture_drain(&gstrSimCapture, SPI_CAPTURE_RING_SIZE);
+#endif
+
+    return M2M_SUCCESS;
+}
+
+// The loopback has no CS, the pieces simply follow each other. A piece with
+// neither buffer clocks zeros.
+static sint8 nm_spi_rw_sg(tstrNmSpiRw *pstrRw, uint8 u8Count)
+{
+    static const uint8 au8Zeros[16];
+    sint8 s8Ret = M2M_SUCCESS;
+
+    gu32Transactions++;
+    gu8InSg = 1;
+    for (uint8 i = 0; i < u8Count && s8Ret == M2M_SUCCESS; i++)
+    {
+        tstrNmSpiRw *pstrPiece = &pstrRw[i];
+        if (pstrPiece->pu8InBuf == NULL && pstrPiece->pu8OutBuf == NULL)
+        {
+            for (uint16 u16Off = 0; u16Off < pstrPiece->u16Sz && s8Ret == M2M_SUCCESS; u16Off += sizeof(au8Zeros))
+            {
+                uint16 u16Sz = pstrPiece->u16Sz - u16Off;
+                if (u16Sz > sizeof(au8Zeros)) u16Sz = sizeof(au8Zeros);
+                s8Ret = nm_spi_rw((uint8 *)au8Zeros, NULL, u16Sz);
+            }
+        }
+        else if (pstrPiece->u16Sz != 0)
+        {
+            s8Ret = nm_spi_rw(pstrPiece->pu8InBuf, pstrPiece->pu8OutBuf, pstrPiece->u16Sz);
+        }
+    }
+    gu8InSg = 0;
+
+    return s8Ret;
+}
+
+uint32 nm_bus_host_transactions(void)
+{
+    return gu32Transactions;
+}
+
+// The loopback has no bus to wait for, the transfer runs to the end here
+static sint8 gs8AsyncResult;
+static uint16 gu16AsyncSz;
+
+sint8 nm_spi_rw_start(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
+{
+    gs8AsyncResult = nm_spi_rw(pu8Mosi, pu8Miso, u16Sz);
+    gu16AsyncSz = u16Sz;
+    return gs8AsyncResult;
+}
+
+uint16 nm_spi_rw_progress(void)
+{
+    return gu16AsyncSz;
+}
+
+sint8 nm_spi_rw_wait(void)
+{
+    return gs8AsyncResult;
+}
+
+sint8 nm_bus_init(void *pvinit)
+{
+    gu8Level = 1;
+    winc_sim_loopback_init(nm_bsp_host_loopback(), 0);
+    winc_sim_loopback_set_clock(nm_bsp_host_loopback(), gau32ProfileHz[gu8Level]);
+#if DRIVER_SPI_CAPTURE_ENABLE
+    spi_capture_init(&gstrCapture, nm_bsp_host_loopback()->sim.transport->now_us, SPI_CAPTURE_STREAM_DRIVER);
+#endif
+#if SIMULATOR_CAPTURE_ENABLE
+    spi_capture_init(&gstrSimCapture, nm_bsp_host_loopback()->sim.transport->now_us, SPI_CAPTURE_STREAM_SIM(0));
+    nm_bsp_host_loopback()->sim.capture = &gstrSimCapture;
+#endif
+    nm_trace_init(nm_bsp_host_loopback()->sim.transport->now_us);
+
+    nm_bsp_reset();
+
+    return M2M_SUCCESS;
+}
+
+sint8 nm_bus_ioctl(uint8 u8Cmd, void *pvParameter)
+{
+    sint8 s8Ret = 0;
+    switch (u8Cmd)
+    {
+    case NM_BUS_IOCTL_RW:
+    {
+        tstrNmSpiRw *pstrParam = (tstrNmSpiRw *)pvParameter;
+        s8Ret = nm_spi_rw(pstrParam->pu8InBuf, pstrParam->pu8OutBuf, pstrParam->u16Sz);
+    }
+    break;
+    case NM_BUS_IOCTL_RW_SG:
+    {
+        tstrNmSpiRwSg *pstrParam = (tstrNmSpiRwSg *)pvParameter;
+        s8Ret = nm_spi_rw_sg(pstrParam->pstrRw, pstrParam->u8Count);
+    }
+    break;
+    default:
+        s8Ret = -1;
+        M2M_ERR("invalid ioclt cmd\n");
+        break;
+    }
+
+    return s8Ret;
+}
+
+sint8 nm_bus_deinit(void)
+{
+    return M2M_SUCCESS;
+}
+
+sint8 nm_bus_reinit(void *config)
+{
+    return M2M_SUCCESS;
+}
+
+sint8 nm_bus_speed(uint8 level)
+{
+    if (level > 1)
+    {
+        return M2M_ERR_INVALID_ARG;
+    }
+    gu8Level = level;
+    winc_sim_loopback_set_clock(nm_bsp_host_loopback(), gau32ProfileHz[gu8Level]);
+    return M2M_SUCCESS;
+}
+
+uint32 nm_bus_set_profile(uint8 u8Level, uint32 u32Hz)
+{
+    if (u8Level > 1)
+    {
+        return 0;
+    }
+    gau32ProfileHz[u8Level] = u32Hz;
+    winc_sim_loopback_set_clock(nm_bsp_host_loopback(), gau32ProfileHz[gu8Level]);
+    return u32Hz;
+}
+
+uint32 nm_bus_get_profile(uint8 u8Level)
+{
+    return (u8Level > 1) ? 0 : gau32ProfileHz[u8Level];
+}
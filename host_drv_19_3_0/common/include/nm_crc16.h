@@ -0,0 +1,43 @@
+#ifndef _NM_CRC16_H_
+#define _NM_CRC16_H_
+
+#include "common/include/nm_common.h"
+
+// CRC16 protecting SPI data packets: CRC-16-CCITT, polynomial 0x1021, MSB
+// first, seeded with 0xFFFF and sent high byte first after each packet.
+
+#define NM_CRC16_SEED 0xFFFF
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@fn		nm_crc16_init
+*	@brief	Build the slice-by-4 lookup tables, call once before nm_crc16_update
+*/
+void nm_crc16_init(void);
+
+/**
+*	@fn		nm_crc16_update
+*	@brief	Continue a CRC16 over u32Sz more bytes
+*	@param [in]	u16Crc
+*				CRC so far, NM_CRC16_SEED for a new packet
+*	@param [in]	pu8Buf
+*				Data
+*	@param [in]	u32Sz
+*				Number of bytes
+*	@return	Updated CRC
+*/
+uint16 nm_crc16_update(uint16 u16Crc, const uint8 *pu8Buf, uint32 u32Sz);
+
+static inline uint16 nm_crc16(const uint8 *pu8Buf, uint32 u32Sz)
+{
+	return nm_crc16_update(NM_CRC16_SEED, pu8Buf, u32Sz);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NM_CRC16_H_ */
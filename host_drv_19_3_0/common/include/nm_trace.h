@@ -0,0 +1,115 @@
+#ifndef _NM_TRACE_H_
+#define _NM_TRACE_H_
+
+#include <stdint.h>
+#include "common/include/nm_common.h"
+
+// Binary trace of the driver's hot paths, in place of printf. NM_TRACE()
+// stores a 16 byte record (the layout of sim_log.h) in a RAM ring and
+// returns: no formatting, no stdio. nm_trace_drain() prints the records
+// later, from the application's main loop.
+//
+// Trace points are filtered at compile time. One whose category is not in
+// DRIVER_TRACE_CATEGORIES (conf_winc.h) or whose level is above
+// DRIVER_TRACE_LEVEL is a constant false condition and compiles to nothing.
+// With DRIVER_TRACE_CATEGORIES 0, the default, there is no ring either.
+//
+// Single producer, the driver, which only touches the bus from thread
+// context. Single consumer, whoever calls nm_trace_drain().
+
+// Categories
+#define NM_TRACE_SPI	0x01	// nmspi.c: register and block accesses, retries
+#define NM_TRACE_BUS	0x02	// Bus wrapper: every transfer
+#define NM_TRACE_HIF	0x04	// m2m_hif.c: messages sent and received
+
+// Levels are the M2M_LOG_* ones of nm_debug.h
+
+// Normally set in conf_winc.h
+#ifndef DRIVER_TRACE_CATEGORIES
+#define DRIVER_TRACE_CATEGORIES 0
+#endif
+#ifndef DRIVER_TRACE_LEVEL
+#define DRIVER_TRACE_LEVEL M2M_LOG_DBG
+#endif
+
+// Records in the ring, a power of two
+#ifndef DRIVER_TRACE_RING_SIZE
+#define DRIVER_TRACE_RING_SIZE 256
+#endif
+
+// Events: ID and the format of the two values. New events go at the end.
+#define NM_TRACE_EVENTS(X)                                                      \
+	X(SPI_REG_READ,     "SPI read reg %06x: %08x")                               \
+	X(SPI_REG_WRITE,    "SPI write reg %06x: %08x")                              \
+	X(SPI_BLOCK_READ,   "SPI read block %06x, %u bytes")                         \
+	X(SPI_BLOCK_WRITE,  "SPI write block %06x, %u bytes")                        \
+	X(SPI_RETRY,        "SPI reset and retry %06x, %u attempts left")            \
+	X(SPI_CHAIN_BROKEN, "SPI chained access %06x failed, %u done")               \
+	X(BUS_RW,           "Bus transfer %u bytes, MOSI %08x")                      \
+	X(HIF_SEND,         "HIF send %04x (group, opcode), %u bytes")               \
+	X(HIF_RECEIVE,      "HIF receive %04x (group, opcode), %u bytes")             \
+	X(SPI_DOWNSHIFT,    "SPI clock down from %u to %u Hz")
+
+#define NM_TRACE_EVENT_ID(id, fmt) NM_TRACE_EV_##id,
+typedef enum {
+	NM_TRACE_EVENTS(NM_TRACE_EVENT_ID)
+	NM_TRACE_EV_COUNT
+} tenuNmTraceEvent;
+#undef NM_TRACE_EVENT_ID
+
+// One record, also the layout of sim_log_record_t
+typedef struct {
+	uint32 u32TimeUs;	// Low 32 bits of the clock
+	uint16 u16Event;	// tenuNmTraceEvent
+	uint16 u16Seq;		// Low bits of the record's position, gaps show drops
+	uint32 u32Val1;
+	uint32 u32Val2;
+} tstrNmTraceRecord;
+
+#define NM_TRACE(category, level, event, val1, val2)									\
+	do {																				\
+		if (((category) & DRIVER_TRACE_CATEGORIES) && ((level) <= DRIVER_TRACE_LEVEL))	\
+			nm_trace_write(NM_TRACE_EV_##event, (uint32)(val1), (uint32)(val2));		\
+	} while (0)
+
+// Up to the first 4 bytes of pu8Buf, most significant first, as a trace value
+static inline uint32 nm_trace_be32(const uint8 *pu8Buf, uint16 u16Sz)
+{
+	uint32 u32Val = 0;
+	uint16 i;
+
+	for (i = 0; (pu8Buf != NULL) && (i < 4); i++)
+		u32Val = (u32Val << 8) | ((i < u16Sz) ? pu8Buf[i] : 0);
+	return u32Val;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+*	@fn		nm_trace_init
+*	@brief	Empty the ring
+*	@param [in]	pfNowUs
+*				Clock for the record time stamps, NULL stamps 0
+*/
+void nm_trace_init(uint64_t (*pfNowUs)(void));
+
+/**
+*	@fn		nm_trace_write
+*	@brief	Store one record, or count it as dropped if the ring is full. Use NM_TRACE().
+*/
+void nm_trace_write(tenuNmTraceEvent enuEvent, uint32 u32Val1, uint32 u32Val2);
+
+/**
+*	@fn		nm_trace_drain
+*	@brief	Print up to u32Max records as "[TRACE] ..." lines and report drops
+*	@return	Records printed
+*/
+uint32 nm_trace_drain(uint32 u32Max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _NM_TRACE_H_ */
@@ -0,0 +1,47 @@
+#include "common/include/nm_crc16.h"
+
+// Slice-by-4: gau16Crc16Table[k][b] is the CRC contribution of byte b followed
+// by k zero bytes, so four table lookups consume four input bytes. The tables
+// are built into RAM at init rather than stored as constants so the lookups
+// never miss in the XIP flash cache on the Pico.
+static uint16 gau16Crc16Table[4][256];
+
+void nm_crc16_init(void)
+{
+	uint32 i, k;
+
+	for (i = 0; i < 256; i++) {
+		uint16 crc = (uint16)(i << 8);
+		for (k = 0; k < 8; k++)
+			crc = (crc & 0x8000) ? (uint16)((crc << 1) ^ 0x1021) : (uint16)(crc << 1);
+		gau16Crc16Table[0][i] = crc;
+	}
+	for (k = 1; k < 4; k++) {
+		for (i = 0; i < 256; i++) {
+			uint16 prev = gau16Crc16Table[k - 1][i];
+			gau16Crc16Table[k][i] = (uint16)(prev << 8) ^ gau16Crc16Table[0][prev >> 8];
+		}
+	}
+}
+
+uint16 nm_crc16_update(uint16 u16Crc, const uint8 *pu8Buf, uint32 u32Sz)
+{
+#ifdef NM_BSP_CRC16_MIN_SZ
+	// The DMA setup only pays off on longer blocks
+	if (u32Sz >= NM_BSP_CRC16_MIN_SZ)
+		return nm_bsp_crc16(u16Crc, pu8Buf, u32Sz);
+#endif
+
+	while (u32Sz >= 4) {
+		u16Crc = gau16Crc16Table[3][(u16Crc >> 8) ^ pu8Buf[0]] ^
+				 gau16Crc16Table[2][(u16Crc & 0xff) ^ pu8Buf[1]] ^
+				 gau16Crc16Table[1][pu8Buf[2]] ^
+				 gau16Crc16Table[0][pu8Buf[3]];
+		pu8Buf += 4;
+		u32Sz -= 4;
+	}
+	while (u32Sz--)
+		u16Crc = (uint16)(u16Crc << 8) ^ gau16Crc16Table[0][(u16Crc >> 8) ^ *pu8Buf++];
+
+	return u16Crc;
+}
@@ -0,0 +1,97 @@
+#include "common/include/nm_trace.h"
+
+#if DRIVER_TRACE_CATEGORIES
+
+#define NM_TRACE_EVENT_FMT(id, fmt) fmt,
+static const char *const gacTraceFmt[NM_TRACE_EV_COUNT] = {
+	NM_TRACE_EVENTS(NM_TRACE_EVENT_FMT)
+};
+#undef NM_TRACE_EVENT_FMT
+
+// The other side's index is read with acquire and published with release,
+// which orders the record contents with it, as in sim_log.c.
+static tstrNmTraceRecord gastrTrace[DRIVER_TRACE_RING_SIZE];
+static uint32 gu32TraceHead;
+static uint32 gu32TraceTail;
+static uint32 gu32TraceDropped;
+static uint32 gu32TraceDroppedReported;
+static uint64_t (*gpfTraceNowUs)(void);
+
+void nm_trace_init(uint64_t (*pfNowUs)(void))
+{
+	gu32TraceHead = 0;
+	gu32TraceTail = 0;
+	gu32TraceDropped = 0;
+	gu32TraceDroppedReported = 0;
+	gpfTraceNowUs = pfNowUs;
+}
+
+void nm_trace_write(tenuNmTraceEvent enuEvent, uint32 u32Val1, uint32 u32Val2)
+{
+	uint32 head = gu32TraceHead;
+	tstrNmTraceRecord *r;
+
+	if (head - __atomic_load_n(&gu32TraceTail, __ATOMIC_ACQUIRE) >= DRIVER_TRACE_RING_SIZE) {
+		gu32TraceDropped++;
+		return;
+	}
+	r = &gastrTrace[head & (DRIVER_TRACE_RING_SIZE - 1)];
+	r->u32TimeUs = gpfTraceNowUs ? (uint32)gpfTraceNowUs() : 0;
+	r->u16Event = (uint16)enuEvent;
+	r->u16Seq = (uint16)head;
+	r->u32Val1 = u32Val1;
+	r->u32Val2 = u32Val2;
+	__atomic_store_n(&gu32TraceHead, head + 1, __ATOMIC_RELEASE);
+}
+
+uint32 nm_trace_drain(uint32 u32Max)
+{
+	uint32 tail = gu32TraceTail;
+	uint32 n = __atomic_load_n(&gu32TraceHead, __ATOMIC_ACQUIRE) - tail;
+	uint32 i, dropped;
+
+	if (n > u32Max)
+		n = u32Max;
+	for (i = 0; i < n; i++) {
+		const tstrNmTraceRecord *r = &gastrTrace[(tail + i) & (DRIVER_TRACE_RING_SIZE - 1)];
+		printf("[TRACE] %10u ", (unsigned)r->u32TimeUs);
+		if (r->u16Event < NM_TRACE_EV_COUNT)
+			printf(gacTraceFmt[r->u16Event], (unsigned)r->u32Val1, (unsigned)r->u32Val2);
+		else
+			printf("Unknown event %u: %08x %08x", (unsigned)r->u16Event, (unsigned)r->u32Val1, (unsigned)r->u32Val2);
+		printf("\n");
+		// Release each slot as soon as it is printed, stdio may be slow
+		__atomic_store_n(&gu32TraceTail, tail + i + 1, __ATOMIC_RELEASE);
+	}
+
+	dropped = __atomic_load_n(&gu32TraceDropped, __ATOMIC_RELAXED);
+	if (dropped != gu32TraceDroppedReported) {
+		printf("[TRACE] %u records dropped\n", (unsigned)(dropped - gu32TraceDroppedReported));
+		gu32TraceDroppedReported = dropped;
+	}
+	return n;
+}
+
+#else
+
+// Every NM_TRACE() is compiled out, these only keep the callers building
+
+void nm_trace_init(uint64_t (*pfNowUs)(void))
+{
+	(void)pfNowUs;
+}
+
+void nm_trace_write(tenuNmTraceEvent enuEvent, uint32 u32Val1, uint32 u32Val2)
+{
+	(void)enuEvent;
+	(void)u32Val1;
+	(void)u32Val2;
+}
+
+uint32 nm_trace_drain(uint32 u32Max)
+{
+	(void)u32Max;
+	return 0;
+}
+
+#endif /* DRIVER_TRACE_CATEGORIES */
@@ -47,6 +47,7 @@
 #include "driver/include/m2m_types.h"
 #include "driver/source/nmasic.h"
 #include "driver/include/m2m_periph.h"
+#include "common/include/nm_trace.h"
 
 #if (defined NM_EDGE_INTERRUPT)&&(defined NM_LEVEL_INTERRUPT)
 #error "only one type of interrupt NM_EDGE_INTERRUPT,NM_LEVEL_INTERRUPT"
@@ -91,19 +92,16 @@ static void isr(void)
 }
 static sint8 hif_set_rx_done(void)
 {
-	uint32 reg;
 	sint8 ret = M2M_SUCCESS;
+	tstrNmRegOp astrOps[] = {
+		/* Set RX Done */
+		{NM_REG_OP_RMW, WIFI_HOST_RCV_CTRL_0, (1<<1), (1<<1)},
+	};
 #ifdef NM_EDGE_INTERRUPT
 	nm_bsp_interrupt_ctrl(1);
 #endif
 
-	ret = nm_read_reg_with_ret(WIFI_HOST_RCV_CTRL_0,&reg);
-	if(ret != M2M_SUCCESS)goto ERR1;
-	//reg &= ~(1<<0);
-
-	/* Set RX Done */
-	reg |= (1<<1);
-	ret = nm_write_reg(WIFI_HOST_RCV_CTRL_0,reg);
+	ret = nm_reg_batch(astrOps, 1);
 	if(ret != M2M_SUCCESS)goto ERR1;
 #ifdef NM_LEVEL_INTERRUPT
 	nm_bsp_interrupt_ctrl(1);
@@ -212,17 +210,13 @@ sint8 hif_chip_sleep(void)
 	{
 		if((gu8ChipMode == M2M_PS_DEEP_AUTOMATIC)||(gu8ChipMode == M2M_PS_MANUAL))
 		{
-			uint32 reg = 0;
-			ret = nm_write_reg(WAKE_REG, SLEEP_VALUE);
-			if(ret != M2M_SUCCESS)goto ERR1;
-			/* Clear bit 1 */
-			ret = nm_read_reg_with_ret(0x1, &reg);
+			tstrNmRegOp astrOps[] = {
+				{NM_REG_OP_WRITE, WAKE_REG, SLEEP_VALUE},
+				/* Clear bit 1 */
+				{NM_REG_OP_UPDATE, 0x1, 0, (1 << 1)},
+			};
+			ret = nm_reg_batch(astrOps, 2);
 			if(ret != M2M_SUCCESS)goto ERR1;
-			if(reg&0x2)
-			{
-				reg &=~(1 << 1);
-				ret = nm_write_reg(0x1, reg);
-			}
 		}
 		else
 		{
@@ -335,11 +329,17 @@ sint8 hif_send(uint8 u8Gid,uint8 u8Opcode,uint8 *pu8CtrlBuf,uint16 u16CtrlBufSiz
 	{
 		strHif.u16Length += u16CtrlBufSize;
 	}
+	NM_TRACE(NM_TRACE_HIF, M2M_LOG_INFO, HIF_SEND, ((uint32)u8Gid << 8) | u8Opcode, strHif.u16Length);
 	ret = hif_chip_wake();
 	if(ret == M2M_SUCCESS)
 	{
 		volatile uint32 reg, dma_addr = 0;
-		volatile uint16 cnt = 0;
+		/* Wait for the firmware to take the request and fetch the buffer it
+		   allocated, in one batch */
+		tstrNmRegOp astrOps[] = {
+			{NM_REG_OP_POLL, WIFI_HOST_RCV_CTRL_2, 0, 0x2, 1000},
+			{NM_REG_OP_READ, 0x150400},
+		};
 
 		reg = 0UL;
 		reg |= (uint32)u8Gid;
@@ -348,34 +348,45 @@ sint8 hif_send(uint8 u8Gid,uint8 u8Opcode,uint8 *pu8CtrlBuf,uint16 u16CtrlBufSiz
 		ret = nm_write_reg(NMI_STATE_REG,reg);
 		if(M2M_SUCCESS != ret) goto ERR1;
 
-
+		/* The request doorbell is not part of a batch: if a chained
+		   response were misplaced, the fallback would post it twice */
 		reg = 0;
 		reg |= (1<<1);
 		ret = nm_write_reg(WIFI_HOST_RCV_CTRL_2, reg);
 		if(M2M_SUCCESS != ret) goto ERR1;
-		dma_addr = 0;
 
 		//nm_bsp_interrupt_ctrl(0);
 
-		for(cnt = 0; cnt < 1000; cnt ++)
-		{
-			ret = nm_read_reg_with_ret(WIFI_HOST_RCV_CTRL_2,(uint32 *)&reg);
-			if(ret != M2M_SUCCESS) break;
-			if (!(reg & 0x2))
-			{
-				ret = nm_read_reg_with_ret(0x150400,(uint32 *)&dma_addr);
-				if(ret != M2M_SUCCESS) {
-					/*in case of read error clear the dma address and return error*/
-					dma_addr = 0;
-				}
-				/*in case of success break */
-				break;
-			}
-		}
+		ret = nm_reg_batch(astrOps, 2);
+		/*in case of read error or time out the dma address stays 0*/
+		if(ret == M2M_SUCCESS) dma_addr = astrOps[1].u32Rd;
 		//nm_bsp_interrupt_ctrl(1);
 
 		if (dma_addr != 0)
 		{
+#ifndef CONF_WINC_USE_I2C
+			tstrNmIov	astrIov[4];
+			uint8		u8Count = 0;
+			strHif.u16Length=NM_BSP_B_L_16(strHif.u16Length);
+			/* Header, control and data go out as one block, the gap up to
+			   the data offset is written as zeros */
+			astrIov[u8Count].pu8Buf = (uint8*)&strHif;
+			astrIov[u8Count++].u16Sz = M2M_HIF_HDR_OFFSET;
+			if(pu8CtrlBuf != NULL)
+			{
+				astrIov[u8Count].pu8Buf = pu8CtrlBuf;
+				astrIov[u8Count++].u16Sz = u16CtrlBufSize;
+			}
+			if(pu8DataBuf != NULL)
+			{
+				astrIov[u8Count].pu8Buf = NULL;
+				astrIov[u8Count++].u16Sz = (uint16)(u16DataOffset - u16CtrlBufSize);
+				astrIov[u8Count].pu8Buf = pu8DataBuf;
+				astrIov[u8Count++].u16Sz = u16DataSize;
+			}
+			ret = nm_write_block_sg(dma_addr, astrIov, u8Count);
+			if(M2M_SUCCESS != ret) goto ERR1;
+#else
 			volatile uint32	u32CurrAddr;
 			u32CurrAddr = dma_addr;
 			strHif.u16Length=NM_BSP_B_L_16(strHif.u16Length);
@@ -404,6 +415,7 @@ sint8 hif_send(uint8 u8Gid,uint8 u8Opcode,uint8 *pu8CtrlBuf,uint16 u16CtrlBufSiz
 				if(M2M_SUCCESS != ret) goto ERR1;
 				u32CurrAddr += u16DataSize;
 			}
+#endif
 
 			reg = dma_addr << 2;
 			reg |= (1 << 1);
@@ -493,6 +505,7 @@ static sint8 hif_isr(void)
 							goto ERR1;
 						}
 					}
+					NM_TRACE(NM_TRACE_HIF, M2M_LOG_INFO, HIF_RECEIVE, ((uint32)strHif.u8Gid << 8) | strHif.u8Opcode, strHif.u16Length);
 
 					if(M2M_REQ_GROUP_WIFI == strHif.u8Gid)
 					{
@@ -39,6 +39,9 @@
  *
  */
 
+#define LOW 0
+#define HIGH 1
+
 #include "common/include/nm_common.h"
 #include "driver/source/nmbus.h"
 #include "bsp/include/nm_bsp.h"
@@ -107,6 +110,9 @@ sint8 nm_clkless_wake(void)
 {
 	sint8 ret = M2M_SUCCESS;
 	uint32 reg, clk_status_reg,trials = 0;
+
+	nm_bus_speed(LOW);
+
 	/* wait 1ms, spi data read */
 	nm_bsp_sleep(1);
 	ret = nm_read_reg_with_ret(0x1, &reg);
@@ -179,6 +185,7 @@ sint8 nm_clkless_wake(void)
 	} while((clk_status_reg & 0x4) == 0);
 
 _WAKE_EXIT:
+	nm_bus_speed(HIGH);
 	return ret;
 }
 void chip_idle(void)
@@ -207,30 +214,18 @@ void enable_rf_blocks(void)
 
 sint8 enable_interrupts(void)
 {
-	uint32 reg;
-	sint8 ret;
-	/**
-	interrupt pin mux select
-	**/
-	ret = nm_read_reg_with_ret(NMI_PIN_MUX_0, &reg);
-	if (M2M_SUCCESS != ret) {
-		return M2M_ERR_BUS_FAIL;
-	}
-	reg |= ((uint32) 1 << 8);
-	ret = nm_write_reg(NMI_PIN_MUX_0, reg);
-	if (M2M_SUCCESS != ret) {
-		return M2M_ERR_BUS_FAIL;
-	}
-	/**
-	interrupt enable
-	**/
-	ret = nm_read_reg_with_ret(NMI_INTR_ENABLE, &reg);
-	if (M2M_SUCCESS != ret) {
-		return M2M_ERR_BUS_FAIL;
-	}
-	reg |= ((uint32) 1 << 16);
-	ret = nm_write_reg(NMI_INTR_ENABLE, reg);
-	if (M2M_SUCCESS != ret) {
+	tstrNmRegOp astrOps[] = {
+		/**
+		interrupt pin mux select
+		**/
+		{NM_REG_OP_RMW, NMI_PIN_MUX_0, ((uint32) 1 << 8), ((uint32) 1 << 8)},
+		/**
+		interrupt enable
+		**/
+		{NM_REG_OP_RMW, NMI_INTR_ENABLE, ((uint32) 1 << 16), ((uint32) 1 << 16)},
+	};
+
+	if (M2M_SUCCESS != nm_reg_batch(astrOps, 2)) {
 		return M2M_ERR_BUS_FAIL;
 	}
 	return M2M_SUCCESS;
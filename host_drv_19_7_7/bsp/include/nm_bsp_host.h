@@ -0,0 +1,61 @@
+#ifndef _NM_BSP_HOST_H_
+#define _NM_BSP_HOST_H_
+
+#include <stdint.h>
+#include "conf_winc.h"
+
+#define CONF_WINC_USE_SPI
+
+#define NM_EDGE_INTERRUPT 1
+
+#define NM_DEBUG CONF_WINC_DEBUG
+#define NM_BSP_PRINTF CONF_WINC_PRINTF
+
+// Edges of the simulated IRQ line passed to the driver's isr(), and dropped
+// because the driver had interrupts disabled
+void nm_bsp_host_get_irq_stats(uint32_t *pu32Taken, uint32_t *pu32Dropped);
+
+// SPI transactions so far, counted as the Pico frames them with CS: each
+// nm_spi_rw() on its own and each NM_BUS_IOCTL_RW_SG as a whole. The
+// loopback's transfer count has every piece of a gathered transfer.
+uint32 nm_bus_host_transactions(void);
+
+// The same asynchronous transfer API as the Pico (nm_bsp_pico.h), so the
+// host build runs nmspi.c's data path unchanged. A transfer completes inside
+// nm_spi_rw_start().
+#define NM_BUS_ASYNC
+sint8 nm_spi_rw_start(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz);
+uint16 nm_spi_rw_progress(void);
+sint8 nm_spi_rw_wait(void);
+
+// Clock profiles and calibration as on the Pico (nm_bsp_pico.h). The bus
+// wrapper passes the rate in use on to the loopback. Calibration only has
+// an edge to find once the loopback models a marginal link
+// (winc_sim_loopback_set_faults()). A stored result is kept for the life of
+// the process.
+#ifndef CONF_WINC_SPI_HIGH_HZ
+#define CONF_WINC_SPI_HIGH_HZ 4000000
+#endif
+#define NM_BUS_PROFILES
+uint32 nm_bus_set_profile(uint8 u8Level, uint32 u32Hz);
+uint32 nm_bus_get_profile(uint8 u8Level);
+
+// As on the Pico, from CLOCK_MONOTONIC
+#define NM_BSP_TIME_US
+uint32 nm_bsp_time_us(void);
+void nm_bsp_sleep_us(uint32 u32TimeUsec);
+#if CONF_WINC_SPI_CAL
+#define NM_BUS_CALIBRATE
+#if CONF_WINC_SPI_CAL_STORE
+#define NM_BUS_CAL_STORE
+uint32 nm_bsp_spi_cal_load(uint32 u32ChipId);
+void nm_bsp_spi_cal_store(uint32 u32ChipId, uint32 u32Hz);
+#endif
+#endif
+
+// The simulated chip the driver talks to. The driver is a single instance,
+// so there is one, shared by the BSP and the bus wrapper.
+typedef struct winc_sim_loopback winc_sim_loopback_t;
+winc_sim_loopback_t *nm_bsp_host_loopback(void);
+
+#endif /* _NM_BSP_HOST_H_ */
@@ -44,6 +44,10 @@
 #include "bsp/include/nm_bsp_pico.h"
 #endif
 
+#ifdef CONF_WINC_USE_HOST
+#include "bsp/include/nm_bsp_host.h"
+#endif
+
 #ifdef WIN32
 #include "nm_bsp_win32.h"
 #endif
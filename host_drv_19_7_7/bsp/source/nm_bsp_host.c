@@ -0,0 +1,109 @@
+#include "bsp/include/nm_bsp.h"
+#include "bsp/include/nm_bsp_internal.h"
+#include "common/include/nm_common.h"
+#include "conf_winc.h"
+#include "winc_sim_loopback.h"
+#include <stdio.h>
+#include <time.h>
+
+// BSP for running the driver as a Linux process against the simulator
+// loopback (see nm_bus_wrapper_host.c). There are no pins to drive, the
+// simulated IRQ line calls chip_isr() directly.
+
+static winc_sim_loopback_t gstrLoopback;
+static tpfNmBspIsr gpfIsr;
+static uint8 gu8IsrEnabled;
+static uint32 gu32IsrTaken;
+static uint32 gu32IsrDropped;
+
+// Like the Pico GPIO IRQ, edges that arrive while disabled are dropped
+static void chip_isr(void)
+{
+    if (gu8IsrEnabled && gpfIsr) {
+        gu32IsrTaken++;
+        gpfIsr();
+    } else {
+        gu32IsrDropped++;
+    }
+}
+
+sint8 nm_bsp_init(void)
+{
+    gpfIsr = NULL;
+
+    return M2M_SUCCESS;
+}
+
+sint8 nm_bsp_deinit(void)
+{
+    return M2M_SUCCESS;
+}
+
+void nm_bsp_reset(void)
+{
+}
+
+void nm_bsp_sleep(uint32 u32TimeMsec)
+{
+    struct timespec ts;
+    ts.tv_sec = u32TimeMsec / 1000;
+    ts.tv_nsec = (long)(u32TimeMsec % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0)
+        ;
+}
+
+uint32 nm_bsp_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32)((uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u);
+}
+
+void nm_bsp_sleep_us(uint32 u32TimeUsec)
+{
+    struct timespec ts;
+    ts.tv_sec = u32TimeUsec / 1000000u;
+    ts.tv_nsec = (long)(u32TimeUsec % 1000000u) * 1000L;
+    while (nanosleep(&ts, &ts) != 0)
+        ;
+}
+
+void nm_bsp_register_isr(tpfNmBspIsr pfIsr)
+{
+    gpfIsr = pfIsr;
+    gu8IsrEnabled = 1;
+    winc_sim_loopback_set_irq_handler(&gstrLoopback, chip_isr);
+}
+
+void nm_bsp_interrupt_ctrl(uint8 u8Enable)
+{
+    gu8IsrEnabled = u8Enable;
+}
+
+void nm_bsp_host_get_irq_stats(uint32_t *pu32Taken, uint32_t *pu32Dropped)
+{
+    *pu32Taken = gu32IsrTaken;
+    *pu32Dropped = gu32IsrDropped;
+}
+
+winc_sim_loopback_t *nm_bsp_host_loopback(void)
+{
+    return &gstrLoopback;
+}
+
+#if CONF_WINC_SPI_CAL && CONF_WINC_SPI_CAL_STORE
+// The process is the host build's boot, nothing outlives it
+static uint32 gu32CalChipId;
+static uint32 gu32CalHz;
+
+uint32 nm_bsp_spi_cal_load(uint32 u32ChipId)
+{
+    return (u32ChipId == gu32CalChipId) ? gu32CalHz : 0;
+}
+
+void nm_bsp_spi_cal_store(uint32 u32ChipId, uint32 u32Hz)
+{
+    gu32CalChipId = u32ChipId;
+    gu32CalHz = u32Hz;
+}
+#endif
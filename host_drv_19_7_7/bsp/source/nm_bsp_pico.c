@@ -4,7 +4,15 @@
 #include "conf_winc.h"
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
+#ifdef CONF_WINC_CRC16_DMA_SNIFFER
+#include "hardware/dma.h"
+#endif
+#if CONF_WINC_SPI_CAL && CONF_WINC_SPI_CAL_STORE
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#endif
 #include <stdio.h>
+#include <string.h>
 
 static tpfNmBspIsr gpfIsr;
 
@@ -66,6 +74,17 @@ void nm_bsp_sleep(uint32 u32TimeMsec)
     sleep_ms(u32TimeMsec);
 }
 
+uint32 nm_bsp_time_us(void)
+{
+    return time_us_32();
+}
+
+// Short waits, spinning is cheaper than a timer alarm
+void nm_bsp_sleep_us(uint32 u32TimeUsec)
+{
+    busy_wait_us_32(u32TimeUsec);
+}
+
 void nm_bsp_register_isr(tpfNmBspIsr pfIsr)
 {
     gpfIsr = pfIsr;
@@ -88,3 +107,107 @@ void nm_bsp_interrupt_ctrl(uint8 u8Enable)
         gpio_set_irq_enabled(CONF_WINC_SPI_INT_PIN, GPIO_IRQ_EDGE_FALL, false);
     }
 }
+
+#ifdef CONF_WINC_CRC16_DMA_SNIFFER
+static int gs32CrcDmaChannel = -1;
+static uint8 gu8CrcDmaSink;
+
+// Run the block through a DMA channel into a dummy byte and let the sniffer
+// compute the CRC-16-CCITT on the way.
+uint16 nm_bsp_crc16(uint16 u16Crc, const uint8 *pu8Buf, uint32 u32Sz)
+{
+    dma_channel_config c;
+
+    if (gs32CrcDmaChannel < 0)
+    {
+        gs32CrcDmaChannel = dma_claim_unused_channel(true);
+    }
+
+    c = dma_channel_get_default_config(gs32CrcDmaChannel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, DREQ_FORCE);
+    channel_config_set_sniff_enable(&c, true);
+
+    dma_sniffer_enable(gs32CrcDmaChannel, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, true);
+    dma_hw->sniff_data = u16Crc;
+    dma_channel_configure(gs32CrcDmaChannel, &c, &gu8CrcDmaSink, pu8Buf, u32Sz, true);
+    dma_channel_wait_for_finish_blocking(gs32CrcDmaChannel);
+
+    return (uint16)dma_hw->sniff_data;
+}
+#endif
+
+#if CONF_WINC_SPI_CAL && CONF_WINC_SPI_CAL_STORE
+// The SPI calibration lives in the sector the application reserved for it
+#ifndef CONF_WINC_SPI_CAL_FLASH_OFFSET
+#error "CONF_WINC_SPI_CAL_STORE needs CONF_WINC_SPI_CAL_FLASH_OFFSET, a flash sector reserved for it"
+#endif
+#if (CONF_WINC_SPI_CAL_FLASH_OFFSET % FLASH_SECTOR_SIZE) || \
+    (CONF_WINC_SPI_CAL_FLASH_OFFSET + FLASH_SECTOR_SIZE > PICO_FLASH_SIZE_BYTES)
+#error "CONF_WINC_SPI_CAL_FLASH_OFFSET must be a whole flash sector within PICO_FLASH_SIZE_BYTES"
+#endif
+#define SPI_CAL_FLASH_OFFSET CONF_WINC_SPI_CAL_FLASH_OFFSET
+#define SPI_CAL_MAGIC 0x57534b31 // "WSK1"
+
+typedef struct {
+    uint32 u32Magic;
+    uint32 u32ChipId;
+    uint32 u32Hz;
+    uint32 u32Check;    // The other three XORed, an erased sector fails it
+} tstrSpiCal;
+
+uint32 nm_bsp_spi_cal_load(uint32 u32ChipId)
+{
+    const tstrSpiCal *pstrCal = (const tstrSpiCal *)(XIP_BASE + SPI_CAL_FLASH_OFFSET);
+
+    if (pstrCal->u32Magic != SPI_CAL_MAGIC || pstrCal->u32ChipId != u32ChipId ||
+        pstrCal->u32Check != (pstrCal->u32Magic ^ pstrCal->u32ChipId ^ pstrCal->u32Hz))
+    {
+        return 0;
+    }
+    return pstrCal->u32Hz;
+}
+
+// Runs with the other core parked and interrupts off, nothing may execute
+// from flash meanwhile
+static void spi_cal_program(void *pvPage)
+{
+    flash_range_erase(SPI_CAL_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(SPI_CAL_FLASH_OFFSET, (const uint8_t *)pvPage, FLASH_PAGE_SIZE);
+}
+
+void nm_bsp_spi_cal_store(uint32 u32ChipId, uint32 u32Hz)
+{
+    static uint8 au8Page[FLASH_PAGE_SIZE];
+    tstrSpiCal strCal;
+    int s32Ret;
+
+    extern char __flash_binary_end;
+
+    if (nm_bsp_spi_cal_load(u32ChipId) == u32Hz)
+    {
+        return;
+    }
+    // Never erase a sector of the running image
+    if (XIP_BASE + SPI_CAL_FLASH_OFFSET < (uintptr_t)&__flash_binary_end)
+    {
+        printf("nm_bsp_spi_cal_store: sector at %x overlaps the image, not stored\n", SPI_CAL_FLASH_OFFSET);
+        return;
+    }
+
+    strCal.u32Magic = SPI_CAL_MAGIC;
+    strCal.u32ChipId = u32ChipId;
+    strCal.u32Hz = u32Hz;
+    strCal.u32Check = strCal.u32Magic ^ strCal.u32ChipId ^ strCal.u32Hz;
+    memset(au8Page, 0xff, sizeof(au8Page));
+    memcpy(au8Page, &strCal, sizeof(strCal));
+
+    s32Ret = flash_safe_execute(spi_cal_program, au8Page, 100);
+    if (s32Ret != PICO_OK)
+    {
+        printf("nm_bsp_spi_cal_store: flash write failed (%d), calibrating again next boot\n", s32Ret);
+    }
+}
+#endif
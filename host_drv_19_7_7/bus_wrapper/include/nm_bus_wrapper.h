@@ -53,6 +53,7 @@
 #define NM_BUS_IOCTL_RW			((uint8)3)	/*!< Read/Write at the same time ==> SPI only. Parameter:tstrNmSpiRw */
 
 #define NM_BUS_IOCTL_WR_RESTART	((uint8)4)				/*!< Write buffer then made restart condition then read ==> I2C only. parameter:tstrNmI2cSpecial */ 
+#define NM_BUS_IOCTL_RW_SG		((uint8)5)	/*!< Several Read/Write buffers back to back within one transfer (one CS cycle) ==> SPI only. Parameter:tstrNmSpiRwSg */
 /**
 *	@struct	tstrNmBusCapabilities
 *	@brief	Structure holding bus capabilities information
@@ -103,6 +104,59 @@ typedef struct
 	uint16	u16Sz;			/*!< Transfere size */	
 } tstrNmSpiRw;
 
+/**
+*	@struct	tstrNmSpiRwSg
+*	@brief	Structure holding the buffers of a scatter-gather SPI transfer
+*	@sa		NM_BUS_IOCTL_RW_SG
+*/
+typedef struct
+{
+	tstrNmSpiRw	*pstrRw;	/*!< Buffers, clocked in order without releasing CS */
+	uint8		u8Count;	/*!< Number of buffers */
+} tstrNmSpiRwSg;
+
+/**
+*	@struct	tstrNmIov
+*	@brief	One piece of a gathered block write
+*	@sa		nm_write_block_sg
+*/
+typedef struct
+{
+	uint8	*pu8Buf;	/*!< Data. Can be set to null and in this case zeros are written */
+	uint16	u16Sz;		/*!< Size */
+} tstrNmIov;
+
+/**
+*	@enum	tenuNmRegOp
+*	@brief	Register operations of a batch
+*	@sa		nm_reg_batch
+*/
+typedef enum
+{
+	NM_REG_OP_READ,		/*!< Read the register into u32Rd */
+	NM_REG_OP_WRITE,	/*!< Write u32Val */
+	NM_REG_OP_RMW,		/*!< Set the bits in u32Mask to those of u32Val and write the result back */
+	NM_REG_OP_POLL,		/*!< Read until the bits in u32Mask equal those of u32Val, at most u16Count times */
+	NM_REG_OP_UPDATE	/*!< As NM_REG_OP_RMW, but written only if that changes the value. Only for
+						registers where writing the value they hold has no effect, never a doorbell */
+} tenuNmRegOp;
+
+/**
+*	@struct	tstrNmRegOp
+*	@brief	One register operation of a batch
+*	@sa		nm_reg_batch
+*/
+typedef struct
+{
+	uint8	u8Op;		/*!< tenuNmRegOp */
+	uint32	u32Addr;	/*!< Register address */
+	uint32	u32Val;		/*!< Value written, or the bits set or waited for */
+	uint32	u32Mask;	/*!< Bits changed or compared */
+	uint16	u16Count;	/*!< Reads of a poll, 0 counts as 1 */
+	sint8	s8Ret;		/*!< Result of the operation, M2M_ERR_FAIL if it did not run */
+	uint32	u32Rd;		/*!< Last value read */
+} tstrNmRegOp;
+
 
 /**
 *	@struct	tstrNmUartDefault
@@ -1,39 +1,216 @@
 #include "bsp/include/nm_bsp.h"
 #include "common/include/nm_common.h"
+#include "common/include/nm_trace.h"
 #include "bus_wrapper/include/nm_bus_wrapper.h"
+#include "bsp/include/nm_bsp_pico.h"
 #include "conf_winc.h"
 #include "pico/stdlib.h"
 #include "hardware/spi.h"
 #include "hardware/gpio.h"
+#if CONF_WINC_SPI_DMA
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#endif
 #include <stdio.h>
+#include <string.h>
+#if DRIVER_SPI_CAPTURE_ENABLE
+#include "spi_capture.h"
+#endif
 
-#define NM_BUS_MAX_TRX_SZ 256
+#define NM_BUS_MAX_TRX_SZ CONF_WINC_SPI_MAX_TRX_SZ
 
 tstrNmBusCapabilities egstrNmBusCapabilities = {
     NM_BUS_MAX_TRX_SZ};
 
-sint8 nm_spi_rw(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
+static tstrNmBusStats gstrStats;
+
+// SCK rates of the LOW and HIGH profiles and the one in use. The rates are
+// what the SPI block runs once a profile has been in use.
+static uint32 gau32ProfileHz[2] = {CONF_WINC_SPI_LOW_HZ, CONF_WINC_SPI_HIGH_HZ};
+static uint8 gu8Level = 1;
+
+// Set while the pieces of an NM_BUS_IOCTL_RW_SG transfer are clocked, CS
+// stays low between them
+static volatile bool gbHoldCs;
+
+#if DRIVER_SPI_CAPTURE_ENABLE
+static spi_capture_t gstrCapture;
+
+void nm_bus_capture_drain(void)
 {
-    gpio_put(CONF_WINC_SPI_CS_PIN, 0);
-    sleep_us(1);
-
-#if DRIVER_SPI_LOG_ENABLE
-    printf("[DRIVER] SPI R/W - Size: %d\n", u16Sz);
-    if (pu8Mosi != NULL) {
-        printf("[DRIVER] MOSI: ");
-        for (int i = 0; i < u16Sz; i++) {
-            printf("%02x ", pu8Mosi[i]);
+    spi_capture_drain(&gstrCapture, SPI_CAPTURE_RING_SIZE);
+}
+#endif
+
+// Before CS goes down. The trace keeps the command, the first MOSI bytes;
+// DRIVER_SPI_CAPTURE_ENABLE records whole transfers.
+static void spi_begin(uint8 *pu8Mosi, uint16 u16Sz)
+{
+    NM_TRACE(NM_TRACE_BUS, M2M_LOG_DBG, BUS_RW, u16Sz, nm_trace_be32(pu8Mosi, u16Sz));
+}
+
+// Bookkeeping once CS is up again
+static void spi_done(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
+{
+    gstrStats.u32Transfers++;
+    gstrStats.u32Bytes += u16Sz;
+
+#if DRIVER_SPI_CAPTURE_ENABLE
+    spi_capture_write(&gstrCapture, pu8Mosi, pu8Miso, u16Sz);
+#endif
+}
+
+#if CONF_WINC_SPI_DMA
+// A TX and an RX channel clock the transfer, the RX channel's completion
+// interrupt (DMA_IRQ_1, the simulator has DMA_IRQ_0) releases CS. The last
+// byte is in memory by then, so the bus is idle.
+static int gs32TxChannel = -1;
+static int gs32RxChannel = -1;
+static bool gbIrqInstalled;
+static volatile bool gbBusy;
+static const uint8 gu8TxZero;   // Sent when there is no MOSI buffer
+static uint8 gu8RxSink;         // Receives MISO nobody asked for
+
+// The running transfer, for nm_spi_rw_progress() and nm_spi_rw_wait()
+static uint8 *gpu8Mosi;
+static uint8 *gpu8Miso;
+static uint16 gu16Sz;
+
+static void spi_dma_isr(void)
+{
+    if (gs32RxChannel >= 0 && dma_channel_get_irq1_status(gs32RxChannel)) {
+        dma_channel_acknowledge_irq1(gs32RxChannel);
+        if (!gbHoldCs) {
+            gpio_put(CONF_WINC_SPI_CS_PIN, 1);
         }
-        printf("\n");
+        gbBusy = false;
+        __sev();
     }
+}
+
+static void spi_dma_init(void)
+{
+    gs32TxChannel = dma_claim_unused_channel(true);
+    gs32RxChannel = dma_claim_unused_channel(true);
+    dma_channel_set_irq1_enabled(gs32RxChannel, true);
+    if (!gbIrqInstalled) {
+        irq_add_shared_handler(DMA_IRQ_1, spi_dma_isr, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_1, true);
+        gbIrqInstalled = true;
+    }
+}
+
+static void spi_dma_deinit(void)
+{
+    if (gs32RxChannel < 0) {
+        return;
+    }
+    dma_channel_set_irq1_enabled(gs32RxChannel, false);
+    dma_channel_abort(gs32TxChannel);
+    dma_channel_abort(gs32RxChannel);
+    dma_channel_unclaim(gs32TxChannel);
+    dma_channel_unclaim(gs32RxChannel);
+    gs32TxChannel = -1;
+    gs32RxChannel = -1;
+}
+
+// Without pu8Mosi the TX channel sends gu8TxZero, its read increment off
+static sint8 spi_dma_start(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
+{
+    spi_hw_t *hw = spi_get_hw(CONF_WINC_SPI_PORT);
+    dma_channel_config c;
+
+    if (u16Sz == 0 || gbBusy)
+    {
+        return M2M_ERR_BUS_FAIL;
+    }
+
+    spi_begin(pu8Mosi, u16Sz);
+
+    // Anything left in the RX FIFO would shift MISO by a byte
+    while (spi_is_readable(CONF_WINC_SPI_PORT)) {
+        (void)hw->dr;
+    }
+
+    c = dma_channel_get_default_config(gs32RxChannel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, pu8Miso != NULL);
+    channel_config_set_dreq(&c, spi_get_dreq(CONF_WINC_SPI_PORT, false));
+    dma_channel_configure(gs32RxChannel, &c, pu8Miso ? pu8Miso : &gu8RxSink, &hw->dr, u16Sz, false);
+
+    c = dma_channel_get_default_config(gs32TxChannel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, pu8Mosi != NULL);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, spi_get_dreq(CONF_WINC_SPI_PORT, true));
+    dma_channel_configure(gs32TxChannel, &c, &hw->dr, pu8Mosi ? pu8Mosi : &gu8TxZero, u16Sz, false);
+
+    gpu8Mosi = pu8Mosi;
+    gpu8Miso = pu8Miso;
+    gu16Sz = u16Sz;
+    gbBusy = true;
+
+    gpio_put(CONF_WINC_SPI_CS_PIN, 0);
+    dma_start_channel_mask((1u << gs32TxChannel) | (1u << gs32RxChannel));
+
+    return M2M_SUCCESS;
+}
+
+sint8 nm_spi_rw_start(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
+{
+    if (pu8Mosi == NULL && pu8Miso == NULL)
+    {
+        return M2M_ERR_BUS_FAIL;
+    }
+    return spi_dma_start(pu8Mosi, pu8Miso, u16Sz);
+}
+
+uint16 nm_spi_rw_progress(void)
+{
+    if (!gbBusy) {
+        return gu16Sz;
+    }
+    return (uint16)(gu16Sz - dma_channel_hw_addr(gs32RxChannel)->transfer_count);
+}
+
+sint8 nm_spi_rw_wait(void)
+{
+    while (gbBusy) {
+        __wfe();
+    }
+
+    gstrStats.u32DmaTransfers++;
+    spi_done(gpu8Mosi, gpu8Miso, gu16Sz);
+
+    return M2M_SUCCESS;
+}
 #endif
 
+sint8 nm_spi_rw(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
+{
     if (pu8Mosi == NULL && pu8Miso == NULL)
     {
-        gpio_put(CONF_WINC_SPI_CS_PIN, 1);
         return M2M_ERR_BUS_FAIL;
     }
-    else if (pu8Mosi == NULL)
+
+#if CONF_WINC_SPI_DMA
+    if (u16Sz >= NM_BUS_DMA_MIN_SZ)
+    {
+        if (nm_spi_rw_start(pu8Mosi, pu8Miso, u16Sz) != M2M_SUCCESS)
+        {
+            return M2M_ERR_BUS_FAIL;
+        }
+        return nm_spi_rw_wait();
+    }
+#endif
+
+    spi_begin(pu8Mosi, u16Sz);
+
+    gpio_put(CONF_WINC_SPI_CS_PIN, 0);
+
+    if (pu8Mosi == NULL)
     {
         spi_read_blocking(CONF_WINC_SPI_PORT, 0, pu8Miso, u16Sz);
     }
@@ -46,26 +223,72 @@ sint8 nm_spi_rw(uint8 *pu8Mosi, uint8 *pu8Miso, uint16 u16Sz)
         spi_write_read_blocking(CONF_WINC_SPI_PORT, pu8Mosi, pu8Miso, u16Sz);
     }
 
-#if DRIVER_SPI_LOG_ENABLE
-    if (pu8Miso != NULL) {
-        printf("[DRIVER] MISO: ");
-        for (int i = 0; i < u16Sz; i++) {
-            printf("%02x ", pu8Miso[i]);
-        }
-        printf("\n");
+    // The blocking calls return once the last byte is in, so the bus is idle
+    if (!gbHoldCs)
+    {
+        gpio_put(CONF_WINC_SPI_CS_PIN, 1);
     }
-#endif
 
-    sleep_us(1);
-    gpio_put(CONF_WINC_SPI_CS_PIN, 1);
+    spi_done(pu8Mosi, pu8Miso, u16Sz);
 
     return M2M_SUCCESS;
 }
 
+// One CS cycle for all pieces. A piece with neither buffer clocks zeros.
+static sint8 nm_spi_rw_sg(tstrNmSpiRw *pstrRw, uint8 u8Count)
+{
+    static const uint8 au8Zeros[16];
+    sint8 s8Ret = M2M_SUCCESS;
+
+    gbHoldCs = true;
+    for (uint8 i = 0; i < u8Count && s8Ret == M2M_SUCCESS; i++)
+    {
+        tstrNmSpiRw *pstrPiece = &pstrRw[i];
+#if CONF_WINC_SPI_DMA
+        if (pstrPiece->pu8InBuf == NULL && pstrPiece->pu8OutBuf == NULL &&
+            pstrPiece->u16Sz >= NM_BUS_DMA_MIN_SZ)
+        {
+            // One transfer, the TX channel repeats a single zero byte
+            s8Ret = spi_dma_start(NULL, NULL, pstrPiece->u16Sz);
+            if (s8Ret == M2M_SUCCESS)
+            {
+                s8Ret = nm_spi_rw_wait();
+            }
+        }
+        else
+#endif
+        if (pstrPiece->pu8InBuf == NULL && pstrPiece->pu8OutBuf == NULL)
+        {
+            for (uint16 u16Off = 0; u16Off < pstrPiece->u16Sz && s8Ret == M2M_SUCCESS; u16Off += sizeof(au8Zeros))
+            {
+                uint16 u16Sz = pstrPiece->u16Sz - u16Off;
+                if (u16Sz > sizeof(au8Zeros)) u16Sz = sizeof(au8Zeros);
+                s8Ret = nm_spi_rw((uint8 *)au8Zeros, NULL, u16Sz);
+            }
+        }
+        else if (pstrPiece->u16Sz != 0)
+        {
+            s8Ret = nm_spi_rw(pstrPiece->pu8InBuf, pstrPiece->pu8OutBuf, pstrPiece->u16Sz);
+        }
+    }
+    gbHoldCs = false;
+    gpio_put(CONF_WINC_SPI_CS_PIN, 1);
+
+    return s8Ret;
+}
+
+void nm_bus_get_stats(tstrNmBusStats *pstrStats)
+{
+    *pstrStats = gstrStats;
+}
+
 sint8 nm_bus_init(void *pvinit)
 {
     printf("nm_bus_init\n");
-    spi_init(CONF_WINC_SPI_PORT, 4 * 1000 * 1000);
+    memset(&gstrStats, 0, sizeof(gstrStats));
+    gu8Level = 1;
+    gstrStats.u32Hz = spi_init(CONF_WINC_SPI_PORT, gau32ProfileHz[gu8Level]);
+    gau32ProfileHz[gu8Level] = gstrStats.u32Hz;
     spi_set_format(CONF_WINC_SPI_PORT, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
 
     gpio_set_function(CONF_WINC_SPI_MISO_PIN, GPIO_FUNC_SPI);
@@ -76,6 +299,15 @@ sint8 nm_bus_init(void *pvinit)
     gpio_set_dir(CONF_WINC_SPI_CS_PIN, GPIO_OUT);
     gpio_put(CONF_WINC_SPI_CS_PIN, 1);
 
+#if CONF_WINC_SPI_DMA
+    spi_dma_init();
+#endif
+
+#if DRIVER_SPI_CAPTURE_ENABLE
+    spi_capture_init(&gstrCapture, time_us_64, SPI_CAPTURE_STREAM_DRIVER);
+#endif
+    nm_trace_init(time_us_64);
+
     nm_bsp_reset();
 
     return M2M_SUCCESS;
@@ -92,6 +324,12 @@ sint8 nm_bus_ioctl(uint8 u8Cmd, void *pvParameter)
         s8Ret = nm_spi_rw(pstrParam->pu8InBuf, pstrParam->pu8OutBuf, pstrParam->u16Sz);
     }
     break;
+    case NM_BUS_IOCTL_RW_SG:
+    {
+        tstrNmSpiRwSg *pstrParam = (tstrNmSpiRwSg *)pvParameter;
+        s8Ret = nm_spi_rw_sg(pstrParam->pstrRw, pstrParam->u8Count);
+    }
+    break;
     default:
         s8Ret = -1;
         M2M_ERR("invalid ioclt cmd\n");
@@ -103,6 +341,9 @@ sint8 nm_bus_ioctl(uint8 u8Cmd, void *pvParameter)
 
 sint8 nm_bus_deinit(void)
 {
+#if CONF_WINC_SPI_DMA
+    spi_dma_deinit();
+#endif
     spi_deinit(CONF_WINC_SPI_PORT);
     return M2M_SUCCESS;
 }
@@ -114,5 +355,35 @@ sint8 nm_bus_reinit(void *config)
 
 sint8 nm_bus_speed(uint8 level)
 {
+    if (level > 1)
+    {
+        return M2M_ERR_INVALID_ARG;
+    }
+    if (level != gu8Level)
+    {
+        gu8Level = level;
+        gstrStats.u32Hz = spi_set_baudrate(CONF_WINC_SPI_PORT, gau32ProfileHz[level]);
+        gau32ProfileHz[level] = gstrStats.u32Hz;
+    }
     return M2M_SUCCESS;
 }
+
+uint32 nm_bus_set_profile(uint8 u8Level, uint32 u32Hz)
+{
+    if (u8Level > 1)
+    {
+        return 0;
+    }
+    gau32ProfileHz[u8Level] = u32Hz;
+    if (u8Level == gu8Level)
+    {
+        gstrStats.u32Hz = spi_set_baudrate(CONF_WINC_SPI_PORT, u32Hz);
+        gau32ProfileHz[u8Level] = gstrStats.u32Hz;
+    }
+    return gau32ProfileHz[u8Level];
+}
+
+uint32 nm_bus_get_profile(uint8 u8Level)
+{
+    return (u8Level > 1) ? 0 : gau32ProfileHz[u8Level];
+}
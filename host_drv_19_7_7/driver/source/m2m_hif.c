@@ -39,6 +39,7 @@
 #include "driver/include/m2m_types.h"
 #include "driver/source/nmasic.h"
 #include "driver/include/m2m_periph.h"
+#include "common/include/nm_trace.h"
 
 #if (defined NM_EDGE_INTERRUPT)&&(defined NM_LEVEL_INTERRUPT)
 #error "only one type of interrupt NM_EDGE_INTERRUPT,NM_LEVEL_INTERRUPT"
@@ -94,18 +95,17 @@ static void isr(void)
 }
 static sint8 hif_set_rx_done(void)
 {
-	uint32 reg;
 	sint8 ret = M2M_SUCCESS;
+	tstrNmRegOp astrOps[] = {
+		/* Set RX Done */
+		{NM_REG_OP_RMW, WIFI_HOST_RCV_CTRL_0, NBIT1, NBIT1},
+	};
 
 	gstrHifCxt.u8HifRXDone = 0;
 #ifdef NM_EDGE_INTERRUPT
 	nm_bsp_interrupt_ctrl(1);
 #endif
-	ret = nm_read_reg_with_ret(WIFI_HOST_RCV_CTRL_0,&reg);
-	if(ret != M2M_SUCCESS)goto ERR1;
-	/* Set RX Done */
-	reg |= NBIT1;
-	ret = nm_write_reg(WIFI_HOST_RCV_CTRL_0,reg);
+	ret = nm_reg_batch(astrOps, 1);
 	if(ret != M2M_SUCCESS)goto ERR1;
 #ifdef NM_LEVEL_INTERRUPT
 	nm_bsp_interrupt_ctrl(1);
@@ -307,6 +307,7 @@ sint8 hif_send(uint8 u8Gid,uint8 u8Opcode,uint8 *pu8CtrlBuf,uint16 u16CtrlBufSiz
 	{
 		strHif.u16Length += u16CtrlBufSize;
 	}
+	NM_TRACE(NM_TRACE_HIF, M2M_LOG_INFO, HIF_SEND, ((uint32)u8Gid << 8) | u8Opcode, strHif.u16Length);
     if (strHif.u16Length <= M2M_HIF_MAX_PACKET_SIZE)
     {
 	ret = hif_chip_wake();
@@ -314,6 +315,12 @@ sint8 hif_send(uint8 u8Gid,uint8 u8Opcode,uint8 *pu8CtrlBuf,uint16 u16CtrlBufSiz
 	{
 		volatile uint32 reg, dma_addr = 0;
 		volatile uint16 cnt = 0;
+		/* Wait for the firmware to take the request and fetch the buffer it
+		   allocated, in one batch */
+		tstrNmRegOp astrOps[] = {
+			{NM_REG_OP_POLL, WIFI_HOST_RCV_CTRL_2, 0, NBIT1, 500},
+			{NM_REG_OP_READ, WIFI_HOST_RCV_CTRL_4},
+		};
 //#define OPTIMIZE_BUS 
 /*please define in firmware also*/
 #ifndef OPTIMIZE_BUS
@@ -326,67 +333,76 @@ sint8 hif_send(uint8 u8Gid,uint8 u8Opcode,uint8 *pu8CtrlBuf,uint16 u16CtrlBufSiz
 
 		reg = 0UL;
 		reg |= NBIT1;
-		ret = nm_write_reg(WIFI_HOST_RCV_CTRL_2, reg);
-		if(M2M_SUCCESS != ret) goto ERR1;
 #else
 		reg = 0UL;
 		reg |= NBIT1;
 		reg |= ((u8Opcode & NBIT7) ? (NBIT2):(0)); /*Data = 1 or config*/
 		reg |= (u8Gid == M2M_REQ_GROUP_IP) ? (NBIT3):(0); /*IP = 1 or non IP*/
 		reg |= ((uint32)strHif.u16Length << 4); /*length of pkt max = 4096*/
+#endif
+		/* The request doorbell is not part of a batch: if a chained
+		   response were misplaced, the fallback would post it twice */
 		ret = nm_write_reg(WIFI_HOST_RCV_CTRL_2, reg);
 		if(M2M_SUCCESS != ret) goto ERR1;
-#endif
-		dma_addr = 0;
-		
-		for(cnt = 0; cnt < 1000; cnt ++)
+
+		ret = nm_reg_batch(astrOps, 2);
+		if(astrOps[0].s8Ret == M2M_ERR_TIME_OUT)
 		{
-			ret = nm_read_reg_with_ret(WIFI_HOST_RCV_CTRL_2,(uint32 *)&reg);
-			if(ret != M2M_SUCCESS) break;
 			/*
 			 * If it takes too long to get a response, the slow down to 
 			 * avoid back-to-back register read operations.
 			 */
-			if(cnt >= 500) {
-				if(cnt < 501) {
-					M2M_INFO("Slowing down...\n");
-				}
-				nm_bsp_sleep(1);
-			}
-			if (!(reg & NBIT1))
+			M2M_INFO("Slowing down...\n");
+			for(cnt = 500; cnt < 1000; cnt ++)
 			{
-				ret = nm_read_reg_with_ret(WIFI_HOST_RCV_CTRL_4,(uint32 *)&dma_addr);
-				if(ret != M2M_SUCCESS) {
-					/*in case of read error clear the DMA address and return error*/
-					dma_addr = 0;
-					goto ERR1;
+				nm_bsp_sleep(1);
+				ret = nm_read_reg_with_ret(WIFI_HOST_RCV_CTRL_2,(uint32 *)&reg);
+				if(ret != M2M_SUCCESS) break;
+				if (!(reg & NBIT1))
+				{
+					ret = nm_read_reg_with_ret(WIFI_HOST_RCV_CTRL_4,(uint32 *)&dma_addr);
+					if(ret != M2M_SUCCESS) {
+						/*in case of read error clear the DMA address and return error*/
+						dma_addr = 0;
+						goto ERR1;
+					}
+					/*in case of success break */
+					break;
 				}
-				/*in case of success break */
-				break;
 			}
 		}
+		else if(ret == M2M_SUCCESS)
+		{
+			dma_addr = astrOps[1].u32Rd;
+		}
+		else
+		{
+			goto ERR1;
+		}
 
 		if (dma_addr != 0)
 		{
-			volatile uint32	u32CurrAddr;
-			u32CurrAddr = dma_addr;
+			tstrNmIov	astrIov[4];
+			uint8		u8Count = 0;
 			strHif.u16Length=NM_BSP_B_L_16(strHif.u16Length);
-			ret = nm_write_block(u32CurrAddr, (uint8*)&strHif, M2M_HIF_HDR_OFFSET);
-			if(M2M_SUCCESS != ret) goto ERR1;
-			u32CurrAddr += M2M_HIF_HDR_OFFSET;
+			/* Header, control and data go out as one block, the gap up to
+			   the data offset is written as zeros */
+			astrIov[u8Count].pu8Buf = (uint8*)&strHif;
+			astrIov[u8Count++].u16Sz = M2M_HIF_HDR_OFFSET;
 			if(pu8CtrlBuf != NULL)
 			{
-				ret = nm_write_block(u32CurrAddr, pu8CtrlBuf, u16CtrlBufSize);
-				if(M2M_SUCCESS != ret) goto ERR1;
-				u32CurrAddr += u16CtrlBufSize;
+				astrIov[u8Count].pu8Buf = pu8CtrlBuf;
+				astrIov[u8Count++].u16Sz = u16CtrlBufSize;
 			}
 			if(pu8DataBuf != NULL)
 			{
-				u32CurrAddr += (u16DataOffset - u16CtrlBufSize);
-				ret = nm_write_block(u32CurrAddr, pu8DataBuf, u16DataSize);
-				if(M2M_SUCCESS != ret) goto ERR1;
-				u32CurrAddr += u16DataSize;
+				astrIov[u8Count].pu8Buf = NULL;
+				astrIov[u8Count++].u16Sz = (uint16)(u16DataOffset - u16CtrlBufSize);
+				astrIov[u8Count].pu8Buf = pu8DataBuf;
+				astrIov[u8Count++].u16Sz = u16DataSize;
 			}
+			ret = nm_write_block_sg(dma_addr, astrIov, u8Count);
+			if(M2M_SUCCESS != ret) goto ERR1;
 
 			reg = dma_addr << 2;
 			reg |= NBIT1;
@@ -480,6 +496,7 @@ static sint8 hif_isr(void)
 						goto ERR1;
 					}
 				}
+				NM_TRACE(NM_TRACE_HIF, M2M_LOG_INFO, HIF_RECEIVE, ((uint32)strHif.u8Gid << 8) | strHif.u8Opcode, strHif.u16Length);
 
 				if(M2M_REQ_GROUP_WIFI == strHif.u8Gid)
 				{
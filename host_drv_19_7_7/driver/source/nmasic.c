@@ -114,29 +114,18 @@ void chip_idle(void)
 
 sint8 enable_interrupts(void)
 {
-	uint32 reg = 0;
-	sint8 ret = M2M_SUCCESS;
-	/**
-	interrupt pin mux select
-	**/
-	ret = nm_read_reg_with_ret(NMI_PIN_MUX_0, &reg);
-	if (M2M_SUCCESS != ret) goto ERR1;
-	
-	reg |= ((uint32) 1 << 8);
-	ret = nm_write_reg(NMI_PIN_MUX_0, reg);
-	if (M2M_SUCCESS != ret) goto ERR1;
-	
-	/**
-	interrupt enable
-	**/
-	ret = nm_read_reg_with_ret(NMI_INTR_ENABLE, &reg);
-	if (M2M_SUCCESS != ret) goto ERR1;
-	
-	reg |= ((uint32) 1 << 16);
-	ret = nm_write_reg(NMI_INTR_ENABLE, reg);
-	if (M2M_SUCCESS != ret) goto ERR1;
-ERR1:	
-	return ret;
+	tstrNmRegOp astrOps[] = {
+		/**
+		interrupt pin mux select
+		**/
+		{NM_REG_OP_RMW, NMI_PIN_MUX_0, ((uint32) 1 << 8), ((uint32) 1 << 8)},
+		/**
+		interrupt enable
+		**/
+		{NM_REG_OP_RMW, NMI_INTR_ENABLE, ((uint32) 1 << 16), ((uint32) 1 << 16)},
+	};
+
+	return nm_reg_batch(astrOps, 2);
 }
 
 sint8 cpu_start(void) {
@@ -276,74 +265,39 @@ void nmi_set_sys_clk_src_to_xo(void)
 }
 sint8 chip_sleep(void)
 {
-	uint32 reg;
 	sint8 ret = M2M_SUCCESS;
-	
-	while(1)
-	{
-		ret = nm_read_reg_with_ret(CORT_HOST_COMM,&reg);
-		if(ret != M2M_SUCCESS) goto ERR1;
-		if((reg & NBIT0) == 0) break;
-	}
-	
-	/* Clear bit 1 */
-	ret = nm_read_reg_with_ret(WAKE_CLK_REG, &reg);
-	if(ret != M2M_SUCCESS)goto ERR1;
-	if(reg & NBIT1)
-	{
-		reg &=~NBIT1;
-		ret = nm_write_reg(WAKE_CLK_REG, reg);
-		if(ret != M2M_SUCCESS)goto ERR1;
-	}
-	
-	ret = nm_read_reg_with_ret(HOST_CORT_COMM, &reg);
-	if(ret != M2M_SUCCESS)goto ERR1;
-	if(reg & NBIT0)
+	tstrNmRegOp astrOps[] = {
+		{NM_REG_OP_POLL, CORT_HOST_COMM, 0, NBIT0, 0xFFFF},
+		/* Clear bit 1 */
+		{NM_REG_OP_UPDATE, WAKE_CLK_REG, 0, NBIT1},
+		{NM_REG_OP_UPDATE, HOST_CORT_COMM, 0, NBIT0},
+	};
+
+	do
 	{
-		reg &= ~NBIT0;
-		ret = nm_write_reg(HOST_CORT_COMM, reg);
-		if(ret != M2M_SUCCESS)goto ERR1;
-	}
+		ret = nm_reg_batch(astrOps, 3);
+	} while(astrOps[0].s8Ret == M2M_ERR_TIME_OUT);
 
-ERR1:
 	return ret;
 }
 sint8 chip_wake(void)
 {
 	sint8 ret = M2M_SUCCESS;
-	uint32 reg = 0, clk_status_reg = 0,trials = 0;
+	uint32 trials = 0;
+	tstrNmRegOp astrOps[] = {
+		/*USE bit 0 to indicate host wakeup*/
+		{NM_REG_OP_UPDATE, HOST_CORT_COMM, NBIT0, NBIT0},
+		/* Set bit 1 */
+		{NM_REG_OP_UPDATE, WAKE_CLK_REG, NBIT1, NBIT1},
+		{NM_REG_OP_POLL, CLOCKS_EN_REG, NBIT2, NBIT2, 1},
+	};
 
 	nm_bus_speed(LOW);
 
-	ret = nm_read_reg_with_ret(HOST_CORT_COMM, &reg);
-	if(ret != M2M_SUCCESS)goto _WAKE_EXIT;
-	
-	if(!(reg & NBIT0))
+	ret = nm_reg_batch(astrOps, 3);
+	/* Give the clocks time to come up */
+	while(astrOps[2].s8Ret == M2M_ERR_TIME_OUT)
 	{
-		/*USE bit 0 to indicate host wakeup*/
-		ret = nm_write_reg(HOST_CORT_COMM, reg|NBIT0);
-		if(ret != M2M_SUCCESS)goto _WAKE_EXIT;
-	}
-		
-	ret = nm_read_reg_with_ret(WAKE_CLK_REG, &reg);
-	if(ret != M2M_SUCCESS)goto _WAKE_EXIT;
-	/* Set bit 1 */
-	if(!(reg & NBIT1))
-	{
-		ret = nm_write_reg(WAKE_CLK_REG, reg | NBIT1);
-		if(ret != M2M_SUCCESS) goto _WAKE_EXIT;	
-	}
-
-	do
-	{
-		ret = nm_read_reg_with_ret(CLOCKS_EN_REG, &clk_status_reg);
-		if(ret != M2M_SUCCESS) {
-			M2M_ERR("Bus error (5).%d %lx\n",ret,clk_status_reg);
-			goto _WAKE_EXIT;
-		}
-		if(clk_status_reg & NBIT2) {
-			break;
-		}
 		nm_bsp_sleep(2);
 		trials++;
 		if(trials > WAKUP_TRAILS_TIMEOUT)
@@ -352,7 +306,12 @@ sint8 chip_wake(void)
 			ret = M2M_ERR_TIME_OUT;
 			goto _WAKE_EXIT;
 		}
-	}while(1);
+		ret = nm_reg_batch(&astrOps[2], 1);
+	}
+	if(ret != M2M_SUCCESS) {
+		M2M_ERR("Bus error (5).%d %lx\n",ret,astrOps[2].u32Rd);
+		goto _WAKE_EXIT;
+	}
 	
 	/*workaround sometimes spi fail to read clock regs after reading/writing clockless registers*/
 	nm_bus_reset();
@@ -288,5 +288,179 @@ sint8 nm_write_block(uint32 u32Addr, uint8 *puBuf, uint32 u32Sz)
 	return s8Ret;
 }
 
+/* Source of the zeros a piece without a buffer writes, when the pieces
+   are written one by one */
+static uint8 gau8SgZeros[64];
+
+/**
+*	@fn		nm_write_block_sg
+*	@brief	Write a block of data gathered from several buffers
+*	@param [in]	u32Addr
+*				Start address
+*	@param [in]	pstrIov
+*				Pieces in address order, a piece with a NULL buffer writes zeros
+*	@param [in]	u8Count
+*				Number of pieces
+*	@return	M2M_SUCCESS in case of success and M2M_ERR_BUS_FAIL in case of failure
+*	@note	On SPI a block that fits one transaction goes out as a single DMA_EXT
+*			write straight from the pieces. Otherwise every piece is written
+*			on its own with nm_write_block, a piece without a buffer in
+*			blocks of zeros.
+*/
+sint8 nm_write_block_sg(uint32 u32Addr, tstrNmIov *pstrIov, uint8 u8Count)
+{
+	uint16 u16MaxTrxSz = egstrNmBusCapabilities.u16MaxTrxSz - MAX_TRX_CFG_SZ;
+	uint32 u32Sz = 0;
+	sint8 s8Ret = M2M_SUCCESS;
+	uint8 i;
+
+	for(i = 0; i < u8Count; i++)
+	{
+		u32Sz += pstrIov[i].u16Sz;
+	}
+#ifdef CONF_WINC_USE_SPI
+	if((u32Sz >= 2) && (u32Sz <= u16MaxTrxSz))
+	{
+		return nm_spi_write_block_sg(u32Addr, pstrIov, u8Count);
+	}
 #endif
+	for(i = 0; (i < u8Count) && (M2M_SUCCESS == s8Ret); i++)
+	{
+		uint16 u16Off, u16Sz;
 
+		for(u16Off = 0; (u16Off < pstrIov[i].u16Sz) && (M2M_SUCCESS == s8Ret); u16Off += u16Sz)
+		{
+			u16Sz = pstrIov[i].u16Sz - u16Off;
+			if(pstrIov[i].pu8Buf != NULL)
+			{
+				s8Ret = nm_write_block(u32Addr + u16Off, pstrIov[i].pu8Buf + u16Off, u16Sz);
+			}
+			else
+			{
+				if(u16Sz > sizeof(gau8SgZeros)) u16Sz = sizeof(gau8SgZeros);
+				s8Ret = nm_write_block(u32Addr + u16Off, gau8SgZeros, u16Sz);
+			}
+		}
+		u32Addr += pstrIov[i].u16Sz;
+	}
+
+	return s8Ret;
+}
+
+/* Register accesses collected before they go to the bus together */
+#define NM_REG_CHAIN_MAX	8
+
+static sint8 p_nm_reg_chain(tstrNmRegOp *pstrOps, uint8 u8Count)
+{
+#ifdef CONF_WINC_USE_SPI
+	return nm_spi_reg_chain(pstrOps, u8Count);
+#else
+	sint8 s8Ret = M2M_SUCCESS;
+	uint8 i;
+
+	for(i = 0; (i < u8Count) && (s8Ret == M2M_SUCCESS); i++)
+	{
+		if(pstrOps[i].u8Op == NM_REG_OP_WRITE)
+			s8Ret = nm_write_reg(pstrOps[i].u32Addr, pstrOps[i].u32Val);
+		else
+			s8Ret = nm_read_reg_with_ret(pstrOps[i].u32Addr, &pstrOps[i].u32Rd);
+		pstrOps[i].s8Ret = s8Ret;
+	}
+	return s8Ret;
+#endif
+}
+
+/*
+*	@fn		nm_reg_batch
+*	@brief	Run a list of register operations in order
+*	@param [in, out]	pstrOps
+*				Operations, see tenuNmRegOp. Each one reports its result in s8Ret
+*				and the last value it read in u32Rd.
+*	@param [in]	u8Count
+*				Number of operations
+*	@return	M2M_SUCCESS in case of success, otherwise the result of the
+*				operation that failed. The ones after it do not run.
+*	@note	Reads and writes are collected and go to the bus together, on SPI
+*			in one transfer. A read-modify-write or a poll ends the collection
+*			with its first read, as what follows depends on the value. The
+*			write of a read-modify-write starts the next one. A write may
+*			reach the chip twice (see nm_spi_reg_chain), so keep doorbell
+*			writes out of a batch.
+*/
+sint8 nm_reg_batch(tstrNmRegOp *pstrOps, uint8 u8Count)
+{
+	tstrNmRegOp astrChain[NM_REG_CHAIN_MAX];
+	uint8 au8Op[NM_REG_CHAIN_MAX];	/* Operation each access belongs to */
+	uint8 u8Chain = 0;
+	uint8 i = 0, j;
+	sint8 s8Ret = M2M_SUCCESS;
+
+	for(j = 0; j < u8Count; j++)
+	{
+		pstrOps[j].s8Ret = M2M_ERR_FAIL;
+	}
+
+	while((i < u8Count) || (u8Chain > 0))
+	{
+		tstrNmRegOp *pstrOp = NULL;
+
+		while((i < u8Count) && (u8Chain < NM_REG_CHAIN_MAX))
+		{
+			astrChain[u8Chain].u8Op = (pstrOps[i].u8Op == NM_REG_OP_WRITE) ? NM_REG_OP_WRITE : NM_REG_OP_READ;
+			astrChain[u8Chain].u32Addr = pstrOps[i].u32Addr;
+			astrChain[u8Chain].u32Val = pstrOps[i].u32Val;
+			astrChain[u8Chain].s8Ret = M2M_ERR_FAIL;
+			au8Op[u8Chain++] = i++;
+			if((pstrOps[i - 1].u8Op != NM_REG_OP_READ) && (pstrOps[i - 1].u8Op != NM_REG_OP_WRITE))
+			{
+				pstrOp = &pstrOps[i - 1];
+				break;
+			}
+		}
+
+		s8Ret = p_nm_reg_chain(astrChain, u8Chain);
+		for(j = 0; j < u8Chain; j++)
+		{
+			pstrOps[au8Op[j]].s8Ret = astrChain[j].s8Ret;
+			if(astrChain[j].u8Op == NM_REG_OP_READ)
+				pstrOps[au8Op[j]].u32Rd = astrChain[j].u32Rd;
+		}
+		u8Chain = 0;
+		if(s8Ret != M2M_SUCCESS) break;
+		if(pstrOp == NULL) continue;
+
+		if(pstrOp->u8Op != NM_REG_OP_POLL)
+		{
+			uint32 u32Val = (pstrOp->u32Rd & ~pstrOp->u32Mask) | (pstrOp->u32Val & pstrOp->u32Mask);
+			if((pstrOp->u8Op == NM_REG_OP_RMW) || (u32Val != pstrOp->u32Rd))
+			{
+				astrChain[0].u8Op = NM_REG_OP_WRITE;
+				astrChain[0].u32Addr = pstrOp->u32Addr;
+				astrChain[0].u32Val = u32Val;
+				astrChain[0].s8Ret = M2M_ERR_FAIL;
+				au8Op[0] = (uint8)(pstrOp - pstrOps);
+				u8Chain = 1;
+			}
+		}
+		else
+		{
+			uint16 u16Reads = 1;
+			while((pstrOp->u32Rd & pstrOp->u32Mask) != (pstrOp->u32Val & pstrOp->u32Mask))
+			{
+				if(u16Reads++ >= pstrOp->u16Count)
+				{
+					s8Ret = M2M_ERR_TIME_OUT;
+					break;
+				}
+				s8Ret = nm_read_reg_with_ret(pstrOp->u32Addr, &pstrOp->u32Rd);
+				if(s8Ret != M2M_SUCCESS) break;
+			}
+			pstrOp->s8Ret = s8Ret;
+			if(s8Ret != M2M_SUCCESS) break;
+		}
+	}
+
+	return s8Ret;
+}
+
+#endif
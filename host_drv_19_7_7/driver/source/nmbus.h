@@ -130,6 +130,33 @@ sint8 nm_read_block(uint32 u32Addr, uint8 *puBuf, uint32 u32Sz);
 */ 
 sint8 nm_write_block(uint32 u32Addr, uint8 *puBuf, uint32 u32Sz);
 
+/**
+*	@fn		nm_write_block_sg
+*	@brief	Write a block of data gathered from several buffers
+*	@param [in]	u32Addr
+*				Start address
+*	@param [in]	pstrIov
+*				Pieces in address order, a piece with a NULL buffer writes zeros
+*	@param [in]	u8Count
+*				Number of pieces
+*	@return	ZERO in case of success and M2M_ERR_BUS_FAIL in case of failure
+*/
+sint8 nm_write_block_sg(uint32 u32Addr, tstrNmIov *pstrIov, uint8 u8Count);
+
+/**
+*	@fn		nm_reg_batch
+*	@brief	Run a list of register operations in order
+*	@param [in, out]	pstrOps
+*				Operations, see tenuNmRegOp. Each one reports its result in s8Ret
+*				and the last value it read in u32Rd.
+*	@param [in]	u8Count
+*				Number of operations
+*	@return	ZERO in case of success, otherwise the result of the operation that
+*				failed. The ones after it do not run.
+*/
+sint8 nm_reg_batch(tstrNmRegOp *pstrOps, uint8 u8Count);
+
+
 
 
 
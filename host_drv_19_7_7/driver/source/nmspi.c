@@ -38,6 +38,8 @@
 
 #include "bus_wrapper/include/nm_bus_wrapper.h"
 #include "nmspi.h"
+#include "common/include/nm_crc16.h"
+#include "common/include/nm_trace.h"
 
 #define NMI_PERIPH_REG_BASE 0x1000
 #define NMI_INTR_REG_BASE (NMI_PERIPH_REG_BASE+0xa00)
@@ -56,6 +58,7 @@
 #define NMI_SPI_INTR_CTL (NMI_SPI_REG_BASE+0x2c)
 #define NMI_SPI_MISC_CTRL (NMI_SPI_REG_BASE+0x48)
 
+#define NMI_SPI_PROTOCOL_CRC_MASK 0xc /* bit 2: command CRC7, bit 3: data CRC16 */
 #define NMI_SPI_PROTOCOL_OFFSET (NMI_SPI_PROTOCOL_CONFIG-NMI_SPI_REG_BASE)
 
 #define SPI_BASE                NMI_SPI_REG_BASE
@@ -84,12 +87,70 @@
 #define DATA_PKT_SZ_1K			1024
 #define DATA_PKT_SZ_4K			(4 * 1024)
 #define DATA_PKT_SZ_8K			(8 * 1024)
-#define DATA_PKT_SZ				DATA_PKT_SZ_8K
 
 static uint8 	gu8Crc_off	=   0;
+/* Data packet size, nm_spi_set_pkt_sz() */
+static uint16	gu16PktSz	=	CONF_WINC_SPI_PKT_SZ;
+/* Attempts per register or block access */
+static uint8	gu8SpiRetry	=	SPI_RETRY_COUNT;
+
+#if CONF_WINC_SPI_PIPELINE
+/*
+	A register access clocks its whole expected response, up to the CRC of
+	the data, in the same transfer as the command (spi_cmd_ahead()). The
+	bytes land here and nmi_spi_read() hands them out before touching the
+	bus, so the response parsing below runs unchanged and only polls the bus
+	if the chip answered later than expected.
+*/
+#define NM_SPI_AHEAD_MAX		24
+
+static uint8	gau8Ahead[NM_SPI_AHEAD_MAX];
+static uint8	gu8AheadPos;
+static uint8	gu8AheadLen;
+/* Filler bytes the chip sent before the last command response */
+static uint8	gu8RspDelay;
+/* Parsing the responses of a chained transfer, the bus has moved on */
+static uint8	gu8AheadOnly;
+
+#define NM_SPI_AHEAD_PENDING()	(gu8AheadPos < gu8AheadLen)
+#define NM_SPI_AHEAD_DROP()		(gu8AheadPos = gu8AheadLen = 0)
+#else
+#define NM_SPI_AHEAD_PENDING()	0
+#define NM_SPI_AHEAD_DROP()		((void)0)
+#endif
+/* Command response and state byte, the start of every response */
+#define NM_SPI_RSP_SZ			2
+/* Whole response to a register access, a read adds the data header, the
+   word and its CRC */
+#define NM_SPI_REG_RSP_SZ(read, clockless)	\
+	(NM_SPI_RSP_SZ + ((read) ? (1 + 4 + (((clockless) || gu8Crc_off) ? 0 : 2)) : 0))
+/* Response to a written block, after its last data packet */
+#define NM_SPI_DATA_RSP_SZ		(gu8Crc_off ? 3 : 2)
+
+#if CONF_WINC_SPI_PIPELINE
+/*
+	nm_spi_reg_chain() sends up to NM_SPI_CHAIN_MAX register accesses in one
+	transfer, each command followed by room for its response.
+*/
+#define NM_SPI_CHAIN_MAX		8
+#define NM_SPI_CHAIN_SZ			(NM_SPI_CHAIN_MAX * (9 + NM_SPI_AHEAD_MAX))
+
+static uint8	gau8ChainTx[NM_SPI_CHAIN_SZ];
+static uint8	gau8ChainRx[NM_SPI_CHAIN_SZ];
+#endif
 
 static inline sint8 nmi_spi_read(uint8 *b, uint16 sz)
 {
+#if CONF_WINC_SPI_PIPELINE
+	while (sz && gu8AheadPos < gu8AheadLen) {
+		*b++ = gau8Ahead[gu8AheadPos++];
+		sz--;
+	}
+	if (sz == 0)
+		return M2M_SUCCESS;
+	if (gu8AheadOnly)
+		return M2M_ERR_BUS_FAIL;
+#endif
     return nm_spi_rw(NULL, b, sz);
 }
 static inline sint8 nmi_spi_write(uint8 *b, uint16 sz)
@@ -101,6 +162,41 @@ static sint8 nmi_spi_writeread(uint8 *bw, uint8 *br, uint16 sz)
     return nm_spi_rw(bw, br, sz);
 }
 
+#ifdef NM_BUS_ASYNC
+/*
+	Data packets run on the bus wrapper's asynchronous transfers, so the CRC16
+	is computed while the packet is on the wire instead of after it. A read is
+	checked in NM_SPI_CRC_CHUNK steps behind the DMA.
+*/
+#define NM_SPI_CRC_CHUNK		64
+
+static sint8 nmi_spi_read_crc(uint8 *b, uint16 sz, uint16 *pu16Crc)
+{
+	uint16 u16Crc = NM_CRC16_SEED;
+	uint16 done = 0;
+
+	if (M2M_SUCCESS != nm_spi_rw_start(NULL, b, sz))
+		return M2M_ERR_BUS_FAIL;
+	while (done < sz) {
+		uint16 avail = nm_spi_rw_progress();
+		if (avail < sz && (uint16)(avail - done) < NM_SPI_CRC_CHUNK)
+			continue;
+		u16Crc = nm_crc16_update(u16Crc, &b[done], avail - done);
+		done = avail;
+	}
+	*pu16Crc = u16Crc;
+	return nm_spi_rw_wait();
+}
+
+static sint8 nmi_spi_write_crc(uint8 *b, uint16 sz, uint16 *pu16Crc)
+{
+	if (M2M_SUCCESS != nm_spi_rw_start(b, NULL, sz))
+		return M2M_ERR_BUS_FAIL;
+	*pu16Crc = nm_crc16(b, sz);
+	return nm_spi_rw_wait();
+}
+#endif
+
 /********************************************
 
 	Crc7
@@ -161,9 +257,9 @@ static inline uint8 crc7(uint8 crc, const uint8 *buffer, uint32 len)
 
 ********************************************/
 
-static sint8 spi_cmd(uint8 cmd, uint32 adr, uint32 u32data, uint32 sz,uint8 clockless)
+/* Encodes the command into bc, returns its length or 0 for an unknown one */
+static uint8 spi_cmd_fmt(uint8 *bc, uint8 cmd, uint32 adr, uint32 u32data, uint32 sz,uint8 clockless)
 {
-	uint8 bc[9];
 	uint8 len = 5;
 	sint8 result = N_OK;
 
@@ -250,31 +346,74 @@ static sint8 spi_cmd(uint8 cmd, uint32 adr, uint32 u32data, uint32 sz,uint8 cloc
 		break;
 	}
 
-    if(result == N_OK) {
-		if (!gu8Crc_off)
-			bc[len-1] = (crc7(0x7f, (const uint8 *)&bc[0], len-1)) << 1;
-		else
-			len-=1;
+	if (result != N_OK)
+		return 0;
+
+	if (!gu8Crc_off)
+		bc[len-1] = (crc7(0x7f, (const uint8 *)&bc[0], len-1)) << 1;
+	else
+		len-=1;
+
+	return len;
+}
+
+/* Sends the command and clocks u8Ahead more bytes of its response, see
+   nmi_spi_read() */
+static sint8 spi_cmd_ahead(uint8 cmd, uint32 adr, uint32 u32data, uint32 sz,uint8 clockless, uint8 u8Ahead)
+{
+#if CONF_WINC_SPI_PIPELINE
+	uint8 bc[9 + NM_SPI_AHEAD_MAX];
+	uint8 br[9 + NM_SPI_AHEAD_MAX];
+#else
+	uint8 bc[9];
+#endif
+	uint8 len;
+	sint8 result = N_OK;
 
-		if (M2M_SUCCESS != nmi_spi_write(bc, len)) {
+#if CONF_WINC_SPI_PIPELINE
+	/* Whatever the last command left unread is stale now */
+	gu8AheadPos = gu8AheadLen = 0;
+#endif
+
+	len = spi_cmd_fmt(bc, cmd, adr, u32data, sz, clockless);
+	if (len == 0)
+		return N_FAIL;
+
+#if CONF_WINC_SPI_PIPELINE
+	if (u8Ahead) {
+		u8Ahead += gu8RspDelay;
+		if (u8Ahead > NM_SPI_AHEAD_MAX)
+			u8Ahead = NM_SPI_AHEAD_MAX;
+		m2m_memset(&bc[len], 0, u8Ahead);
+		if (M2M_SUCCESS != nmi_spi_writeread(bc, br, len + u8Ahead)) {
 			M2M_ERR("[nmi spi]: Failed cmd write, bus error...\n");
 			result = N_FAIL;
+		} else {
+			m2m_memcpy(gau8Ahead, &br[len], u8Ahead);
+			gu8AheadLen = u8Ahead;
 		}
+	} else
+#endif
+	if (M2M_SUCCESS != nmi_spi_write(bc, len)) {
+		M2M_ERR("[nmi spi]: Failed cmd write, bus error...\n");
+		result = N_FAIL;
 	}
 
 	return result;
 }
 
+static inline sint8 spi_cmd(uint8 cmd, uint32 adr, uint32 u32data, uint32 sz,uint8 clockless)
+{
+	return spi_cmd_ahead(cmd, adr, u32data, sz, clockless, 0);
+}
+
 static sint8 spi_data_rsp(uint8 cmd)
 {
 	uint8 len;
 	uint8 rsp[3];
 	sint8 result = N_OK;
 
-    if (!gu8Crc_off)
-		len = 2;
-	else
-		len = 3;
+	len = NM_SPI_DATA_RSP_SZ;
 
 	if (M2M_SUCCESS != nmi_spi_read(&rsp[0], len)) {
 		M2M_ERR("[nmi spi]: Failed bus error...\n");
@@ -329,6 +468,11 @@ static sint8 spi_cmd_rsp(uint8 cmd)
 			goto _fail_;
 		}
 	} while((rsp != cmd) && (s8RetryCnt-- >0));
+#if CONF_WINC_SPI_PIPELINE
+	/* The next pipelined command clocks that much more */
+	if (rsp == cmd)
+		gu8RspDelay = (uint8)(SPI_RESP_RETRY_COUNT - s8RetryCnt);
+#endif
 
 	/**
 		State response
@@ -373,18 +517,21 @@ static sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
 {
 	sint16 retry, ix, nbytes;
 	sint8 result = N_OK;
+	sint8 s8Ret;
 	uint8 crc[2];
+	uint16 u16Crc = 0;
 	uint8 rsp;
+	uint8 u8Overlap = 0;
 
 	/**
 		Data
 	**/
 	ix = 0;
 	do {
-		if (sz <= DATA_PKT_SZ)
+		if (sz <= gu16PktSz)
 			nbytes = sz;
 		else
-			nbytes = DATA_PKT_SZ;
+			nbytes = gu16PktSz;
 
 		/**
 			Data Response header
@@ -412,7 +559,15 @@ static sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
 		/**
 			Read bytes
 		**/
-		if (M2M_SUCCESS != nmi_spi_read(&b[ix], nbytes)) {
+#ifdef NM_BUS_ASYNC
+		/* Not when the bytes were clocked ahead with the command */
+		u8Overlap = !clockless && !gu8Crc_off && !NM_SPI_AHEAD_PENDING();
+		if (u8Overlap)
+			s8Ret = nmi_spi_read_crc(&b[ix], nbytes, &u16Crc);
+		else
+#endif
+		s8Ret = nmi_spi_read(&b[ix], nbytes);
+		if (M2M_SUCCESS != s8Ret) {
 			M2M_ERR("[nmi spi]: Failed data block read, bus error...\n");
 			result = N_FAIL;
 			break;
@@ -428,6 +583,13 @@ static sint8 spi_data_read(uint8 *b, uint16 sz,uint8 clockless)
 					result = N_FAIL;
 					break;
 				}
+				if (!u8Overlap)
+					u16Crc = nm_crc16(&b[ix], nbytes);
+				if (u16Crc != (uint16)((crc[0] << 8) | crc[1])) {
+					M2M_ERR("[nmi spi]: Failed data block crc check...\n");
+					result = N_FAIL;
+					break;
+				}
 			}
 		}
 		ix += nbytes;
@@ -443,29 +605,31 @@ static sint8 spi_data_write(uint8 *b, uint16 sz)
     sint16 ix = 0;
 	uint16 nbytes;
     sint8 result = N_OK;
-	uint8 cmd, order, crc[2] = {0};
+	uint8 cmd, order, crc[2];
+	uint16 u16Crc = 0;
+	sint8 s8Ret;
 	//uint8 rsp;
 
 	/**
 		Data
 	**/
 	do {
-		if (sz <= DATA_PKT_SZ)
+		if (sz <= gu16PktSz)
 			nbytes = sz;
 		else
-			nbytes = DATA_PKT_SZ;
+			nbytes = gu16PktSz;
 
 		/**
 			Write command
 		**/
 		cmd = 0xf0;
 		if (ix == 0)  {
-			if (sz <= DATA_PKT_SZ)
+			if (sz <= gu16PktSz)
 				order = 0x3;
 			else
 				order = 0x1;
 		} else {
-			if (sz <= DATA_PKT_SZ)
+			if (sz <= gu16PktSz)
 				order = 0x3;
 			else
 				order = 0x2;
@@ -480,7 +644,13 @@ static sint8 spi_data_write(uint8 *b, uint16 sz)
 		/**
 			Write data
 		**/
-		if (M2M_SUCCESS != nmi_spi_write(&b[ix], nbytes)) {
+#ifdef NM_BUS_ASYNC
+		if (!gu8Crc_off)
+			s8Ret = nmi_spi_write_crc(&b[ix], nbytes, &u16Crc);
+		else
+#endif
+		s8Ret = nmi_spi_write(&b[ix], nbytes);
+		if (M2M_SUCCESS != s8Ret) {
 			M2M_ERR("[nmi spi]: Failed data block write, bus error...\n");
 			result = N_FAIL;
 			break;
@@ -490,6 +660,11 @@ static sint8 spi_data_write(uint8 *b, uint16 sz)
 			Write Crc
 		**/
 		if (!gu8Crc_off) {
+#ifndef NM_BUS_ASYNC
+			u16Crc = nm_crc16(&b[ix], nbytes);
+#endif
+			crc[0] = (uint8)(u16Crc >> 8);
+			crc[1] = (uint8)u16Crc;
 			if (M2M_SUCCESS != nmi_spi_write(crc, 2)) {
 				M2M_ERR("[nmi spi]: Failed data block crc write, bus error...\n");
 				result = N_FAIL;
@@ -505,12 +680,239 @@ static sint8 spi_data_write(uint8 *b, uint16 sz)
 	return result;
 }
 
+/*
+	Gathered data: each packet goes out in one NM_BUS_IOCTL_RW_SG transfer,
+	the command byte, the pieces it covers and the CRC, so the pieces never
+	need copying into one buffer. A piece without a buffer sends zeros. With
+	CONF_WINC_SPI_PIPELINE the last packet's transfer also clocks the data
+	response, for spi_data_rsp() to take from the read-ahead buffer.
+*/
+#define NM_SPI_SG_MAX_PIECES	8
+
+static uint16 spi_crc16_zeros(uint16 u16Crc, uint16 sz)
+{
+	static const uint8 zeros[16];
+
+	while (sz) {
+		uint16 n = (sz < sizeof(zeros)) ? sz : sizeof(zeros);
+		u16Crc = nm_crc16_update(u16Crc, zeros, n);
+		sz -= n;
+	}
+	return u16Crc;
+}
+
+static sint8 spi_data_write_sg(tstrNmIov *pstrIov, uint8 u8Count, uint16 sz)
+{
+	tstrNmSpiRw astrRw[NM_SPI_SG_MAX_PIECES + 3];
+	tstrNmSpiRwSg strSg;
+	uint16 ix = 0, nbytes, left, piece_off = 0;
+	uint8 piece = 0, n, cmd, order, crc[2];
+	uint16 u16Crc;
+
+	if (u8Count > NM_SPI_SG_MAX_PIECES)
+		return N_FAIL;
+
+	do {
+		if (sz <= gu16PktSz)
+			nbytes = sz;
+		else
+			nbytes = gu16PktSz;
+
+		if (ix == 0)
+			order = (sz <= gu16PktSz) ? 0x3 : 0x1;
+		else
+			order = (sz <= gu16PktSz) ? 0x3 : 0x2;
+		cmd = 0xf0 | order;
+
+		n = 0;
+		astrRw[n].pu8InBuf = &cmd;
+		astrRw[n].pu8OutBuf = NULL;
+		astrRw[n++].u16Sz = 1;
+
+		u16Crc = NM_CRC16_SEED;
+		for (left = nbytes; left; ) {
+			tstrNmIov *pstrPiece = &pstrIov[piece];
+			uint16 take = pstrPiece->u16Sz - piece_off;
+			if (take > left)
+				take = left;
+			if (take) {
+				uint8 *pu8 = pstrPiece->pu8Buf ? &pstrPiece->pu8Buf[piece_off] : NULL;
+				astrRw[n].pu8InBuf = pu8;
+				astrRw[n].pu8OutBuf = NULL;
+				astrRw[n++].u16Sz = take;
+				if (!gu8Crc_off)
+					u16Crc = pu8 ? nm_crc16_update(u16Crc, pu8, take) : spi_crc16_zeros(u16Crc, take);
+				piece_off += take;
+				left -= take;
+			}
+			if (piece_off == pstrPiece->u16Sz) {
+				piece++;
+				piece_off = 0;
+			}
+		}
+
+		if (!gu8Crc_off) {
+			crc[0] = (uint8)(u16Crc >> 8);
+			crc[1] = (uint8)u16Crc;
+			astrRw[n].pu8InBuf = crc;
+			astrRw[n].pu8OutBuf = NULL;
+			astrRw[n++].u16Sz = 2;
+		}
+#if CONF_WINC_SPI_PIPELINE
+		if (sz == nbytes) {
+			astrRw[n].pu8InBuf = NULL;
+			astrRw[n].pu8OutBuf = gau8Ahead;
+			astrRw[n++].u16Sz = NM_SPI_DATA_RSP_SZ;
+		}
+#endif
+
+		strSg.pstrRw = astrRw;
+		strSg.u8Count = n;
+		if (M2M_SUCCESS != nm_bus_ioctl(NM_BUS_IOCTL_RW_SG, &strSg)) {
+			M2M_ERR("[nmi spi]: Failed gathered data block write, bus error...\n");
+			return N_FAIL;
+		}
+
+		ix += nbytes;
+		sz -= nbytes;
+	} while (sz);
+
+#if CONF_WINC_SPI_PIPELINE
+	gu8AheadPos = 0;
+	gu8AheadLen = NM_SPI_DATA_RSP_SZ;
+#endif
+	return N_OK;
+}
+
 /********************************************
 
 	Spi Internal Read/Write Function
 
 ********************************************/
 
+/*
+	Error recovery. After a failed attempt the bus is resynced at once:
+	CMD_RESET and a few idle bytes, no delay. Only a repeated failure of the
+	same access backs off first, CONF_WINC_SPI_BACKOFF_MIN_US doubling up to
+	CONF_WINC_SPI_BACKOFF_MAX_US. Each failure takes NM_SPI_HEALTH_PENALTY
+	off the bus health, which regains a point every
+	CONF_WINC_SPI_HEALTH_REGEN_MS without one. At zero the HIGH clock profile
+	is lowered by CONF_WINC_SPI_DOWNSHIFT percent.
+*/
+#define NM_SPI_RESYNC_IDLE		8
+#define NM_SPI_HEALTH_MAX		100
+#define NM_SPI_HEALTH_PENALTY	20
+
+#ifdef NM_BSP_TIME_US
+#define NM_SPI_NOW_US()			nm_bsp_time_us()
+#define NM_SPI_SLEEP_US(us)		nm_bsp_sleep_us(us)
+#else
+#define NM_SPI_NOW_US()			0
+#define NM_SPI_SLEEP_US(us)		nm_bsp_sleep(((us) + 999) / 1000)
+#endif
+
+static tstrNmSpiErrStats gstrSpiErr = {.u8Health = NM_SPI_HEALTH_MAX};
+/* Time of the first failure of the access being retried, and of the last */
+static uint32 gu32SpiErrStartUs;
+static uint32 gu32SpiErrLastUs;
+
+#if defined(NM_BUS_PROFILES) && CONF_WINC_SPI_DOWNSHIFT
+static void spi_downshift(void)
+{
+	uint32 u32Hz = nm_bus_get_profile(1);
+	uint32 u32Low = nm_bus_get_profile(0);
+	uint32 u32New;
+
+	if(u32Hz <= u32Low)
+		return;
+	u32New = u32Hz / 100 * (100 - CONF_WINC_SPI_DOWNSHIFT);
+	if(u32New < u32Low)
+		u32New = u32Low;
+	u32New = nm_bus_set_profile(1, u32New);
+	gstrSpiErr.u32Downshifts++;
+	NM_TRACE(NM_TRACE_SPI, M2M_LOG_ERROR, SPI_DOWNSHIFT, u32Hz, u32New);
+	M2M_INFO("SPI errors, clock down from %lu to %lu Hz\n", (unsigned long)u32Hz, (unsigned long)u32New);
+}
+#endif
+
+/* A failed attempt, u8Attempt of them before it. Gets the bus ready for
+   the next one. */
+static void spi_recover(uint8 u8Attempt)
+{
+	uint8 au8Idle[NM_SPI_RESYNC_IDLE];
+	uint32 u32Now, u32Regen, u32Delay;
+
+	/* A single attempt is a caller probing the bus, calibration, that
+	   wants the error and not the statistics */
+	if(gu8SpiRetry > 1)
+	{
+		u32Now = NM_SPI_NOW_US();
+		gstrSpiErr.u32Errors++;
+		if(u8Attempt == 0)
+			gu32SpiErrStartUs = u32Now;
+
+		u32Regen = (u32Now - gu32SpiErrLastUs) / (CONF_WINC_SPI_HEALTH_REGEN_MS * 1000ul);
+		gu32SpiErrLastUs = u32Now;
+		if(u32Regen > NM_SPI_HEALTH_MAX - gstrSpiErr.u8Health)
+			u32Regen = NM_SPI_HEALTH_MAX - gstrSpiErr.u8Health;
+		gstrSpiErr.u8Health += (uint8)u32Regen;
+		if(gstrSpiErr.u8Health > NM_SPI_HEALTH_PENALTY)
+		{
+			gstrSpiErr.u8Health -= NM_SPI_HEALTH_PENALTY;
+		}
+		else
+		{
+			gstrSpiErr.u8Health = NM_SPI_HEALTH_MAX;
+#if defined(NM_BUS_PROFILES) && CONF_WINC_SPI_DOWNSHIFT
+			spi_downshift();
+#endif
+		}
+
+		if(u8Attempt == 0)
+		{
+			gstrSpiErr.u32Resyncs++;
+		}
+		else
+		{
+			u32Delay = (u8Attempt > 16) ? CONF_WINC_SPI_BACKOFF_MAX_US :
+				(uint32)CONF_WINC_SPI_BACKOFF_MIN_US << (u8Attempt - 1);
+			if(u32Delay > CONF_WINC_SPI_BACKOFF_MAX_US)
+				u32Delay = CONF_WINC_SPI_BACKOFF_MAX_US;
+			gstrSpiErr.u32Backoffs++;
+			NM_SPI_SLEEP_US(u32Delay);
+		}
+	}
+
+#if CONF_WINC_SPI_PIPELINE
+	/* Whatever was read ahead belongs to the failed attempt */
+	gu8AheadPos = gu8AheadLen = 0;
+#endif
+	spi_cmd(CMD_RESET, 0, 0, 0, 0);
+	spi_cmd_rsp(CMD_RESET);
+	/* Idle clocks let the chip finish the reset before the next command */
+	m2m_memset(au8Idle, 0, sizeof(au8Idle));
+	nmi_spi_write(au8Idle, sizeof(au8Idle));
+}
+
+/* End of an access that needed spi_recover() */
+static void spi_recover_done(sint8 result)
+{
+	uint32 u32Us;
+
+	if(gu8SpiRetry <= 1)
+		return;
+	if(result != N_OK)
+	{
+		gstrSpiErr.u32Failed++;
+		return;
+	}
+	u32Us = NM_SPI_NOW_US() - gu32SpiErrStartUs;
+	gstrSpiErr.u32Recovered++;
+	gstrSpiErr.u32RecoveryUsTotal += u32Us;
+	if(u32Us > gstrSpiErr.u32RecoveryUsMax)
+		gstrSpiErr.u32RecoveryUsMax = u32Us;
+}
+
 /********************************************
 
 	Spi interfaces
@@ -528,7 +930,7 @@ static sint8 spi_data_write(uint8 *b, uint16 sz)
  */
 sint8 nm_spi_write_reg(uint32 addr, uint32 u32data)
 {
-	uint8 retry = SPI_RETRY_COUNT;
+	uint8 retry = gu8SpiRetry;
 	sint8 result = N_OK;
 	uint8 cmd = CMD_SINGLE_WRITE;
 	uint8 clockless = 0;
@@ -543,7 +945,8 @@ _RETRY_:
 		clockless = 1;
 	}
 
-	result = spi_cmd(cmd, addr, u32data, 4, clockless);
+	NM_TRACE(NM_TRACE_SPI, M2M_LOG_DBG, SPI_REG_WRITE, addr, u32data);
+	result = spi_cmd_ahead(cmd, addr, u32data, 4, clockless, NM_SPI_REG_RSP_SZ(0, clockless));
 	if (result != N_OK) {
 		M2M_ERR("[nmi spi]: Failed cmd, write reg (%08x)...\n", (unsigned int)addr);
 		goto _FAIL_;
@@ -557,22 +960,23 @@ _RETRY_:
 _FAIL_:
 	if(result != N_OK)
 	{
-		nm_bsp_sleep(1);
-		spi_cmd(CMD_RESET, 0, 0, 0, 0);
-		spi_cmd_rsp(CMD_RESET);
+		spi_recover(gu8SpiRetry - retry);
 		M2M_ERR("Reset and retry %d %x %x\n",retry,addr,u32data);
-		nm_bsp_sleep(1);
+		NM_TRACE(NM_TRACE_SPI, M2M_LOG_ERROR, SPI_RETRY, addr, retry - 1);
 		retry--;
 		if(retry) goto _RETRY_;
 	}
+	if(retry != gu8SpiRetry)
+		spi_recover_done(result);
 
 	return result;
 }
 
-static sint8 nm_spi_write(uint32 addr, uint8 *buf, uint16 size)
+// Writes buf, or the u8Count pieces of pstrIov if it is not NULL
+static sint8 nm_spi_write(uint32 addr, uint8 *buf, tstrNmIov *pstrIov, uint8 u8Count, uint16 size)
 {
 	sint8 result;
-	uint8 retry = SPI_RETRY_COUNT;
+	uint8 retry = gu8SpiRetry;
 	uint8 cmd = CMD_DMA_EXT_WRITE;
 
 
@@ -584,7 +988,9 @@ _RETRY_:
 	if (size == 1)
 		size = 2;
 
-	result = spi_cmd(cmd, addr, 0, size,0);
+	/* Zeros after the response are idle bytes to the chip, it waits for
+	   the data token */
+	result = spi_cmd_ahead(cmd, addr, 0, size, 0, NM_SPI_RSP_SZ);
 	if (result != N_OK) {
 		M2M_ERR("[nmi spi]: Failed cmd, write block (%08x)...\n", (unsigned int)addr);
 		goto _FAIL_;
@@ -595,12 +1001,16 @@ _RETRY_:
 		M2M_ERR("[nmi spi ]: Failed cmd response, write block (%08x)...\n", (unsigned int)addr);
 		goto _FAIL_;
 	}
+	NM_SPI_AHEAD_DROP();
 
-	printf("nm_spi_write: writing %X bytes\n", size);
+	NM_TRACE(NM_TRACE_SPI, M2M_LOG_DBG, SPI_BLOCK_WRITE, addr, size);
 	/**
 		Data
 	**/
-	result = spi_data_write(buf, size);
+	if (pstrIov != NULL)
+		result = spi_data_write_sg(pstrIov, u8Count, size);
+	else
+		result = spi_data_write(buf, size);
 	if (result != N_OK) {
 		M2M_ERR("[nmi spi]: Failed block data write...\n");
 		goto _FAIL_;
@@ -617,17 +1027,14 @@ _RETRY_:
 _FAIL_:
 	if(result != N_OK)
 	{
-		nm_bsp_sleep(1);
-		spi_cmd(CMD_RESET, 0, 0, 0, 0);
-		spi_cmd_rsp(CMD_RESET);
+		spi_recover(gu8SpiRetry - retry);
 		M2M_ERR("Reset and retry %d %x %d\n",retry,addr,size);
-		nm_bsp_sleep(1);
+		NM_TRACE(NM_TRACE_SPI, M2M_LOG_ERROR, SPI_RETRY, addr, retry - 1);
 		retry--;
 		if(retry) goto _RETRY_;
 	}
-
-	printf("write finsihed\n");
-
+	if(retry != gu8SpiRetry)
+		spi_recover_done(result);
 
 	return result;
 }
@@ -643,7 +1050,7 @@ _FAIL_:
  */
 sint8 nm_spi_read_reg_with_ret(uint32 addr, uint32 *u32data)
 {
-	uint8 retry = SPI_RETRY_COUNT;
+	uint8 retry = gu8SpiRetry;
 	volatile sint8 result = N_OK;
 	uint8 cmd = CMD_SINGLE_READ;
 	uint8 tmp[4];
@@ -660,7 +1067,7 @@ _RETRY_:
 		clockless = 1;
 	}
 
-	result = spi_cmd(cmd, addr, 0, 4, clockless);
+	result = spi_cmd_ahead(cmd, addr, 0, 4, clockless, NM_SPI_REG_RSP_SZ(1, clockless));
 	if (result != N_OK) {
 		M2M_ERR("[nmi spi]: Failed cmd, read reg (%08x)...\n", (unsigned int)addr);
 		goto _FAIL_;
@@ -683,27 +1090,141 @@ _RETRY_:
 		((uint32)tmp[1] << 8) |
 		((uint32)tmp[2] << 16) |
 		((uint32)tmp[3] << 24);
+	NM_TRACE(NM_TRACE_SPI, M2M_LOG_DBG, SPI_REG_READ, addr, *u32data);
 		
 _FAIL_:
 	if(result != N_OK)
 	{
-		nm_bsp_sleep(1);
-		spi_cmd(CMD_RESET, 0, 0, 0, 0);
-		spi_cmd_rsp(CMD_RESET);
+		spi_recover(gu8SpiRetry - retry);
 		M2M_ERR("Reset and retry %d %lx\n",retry,addr);
-		nm_bsp_sleep(1);
+		NM_TRACE(NM_TRACE_SPI, M2M_LOG_ERROR, SPI_RETRY, addr, retry - 1);
 		retry--;
 		if(retry) goto _RETRY_;
 	}
+	if(retry != gu8SpiRetry)
+		spi_recover_done(result);
 		
 	return result;
 }
 
+#if CONF_WINC_SPI_PIPELINE
+/* Sends the u8Count accesses back to back in one transfer and parses the
+   responses from what came back. Returns how many succeeded. */
+static uint8 spi_reg_chain(tstrNmRegOp *pstrOps, uint8 u8Count)
+{
+	uint8 au8Cmd[NM_SPI_CHAIN_MAX];
+	uint8 au8Ahead[NM_SPI_CHAIN_MAX];
+	uint16 au16Rsp[NM_SPI_CHAIN_MAX];
+	uint16 u16Len = 0;
+	uint8 i, u8Read, clockless, len;
+	uint8 tmp[4];
+
+	for (i = 0; i < u8Count; i++) {
+		u8Read = (pstrOps[i].u8Op != NM_REG_OP_WRITE);
+		if (u8Read) {
+			clockless = (pstrOps[i].u32Addr <= 0xff);
+			au8Cmd[i] = clockless ? CMD_INTERNAL_READ : CMD_SINGLE_READ;
+		} else {
+			clockless = (pstrOps[i].u32Addr <= 0x30);
+			au8Cmd[i] = clockless ? CMD_INTERNAL_WRITE : CMD_SINGLE_WRITE;
+		}
+		len = spi_cmd_fmt(&gau8ChainTx[u16Len], au8Cmd[i], pstrOps[i].u32Addr,
+			u8Read ? 0 : pstrOps[i].u32Val, 4, clockless);
+		u16Len += len;
+		au16Rsp[i] = u16Len;
+		au8Ahead[i] = NM_SPI_REG_RSP_SZ(u8Read, clockless) + gu8RspDelay;
+		if (au8Ahead[i] > NM_SPI_AHEAD_MAX)
+			au8Ahead[i] = NM_SPI_AHEAD_MAX;
+		m2m_memset(&gau8ChainTx[u16Len], 0, au8Ahead[i]);
+		u16Len += au8Ahead[i];
+	}
+
+	gu8AheadPos = gu8AheadLen = 0;
+	if (M2M_SUCCESS != nmi_spi_writeread(gau8ChainTx, gau8ChainRx, u16Len)) {
+		M2M_ERR("[nmi spi]: Failed chained cmd write, bus error...\n");
+		return 0;
+	}
+
+	/* Each response is parsed by the usual code, from its slot only */
+	gu8AheadOnly = 1;
+	for (i = 0; i < u8Count; i++) {
+		m2m_memcpy(gau8Ahead, &gau8ChainRx[au16Rsp[i]], au8Ahead[i]);
+		gu8AheadPos = 0;
+		gu8AheadLen = au8Ahead[i];
+		if (spi_cmd_rsp(au8Cmd[i]) != N_OK)
+			break;
+		if ((au8Cmd[i] == CMD_SINGLE_READ) || (au8Cmd[i] == CMD_INTERNAL_READ)) {
+			if (spi_data_read(tmp, 4, au8Cmd[i] == CMD_INTERNAL_READ) != N_OK)
+				break;
+			pstrOps[i].u32Rd = tmp[0] |
+				((uint32)tmp[1] << 8) |
+				((uint32)tmp[2] << 16) |
+				((uint32)tmp[3] << 24);
+			NM_TRACE(NM_TRACE_SPI, M2M_LOG_DBG, SPI_REG_READ, pstrOps[i].u32Addr, pstrOps[i].u32Rd);
+		} else {
+			NM_TRACE(NM_TRACE_SPI, M2M_LOG_DBG, SPI_REG_WRITE, pstrOps[i].u32Addr, pstrOps[i].u32Val);
+		}
+		pstrOps[i].s8Ret = M2M_SUCCESS;
+	}
+	gu8AheadOnly = 0;
+	gu8AheadPos = gu8AheadLen = 0;
+
+	return i;
+}
+#endif
+
+/**
+*	@fn		nm_spi_reg_chain
+*	@brief	Run register reads and writes back to back
+*	@param [in, out]	pstrOps
+*				NM_REG_OP_WRITE writes u32Val, any other operation reads into u32Rd
+*	@param [in]	u8Count
+*				Number of operations
+*	@return	ZERO in case of success and M2M_ERR_BUS_FAIL in case of failure
+*	@note	With CONF_WINC_SPI_PIPELINE up to NM_SPI_CHAIN_MAX accesses go out
+*			in one transfer. If a response in it is not where it was expected,
+*			the rest is done one access at a time with the usual retries, so a
+*			write after that point may reach the chip twice. Doorbell registers,
+*			where every write counts, must be written on their own.
+*/
+sint8 nm_spi_reg_chain(tstrNmRegOp *pstrOps, uint8 u8Count)
+{
+	sint8 s8Ret = M2M_SUCCESS;
+	uint8 i = 0;
+
+#if CONF_WINC_SPI_PIPELINE
+	while (u8Count - i > 1) {
+		uint8 n = u8Count - i;
+		uint8 u8Done;
+
+		if (n > NM_SPI_CHAIN_MAX)
+			n = NM_SPI_CHAIN_MAX;
+		u8Done = spi_reg_chain(&pstrOps[i], n);
+		i += u8Done;
+		if (u8Done < n) {
+			NM_TRACE(NM_TRACE_SPI, M2M_LOG_ERROR, SPI_CHAIN_BROKEN, pstrOps[i].u32Addr, i);
+			M2M_ERR("[nmi spi]: Chained access (%08x) failed, going on one by one\n",
+				(unsigned int)pstrOps[i].u32Addr);
+			break;
+		}
+	}
+#endif
+	for (; (i < u8Count) && (s8Ret == M2M_SUCCESS); i++) {
+		if (pstrOps[i].u8Op == NM_REG_OP_WRITE)
+			s8Ret = nm_spi_write_reg(pstrOps[i].u32Addr, pstrOps[i].u32Val);
+		else
+			s8Ret = nm_spi_read_reg_with_ret(pstrOps[i].u32Addr, &pstrOps[i].u32Rd);
+		pstrOps[i].s8Ret = s8Ret;
+	}
+
+	return s8Ret;
+}
+
 static sint8 nm_spi_read(uint32 addr, uint8 *buf, uint16 size)
 {
 	uint8 cmd = CMD_DMA_EXT_READ;
 	sint8 result;
-	uint8 retry = SPI_RETRY_COUNT;
+	uint8 retry = gu8SpiRetry;
 	uint8 tmp[2];
 	uint8 single_byte_workaround = 0;
 
@@ -718,6 +1239,7 @@ _RETRY_:
 		size = 2;
 		single_byte_workaround = 1;
 	}
+	NM_TRACE(NM_TRACE_SPI, M2M_LOG_DBG, SPI_BLOCK_READ, addr, size);
 	result = spi_cmd(cmd, addr, 0, size,0);
 	if (result != N_OK) {
 		M2M_ERR("[nmi spi]: Failed cmd, read block (%08x)...\n", (unsigned int)addr);
@@ -749,14 +1271,14 @@ _RETRY_:
 _FAIL_:
 	if(result != N_OK)
 	{
-		nm_bsp_sleep(1);
-		spi_cmd(CMD_RESET, 0, 0, 0, 0);
-		spi_cmd_rsp(CMD_RESET);
+		spi_recover(gu8SpiRetry - retry);
 		M2M_ERR("Reset and retry %d %lx %d\n",retry,addr,size);
-		nm_bsp_sleep(1);
+		NM_TRACE(NM_TRACE_SPI, M2M_LOG_ERROR, SPI_RETRY, addr, retry - 1);
 		retry--;
 		if(retry) goto _RETRY_;
 	}
+	if(retry != gu8SpiRetry)
+		spi_recover_done(result);
 
 	return result;
 }
@@ -767,37 +1289,164 @@ _FAIL_:
 
 ********************************************/
 
-static void spi_init_pkt_sz(void)
+/* Bits 4 to 6 of the protocol config register select 256 << code */
+static sint8 spi_init_pkt_sz(void)
 {
 	uint32 val32;
+	uint8 code = 0;
 
-	/* Make sure SPI max. packet size fits the defined DATA_PKT_SZ.  */
-	val32 = nm_spi_read_reg(SPI_BASE+0x24);
+	while((256u << code) < gu16PktSz)
+		code++;
+	if(nm_spi_read_reg_with_ret(NMI_SPI_PROTOCOL_CONFIG, &val32) != M2M_SUCCESS)
+		return M2M_ERR_BUS_FAIL;
 	val32 &= ~(0x7 << 4);
-	switch(DATA_PKT_SZ)
+	val32 |= ((uint32)code << 4);
+	return nm_spi_write_reg(NMI_SPI_PROTOCOL_CONFIG, val32);
+}
+
+#ifdef NM_BUS_CALIBRATE
+#define NM_SPI_CAL_REG			CONF_WINC_SPI_CAL_ADDR
+#define NM_SPI_CAL_MAX_STEPS	32
+
+static const uint32 gau32CalPattern[] = {
+	0x00000000, 0xffffffff, 0xaaaaaaaa, 0x55555555,
+	0x0f0f0f0f, 0xf0f0f0f0, 0x00ff00ff, 0xff00ff00
+};
+
+/* Write and read back the patterns at the current rate, then the chip id.
+   A transfer that fails or comes back different fails the rate. */
+static sint8 spi_cal_check(uint32 u32ChipId)
+{
+	uint32 u32Val, u32Pattern;
+	uint8 i, round;
+
+	for(round = 0; round < CONF_WINC_SPI_CAL_ROUNDS; round++)
 	{
-        case 256:
-            val32 |= (0 << 4);
-            break;
-        case 512:
-            val32 |= (1 << 4);
-            break;
-        case 1024:
-            val32 |= (2 << 4);
-            break;
-        case 2048:
-            val32 |= (3 << 4);
-            break;
-        case 4096:
-            val32 |= (4 << 4);
-            break;
-        case 8192:
-            val32 |= (5 << 4);
-            break;
-	}
-	nm_spi_write_reg(SPI_BASE+0x24, val32);
+		for(i = 0; i < sizeof(gau32CalPattern) / sizeof(gau32CalPattern[0]); i++)
+		{
+			/* A flipped bit walks through the patterns from round to round */
+			u32Pattern = gau32CalPattern[i] ^ (1ul << ((round * 5 + i) & 31));
+			if(nm_spi_write_reg(NM_SPI_CAL_REG, u32Pattern) != M2M_SUCCESS)
+				return M2M_ERR_BUS_FAIL;
+			if(nm_spi_read_reg_with_ret(NM_SPI_CAL_REG, &u32Val) != M2M_SUCCESS)
+				return M2M_ERR_BUS_FAIL;
+			if(u32Val != u32Pattern)
+				return M2M_ERR_BUS_FAIL;
+		}
+	}
+	if(nm_spi_read_reg_with_ret(NMI_CHIPID, &u32Val) != M2M_SUCCESS)
+		return M2M_ERR_BUS_FAIL;
+
+	return (u32Val == u32ChipId) ? M2M_SUCCESS : M2M_ERR_BUS_FAIL;
 }
 
+/* Back to a rate known to work and clear whatever the chip made of the
+   last transfers */
+static void spi_cal_recover(uint32 u32Hz)
+{
+	nm_bus_set_profile(1, u32Hz);
+	spi_cmd(CMD_RESET, 0, 0, 0, 0);
+	spi_cmd_rsp(CMD_RESET);
+}
+
+/*
+*	@fn		spi_calibrate
+*	@brief	Pick the SCK rate of the HIGH bus profile
+*	@param [in]	u32ChipId
+*				Chip id read at the safe rate, checked at every rate tried
+*	@note	A stored rate that still passes is taken as is. Otherwise the rate
+*			ramps from CONF_WINC_SPI_HIGH_HZ in CONF_WINC_SPI_CAL_STEP_HZ steps
+*			until a check fails or CONF_WINC_SPI_CAL_MAX_HZ is reached. The
+*			fastest rate passed, less CONF_WINC_SPI_CAL_MARGIN percent, is
+*			kept, and stored by the BSP with CONF_WINC_SPI_CAL_STORE. A rate
+*			is only kept once the probed word is restored.
+*	@return	M2M_SUCCESS, also when HIGH stays at its rate, and M2M_ERR_BUS_FAIL
+*			if the probed word could not be restored
+*/
+static sint8 spi_calibrate(uint32 u32ChipId)
+{
+	uint32 au32Passed[NM_SPI_CAL_MAX_STEPS];
+	uint32 u32Saved, u32Default, u32Hz, u32Actual, u32Limit;
+	uint32 u32Store = 0;
+	uint8 u8Passed = 0, i;
+
+	/* Without CRC the chip would execute a corrupted command */
+	if(gu8Crc_off)
+		return M2M_SUCCESS;
+	if(nm_spi_read_reg_with_ret(NM_SPI_CAL_REG, &u32Saved) != M2M_SUCCESS)
+		return M2M_SUCCESS;
+
+	nm_bus_speed(1);
+	u32Default = nm_bus_get_profile(1);
+	/* A retried access must fail the rate, not hide the error */
+	gu8SpiRetry = 1;
+
+#ifdef NM_BUS_CAL_STORE
+	u32Hz = nm_bsp_spi_cal_load(u32ChipId);
+	if(u32Hz != 0)
+	{
+		u32Actual = nm_bus_set_profile(1, u32Hz);
+		if(spi_cal_check(u32ChipId) == M2M_SUCCESS)
+		{
+			M2M_INFO("SPI clock %lu Hz (stored)\n", (unsigned long)u32Actual);
+			goto _CAL_EXIT;
+		}
+		M2M_INFO("SPI clock %lu Hz stored but fails, calibrating\n", (unsigned long)u32Actual);
+		spi_cal_recover(u32Default);
+	}
+#endif
+
+	for(u32Hz = CONF_WINC_SPI_HIGH_HZ; (u32Hz <= CONF_WINC_SPI_CAL_MAX_HZ) && (u8Passed < NM_SPI_CAL_MAX_STEPS);
+		u32Hz += CONF_WINC_SPI_CAL_STEP_HZ)
+	{
+		u32Actual = nm_bus_set_profile(1, u32Hz);
+		/* Same divider as the last rate */
+		if((u8Passed > 0) && (u32Actual == au32Passed[u8Passed - 1]))
+			continue;
+		if(spi_cal_check(u32ChipId) != M2M_SUCCESS)
+		{
+			spi_cal_recover((u8Passed > 0) ? au32Passed[u8Passed - 1] : u32Default);
+			break;
+		}
+		au32Passed[u8Passed++] = u32Actual;
+	}
+
+	if(u8Passed == 0)
+	{
+		M2M_ERR("SPI clock calibration failed, staying at %lu Hz\n", (unsigned long)u32Default);
+		nm_bus_set_profile(1, u32Default);
+		goto _CAL_EXIT;
+	}
+
+	/* The fastest rate not above the best one less the margin */
+	u32Limit = au32Passed[u8Passed - 1] / 100 * (100 - CONF_WINC_SPI_CAL_MARGIN);
+	for(i = u8Passed - 1; (i > 0) && (au32Passed[i] > u32Limit); i--)
+		;
+	u32Actual = nm_bus_set_profile(1, au32Passed[i]);
+	u32Store = u32Actual;
+	M2M_INFO("SPI clock %lu Hz (%lu Hz passed)\n", (unsigned long)u32Actual,
+		(unsigned long)au32Passed[u8Passed - 1]);
+
+_CAL_EXIT:
+	gu8SpiRetry = SPI_RETRY_COUNT;
+	if(nm_spi_write_reg(NM_SPI_CAL_REG, u32Saved) != M2M_SUCCESS)
+	{
+		/* The rate cannot be trusted, try again at the default */
+		M2M_ERR("SPI clock calibration failed to restore %08lx, staying at %lu Hz\n",
+			(unsigned long)NM_SPI_CAL_REG, (unsigned long)u32Default);
+		spi_cal_recover(u32Default);
+		return nm_spi_write_reg(NM_SPI_CAL_REG, u32Saved);
+	}
+#ifdef NM_BUS_CAL_STORE
+	if(u32Store != 0)
+		nm_bsp_spi_cal_store(u32ChipId, u32Store);
+#else
+	(void)u32Store;
+#endif
+	return M2M_SUCCESS;
+}
+#endif
+
 /**
 *	@fn		nm_spi_init
 *	@brief	Initialize the SPI
@@ -812,7 +1461,10 @@ sint8 nm_spi_init(void)
 	/**
 		configure protocol
 	**/
+	nm_crc16_init();
 	gu8Crc_off = 0;
+	m2m_memset((uint8 *)&gstrSpiErr, 0, sizeof(gstrSpiErr));
+	gstrSpiErr.u8Health = NM_SPI_HEALTH_MAX;
 
     if(nm_spi_read_reg_with_ret(NMI_SPI_PROTOCOL_CONFIG, &reg) != M2M_SUCCESS) {
 		/* Read failed. Try with CRC off. This might happen when module
@@ -825,17 +1477,16 @@ sint8 nm_spi_init(void)
             return M2M_ERR_BUS_FAIL;
 		}
 	}
-	if(gu8Crc_off == 0)
-	{
-		reg &= ~0xc;	/* disable crc checking */
-		reg &= ~0x70;
-		reg |= (0x5 << 4);
-        if(nm_spi_write_reg(NMI_SPI_PROTOCOL_CONFIG, reg) != M2M_SUCCESS) {
-			M2M_ERR( "[nmi spi]: Failed internal write protocol reg...\n");
-            return M2M_ERR_BUS_FAIL;
-		}
-		gu8Crc_off = 1;
+#if CONF_WINC_SPI_CRC
+	reg |= NMI_SPI_PROTOCOL_CRC_MASK;	/* command CRC7 and data CRC16 */
+#else
+	reg &= ~NMI_SPI_PROTOCOL_CRC_MASK;	/* disable crc checking */
+#endif
+	if(nm_spi_write_reg(NMI_SPI_PROTOCOL_CONFIG, reg) != M2M_SUCCESS) {
+		M2M_ERR( "[nmi spi]: Failed internal write protocol reg...\n");
+		return M2M_ERR_BUS_FAIL;
 	}
+	gu8Crc_off = (reg & NMI_SPI_PROTOCOL_CRC_MASK) ? 0 : 1;
 
 	/**
 		make sure can read back chip id correctly
@@ -846,8 +1497,15 @@ sint8 nm_spi_init(void)
 	}
 
 	M2M_DBG("[nmi spi]: chipid (%08x)\n", (unsigned int)chipid);
-	spi_init_pkt_sz();
-
+	/* Data packet size, bits 4 to 6 of the protocol config */
+	if(spi_init_pkt_sz() != M2M_SUCCESS) {
+		M2M_ERR("[nmi spi]: Failed to set the data packet size...\n");
+		return M2M_ERR_BUS_FAIL;
+	}
+#ifdef NM_BUS_CALIBRATE
+	if(spi_calibrate(chipid) != M2M_SUCCESS)
+		return M2M_ERR_BUS_FAIL;
+#endif
 
 	return M2M_SUCCESS;
 }
@@ -863,6 +1521,63 @@ sint8 nm_spi_deinit(void)
 	return M2M_SUCCESS;
 }
 
+/**
+*	@fn		nm_spi_set_crc
+*	@brief	Switch command CRC7 and data CRC16 on or off at runtime
+*	@param [in]	u8Enable
+*				Non-zero to protect transfers with CRC
+*	@return	M2M_SUCCESS in case of success and M2M_ERR_BUS_FAIL in case of failure
+*/
+sint8 nm_spi_set_crc(uint8 u8Enable)
+{
+	uint32 reg;
+
+	if(nm_spi_read_reg_with_ret(NMI_SPI_PROTOCOL_CONFIG, &reg) != M2M_SUCCESS)
+		return M2M_ERR_BUS_FAIL;
+	if(u8Enable)
+		reg |= NMI_SPI_PROTOCOL_CRC_MASK;
+	else
+		reg &= ~NMI_SPI_PROTOCOL_CRC_MASK;
+	if(nm_spi_write_reg(NMI_SPI_PROTOCOL_CONFIG, reg) != M2M_SUCCESS)
+		return M2M_ERR_BUS_FAIL;
+	gu8Crc_off = u8Enable ? 0 : 1;
+	return M2M_SUCCESS;
+}
+
+/**
+*	@fn		nm_spi_set_pkt_sz
+*	@brief	Set the size of the data packets block transfers are split into
+*	@param [in]	u16Sz
+*				256, 512, 1024, 2048, 4096 or 8192 bytes
+*	@return	M2M_SUCCESS in case of success, M2M_ERR_INVALID_ARG for another size
+*			and M2M_ERR_BUS_FAIL if the chip could not be told
+*/
+sint8 nm_spi_set_pkt_sz(uint16 u16Sz)
+{
+	uint16 u16Old = gu16PktSz;
+
+	if((u16Sz < 256) || (u16Sz > 8192) || (u16Sz & (u16Sz - 1)))
+		return M2M_ERR_INVALID_ARG;
+	gu16PktSz = u16Sz;
+	if(spi_init_pkt_sz() != M2M_SUCCESS)
+	{
+		gu16PktSz = u16Old;
+		return M2M_ERR_BUS_FAIL;
+	}
+	return M2M_SUCCESS;
+}
+
+/**
+*	@fn		nm_spi_get_err_stats
+*	@brief	Read the error recovery counters
+*	@param [out]	pstrStats
+*				Counters and bus health
+*/
+void nm_spi_get_err_stats(tstrNmSpiErrStats *pstrStats)
+{
+	*pstrStats = gstrSpiErr;
+}
+
 /*
 *	@fn		nm_spi_read_reg
 *	@brief	Read register
@@ -923,7 +1638,37 @@ sint8 nm_spi_write_block(uint32 u32Addr, uint8 *puBuf, uint16 u16Sz)
 {
 	sint8 s8Ret;
 
-	s8Ret = nm_spi_write(u32Addr, puBuf, u16Sz);
+	s8Ret = nm_spi_write(u32Addr, puBuf, NULL, 0, u16Sz);
+
+	if(N_OK == s8Ret) s8Ret = M2M_SUCCESS;
+	else s8Ret = M2M_ERR_BUS_FAIL;
+
+	return s8Ret;
+}
+
+/**
+*	@fn		nm_spi_write_block_sg
+*	@brief	Write the pieces of pstrIov back to back from u32Addr, as one block
+*	@param [in]	u32Addr
+*				Start address
+*	@param [in]	pstrIov
+*				Pieces to write, a NULL buffer writes zeros
+*	@param [in]	u8Count
+*				Number of pieces, at most 8
+*	@return	M2M_SUCCESS in case of success and M2M_ERR_BUS_FAIL in case of failure
+*/
+sint8 nm_spi_write_block_sg(uint32 u32Addr, tstrNmIov *pstrIov, uint8 u8Count)
+{
+	sint8 s8Ret;
+	uint32 u32Sz = 0;
+	uint8 i;
+
+	for (i = 0; i < u8Count; i++)
+		u32Sz += pstrIov[i].u16Sz;
+	if (u32Sz < 2 || u32Sz > 0xFFFF)
+		return M2M_ERR_INVALID_ARG;
+
+	s8Ret = nm_spi_write(u32Addr, NULL, pstrIov, u8Count, (uint16)u32Sz);
 
 	if(N_OK == s8Ret) s8Ret = M2M_SUCCESS;
 	else s8Ret = M2M_ERR_BUS_FAIL;
@@ -36,6 +36,25 @@
 #define _NMSPI_H_
 
 #include "common/include/nm_common.h"
+#include "bus_wrapper/include/nm_bus_wrapper.h"
+
+/**
+*	@struct	tstrNmSpiErrStats
+*	@brief	SPI error recovery counters since nm_spi_init()
+*	@sa		nm_spi_get_err_stats
+*/
+typedef struct
+{
+	uint32	u32Errors;			/*!< Failed attempts of register and block accesses */
+	uint32	u32Resyncs;			/*!< Failures followed at once by a resync */
+	uint32	u32Backoffs;		/*!< Repeated failures that waited before the resync */
+	uint32	u32Recovered;		/*!< Accesses that succeeded on a retry */
+	uint32	u32Failed;			/*!< Accesses that failed every attempt */
+	uint32	u32Downshifts;		/*!< Times the HIGH clock profile was lowered */
+	uint32	u32RecoveryUsTotal;	/*!< Time from the first failure to the success, summed over the recovered accesses */
+	uint32	u32RecoveryUsMax;	/*!< Longest of those */
+	uint8	u8Health;			/*!< Bus health, 100 is no recent failures */
+} tstrNmSpiErrStats;
 
 #ifdef __cplusplus
      extern "C" {
@@ -61,6 +80,25 @@ sint8 nm_spi_reset(void);
 */ 
 sint8 nm_spi_deinit(void);
 
+/**
+*	@fn		nm_spi_set_crc
+*	@brief	Switch command CRC7 and data CRC16 on or off at runtime
+*	@param [in]	u8Enable
+*				Non-zero to protect transfers with CRC
+*	@return	ZERO in case of success and M2M_ERR_BUS_FAIL in case of failure
+*/
+sint8 nm_spi_set_crc(uint8 u8Enable);
+
+/**
+*	@fn		nm_spi_set_pkt_sz
+*	@brief	Set the size of the data packets block transfers are split into
+*	@param [in]	u16Sz
+*				256, 512, 1024, 2048, 4096 or 8192 bytes
+*	@return	ZERO in case of success, M2M_ERR_INVALID_ARG for another size and
+*			M2M_ERR_BUS_FAIL if the chip could not be told
+*/
+sint8 nm_spi_set_pkt_sz(uint16 u16Sz);
+
 /**
 *	@fn		nm_spi_read_reg
 *	@brief	Read register
@@ -118,6 +156,39 @@ sint8 nm_spi_read_block(uint32 u32Addr, uint8 *puBuf, uint16 u16Sz);
 */
 sint8 nm_spi_write_block(uint32 u32Addr, uint8 *puBuf, uint16 u16Sz);
 
+/**
+*	@fn		nm_spi_write_block_sg
+*	@brief	Write several buffers back to back as one block, in one DMA_EXT_WRITE
+*	@param [in]	u32Addr
+*				Start address
+*	@param [in]	pstrIov
+*				Pieces to write, a NULL buffer writes zeros
+*	@param [in]	u8Count
+*				Number of pieces, at most 8
+*	@return	ZERO in case of success and M2M_ERR_BUS_FAIL in case of failure
+*/
+sint8 nm_spi_write_block_sg(uint32 u32Addr, tstrNmIov *pstrIov, uint8 u8Count);
+
+/**
+*	@fn		nm_spi_reg_chain
+*	@brief	Run register reads and writes back to back, several in one transfer
+*	@param [in, out]	pstrOps
+*				NM_REG_OP_WRITE writes u32Val, any other operation reads into u32Rd.
+*				s8Ret is set for every operation that ran.
+*	@param [in]	u8Count
+*				Number of operations
+*	@return	ZERO in case of success and M2M_ERR_BUS_FAIL in case of failure
+*/
+sint8 nm_spi_reg_chain(tstrNmRegOp *pstrOps, uint8 u8Count);
+
+/**
+*	@fn		nm_spi_get_err_stats
+*	@brief	Read the error recovery counters
+*	@param [out]	pstrStats
+*				Counters and bus health
+*/
+void nm_spi_get_err_stats(tstrNmSpiErrStats *pstrStats);
+
 #ifdef __cplusplus
 	 }
 #endif
@@ -38,10 +38,17 @@
 #include "m2m_wifi.h"
 #include <stdio.h>
 #include <errno.h>
-#include "pico/stdlib.h"
+#include <stdbool.h>
 
 extern volatile bool is_connected;
 
+/* The 19.3.0 driver (WiFi101 port) renamed connect() to avoid the libc name */
+#ifdef M2M_DRIVER_VERSION_MINOR_NO
+#define sock_connect connectSocket
+#else
+#define sock_connect connect
+#endif
+
 #define DEFAULT_USER_AGENT "atmel/1.0.2"
 
 //#define MIN_SEND_BUFFER_SIZE 18 + HTTP_MAX_URI_LENGTH /* DELETE {URI} HTTP/1.1\r\n 
@@ -343,7 +350,7 @@ void http_client_socket_resolve_handler(uint8_t *doamin_name, uint32_t server_ip
 				addr_in.sin_family = AF_INET;
 				addr_in.sin_port = _htons(module->config.port);
 				addr_in.sin_addr.s_addr = server_ip; // Use the resolved IP address
-				        connectSocket(module->sock, (struct sockaddr *)&addr_in, sizeof(struct sockaddr_in));
+				        sock_connect(module->sock, (struct sockaddr *)&addr_in, sizeof(struct sockaddr_in));
 				return;
 			}
 		}
@@ -468,7 +475,7 @@ int http_client_send_request(struct http_client_module *const module, const char
 				addr_in.sin_family = AF_INET;
 				addr_in.sin_port = _htons(module->config.port);
 				addr_in.sin_addr.s_addr = 0x26B2A8C0; // 192.168.178.38
-				connectSocket(module->sock, (struct sockaddr *)&addr_in, sizeof(struct sockaddr_in));
+				sock_connect(module->sock, (struct sockaddr *)&addr_in, sizeof(struct sockaddr_in));
 			} else {
 				gethostbyname((uint8*)module->host);
 			}
@@ -1048,7 +1055,7 @@ int _http_client_handle_entity(struct http_client_module *const module)
 void _http_client_move_buffer(struct http_client_module *const module, char *base)
 {
 	char *buffer = module->config.recv_buffer;
-	int remain = (int)module->recved_size - (int)base + (int)buffer;
+	int remain = (int)module->recved_size - (int)(base - buffer);
 
 	if (remain > 0) {
 		memmove(buffer, base, remain);
@@ -4,29 +4,15 @@
 #include "spi_slave.pio.h"
 #include "pio_spi.h"
 
-// Define GPIO connections for the SPI slave
-#define MOSI_PIN 16
-#define CS_PIN   17
-#define SCK_PIN  18
-#define MISO_PIN 19
-
-static PIO pio = pio0;
-static uint sm_rx;
-static uint sm_tx;
-static uint sm_oe;
-static irq_handler_t app_irq_handler = NULL;
-
-static void pio_spi_irq();
-
 // --- WRITE (TX) ---
 // Send a byte to the Master.
 // If the FIFO is full, this hangs until there is space.
-size_t pio_spi_write_blocking(uint8_t* buffer, size_t len) {
+size_t pio_spi_write_blocking(pio_spi_t *spi, uint8_t* buffer, size_t len) {
     for(size_t i=0; i<len; i++){
-        pio_sm_put_blocking(pio0, sm_tx, (uint32_t)buffer[i] <<24 | 1);
+        pio_sm_put_blocking(spi->pio, spi->sm_tx, (uint32_t)buffer[i] << 24);
         // prevent rx fifo from filling up with dummy data
-        if(!pio_sm_is_rx_fifo_empty(pio, sm_rx)) {
-            pio_sm_get(pio, sm_rx);
+        if(!pio_sm_is_rx_fifo_empty(spi->pio, spi->sm_rx)) {
+            pio_sm_get(spi->pio, spi->sm_rx);
         }
     }
     return len;
@@ -35,16 +21,16 @@ size_t pio_spi_write_blocking(uint8_t* buffer, size_t len) {
 // --- READ (RX) ---
 // Receive a byte from the Master.
 // If the FIFO is empty, this hangs until a byte arrives.
-size_t pio_spi_read_blocking(uint8_t* buffer, size_t len) {
+size_t pio_spi_read_blocking(pio_spi_t *spi, uint8_t* buffer, size_t len) {
     for(size_t i=0; i<len; i++){
-        buffer[i] = (uint8_t) pio_sm_get_blocking(pio, sm_rx);
+        buffer[i] = (uint8_t) pio_sm_get_blocking(spi->pio, spi->sm_rx);
     }
     return len;
 }
 
-uint8_t pio_spi_get_non_zero_byte(void) {
-    while (!pio_sm_is_rx_fifo_empty(pio, sm_rx)) {
-        uint8_t received_byte = (uint8_t)pio_sm_get(pio, sm_rx);
+uint8_t pio_spi_get_non_zero_byte(pio_spi_t *spi) {
+    while (!pio_sm_is_rx_fifo_empty(spi->pio, spi->sm_rx)) {
+        uint8_t received_byte = (uint8_t)pio_sm_get(spi->pio, spi->sm_rx);
         if (received_byte != 0) {
             return received_byte;
         }
@@ -52,11 +38,12 @@ uint8_t pio_spi_get_non_zero_byte(void) {
     return 0; // FIFO empty or only contained zero bytes
 }
 
-void pio_spi_slave_init(irq_handler_t handler) {
-    app_irq_handler = handler;
-    sm_rx = pio_claim_unused_sm(pio, true);
-    sm_tx = pio_claim_unused_sm(pio, true);
-    sm_oe = pio_claim_unused_sm(pio, true);
+void pio_spi_slave_init(pio_spi_t *spi, PIO pio, uint mosi_pin, uint miso_pin, irq_handler_t handler) {
+    uint cs_pin = mosi_pin + 1;
+    spi->pio = pio;
+    uint sm_rx = spi->sm_rx = pio_claim_unused_sm(pio, true);
+    uint sm_tx = spi->sm_tx = pio_claim_unused_sm(pio, true);
+    uint sm_oe = spi->sm_oe = pio_claim_unused_sm(pio, true);
 
     // 1. Load the PIO programs
     uint offset_rx = pio_add_program(pio, &spi_rx_program);
@@ -69,15 +56,15 @@ void pio_spi_slave_init(irq_handler_t handler) {
     pio_sm_config c_rx = spi_rx_program_get_default_config(offset_rx);
 
     // Pin Configuration:
-    // Set IN Base to MOSI_PIN (16). 
+    // Set IN Base to MOSI.
     // This allows the assembly to see:
-    //   - 'pin 0' = MOSI (16)
-    //   - 'pin 1' = CS   (17)
-    //   - 'pin 2' = SCK  (18)
-    sm_config_set_in_pins(&c_rx, MOSI_PIN);
+    //   - 'pin 0' = MOSI
+    //   - 'pin 1' = CS
+    //   - 'pin 2' = SCK
+    sm_config_set_in_pins(&c_rx, mosi_pin);
     
-    // Set JMP Pin to CS_PIN for the 'jmp pin' instruction
-    sm_config_set_jmp_pin(&c_rx, CS_PIN);
+    // Set JMP Pin to CS for the 'jmp pin' instruction
+    sm_config_set_jmp_pin(&c_rx, cs_pin);
 
     // Shift Configuration:
     // Shift Left (false), Auto-Push (true), Threshold 8 bits
@@ -85,13 +72,13 @@ void pio_spi_slave_init(irq_handler_t handler) {
     sm_config_set_fifo_join(&c_rx, PIO_FIFO_JOIN_RX); // Double RX FIFO depth
 
     // GPIO Initialization:
-    pio_gpio_init(pio, MOSI_PIN);
-    pio_gpio_init(pio, CS_PIN);
-    pio_gpio_init(pio, SCK_PIN);
+    pio_gpio_init(pio, mosi_pin);
+    pio_gpio_init(pio, cs_pin);
+    pio_gpio_init(pio, mosi_pin + 2);
     
     // Set MOSI, CS, and SCK as Inputs.
-    // Since they are sequential (16,17,18), we can set 3 pins starting at MOSI_PIN.
-    pio_sm_set_consecutive_pindirs(pio, sm_rx, MOSI_PIN, 3, false);
+    // Since they are sequential, we can set 3 pins starting at MOSI.
+    pio_sm_set_consecutive_pindirs(pio, sm_rx, mosi_pin, 3, false);
 
     // Enable RX SM
     pio_sm_init(pio, sm_rx, offset_rx, &c_rx);
@@ -103,16 +90,16 @@ void pio_spi_slave_init(irq_handler_t handler) {
     // ============================================================
     pio_sm_config c_oe = spi_tristate_program_get_default_config(offset_oe);
 
-    // IN Base = CS (17) -> 'wait' monitors CS
-    sm_config_set_in_pins(&c_oe, CS_PIN);
+    // IN Base = CS -> 'wait' monitors CS
+    sm_config_set_in_pins(&c_oe, cs_pin);
     
-    // SIDESET Base = MISO (19) -> controls Direction
-    sm_config_set_sideset_pins(&c_oe, MISO_PIN);
+    // SIDESET Base = MISO -> controls Direction
+    sm_config_set_sideset_pins(&c_oe, miso_pin);
     
     // GPIO Init for MISO
-    pio_gpio_init(pio, MISO_PIN);
+    pio_gpio_init(pio, miso_pin);
     // Start as Input (Hi-Z)
-    pio_sm_set_consecutive_pindirs(pio, sm_oe, MISO_PIN, 1, false);
+    pio_sm_set_consecutive_pindirs(pio, sm_oe, miso_pin, 1, false);
 
     pio_sm_init(pio, sm_oe, offset_oe, &c_oe);
     pio_sm_set_enabled(pio, sm_oe, true);
@@ -123,17 +110,17 @@ void pio_spi_slave_init(irq_handler_t handler) {
     pio_sm_config c_tx = spi_tx_program_get_default_config(offset_tx);
 
     // Pin Configuration:
-    // OUT Base: MISO_PIN (19)
-    sm_config_set_out_pins(&c_tx, MISO_PIN, 1);
+    // OUT Base: MISO
+    sm_config_set_out_pins(&c_tx, miso_pin, 1);
     
-    // IN Base: MOSI_PIN (16) - CRITICAL!
-    // Even though TX doesn't read MOSI, we set the IN base to 16 
+    // IN Base: MOSI - CRITICAL!
+    // Even though TX doesn't read MOSI, we set the IN base to MOSI
     // so that the 'wait pin 1' (CS) and 'wait pin 2' (SCK) instructions 
     // point to the correct GPIOs relative to this base.
-    sm_config_set_in_pins(&c_tx, MOSI_PIN);
+    sm_config_set_in_pins(&c_tx, mosi_pin);
     
-    // JMP Pin: CS_PIN (17)
-    sm_config_set_jmp_pin(&c_tx, CS_PIN);
+    // JMP Pin: CS
+    sm_config_set_jmp_pin(&c_tx, cs_pin);
 
     // Shift Configuration:
     // Shift Left (false), Auto-Pull (true), Threshold 8 bits
@@ -141,16 +128,18 @@ void pio_spi_slave_init(irq_handler_t handler) {
     sm_config_set_fifo_join(&c_tx, PIO_FIFO_JOIN_TX); // Double TX FIFO depth
 
     // GPIO Initialization:
-    pio_gpio_init(pio, MISO_PIN);
+    pio_gpio_init(pio, miso_pin);
     // Set MISO as Output
-    pio_sm_set_consecutive_pindirs(pio, sm_tx, MISO_PIN, 1, false);
+    pio_sm_set_consecutive_pindirs(pio, sm_tx, miso_pin, 1, false);
 
     // ------------------------------------------------------------
     // TX Requirement 1: Zero Padding
     // ------------------------------------------------------------
-    // Initialize the X register to 0. If the FIFO is empty, 
-    // 'pull noblock' uses X, ensuring we send 0x00 padding.
-    pio_sm_exec(pio, sm_tx, pio_encode_mov(pio_x, pio_null));
+    // Initialize the X register to 1. If the FIFO is empty, 
+    // 'pull noblock' uses X, ensuring we send 0x00 padding. The low
+    // bit marks the word as padding for the abort handler, since a
+    // real 0x00 byte from the CPU or the DMA never looks like this.
+    pio_sm_exec(pio, sm_tx, pio_encode_set(pio_x, 1));
 
     // ------------------------------------------------------------
     // TX Requirement 2: Start at 'first_pull'
@@ -164,20 +153,35 @@ void pio_spi_slave_init(irq_handler_t handler) {
     pio_sm_set_enabled(pio, sm_tx, true);
 
     // --- Interrupt Setup ---
-    irq_set_exclusive_handler(PIO0_IRQ_0, app_irq_handler);
-    irq_set_enabled(PIO0_IRQ_0, true);
+    uint irq = pio == pio0 ? PIO0_IRQ_0 : PIO1_IRQ_0;
+    irq_set_exclusive_handler(irq, handler);
+    irq_set_enabled(irq, true);
     pio_set_irq0_source_enabled(pio, pio_get_rx_fifo_not_empty_interrupt_source(sm_rx), true);
 }
 
-uint pio_spi_get_rx_dreq(void) {
-    return pio_get_dreq(pio, sm_rx, false);
+uint pio_spi_get_tx_dreq(pio_spi_t *spi) {
+    return pio_get_dreq(spi->pio, spi->sm_tx, true);
+}
+
+volatile void* pio_spi_get_tx_fifo_address(pio_spi_t *spi) {
+    return &spi->pio->txf[spi->sm_tx];
+}
+
+void pio_spi_drain_rx_fifo(pio_spi_t *spi) {
+    while (!pio_sm_is_rx_fifo_empty(spi->pio, spi->sm_rx)) {
+        (void)pio_sm_get(spi->pio, spi->sm_rx);
+    }
+}
+
+uint pio_spi_get_rx_dreq(pio_spi_t *spi) {
+    return pio_get_dreq(spi->pio, spi->sm_rx, false);
 }
 
-volatile const void* pio_spi_get_rx_fifo_address(void) {
-    return &pio->rxf[sm_rx];
+volatile const void* pio_spi_get_rx_fifo_address(pio_spi_t *spi) {
+    return &spi->pio->rxf[spi->sm_rx];
 }
 
-void pio_spi_set_rx_irq_enabled(bool enabled) {
-    pio_set_irq0_source_enabled(pio, pio_get_rx_fifo_not_empty_interrupt_source(sm_rx), enabled);
+void pio_spi_set_rx_irq_enabled(pio_spi_t *spi, bool enabled) {
+    pio_set_irq0_source_enabled(spi->pio, pio_get_rx_fifo_not_empty_interrupt_source(spi->sm_rx), enabled);
 }
 
@@ -3,16 +3,31 @@
 
 #include "pico/stdlib.h"
 #include "hardware/irq.h"
+#include "hardware/pio.h"
 
-void pio_spi_slave_init(irq_handler_t handler);
-size_t pio_spi_write_blocking(uint8_t* buffer, size_t len);
-size_t pio_spi_read_blocking(uint8_t* buffer, size_t len);
+// One SPI slave: three state machines and the programs on a PIO block of its
+// own, so a second slave goes on the other PIO.
+typedef struct {
+    PIO pio;
+    uint sm_rx;
+    uint sm_tx;
+    uint sm_oe;
+} pio_spi_t;
+
+// MOSI, CS and SCK are consecutive pins starting at mosi_pin. The handler
+// is installed as the PIO's IRQ 0 handler.
+void pio_spi_slave_init(pio_spi_t *spi, PIO pio, uint mosi_pin, uint miso_pin, irq_handler_t handler);
+size_t pio_spi_write_blocking(pio_spi_t *spi, uint8_t* buffer, size_t len);
+size_t pio_spi_read_blocking(pio_spi_t *spi, uint8_t* buffer, size_t len);
 
 // New functions for DMA support
-uint pio_spi_get_rx_dreq(void);
-volatile const void* pio_spi_get_rx_fifo_address(void);
-void pio_spi_set_rx_irq_enabled(bool enabled);
+uint pio_spi_get_rx_dreq(pio_spi_t *spi);
+volatile const void* pio_spi_get_rx_fifo_address(pio_spi_t *spi);
+void pio_spi_set_rx_irq_enabled(pio_spi_t *spi, bool enabled);
+uint pio_spi_get_tx_dreq(pio_spi_t *spi);
+volatile void* pio_spi_get_tx_fifo_address(pio_spi_t *spi);
+void pio_spi_drain_rx_fifo(pio_spi_t *spi);
 
-uint8_t pio_spi_get_non_zero_byte(void);
+uint8_t pio_spi_get_non_zero_byte(pio_spi_t *spi);
 
 #endif // PIO_SPI_H
@@ -1,61 +1,147 @@
 #include <stdio.h>
 #include <string.h>
-#include <stdarg.h> // Required for va_list
-#include "pico/stdlib.h"
 #include "sim_log.h"
 
-// Global log buffer instance
-sim_log_ring_buffer_t g_sim_log_buffer = {0};
-
-// Function to enqueue a log message
-void sim_log_enqueue(sim_log_type_t type, const char *message_str, uint32_t value1, uint32_t value2) {
-    if (g_sim_log_buffer.count < SIM_LOG_BUFFER_SIZE) {
-        sim_log_message_t *msg = &g_sim_log_buffer.buffer[g_sim_log_buffer.head];
-        msg->type = type;
-        strncpy(msg->message_str, message_str, SIM_LOG_MESSAGE_STRING_LEN - 1);
-        msg->message_str[SIM_LOG_MESSAGE_STRING_LEN - 1] = '\0'; // Ensure null termination
-        msg->value1 = value1;
-        msg->value2 = value2;
-
-        g_sim_log_buffer.head = (g_sim_log_buffer.head + 1) % SIM_LOG_BUFFER_SIZE;
-        g_sim_log_buffer.count++;
+#define SIM_LOG_EVENT_INFO(id, text, type) { text, type },
+static const struct {
+    const char *text;
+    sim_log_type_t type;
+} event_info[SIM_EVENT_COUNT] = {
+    SIM_LOG_EVENTS(SIM_LOG_EVENT_INFO)
+};
+#undef SIM_LOG_EVENT_INFO
+
+// The other side's index is read with acquire and published with release,
+// which orders the record contents with it (a DMB on the RP2040).
+
+void sim_log_init(sim_log_t *log, uint64_t (*now_us)(void), uint8_t instance) {
+    log->head = 0;
+    log->tail = 0;
+    log->dropped = 0;
+    log->dropped_reported = 0;
+    log->clock_us = now_us;
+    log->instance = instance;
+}
+
+void sim_log_write(sim_log_t *log, sim_log_event_t event, uint32_t value1, uint32_t value2) {
+    uint32_t head = log->head;
+    if (head - __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE) >= SIM_LOG_RING_SIZE) {
+        log->dropped++;
+        return;
     }
+
+    sim_log_record_t *r = &log->records[head & (SIM_LOG_RING_SIZE - 1)];
+    r->time_us = log->clock_us ? (uint32_t)log->clock_us() : 0;
+    r->event = (uint16_t)event;
+    r->seq = (uint16_t)head;
+    r->value1 = value1;
+    r->value2 = value2;
+    __atomic_store_n(&log->head, head + 1, __ATOMIC_RELEASE);
 }
 
-// Function to process (print) one log message from the queue
-bool sim_log_process_one_message(void) {
-    if (g_sim_log_buffer.count > 0) {
-        sim_log_message_t *msg = &g_sim_log_buffer.buffer[g_sim_log_buffer.tail];
-
-        switch (msg->type) {
-            case SIM_LOG_TYPE_COMMAND:
-                printf("[SIMULATOR] %s: 0x%X -> 0x%X\n", msg->message_str, msg->value1, msg->value2);
-                break;
-            case SIM_LOG_TYPE_ADDRESS:
-                printf("[SIMULATOR] %s: 0x%06x\n", msg->message_str, msg->value1);
-                break;
-            case SIM_LOG_TYPE_DATA:
-                printf("[SIMULATOR] %s: %02x %02x %02x %02x\n", msg->message_str,
-                       (uint8_t)(msg->value1 >> 24), (uint8_t)(msg->value1 >> 16),
-                       (uint8_t)(msg->value1 >> 8), (uint8_t)msg->value1);
-                break;
-            case SIM_LOG_TYPE_ADDRESS_DATA:
-                printf("[SIMULATOR] %s Address: 0x%06x Data: %02x %02x %02x %02x\n", msg->message_str, msg->value1,
-                       (uint8_t)(msg->value2 >> 24), (uint8_t)(msg->value2 >> 16),
-                       (uint8_t)(msg->value2 >> 8), (uint8_t)msg->value2);
-                break;
-            case SIM_LOG_TYPE_UNKNOWN_COMMAND:
-                printf("[SIMULATOR] %s: 0x%02x\n", msg->message_str, (uint8_t)msg->value1);
-                break;
-            case SIM_LOG_TYPE_NONE:
-            default:
-                printf("[SIMULATOR] %s\n", msg->message_str);
-                break;
+uint32_t sim_log_read(sim_log_t *log, sim_log_record_t *out, uint32_t max) {
+    uint32_t tail = log->tail;
+    uint32_t n = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE) - tail;
+    if (n > max) n = max;
+
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = log->records[(tail + i) & (SIM_LOG_RING_SIZE - 1)];
+    }
+    __atomic_store_n(&log->tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+int sim_log_format(const sim_log_record_t *r, uint8_t instance, char *buf, size_t len) {
+    const char *text = "Unknown event";
+    sim_log_type_t type = SIM_LOG_TYPE_COMMAND;
+    if (r->event < SIM_EVENT_COUNT) {
+        text = event_info[r->event].text;
+        type = event_info[r->event].type;
+    }
+
+    int n = instance ? snprintf(buf, len, "[SIMULATOR %u] %10u ", (unsigned)instance, (unsigned)r->time_us)
+                     : snprintf(buf, len, "[SIMULATOR] %10u ", (unsigned)r->time_us);
+    if (n < 0 || (size_t)n >= len) return n;
+    buf += n;
+    len -= (size_t)n;
+
+    int m;
+    switch (type) {
+        case SIM_LOG_TYPE_COMMAND:
+            m = snprintf(buf, len, "%s: 0x%X -> 0x%X", text, (unsigned)r->value1, (unsigned)r->value2);
+            break;
+        case SIM_LOG_TYPE_ADDRESS:
+            m = snprintf(buf, len, "%s: 0x%06x", text, (unsigned)r->value1);
+            break;
+        case SIM_LOG_TYPE_DATA:
+            m = snprintf(buf, len, "%s: %02x %02x %02x %02x", text,
+                         (uint8_t)(r->value1 >> 24), (uint8_t)(r->value1 >> 16),
+                         (uint8_t)(r->value1 >> 8), (uint8_t)r->value1);
+            break;
+        case SIM_LOG_TYPE_ADDRESS_DATA:
+            m = snprintf(buf, len, "%s Address: 0x%06x Data: %02x %02x %02x %02x", text, (unsigned)r->value1,
+                         (uint8_t)(r->value2 >> 24), (uint8_t)(r->value2 >> 16),
+                         (uint8_t)(r->value2 >> 8), (uint8_t)r->value2);
+            break;
+        case SIM_LOG_TYPE_UNKNOWN_COMMAND:
+            m = snprintf(buf, len, "%s: 0x%02x", text, (uint8_t)r->value1);
+            break;
+        case SIM_LOG_TYPE_NONE:
+        default:
+            m = snprintf(buf, len, "%s", text);
+            break;
+    }
+    return m < 0 ? m : n + m;
+}
+
+uint32_t sim_log_drain(sim_log_t *log, uint32_t max) {
+    sim_log_record_t batch[16];
+    uint32_t done = 0;
+
+    while (done < max) {
+        uint32_t want = max - done;
+        if (want > sizeof(batch) / sizeof(batch[0])) want = sizeof(batch) / sizeof(batch[0]);
+        uint32_t n = sim_log_read(log, batch, want);
+        if (n == 0) break;
+
+        for (uint32_t i = 0; i < n; i++) {
+#if SIMULATOR_LOG_RAW
+            const uint8_t *bytes = (const uint8_t *)&batch[i];
+            char hex[2 * sizeof(sim_log_record_t) + 1];
+            for (uint32_t b = 0; b < sizeof(sim_log_record_t); b++) {
+                static const char digits[] = "0123456789abcdef";
+                hex[2 * b] = digits[bytes[b] >> 4];
+                hex[2 * b + 1] = digits[bytes[b] & 0xF];
+            }
+            hex[sizeof(hex) - 1] = '\0';
+            if (log->instance) {
+                printf("#L%u %s\n", (unsigned)log->instance, hex);
+            } else {
+                printf("#L %s\n", hex);
+            }
+#else
+            char line[96];
+            sim_log_format(&batch[i], log->instance, line, sizeof(line));
+            printf("%s\n", line);
+#endif
         }
+        done += n;
+    }
 
-        g_sim_log_buffer.tail = (g_sim_log_buffer.tail + 1) % SIM_LOG_BUFFER_SIZE;
-        g_sim_log_buffer.count--;
-        return true;
+    uint32_t dropped = __atomic_load_n(&log->dropped, __ATOMIC_RELAXED);
+    if (dropped != log->dropped_reported) {
+        if (log->instance) {
+            printf("[SIMULATOR %u] %u log records dropped\n", (unsigned)log->instance,
+                   (unsigned)(dropped - log->dropped_reported));
+        } else {
+            printf("[SIMULATOR] %u log records dropped\n", (unsigned)(dropped - log->dropped_reported));
+        }
+        log->dropped_reported = dropped;
     }
-    return false;
+    return done;
+}
+
+void sim_log_get_stats(const sim_log_t *log, sim_log_stats_t *stats) {
+    stats->written = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+    stats->dropped = __atomic_load_n(&log->dropped, __ATOMIC_RELAXED);
 }
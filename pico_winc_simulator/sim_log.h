@@ -1,46 +1,151 @@
 #ifndef SIM_LOG_H
 #define SIM_LOG_H
 
-#include <stdio.h> // Required for printf
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include "config/conf_simulator.h" // Include for SIMULATOR_SPI_LOG_ENABLE
 
-// Asynchronous logging buffer
-#define SIM_LOG_BUFFER_SIZE 16
-#define SIM_LOG_MESSAGE_STRING_LEN 28 // Max length for the log string part
+// Binary trace of the simulator. SIM_LOG() stores a 16 byte record in a
+// single-producer single-consumer ring and returns: no string copy, no lock,
+// no formatting. The consumer drains records in bulk and formats them, or
+// dumps them for tools/sim_log_decode.c.
+//
+// Each simulator instance has its own ring. Producer: the instance. On the
+// Pico its handlers all run on one core at one IRQ priority, so they never
+// preempt each other. Consumer: the simulator's main loop on the Pico, the
+// loopback bus wrapper on the host.
 
-// Enum to define the type of log message for formatting
+// Records in the ring, a power of two
+#ifndef SIM_LOG_RING_SIZE
+#define SIM_LOG_RING_SIZE 256
+#endif
+
+_Static_assert((SIM_LOG_RING_SIZE & (SIM_LOG_RING_SIZE - 1)) == 0, "SIM_LOG_RING_SIZE must be a power of two");
+
+// How the two values of a record are printed
 typedef enum {
-    SIM_LOG_TYPE_NONE,
-    SIM_LOG_TYPE_COMMAND,
-    SIM_LOG_TYPE_ADDRESS,
-    SIM_LOG_TYPE_DATA,
-    SIM_LOG_TYPE_UNKNOWN_COMMAND,
-    SIM_LOG_TYPE_ADDRESS_DATA // New type for logging address and data
+    SIM_LOG_TYPE_NONE,              // No values
+    SIM_LOG_TYPE_COMMAND,           // value1 -> value2, both hex
+    SIM_LOG_TYPE_ADDRESS,           // value1 as a 24 bit address
+    SIM_LOG_TYPE_DATA,              // value1 as four bytes
+    SIM_LOG_TYPE_UNKNOWN_COMMAND,   // value1 as one byte
+    SIM_LOG_TYPE_ADDRESS_DATA       // value1 address, value2 as four bytes
 } sim_log_type_t;
 
+// Events: ID, text, format. New events go at the end so older dumps still
+// decode.
+#define SIM_LOG_EVENTS(X)                                                       \
+    X(SOFTWARE_RESET,       "Software Reset",           SIM_LOG_TYPE_NONE)      \
+    X(CMD_RESET,            "CMD_RESET",                SIM_LOG_TYPE_NONE)      \
+    X(SINGLE_READ,          "SINGLE_READ",              SIM_LOG_TYPE_COMMAND)   \
+    X(SINGLE_READ_RESET,    "SINGLE_READ (reset)",      SIM_LOG_TYPE_COMMAND)   \
+    X(SINGLE_WRITE,         "SINGLE_WRITE",             SIM_LOG_TYPE_COMMAND)   \
+    X(INTERNAL_READ,        "INTERNAL_READ",            SIM_LOG_TYPE_COMMAND)   \
+    X(INTERNAL_WRITE,       "INTERNAL_WRITE",           SIM_LOG_TYPE_COMMAND)   \
+    X(DMA_READ,             "DMA_READ",                 SIM_LOG_TYPE_COMMAND)   \
+    X(DMA_EXT_READ,         "DMA_EXT_READ",             SIM_LOG_TYPE_COMMAND)   \
+    X(DMA_WRITE,            "DMA_WRITE",                SIM_LOG_TYPE_COMMAND)   \
+    X(OOB_DMA_READ,         "OOB DMA read",             SIM_LOG_TYPE_COMMAND)   \
+    X(OOB_DMA_WRITE,        "OOB DMA write",            SIM_LOG_TYPE_COMMAND)   \
+    X(BAD_DMA_WRITE_SIZE,   "Bad DMA write size",       SIM_LOG_TYPE_COMMAND)   \
+    X(DMA_PREFIX,           "Unexpected DMA prefix",    SIM_LOG_TYPE_COMMAND)   \
+    X(DATA_CRC_ERROR,       "Data CRC error",           SIM_LOG_TYPE_COMMAND)   \
+    X(UNKNOWN_COMMAND,      "Unknown Command",          SIM_LOG_TYPE_UNKNOWN_COMMAND) \
+    X(CRC_OFF,              "CRC turned off",           SIM_LOG_TYPE_ADDRESS)   \
+    X(CRC_ON,               "CRC turned on",            SIM_LOG_TYPE_ADDRESS)   \
+    X(FIRMWARE_STARTED,     "Firmware started",         SIM_LOG_TYPE_COMMAND)   \
+    X(PAGE_POOL_EXHAUSTED,  "Page pool exhausted",      SIM_LOG_TYPE_COMMAND)   \
+    X(LOOPBACK_TX_OVERFLOW, "Loopback TX overflow",     SIM_LOG_TYPE_COMMAND)   \
+    X(HIF_REQUEST,          "HIF request",              SIM_LOG_TYPE_COMMAND)   \
+    X(HIF_NO_BUFFER,        "HIF no buffer",            SIM_LOG_TYPE_ADDRESS)   \
+    X(HIF_RESPONSE_DROPPED, "HIF response dropped",     SIM_LOG_TYPE_COMMAND)   \
+    X(EVENT_TABLE_FULL,     "Event table full",         SIM_LOG_TYPE_COMMAND)   \
+    X(UNHANDLED_WIFI,       "Unhandled WIFI request",   SIM_LOG_TYPE_COMMAND)   \
+    X(UNHANDLED_IP,         "Unhandled IP request",     SIM_LOG_TYPE_COMMAND)   \
+    X(TRAFFIC_STARTED,      "Traffic generator started", SIM_LOG_TYPE_COMMAND)  \
+    X(HOST_IRQ_PENDING,     "Host left interrupt pending", SIM_LOG_TYPE_COMMAND) \
+    X(PACKET_SIZE,          "Data packet size",         SIM_LOG_TYPE_COMMAND)
+
+#define SIM_LOG_EVENT_ID(id, text, type) SIM_EVENT_##id,
+typedef enum {
+    SIM_LOG_EVENTS(SIM_LOG_EVENT_ID)
+    SIM_EVENT_COUNT
+} sim_log_event_t;
+#undef SIM_LOG_EVENT_ID
+
+// One record, also the dump format (little endian)
 typedef struct {
-    sim_log_type_t type;
-    char message_str[SIM_LOG_MESSAGE_STRING_LEN];
-    uint32_t value1; // Renamed from 'value'
-    uint32_t value2; // New field for second value
-} sim_log_message_t;
+    uint32_t time_us;   // Low 32 bits of the transport clock
+    uint16_t event;     // sim_log_event_t
+    uint16_t seq;       // Low bits of the record's position, gaps show drops
+    uint32_t value1;
+    uint32_t value2;
+} sim_log_record_t;
+
+_Static_assert(sizeof(sim_log_record_t) == 16, "sim_log_record_t is 16 bytes");
 
 typedef struct {
-    sim_log_message_t buffer[SIM_LOG_BUFFER_SIZE];
+    uint32_t written;   // Records stored
+    uint32_t dropped;   // Records lost, ring full
+} sim_log_stats_t;
+
+// One ring. head is only written by the producer, tail only by the consumer.
+typedef struct {
+    sim_log_record_t records[SIM_LOG_RING_SIZE];
     uint32_t head;
     uint32_t tail;
-    uint32_t count;
-} sim_log_ring_buffer_t;
-
-extern sim_log_ring_buffer_t g_sim_log_buffer;
+    uint32_t dropped;           // Producer only
+    uint32_t dropped_reported;  // Consumer only
+    uint64_t (*clock_us)(void);
+    uint8_t instance;           // Shown in the printed lines
+} sim_log_t;
 
+// sim is a winc_sim_t *, the record goes to its ring
 #if (SIMULATOR_SPI_LOG_ENABLE == 1)
-#define SIM_LOG(type, str, val1, ...) sim_log_enqueue(type, str, val1, ##__VA_ARGS__)
+#define SIM_LOG(sim, event, val1, val2) sim_log_write(&(sim)->log, event, val1, val2)
 #else
-#define SIM_LOG(type, str, val1, ...) do {} while(0)
+#define SIM_LOG(sim, event, val1, val2) do { (void)(sim); } while(0)
 #endif
 
-void sim_log_enqueue(sim_log_type_t type, const char *message_str, uint32_t value1, uint32_t value2);
-bool sim_log_process_one_message(void);
+/**
+ * @brief Empty the ring
+ *
+ * @param now_us    Clock for the record time stamps, NULL stamps 0
+ * @param instance  Simulator instance, 0 prints "[SIMULATOR]", n "[SIMULATOR n]"
+ */
+void sim_log_init(sim_log_t *log, uint64_t (*now_us)(void), uint8_t instance);
+
+// Producer side: store one record, or count it as dropped if the ring is full
+void sim_log_write(sim_log_t *log, sim_log_event_t event, uint32_t value1, uint32_t value2);
+
+/**
+ * @brief Consumer side: take up to max records out of the ring
+ *
+ * @return Records copied to out
+ */
+uint32_t sim_log_read(sim_log_t *log, sim_log_record_t *out, uint32_t max);
+
+/**
+ * @brief Format a record as one line, without the newline
+ *
+ * Also used by the host decoder, so it only depends on the record.
+ *
+ * @return Length of the line, as snprintf()
+ */
+int sim_log_format(const sim_log_record_t *record, uint8_t instance, char *buf, size_t len);
+
+/**
+ * @brief Drain up to max records and print them
+ *
+ * Prints "[SIMULATOR] ..." lines, or with SIMULATOR_LOG_RAW the records as
+ * hex for tools/sim_log_decode.c ("#L" for instance 0, "#L<n>" otherwise).
+ * Reports records dropped since the last call.
+ *
+ * @return Records printed
+ */
+uint32_t sim_log_drain(sim_log_t *log, uint32_t max);
+
+void sim_log_get_stats(const sim_log_t *log, sim_log_stats_t *stats);
 
 #endif // SIM_LOG_H
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include "spi_capture.h"
+
+#define RING_MASK (SPI_CAPTURE_RING_SIZE - 1)
+
+// Hex bytes per printed line
+#define LINE_BYTES 32
+
+// The other side's index is read with acquire and published with release,
+// which orders the bytes with it, as in sim_log.c.
+
+void spi_capture_init(spi_capture_t *cap, uint64_t (*now_us)(void), uint8_t stream) {
+    cap->head = 0;
+    cap->tail = 0;
+    cap->fill = 0;
+    cap->reserve = 0;
+    cap->records = 0;
+    cap->dropped = 0;
+    cap->gap = false;
+    cap->dropped_reported = 0;
+    cap->clock_us = now_us;
+    cap->stream = stream;
+}
+
+// Copy into the ring at pos, wrapping
+static void put(spi_capture_t *cap, uint32_t pos, const uint8_t *data, size_t len) {
+    uint32_t at = pos & RING_MASK;
+    size_t first = SPI_CAPTURE_RING_SIZE - at;
+    if (first > len) first = len;
+    if (data) {
+        memcpy(&cap->ring[at], data, first);
+        memcpy(cap->ring, data + first, len - first);
+    } else {
+        memset(&cap->ring[at], 0, first);
+        memset(cap->ring, 0, len - first);
+    }
+}
+
+bool spi_capture_begin(spi_capture_t *cap, uint8_t flags, uint16_t len) {
+    uint32_t dirs = ((flags & SPI_CAPTURE_MOSI) ? 1u : 0u) + ((flags & SPI_CAPTURE_MISO) ? 1u : 0u);
+    uint32_t size = sizeof(spi_capture_header_t) + dirs * len;
+    uint32_t head = cap->head;
+    if (size > SPI_CAPTURE_RING_SIZE - (head - __atomic_load_n(&cap->tail, __ATOMIC_ACQUIRE))) {
+        cap->dropped++;
+        cap->gap = true;
+        return false;
+    }
+
+    spi_capture_header_t h = {
+        .time_us = cap->clock_us ? (uint32_t)cap->clock_us() : 0,
+        .len = len,
+        .flags = (uint8_t)(flags | (cap->gap ? SPI_CAPTURE_GAP : 0)),
+    };
+    put(cap, head, (const uint8_t *)&h, sizeof(h));
+    cap->gap = false;
+    cap->reserve = head + size;
+    cap->fill = head + sizeof(h);
+    return true;
+}
+
+void spi_capture_append(spi_capture_t *cap, const uint8_t *data, size_t len) {
+    put(cap, cap->fill, data, len);
+    cap->fill += len;
+}
+
+void spi_capture_end(spi_capture_t *cap) {
+    cap->records++;
+    __atomic_store_n(&cap->head, cap->reserve, __ATOMIC_RELEASE);
+}
+
+void spi_capture_write(spi_capture_t *cap, const uint8_t *mosi, const uint8_t *miso, uint16_t len) {
+    uint8_t flags = (mosi ? SPI_CAPTURE_MOSI : 0) | (miso ? SPI_CAPTURE_MISO : 0);
+    if (!spi_capture_begin(cap, flags, len)) return;
+    if (mosi) spi_capture_append(cap, mosi, len);
+    if (miso) spi_capture_append(cap, miso, len);
+    spi_capture_end(cap);
+}
+
+uint32_t spi_capture_drain(spi_capture_t *cap, uint32_t max) {
+    static const char digits[] = "0123456789abcdef";
+    uint32_t tail = cap->tail;
+    uint32_t n = __atomic_load_n(&cap->head, __ATOMIC_ACQUIRE) - tail;
+    if (n > max) n = max;
+
+    for (uint32_t done = 0; done < n; ) {
+        uint32_t chunk = n - done;
+        if (chunk > LINE_BYTES) chunk = LINE_BYTES;
+        char hex[2 * LINE_BYTES + 1];
+        for (uint32_t i = 0; i < chunk; i++) {
+            uint8_t b = cap->ring[(tail + done + i) & RING_MASK];
+            hex[2 * i] = digits[b >> 4];
+            hex[2 * i + 1] = digits[b & 0xF];
+        }
+        hex[2 * chunk] = '\0';
+        printf("#C%u %08x %s\n", (unsigned)cap->stream, (unsigned)(tail + done), hex);
+        done += chunk;
+    }
+    __atomic_store_n(&cap->tail, tail + n, __ATOMIC_RELEASE);
+
+    uint32_t dropped = __atomic_load_n(&cap->dropped, __ATOMIC_RELAXED);
+    if (dropped != cap->dropped_reported) {
+        printf("[CAPTURE %u] %u transfers dropped\n", (unsigned)cap->stream,
+               (unsigned)(dropped - cap->dropped_reported));
+        cap->dropped_reported = dropped;
+    }
+    return n;
+}
+
+void spi_capture_get_stats(const spi_capture_t *cap, spi_capture_stats_t *stats) {
+    stats->records = __atomic_load_n(&cap->records, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&cap->head, __ATOMIC_ACQUIRE);
+    stats->dropped = __atomic_load_n(&cap->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,111 @@
+#ifndef SPI_CAPTURE_H
+#define SPI_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary capture of SPI transfers, for replay by tools/spi_replay.c. The
+// driver records every nm_spi_rw() (both directions of one full-duplex
+// transfer), the simulator records what its engine received and sent
+// (one direction per record).
+//
+// Like sim_log, a single-producer single-consumer ring: the producer copies
+// the bytes and returns, the consumer streams them over stdio as
+// "#C<stream> <offset> <hex>" lines. The stream is a sequence of records:
+//
+//   spi_capture_header_t, then len MOSI bytes if SPI_CAPTURE_MOSI,
+//   then len MISO bytes if SPI_CAPTURE_MISO
+//
+// A record that does not fit is dropped whole and the next one is flagged
+// SPI_CAPTURE_GAP.
+
+// Bytes in the ring, a power of two
+#ifndef SPI_CAPTURE_RING_SIZE
+#define SPI_CAPTURE_RING_SIZE 16384
+#endif
+
+_Static_assert((SPI_CAPTURE_RING_SIZE & (SPI_CAPTURE_RING_SIZE - 1)) == 0, "SPI_CAPTURE_RING_SIZE must be a power of two");
+
+// Stream ids: the driver, then one per simulator instance
+#define SPI_CAPTURE_STREAM_DRIVER 0
+#define SPI_CAPTURE_STREAM_SIM(instance) (1 + (instance))
+
+// Record flags
+#define SPI_CAPTURE_MOSI 0x01   // Bytes the host sent
+#define SPI_CAPTURE_MISO 0x02   // Bytes the chip sent
+#define SPI_CAPTURE_GAP  0x80   // Records were dropped before this one
+
+// Record header, also the dump format (little endian)
+typedef struct {
+    uint32_t time_us;   // Low 32 bits of the clock
+    uint16_t len;       // Bytes per direction
+    uint8_t flags;
+    uint8_t reserved;
+} spi_capture_header_t;
+
+_Static_assert(sizeof(spi_capture_header_t) == 8, "spi_capture_header_t is 8 bytes");
+
+typedef struct {
+    uint32_t records;   // Records stored
+    uint32_t bytes;     // Stream bytes stored, headers included
+    uint32_t dropped;   // Records lost, ring full
+} spi_capture_stats_t;
+
+// One ring. head is only written by the producer, tail only by the consumer.
+typedef struct {
+    uint8_t ring[SPI_CAPTURE_RING_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t fill;              // Producer: next byte of the record being written
+    uint32_t reserve;           // Producer: end of that record
+    uint32_t records;           // Producer only
+    uint32_t dropped;           // Producer only
+    bool gap;                   // Producer only
+    uint32_t dropped_reported;  // Consumer only
+    uint64_t (*clock_us)(void);
+    uint8_t stream;
+} spi_capture_t;
+
+/**
+ * @brief Empty the ring
+ *
+ * @param now_us  Clock for the record time stamps, NULL stamps 0
+ * @param stream  Shown in the printed lines, see SPI_CAPTURE_STREAM_*
+ */
+void spi_capture_init(spi_capture_t *cap, uint64_t (*now_us)(void), uint8_t stream);
+
+/**
+ * @brief Record one transfer
+ *
+ * @param mosi Bytes sent by the host, NULL if not captured
+ * @param miso Bytes sent by the chip, NULL if not captured
+ */
+void spi_capture_write(spi_capture_t *cap, const uint8_t *mosi, const uint8_t *miso, uint16_t len);
+
+/**
+ * @brief Record one direction of a transfer from several pieces
+ *
+ * spi_capture_begin() reserves room for the whole record, then
+ * spi_capture_append() fills it (NULL appends zeros) and spi_capture_end()
+ * publishes it. If begin returns false the record was dropped and the other
+ * two must not be called.
+ */
+bool spi_capture_begin(spi_capture_t *cap, uint8_t flags, uint16_t len);
+void spi_capture_append(spi_capture_t *cap, const uint8_t *data, size_t len);
+void spi_capture_end(spi_capture_t *cap);
+
+/**
+ * @brief Stream up to max bytes of the ring to stdout
+ *
+ * Prints "#C<stream> <offset> <hex>" lines, the offset counting stream
+ * bytes so the replayer notices lost lines. Reports records dropped since
+ * the last call.
+ *
+ * @return Bytes printed
+ */
+uint32_t spi_capture_drain(spi_capture_t *cap, uint32_t max);
+
+void spi_capture_get_stats(const spi_capture_t *cap, spi_capture_stats_t *stats);
+
+#endif // SPI_CAPTURE_H
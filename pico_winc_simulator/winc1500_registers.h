@@ -22,9 +22,14 @@
 #define WIFI_HOST_RCV_CTRL_1	(0x1084)
 #define WIFI_HOST_RCV_CTRL_2    (0x1078)
 #define WIFI_HOST_RCV_CTRL_3    (0x106c)
+#define WIFI_HOST_RCV_CTRL_4	(0x150400)
 #define WAKE_REG				(0x1074)
 
 #define M2M_WAIT_FOR_HOST_REG 	(0x207bc)
+#define M2M_START_FIRMWARE		(0xef522f61)
+#define M2M_FINISH_INIT_STATE	(0x02532636)
+
+#define NMI_AHB_DATA_MEM_BASE	(0x30000)
 
 #define NMI_SPI_REG_BASE        0xE800
 #define NMI_SPI_CTL             (NMI_SPI_REG_BASE)
@@ -0,0 +1,27 @@
+#ifndef WINC_CRC_H
+#define WINC_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Data packet CRC: CRC-16-CCITT (poly 0x1021, MSB first, no reflection),
+// seeded with 0xFFFF and sent high byte first. This is what the RP2040 DMA
+// sniffer computes in its CRC-16-CCITT mode, so both paths agree bit for bit.
+#define WINC_CRC16_SEED 0xFFFF
+
+/**
+ * @brief Continue a CRC16 over len bytes
+ *
+ * @param crc Running CRC, WINC_CRC16_SEED for a new packet
+ * @param buf Data
+ * @param len Number of bytes
+ * @return Updated CRC
+ */
+uint16_t winc_crc16_update(uint16_t crc, const uint8_t *buf, size_t len);
+
+// CRC16 of one complete data packet
+static inline uint16_t winc_crc16(const uint8_t *buf, size_t len) {
+    return winc_crc16_update(WINC_CRC16_SEED, buf, len);
+}
+
+#endif // WINC_CRC_H
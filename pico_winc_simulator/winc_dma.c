@@ -2,44 +2,124 @@
 #include "hardware/dma.h"
 #include "hardware/irq.h"
 #include "pio_spi.h"
+#include "winc_crc.h"
+#include "winc_sim_cpu.h"
 
-static int dma_channel = -1;
-static winc_dma_complete_cb_t dma_callback = NULL;
+// Payload chains: the data channel moves one segment at a time and chains to
+// the control channel, which reloads the data channel's alias 1 registers
+// (CTRL, READ_ADDR, WRITE_ADDR, TRANS_COUNT_TRIG) from the next control block.
+// A block with a zero transfer count is a null trigger and ends the chain; the
+// data channel runs with IRQ_QUIET so that is the only interrupt it raises.
 
-static void dma_handler() {
-    if (dma_channel >= 0 && dma_hw->ints0 & (1u << dma_channel)) {
-        dma_hw->ints0 = 1u << dma_channel; // Clear interrupt
-        if (dma_callback) {
-            dma_callback();
+static winc_dma_t *instances[WINC_DMA_MAX_INSTANCES];
+static size_t instance_count;
+static winc_sim_cpu_t *dma_cpu;
+static const uint32_t crc_seed = WINC_CRC16_SEED;
+
+// Data CRC16 of a finished receive chain, for instances without the sniffer.
+// Discarded bytes are gone by now, so a packet with some only gets the host's
+// CRC copied over, which the engine takes as a match.
+static void software_rx_crc(const winc_dma_seg_t *segs, size_t count) {
+    uint16_t crc = WINC_CRC16_SEED;
+    bool checked = true;
+    for (size_t i = 0; i < count; i++) {
+        const winc_dma_seg_t *seg = &segs[i];
+        if (seg->len == 0) continue;
+        if (seg->flags & WINC_DMA_SEG_CRC16) {
+            if (checked) {
+                seg->addr[2] = (uint8_t)(crc >> 8);
+                seg->addr[3] = (uint8_t)crc;
+            } else {
+                seg->addr[2] = seg->addr[0];
+                seg->addr[3] = seg->addr[1];
+            }
+            crc = WINC_CRC16_SEED;
+            checked = true;
+        } else if (seg->flags & WINC_DMA_SEG_CRC_DATA) {
+            if (seg->flags & WINC_DMA_SEG_DISCARD) {
+                checked = false;
+            } else {
+                crc = winc_crc16_update(crc, seg->addr, seg->len);
+            }
         }
     }
 }
 
-void winc_dma_init(winc_dma_complete_cb_t callback) {
-    dma_callback = callback;
-    dma_channel = dma_claim_unused_channel(true);
+static void instance_irq(winc_dma_t *dma) {
+    if (dma_hw->ints0 & (1u << dma->read_channel)) {
+        dma_hw->ints0 = 1u << dma->read_channel; // Clear interrupt
+        if (dma->read_callback) {
+            dma->read_callback(dma->ctx);
+        }
+    }
+    if (dma_hw->ints0 & (1u << dma->chain_data_channel)) {
+        dma_hw->ints0 = 1u << dma->chain_data_channel; // Clear interrupt
+        if (dma_channel_is_busy(dma->drain_channel)) {
+            dma_channel_abort(dma->drain_channel);
+        }
+        if (dma->crc_segs) {
+            software_rx_crc(dma->crc_segs, dma->crc_count);
+            dma->crc_segs = NULL;
+        }
+        winc_dma_complete_cb_t cb = dma->chain_callback;
+        dma->chain_callback = NULL;
+        if (cb) {
+            cb(dma->ctx);
+        }
+    }
+}
 
-    // Setup interrupt
-    dma_channel_set_irq0_enabled(dma_channel, true);
-    irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
-    irq_set_enabled(DMA_IRQ_0, true);
+static void dma_handler() {
+    winc_sim_cpu_enter(dma_cpu, WINC_SIM_CPU_DMA_ISR);
+    for (size_t i = 0; i < instance_count; i++) {
+        instance_irq(instances[i]);
+    }
+    winc_sim_cpu_exit(dma_cpu);
 }
 
-void winc_dma_read(uint8_t *buffer, size_t length) {
-    if (dma_channel < 0) return;
+void winc_dma_init(winc_dma_t *dma, pio_spi_t *spi, winc_sim_cpu_t *cpu, winc_dma_complete_cb_t callback, void *ctx) {
+    if (instance_count == WINC_DMA_MAX_INSTANCES) return;
 
-    dma_channel_config c = dma_channel_get_default_config(dma_channel);
+    dma->spi = spi;
+    dma->ctx = ctx;
+    dma->sniffer = instance_count == 0;
+    dma->read_callback = callback;
+    dma->chain_callback = NULL;
+    dma->crc_segs = NULL;
+    dma->read_channel = dma_claim_unused_channel(true);
+    dma->chain_data_channel = dma_claim_unused_channel(true);
+    dma->chain_ctrl_channel = dma_claim_unused_channel(true);
+    dma->drain_channel = dma_claim_unused_channel(true);
+
+    // Setup interrupt
+    dma_channel_set_irq0_enabled(dma->read_channel, true);
+    dma_channel_set_irq0_enabled(dma->chain_data_channel, true);
+    if (dma->sniffer) {
+        // Only the data channel is sniffed, and only blocks with SNIFF_EN set
+        dma_sniffer_enable(dma->chain_data_channel, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, false);
+    }
+
+    instances[instance_count++] = dma;
+    if (instance_count == 1) {
+        dma_cpu = cpu;
+        irq_set_exclusive_handler(DMA_IRQ_0, dma_handler);
+        irq_set_enabled(DMA_IRQ_0, true);
+    }
+}
+
+void winc_dma_read(winc_dma_t *dma, uint8_t *buffer, size_t length) {
+    dma_channel_config c = dma_channel_get_default_config(dma->read_channel);
     channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
     channel_config_set_read_increment(&c, false);
     channel_config_set_write_increment(&c, true);
 
-    uint dreq = pio_spi_get_rx_dreq();
+    uint dreq = pio_spi_get_rx_dreq(dma->spi);
     channel_config_set_dreq(&c, dreq);
 
-    volatile const void *read_addr = pio_spi_get_rx_fifo_address();
+    volatile const void *read_addr = pio_spi_get_rx_fifo_address(dma->spi);
 
     dma_channel_configure(
-        dma_channel,
+        dma->read_channel,
         &c,
         buffer,
         read_addr,
@@ -47,3 +127,128 @@ void winc_dma_read(uint8_t *buffer, size_t length) {
         true // start immediately
     );
 }
+
+static uint32_t chain_block_ctrl(winc_dma_t *dma, enum dma_channel_transfer_size size, bool read_incr, bool write_incr, uint dreq, bool sniff) {
+    dma_channel_config c = dma_channel_get_default_config(dma->chain_data_channel);
+    channel_config_set_transfer_data_size(&c, size);
+    channel_config_set_read_increment(&c, read_incr);
+    channel_config_set_write_increment(&c, write_incr);
+    channel_config_set_dreq(&c, dreq);
+    channel_config_set_chain_to(&c, dma->chain_ctrl_channel);
+    channel_config_set_irq_quiet(&c, true);
+    channel_config_set_sniff_enable(&c, sniff && dma->sniffer);
+    return channel_config_get_ctrl_value(&c);
+}
+
+static void add_block(winc_dma_t *dma, size_t *n, uint32_t ctrl, const volatile void *read_addr, volatile void *write_addr, uint32_t count) {
+    winc_dma_ctrl_block_t *b = &dma->blocks[(*n)++];
+    b->ctrl = ctrl;
+    b->read_addr = (uint32_t)read_addr;
+    b->write_addr = (uint32_t)write_addr;
+    b->transfer_count = count;
+}
+
+// The data CRC16 is computed by the DMA sniffer on the data channel while the
+// payload streams: data blocks run with SNIFF_EN set, a CRC segment reads the
+// accumulator a byte at a time (high byte first) and a 32-bit block from
+// crc_seed reseeds it for the next packet. The CPU never touches the payload.
+// Without the sniffer a send chain takes the CRC from tx_crc, filled here,
+// and a receive chain gets it in the completion IRQ.
+static void start_chain(winc_dma_t *dma, bool tx, const winc_dma_seg_t *segs, size_t count, winc_dma_complete_cb_t callback) {
+    if (count > WINC_DMA_MAX_SEGMENTS) count = WINC_DMA_MAX_SEGMENTS;
+
+    uint dreq = tx ? pio_spi_get_tx_dreq(dma->spi) : pio_spi_get_rx_dreq(dma->spi);
+    volatile void *fifo = tx ? pio_spi_get_tx_fifo_address(dma->spi) : (volatile void *)pio_spi_get_rx_fifo_address(dma->spi);
+    volatile uint8_t *sniff_hi = (volatile uint8_t *)&dma_hw->sniff_data + 1;
+    volatile uint8_t *sniff_lo = (volatile uint8_t *)&dma_hw->sniff_data;
+    uint32_t ctrl_crc_byte = tx ? chain_block_ctrl(dma, DMA_SIZE_8, false, false, dreq, false)
+                                : chain_block_ctrl(dma, DMA_SIZE_8, false, false, DREQ_FORCE, false);
+    uint32_t ctrl_reseed = chain_block_ctrl(dma, DMA_SIZE_32, false, false, DREQ_FORCE, false);
+    uint16_t crc = WINC_CRC16_SEED;
+    size_t crcs = 0;
+
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        const winc_dma_seg_t *seg = &segs[i];
+        if (seg->len == 0) continue;
+        bool sniff = (seg->flags & WINC_DMA_SEG_CRC_DATA) != 0;
+
+        if (seg->flags & WINC_DMA_SEG_CRC16) {
+            if (!dma->sniffer) {
+                if (tx) {
+                    uint8_t *out = dma->tx_crc[crcs++];
+                    out[0] = (uint8_t)(crc >> 8);
+                    out[1] = (uint8_t)crc;
+                    add_block(dma, &n, chain_block_ctrl(dma, DMA_SIZE_8, true, false, dreq, false), out, fifo, 2);
+                    crc = WINC_CRC16_SEED;
+                } else {
+                    add_block(dma, &n, chain_block_ctrl(dma, DMA_SIZE_8, false, true, dreq, false), fifo, seg->addr, 2);
+                }
+                continue;
+            }
+            if (tx) {
+                add_block(dma, &n, ctrl_crc_byte, sniff_hi, fifo, 1);
+                add_block(dma, &n, ctrl_crc_byte, sniff_lo, fifo, 1);
+            } else {
+                // Host's CRC first, then the sniffer's next to it for the engine to compare
+                add_block(dma, &n, chain_block_ctrl(dma, DMA_SIZE_8, false, true, dreq, false), fifo, seg->addr, 2);
+                add_block(dma, &n, ctrl_crc_byte, sniff_hi, seg->addr + 2, 1);
+                add_block(dma, &n, ctrl_crc_byte, sniff_lo, seg->addr + 3, 1);
+            }
+            add_block(dma, &n, ctrl_reseed, &crc_seed, &dma_hw->sniff_data, 1);
+        } else if (tx) {
+            if (sniff && !dma->sniffer) {
+                crc = winc_crc16_update(crc, seg->addr, seg->len);
+            }
+            add_block(dma, &n, chain_block_ctrl(dma, DMA_SIZE_8, true, false, dreq, sniff), seg->addr, fifo, seg->len);
+        } else if (seg->flags & WINC_DMA_SEG_DISCARD) {
+            add_block(dma, &n, chain_block_ctrl(dma, DMA_SIZE_8, false, false, dreq, sniff), fifo, &dma->sink, seg->len);
+        } else {
+            add_block(dma, &n, chain_block_ctrl(dma, DMA_SIZE_8, false, true, dreq, sniff), fifo, seg->addr, seg->len);
+        }
+    }
+    // Null trigger terminates the chain and raises the (quiet) IRQ
+    add_block(dma, &n, ctrl_reseed, NULL, NULL, 0);
+
+    dma->chain_callback = callback;
+    if (dma->sniffer) {
+        dma_hw->sniff_data = crc_seed;
+    } else if (!tx) {
+        dma->crc_segs = segs;
+        dma->crc_count = count;
+    }
+
+    if (tx) {
+        // The host clocks dummy bytes in while it reads; keep them from
+        // piling up in the RX FIFO without waking the CPU for each one.
+        dma_channel_config d = dma_channel_get_default_config(dma->drain_channel);
+        channel_config_set_transfer_data_size(&d, DMA_SIZE_8);
+        channel_config_set_read_increment(&d, false);
+        channel_config_set_write_increment(&d, false);
+        channel_config_set_dreq(&d, pio_spi_get_rx_dreq(dma->spi));
+        dma_channel_configure(dma->drain_channel, &d, &dma->sink, pio_spi_get_rx_fifo_address(dma->spi), 0xffffffffu, true);
+    }
+
+    dma_channel_config c = dma_channel_get_default_config(dma->chain_ctrl_channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, 4); // 4 words = 16 bytes of alias 1 registers
+
+    dma_channel_configure(
+        dma->chain_ctrl_channel,
+        &c,
+        &dma_hw->ch[dma->chain_data_channel].al1_ctrl,
+        dma->blocks,
+        4,
+        true // start immediately
+    );
+}
+
+void winc_dma_send_chain(winc_dma_t *dma, const winc_dma_seg_t *segs, size_t count, winc_dma_complete_cb_t callback) {
+    start_chain(dma, true, segs, count, callback);
+}
+
+void winc_dma_recv_chain(winc_dma_t *dma, const winc_dma_seg_t *segs, size_t count, winc_dma_complete_cb_t callback) {
+    start_chain(dma, false, segs, count, callback);
+}
@@ -3,16 +3,70 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "pio_spi.h"
+#include "winc_sim_transport.h"
+#include "winc_sim_cpu.h"
 
-// Callback type for when DMA transfer is complete
-typedef void (*winc_dma_complete_cb_t)(void);
+// Callback type for when DMA transfer is complete, with the instance's ctx
+typedef void (*winc_dma_complete_cb_t)(void *ctx);
+
+// Payload chains use the engine's segment list as-is
+#define WINC_DMA_MAX_SEGMENTS WINC_SIM_MAX_SEGMENTS
+#define WINC_DMA_SEG_DISCARD  WINC_SIM_SEG_DISCARD
+#define WINC_DMA_SEG_CRC_DATA WINC_SIM_SEG_CRC_DATA
+#define WINC_DMA_SEG_CRC16    WINC_SIM_SEG_CRC16
+typedef winc_sim_seg_t winc_dma_seg_t;
+
+// One per PIO block
+#define WINC_DMA_MAX_INSTANCES 2
+
+// A CRC16 segment expands to up to four blocks (see start_chain)
+#define WINC_DMA_MAX_BLOCKS (WINC_DMA_MAX_SEGMENTS * 4 + 1)
+
+typedef struct {
+    uint32_t ctrl;
+    uint32_t read_addr;
+    uint32_t write_addr;
+    uint32_t transfer_count;
+} winc_dma_ctrl_block_t;
+
+// DMA channels and chain state of one SPI slave. There is one DMA sniffer,
+// it goes to the first instance; the others compute the data CRC16 on the
+// CPU, before a send chain and after a receive chain.
+typedef struct {
+    pio_spi_t *spi;
+    void *ctx;
+    bool sniffer;
+
+    int read_channel;
+    int chain_data_channel;
+    int chain_ctrl_channel;
+    int drain_channel;
+    winc_dma_complete_cb_t read_callback;
+    winc_dma_complete_cb_t chain_callback;
+
+    // Receive chain awaiting its software CRC, NULL with the sniffer
+    const winc_dma_seg_t *crc_segs;
+    size_t crc_count;
+
+    winc_dma_ctrl_block_t blocks[WINC_DMA_MAX_BLOCKS];
+    uint8_t tx_crc[WINC_DMA_MAX_SEGMENTS][2];
+    uint32_t sink;
+} winc_dma_t;
 
 /**
- * @brief Initialize the DMA for WINC simulator
+ * @brief Initialize the DMA for one WINC simulator instance
  *
- * @param callback Function to call when DMA transfer completes
+ * All instances share the DMA_IRQ_0 handler, which is charged to cpu.
+ *
+ * @param dma      Instance state, must stay valid
+ * @param spi      SPI slave the channels move data for
+ * @param cpu      CPU accounting of the core taking DMA_IRQ_0
+ * @param callback Function to call when a winc_dma_read() completes
+ * @param ctx      Passed to every callback of this instance
  */
-void winc_dma_init(winc_dma_complete_cb_t callback);
+void winc_dma_init(winc_dma_t *dma, pio_spi_t *spi, winc_sim_cpu_t *cpu, winc_dma_complete_cb_t callback, void *ctx);
 
 /**
  * @brief Start a DMA read transfer from the SPI RX FIFO
@@ -20,6 +74,36 @@ void winc_dma_init(winc_dma_complete_cb_t callback);
  * @param buffer Destination buffer
  * @param length Number of bytes to read
  */
-void winc_dma_read(uint8_t *buffer, size_t length);
+void winc_dma_read(winc_dma_t *dma, uint8_t *buffer, size_t length);
+
+/**
+ * @brief Stream a list of segments into the SPI TX FIFO
+ *
+ * The segments are turned into DMA control blocks, so the whole chain runs
+ * without CPU involvement. The RX FIFO is drained into a sink while the chain
+ * runs. The callback is invoked once the last byte has entered the TX FIFO.
+ * WINC_DMA_SEG_CRC16 segments send the CRC16 the DMA sniffer accumulated over
+ * the preceding WINC_DMA_SEG_CRC_DATA segments.
+ *
+ * @param segs     Segments to send, in order
+ * @param count    Number of segments (at most WINC_DMA_MAX_SEGMENTS)
+ * @param callback Function to call when the chain completes
+ */
+void winc_dma_send_chain(winc_dma_t *dma, const winc_dma_seg_t *segs, size_t count, winc_dma_complete_cb_t callback);
+
+/**
+ * @brief Receive a list of segments from the SPI RX FIFO
+ *
+ * Same as winc_dma_send_chain() in the other direction. Segments flagged with
+ * WINC_DMA_SEG_DISCARD are read into a sink without advancing the address.
+ * WINC_DMA_SEG_CRC16 segments receive the host's CRC into addr[0..1] and the
+ * sniffer's CRC into addr[2..3]. The segments must stay valid until the
+ * callback.
+ *
+ * @param segs     Segments to fill, in order
+ * @param count    Number of segments (at most WINC_DMA_MAX_SEGMENTS)
+ * @param callback Function to call when the chain completes
+ */
+void winc_dma_recv_chain(winc_dma_t *dma, const winc_dma_seg_t *segs, size_t count, winc_dma_complete_cb_t callback);
 
 #endif // WINC_DMA_H
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <string.h>
+#include "winc_sim_cpu.h"
+
+static inline uint32_t now(const winc_sim_transport_t *transport) {
+    if (transport->cycles) {
+        return transport->cycles();
+    }
+    return (uint32_t)transport->now_us();
+}
+
+static void charge(winc_sim_cpu_t *cpu) {
+    uint32_t t = now(cpu->transport);
+    uint32_t mask = cpu->transport->cycles ? cpu->transport->cycles_mask : UINT32_MAX;
+    cpu->counters.cycles[cpu->stack[cpu->depth - 1]] += (t - cpu->last) & mask;
+    cpu->last = t;
+}
+
+void winc_sim_cpu_init(winc_sim_cpu_t *cpu, const winc_sim_transport_t *transport) {
+    cpu->transport = transport;
+    winc_sim_cpu_reset(cpu);
+}
+
+void winc_sim_cpu_enter(winc_sim_cpu_t *cpu, winc_sim_cpu_context_t context) {
+    charge(cpu);
+    cpu->counters.entries[context]++;
+    if (cpu->depth < WINC_SIM_CPU_DEPTH) {
+        cpu->stack[cpu->depth++] = (uint8_t)context;
+    } else {
+        cpu->overflow++;
+    }
+}
+
+void winc_sim_cpu_exit(winc_sim_cpu_t *cpu) {
+    charge(cpu);
+    if (cpu->overflow > 0) {
+        cpu->overflow--;
+    } else if (cpu->depth > 1) {
+        cpu->depth--;
+    }
+}
+
+void winc_sim_cpu_get_stats(winc_sim_cpu_t *cpu, winc_sim_cpu_stats_t *stats) {
+    charge(cpu);
+    *stats = cpu->counters;
+    stats->total = 0;
+    for (uint32_t i = 0; i < WINC_SIM_CPU_CONTEXTS; i++) {
+        stats->total += cpu->counters.cycles[i];
+    }
+}
+
+void winc_sim_cpu_reset(winc_sim_cpu_t *cpu) {
+    memset(&cpu->counters, 0, sizeof(cpu->counters));
+    cpu->stack[0] = WINC_SIM_CPU_MAIN;
+    cpu->depth = 1;
+    cpu->overflow = 0;
+    cpu->last = now(cpu->transport);
+}
+
+void winc_sim_cpu_print(const winc_sim_cpu_stats_t *cur, const winc_sim_cpu_stats_t *prev) {
+    static const char *names[WINC_SIM_CPU_CONTEXTS] = { "main", "idle", "pio", "dma", "timer", "command" };
+
+    uint64_t total = cur->total - prev->total;
+    if (total == 0) return;
+
+    // Per mille, no floating point on the M0+
+    uint32_t share[WINC_SIM_CPU_CONTEXTS];
+    for (uint32_t i = 0; i < WINC_SIM_CPU_CONTEXTS; i++) {
+        share[i] = (uint32_t)((cur->cycles[i] - prev->cycles[i]) * 1000u / total);
+    }
+    uint32_t busy = 1000u - share[WINC_SIM_CPU_IDLE];
+
+    printf("CPU %lu.%lu%% busy:", (unsigned long)(busy / 10), (unsigned long)(busy % 10));
+    for (uint32_t i = 0; i < WINC_SIM_CPU_CONTEXTS; i++) {
+        if (i == WINC_SIM_CPU_IDLE) continue;
+        printf(" %s %lu.%lu%%", names[i], (unsigned long)(share[i] / 10), (unsigned long)(share[i] % 10));
+    }
+    printf(", %lu commands, %lu wakeups\n",
+           (unsigned long)(cur->entries[WINC_SIM_CPU_COMMAND] - prev->entries[WINC_SIM_CPU_COMMAND]),
+           (unsigned long)(cur->entries[WINC_SIM_CPU_IDLE] - prev->entries[WINC_SIM_CPU_IDLE]));
+}
@@ -0,0 +1,71 @@
+#ifndef WINC_SIM_CPU_H
+#define WINC_SIM_CPU_H
+
+#include <stdint.h>
+#include "winc_sim_transport.h"
+
+// Where the simulator's core spends its cycles. Each handler brackets itself
+// with winc_sim_cpu_enter()/winc_sim_cpu_exit(), and the main loop brackets
+// its sleep. Cycles always go to the innermost context, so an ISR taken
+// during the main loop is not counted twice and command processing inside
+// the DMA ISR is taken out of the ISR's share.
+//
+// Intervals are measured with the transport's cycles() counter, so the
+// caller must enter or exit a context at least once per counter wrap (134 ms
+// for the Pico's SysTick).
+//
+// The counters belong to a core, not to a simulator instance: instances that
+// share a core share one winc_sim_cpu_t through winc_sim_t.cpu.
+
+typedef enum {
+    WINC_SIM_CPU_MAIN,      // Main loop: trace drain, reports, console
+    WINC_SIM_CPU_IDLE,      // Asleep in WFI
+    WINC_SIM_CPU_PIO_ISR,   // Command byte from the PIO RX FIFO
+    WINC_SIM_CPU_DMA_ISR,   // Header, payload and chain completion
+    WINC_SIM_CPU_TIMER,     // Scheduler alarms and the accounting tick
+    WINC_SIM_CPU_COMMAND,   // Engine decoding and answering a command
+    WINC_SIM_CPU_CONTEXTS
+} winc_sim_cpu_context_t;
+
+typedef struct {
+    uint64_t cycles[WINC_SIM_CPU_CONTEXTS];
+    uint32_t entries[WINC_SIM_CPU_CONTEXTS];   // IDLE: wakeups
+    uint64_t total;                             // Sum of cycles
+} winc_sim_cpu_stats_t;
+
+// MAIN, an ISR and COMMAND; one spare
+#define WINC_SIM_CPU_DEPTH 4
+
+typedef struct {
+    const winc_sim_transport_t *transport;
+    winc_sim_cpu_stats_t counters;
+    uint8_t stack[WINC_SIM_CPU_DEPTH];
+    uint8_t depth;
+    uint8_t overflow;   // Enters beyond WINC_SIM_CPU_DEPTH, not tracked
+    uint32_t last;
+} winc_sim_cpu_t;
+
+/**
+ * @brief Clear the counters and take the clock from the transport
+ *
+ * The caller is in the MAIN context.
+ */
+void winc_sim_cpu_init(winc_sim_cpu_t *cpu, const winc_sim_transport_t *transport);
+
+// Charge the cycles since the last call to the current context, then switch
+void winc_sim_cpu_enter(winc_sim_cpu_t *cpu, winc_sim_cpu_context_t context);
+void winc_sim_cpu_exit(winc_sim_cpu_t *cpu);
+
+/**
+ * @brief Counters since init or reset, charged up to now
+ *
+ * Not safe against the handlers: call with interrupts disabled on the Pico.
+ */
+void winc_sim_cpu_get_stats(winc_sim_cpu_t *cpu, winc_sim_cpu_stats_t *stats);
+
+void winc_sim_cpu_reset(winc_sim_cpu_t *cpu);
+
+// Print the share of each context between two snapshots
+void winc_sim_cpu_print(const winc_sim_cpu_stats_t *now, const winc_sim_cpu_stats_t *prev);
+
+#endif // WINC_SIM_CPU_H
@@ -0,0 +1,565 @@
+#include <stdio.h>
+#include <string.h>
+#include "winc1500_registers.h"
+#include "winc_sim_engine.h"
+#include "winc_sim_memmap.h"
+#include "winc_sim_hif.h"
+#include "winc_sim_wifi.h"
+#include "winc_sim_socket.h"
+#include "winc_sim_sched.h"
+#include "winc_sim_traffic.h"
+#include "winc_sim_latency.h"
+#include "winc_sim_cpu.h"
+#include "winc_crc.h"
+#include "config/conf_simulator.h"
+#include "sim_log.h"
+
+// Command processing is charged to the core's COMMAND context
+static inline void cpu_enter(winc_sim_t *sim) {
+    if (sim->cpu) winc_sim_cpu_enter(sim->cpu, WINC_SIM_CPU_COMMAND);
+}
+
+static inline void cpu_exit(winc_sim_t *sim) {
+    if (sim->cpu) winc_sim_cpu_exit(sim->cpu);
+}
+
+// Capture of the bytes the engine takes in and puts out, one direction per
+// record. Replayed in order through a fresh engine they give the same answers.
+static inline void capture(winc_sim_t *sim, bool mosi, const uint8_t *buf, size_t len) {
+    if (sim->capture && len > 0) {
+        spi_capture_write(sim->capture, mosi ? buf : NULL, mosi ? NULL : buf, (uint16_t)len);
+    }
+}
+
+// A payload chain as it goes over the wire. The CRC16 the transport
+// generates for a read is computed here again; for a write the host's is in
+// the slot.
+static void capture_chain(winc_sim_t *sim, bool mosi) {
+    const winc_sim_seg_t *segs = sim->payload_segs;
+    size_t count = sim->payload_count;
+    uint32_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        len += segs[i].len;
+    }
+    if (!spi_capture_begin(sim->capture, mosi ? SPI_CAPTURE_MOSI : SPI_CAPTURE_MISO, (uint16_t)len)) {
+        return;
+    }
+    uint16_t crc = WINC_CRC16_SEED;
+    for (size_t i = 0; i < count; i++) {
+        const winc_sim_seg_t *seg = &segs[i];
+        if (seg->flags & WINC_SIM_SEG_CRC16) {
+            uint8_t sent[2] = { (uint8_t)(crc >> 8), (uint8_t)crc };
+            spi_capture_append(sim->capture, mosi ? seg->addr : sent, 2);
+            crc = WINC_CRC16_SEED;
+            continue;
+        }
+        if (!mosi && (seg->flags & WINC_SIM_SEG_CRC_DATA)) {
+            crc = winc_crc16_update(crc, seg->addr, seg->len);
+        }
+        // Discarded write data is gone, zeros stand in for it
+        spi_capture_append(sim->capture, seg->addr, seg->len);
+    }
+    spi_capture_end(sim->capture);
+}
+
+// Every response goes through here, the first one of a transaction is what
+// the host's spi_cmd_rsp() has been polling for
+static void respond(winc_sim_t *sim, const uint8_t *buf, size_t len) {
+    winc_sim_latency_response(sim);
+    capture(sim, false, buf, len);
+    sim->transport->write(sim->ctx, buf, len);
+}
+
+// Read response: 4 data bytes, followed by their CRC16 unless CRC is off.
+// Clockless register reads never carry a CRC.
+static void spi_send_data_with_crc(winc_sim_t *sim, const uint8_t *data, bool clockless) {
+    uint8_t rsp[6];
+    memcpy(rsp, data, 4);
+    if (sim->crc_off || clockless) {
+        respond(sim, rsp, 4);
+        return;
+    }
+    uint16_t crc = winc_crc16(rsp, 4);
+    rsp[4] = (uint8_t)(crc >> 8);
+    rsp[5] = (uint8_t)crc;
+    respond(sim, rsp, 6);
+}
+
+// Prefix and CRC slot per packet, plus one data segment per packet and per
+// page boundary the payload crosses
+#if WINC_SIM_MAX_SEGMENTS < (MAX_DMA_PACKETS * 3 + MAX_DMA_PAYLOAD_SIZE / WINC_SIM_MAP_PAGE_SIZE)
+#error "WINC_SIM_MAX_SEGMENTS too small for MAX_DMA_PAYLOAD_SIZE"
+#endif
+
+// Build the segment list for a multi-packet payload:
+// [prefix][data][crc] per packet, prefix 0xF1/0xF2/0xF3 as per the protocol.
+// For writes the first prefix has already been consumed by the prefix hunt.
+// Data is split wherever it crosses a page, so each segment is contiguous;
+// writes allocate the pages they touch. Returns 0 if part of the range is
+// unmapped or no page is left. With map false the data goes to the sink.
+static size_t build_payload_chain(winc_sim_t *sim, uint32_t addr, uint32_t total_size, bool write, bool map) {
+    size_t n = 0;
+    uint32_t remaining_size = total_size;
+    uint32_t offset = 0;
+    uint32_t packet = 0;
+
+    while (remaining_size > 0) {
+        uint32_t chunk_size = (remaining_size > sim->packet_size) ? sim->packet_size : remaining_size;
+
+        sim->packet_prefix[packet] = remaining_size <= sim->packet_size ? 0xF3 : offset ? 0xF2 : 0xF1;
+        if (!(write && packet == 0)) {
+            sim->payload_segs[n++] = (winc_sim_seg_t){ &sim->packet_prefix[packet], 1, 0 };
+        }
+        uint32_t crc_flag = sim->crc_off ? 0 : WINC_SIM_SEG_CRC_DATA;
+        if (map) {
+            for (uint32_t done = 0; done < chunk_size; ) {
+                uint8_t *ptr;
+                uint32_t len = winc_sim_map_span(sim, addr + offset + done, chunk_size - done, write, &ptr);
+                if (len == 0) {
+                    return 0;
+                }
+                sim->payload_segs[n++] = (winc_sim_seg_t){ ptr, len, crc_flag };
+                done += len;
+            }
+        } else {
+            sim->payload_segs[n++] = (winc_sim_seg_t){ NULL, chunk_size, WINC_SIM_SEG_DISCARD | crc_flag };
+        }
+        if (!sim->crc_off) {
+            // Generated (reads) or checked (writes) by the transport as the data streams
+            sim->payload_segs[n++] = (winc_sim_seg_t){ sim->packet_crc[packet], 2, WINC_SIM_SEG_CRC16 };
+        }
+
+        remaining_size -= chunk_size;
+        offset += chunk_size;
+        packet++;
+    }
+    return n;
+}
+
+void winc_sim_engine_chain_done(winc_sim_t *sim) {
+    cpu_enter(sim);
+    if (sim->state == SIM_STATE_RECEIVING_DATA) {
+        if (sim->capture) {
+            capture_chain(sim, true);
+        }
+        uint8_t state = sim->dma_write_oob ? DATA_RSP_STATE_BAD_ADDR : DATA_RSP_STATE_OK;
+
+        for (uint32_t i = 0; i * sim->packet_size < sim->dma_write_size; i++) {
+            if (i > 0 && (sim->packet_prefix[i] & 0xF0) != 0xF0) {
+                SIM_LOG(sim, SIM_EVENT_DMA_PREFIX, sim->packet_prefix[i], i);
+            }
+            const uint8_t *crc = sim->packet_crc[i];
+            if (!sim->crc_off && memcmp(&crc[0], &crc[2], 2) != 0) {
+                SIM_LOG(sim, SIM_EVENT_DATA_CRC_ERROR, (crc[0] << 8) | crc[1], (crc[2] << 8) | crc[3]);
+                if (state == DATA_RSP_STATE_OK) {
+                    state = DATA_RSP_STATE_CRC_ERROR;
+                }
+            }
+        }
+
+        // Data response: 0xC3 + state, preceded by a turnaround byte without CRC
+        uint8_t data_rsp[3] = {0x00, 0xC3, state};
+        if (sim->crc_off) {
+            respond(sim, data_rsp, 3);
+        } else {
+            respond(sim, &data_rsp[1], 2);
+        }
+        SIM_LOG(sim, SIM_EVENT_DMA_WRITE, sim->dma_write_addr, sim->dma_write_size);
+    }
+
+    sim->state = SIM_STATE_IDLE;
+    winc_sim_latency_end(sim);
+    cpu_exit(sim);
+    sim->transport->hunt(sim->ctx);
+}
+
+// First 0xFx of a DMA write: the rest of the payload (data, CRC and the
+// following prefixes) is received as one chain
+static void winc_data_prefix_handler(winc_sim_t *sim, uint8_t prefix_byte) {
+    if ((prefix_byte & 0xF0) != 0xF0) {
+        SIM_LOG(sim, SIM_EVENT_DMA_PREFIX, prefix_byte, 0);
+    }
+
+    // Out of bounds writes are still clocked in, just into the sink
+    size_t n = build_payload_chain(sim, sim->dma_write_addr, sim->dma_write_size, true, true);
+    sim->dma_write_oob = (n == 0);
+    if (sim->dma_write_oob) {
+        SIM_LOG(sim, SIM_EVENT_OOB_DMA_WRITE, sim->dma_write_addr, sim->dma_write_size);
+        n = build_payload_chain(sim, sim->dma_write_addr, sim->dma_write_size, true, false);
+    }
+    // The prefix slots of the following packets receive what the host sent
+    sim->payload_count = n;
+    sim->state = SIM_STATE_RECEIVING_DATA;
+    sim->transport->recv_chain(sim->ctx, sim->payload_segs, n);
+}
+
+// Register side effects, attached in winc_sim_engine_init()
+
+static bool chipid_write(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    SIM_LOG(sim, SIM_EVENT_SOFTWARE_RESET, 0, 0);
+    sim->reset_triggered = true;
+    return false; // Don't actually write to CHIPID
+}
+
+// The driver leaves its version in NMI_STATE_REG and then starts the
+// firmware, which reports it is up by replacing it with M2M_FINISH_INIT_STATE
+static bool bootrom_write(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    if (value == M2M_START_FIRMWARE) {
+        SIM_LOG(sim, SIM_EVENT_FIRMWARE_STARTED, addr, value);
+        winc_sim_map_write32(sim, NMI_STATE_REG, M2M_FINISH_INIT_STATE);
+#if SIMULATOR_TRAFFIC_RATE_HZ
+        winc_sim_traffic_start(sim, NULL);
+#endif
+    }
+    return true;
+}
+
+// Codes 6 and 7 are reserved, taken as the largest size
+static uint32_t packet_size_decode(uint32_t config) {
+    uint32_t code = (config >> 4) & 0x7;
+    return code <= 5 ? MIN_SPI_PACKET_SIZE << code : MAX_SPI_PACKET_SIZE;
+}
+
+static bool protocol_config_write(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    // The driver writes this one with SINGLE_WRITE, not INTERNAL_WRITE
+    bool off = (value & 0xc) == 0;
+    if (off != sim->crc_off) {
+        sim->crc_off = off;
+        SIM_LOG(sim, off ? SIM_EVENT_CRC_OFF : SIM_EVENT_CRC_ON, value, 0);
+    }
+    uint32_t size = packet_size_decode(value);
+    if (size != sim->packet_size) {
+        sim->packet_size = size;
+        SIM_LOG(sim, SIM_EVENT_PACKET_SIZE, value, size);
+    }
+    return true;
+}
+
+static void state_reg_read(winc_sim_t *sim, uint32_t addr, uint32_t *value) {
+    if (sim->reset_triggered) {
+        *value = 0x02532636;
+        SIM_LOG(sim, SIM_EVENT_SINGLE_READ_RESET, addr, *value);
+        sim->reset_triggered = false; // Clear the flag
+    }
+}
+
+static bool dma_size_ok(const winc_sim_t *sim, uint32_t total_size) {
+    return total_size <= MAX_DMA_PAYLOAD_SIZE && total_size <= MAX_DMA_PACKETS * sim->packet_size;
+}
+
+// Returns true when the transaction is finished and the transport can hunt for
+// the next command, false when a payload chain or prefix hunt is still pending.
+static bool winc_process_command(winc_sim_t *sim) {
+    uint8_t command = sim->cmd_buf[0];
+    uint8_t response_buf[5]; // Buffer for command echo + 4 bytes data/status
+
+    response_buf[0] = command; // Prepend command to response buffer
+
+    switch(command) {
+        case CMD_SINGLE_READ: {
+            // Address and CRC already read into sim->cmd_buf[1]...
+            uint32_t addr = (sim->cmd_buf[1] << 16) | (sim->cmd_buf[2] << 8) | sim->cmd_buf[3];
+            uint32_t data_val;
+
+            if (!winc_sim_map_read32(sim, addr, &data_val)) {
+                response_buf[1] = 0xFF; // Respond with status byte (error)
+                respond(sim, response_buf, 2); // Write command + 1 byte status
+                break;
+            }
+
+            // Send command echo, status byte, and 0xF3 prefix
+            uint8_t single_read_prefix[3] = {command, 0x00, 0xF3};
+            respond(sim, single_read_prefix, 3);
+
+            // Send data
+            spi_send_data_with_crc(sim, (uint8_t*)&data_val, false);
+
+            SIM_LOG(sim, SIM_EVENT_SINGLE_READ, addr, data_val);
+            break;
+        }
+        case CMD_SINGLE_WRITE: {
+            // Data is in sim->cmd_buf[4]...[7]
+            uint32_t addr = (sim->cmd_buf[1] << 16) | (sim->cmd_buf[2] << 8) | sim->cmd_buf[3];
+            uint32_t data_val = ((uint32_t)sim->cmd_buf[4] << 24) | (sim->cmd_buf[5] << 16) | (sim->cmd_buf[6] << 8) | sim->cmd_buf[7];
+
+            if (!winc_sim_map_write32(sim, addr, data_val)) {
+                response_buf[1] = 0xFF; // Respond with status byte (error)
+                respond(sim, response_buf, 2); // Write command + 1 byte status
+                break;
+            }
+
+            response_buf[1] = 0x00; // Respond with status byte (0x00 for success)
+            respond(sim, response_buf, 2); // Write command + 1 byte status
+            SIM_LOG(sim, SIM_EVENT_SINGLE_WRITE, addr, data_val);
+            break;
+        }
+        case CMD_INTERNAL_READ: {
+            // Address in sim->cmd_buf[1]..[2], bit 15 selects the clockless path
+            uint32_t addr = (sim->cmd_buf[1] << 8) | sim->cmd_buf[2];
+            bool clockless = (sim->cmd_buf[1] & 0x80) != 0;
+            if(clockless) addr &= ~0x8000;
+
+            uint32_t data_val;
+            if(!winc_sim_map_read32(sim, addr, &data_val)) {
+                response_buf[1] = 0xFF; // Respond with status byte (error)
+                respond(sim, response_buf, 2); // Write command + 1 byte status
+                break;
+            }
+
+            // Send command echo, status byte, and 0xF3 prefix
+            uint8_t internal_read_prefix[3] = {command, 0x00, 0xF3};
+            respond(sim, internal_read_prefix, 3);
+
+            // Send data
+            spi_send_data_with_crc(sim, (uint8_t*)&data_val, clockless);
+            SIM_LOG(sim, SIM_EVENT_INTERNAL_READ, addr, data_val);
+            break;
+        }
+        case CMD_INTERNAL_WRITE: {
+            // Address sim->cmd_buf[1]..[2], Data sim->cmd_buf[3]..[6]
+            uint32_t addr = (sim->cmd_buf[1] << 8) | (sim->cmd_buf[2]);
+            if(sim->cmd_buf[1] & 0x80) addr &= ~0x8000;
+            uint32_t data_val = ((uint32_t)sim->cmd_buf[3] << 24) | (sim->cmd_buf[4] << 16) | (sim->cmd_buf[5] << 8) | sim->cmd_buf[6];
+
+            if(!winc_sim_map_write32(sim, addr, data_val)) {
+                response_buf[1] = 0xFF; // Respond with status byte (error)
+                respond(sim, response_buf, 2); // Write command + 1 byte status
+                break;
+            }
+
+            response_buf[1] = 0x00; // Respond with status byte (0x00 for success)
+            respond(sim, response_buf, 2); // Write command + 1 byte status
+            SIM_LOG(sim, SIM_EVENT_INTERNAL_WRITE, addr, data_val);
+            break;
+        }
+        case CMD_DMA_READ:
+        case CMD_DMA_EXT_READ: {
+            uint32_t addr = (sim->cmd_buf[1] << 16) | (sim->cmd_buf[2] << 8) | sim->cmd_buf[3];
+            uint32_t total_size;
+            if (command == CMD_DMA_READ) {
+                total_size = (sim->cmd_buf[4] << 8) | sim->cmd_buf[5];
+            } else { // CMD_DMA_EXT_READ
+                total_size = (sim->cmd_buf[4] << 16) | (sim->cmd_buf[5] << 8) | sim->cmd_buf[6];
+            }
+
+            // Prefix, data and CRC of every packet go out as one chain
+            size_t n = 0;
+            if (total_size > 0 && dma_size_ok(sim, total_size)) {
+                n = build_payload_chain(sim, addr, total_size, false, true);
+            }
+            if(n == 0) {
+                response_buf[1] = 0xFF; // Respond with status byte (error)
+                respond(sim, response_buf, 2); // Write command + 1 byte status
+                SIM_LOG(sim, SIM_EVENT_OOB_DMA_READ, addr, total_size);
+                break;
+            }
+
+            // Send command echo and status byte
+            response_buf[1] = 0x00;
+            respond(sim, response_buf, 2);
+
+            sim->payload_count = n;
+            if (sim->capture) {
+                capture_chain(sim, false);
+            }
+            sim->state = SIM_STATE_SENDING_DATA;
+            sim->transport->send_chain(sim->ctx, sim->payload_segs, n);
+
+            SIM_LOG(sim, (command == CMD_DMA_READ) ? SIM_EVENT_DMA_READ : SIM_EVENT_DMA_EXT_READ, addr, total_size);
+            return false;
+        }
+        case CMD_DMA_WRITE:
+        case CMD_DMA_EXT_WRITE: {
+            uint32_t addr = (sim->cmd_buf[1] << 16) | (sim->cmd_buf[2] << 8) | sim->cmd_buf[3];
+            uint32_t total_size;
+            if (command == CMD_DMA_WRITE) {
+                total_size = (sim->cmd_buf[4] << 8) | sim->cmd_buf[5];
+            } else { // CMD_DMA_EXT_WRITE
+                total_size = (sim->cmd_buf[4] << 16) | (sim->cmd_buf[5] << 8) | sim->cmd_buf[6];
+            }
+
+            if (total_size == 0 || !dma_size_ok(sim, total_size)) {
+                response_buf[1] = 0xFF; // Respond with status byte (error)
+                respond(sim, response_buf, 2); // Write command + 1 byte status
+                SIM_LOG(sim, SIM_EVENT_BAD_DMA_WRITE_SIZE, addr, total_size);
+                break;
+            }
+
+            // Accept the command, the host sends the first packet prefix next
+            response_buf[1] = 0x00;
+            respond(sim, response_buf, 2);
+
+            sim->dma_write_addr = addr;
+            sim->dma_write_size = total_size;
+            sim->state = SIM_STATE_WAITING_DATA_PREFIX;
+            sim->transport->hunt(sim->ctx);
+            return false;
+        }
+        case CMD_RESET: {
+            SIM_LOG(sim, SIM_EVENT_CMD_RESET, 0, 0);
+            response_buf[1] = 0x00; // Respond with status byte (0x00 for success)
+            respond(sim, response_buf, 2); // Write command + 1 byte status
+            break;
+        }
+        default: {
+            // Unknown command, the length is unknown too: nothing more is
+            // consumed and the driver's retry path resynchronises with CMD_RESET
+            response_buf[1] = 0xFF; // Error status
+            respond(sim, response_buf, 2); // Write command + 1 byte status
+            SIM_LOG(sim, SIM_EVENT_UNKNOWN_COMMAND, command, 0);
+            break;
+        }
+    }
+    sim->state = SIM_STATE_IDLE;
+    return true;
+}
+
+void winc_sim_engine_read_done(winc_sim_t *sim) {
+    winc_sim_latency_header(sim);
+    capture(sim, true, sim->cmd_buf + 1, sim->cmd_len);
+    cpu_enter(sim);
+    bool done = winc_process_command(sim);
+    cpu_exit(sim);
+    if (done) {
+        winc_sim_latency_end(sim);
+        sim->transport->hunt(sim->ctx);
+    }
+}
+
+void winc_sim_engine_on_byte(winc_sim_t *sim, uint8_t command) {
+    capture(sim, true, &command, 1);
+    if (sim->state == SIM_STATE_WAITING_DATA_PREFIX) {
+        winc_data_prefix_handler(sim, command);
+        return;
+    }
+
+    winc_sim_latency_command(sim, command);
+    sim->cmd_buf[0] = command;
+    size_t bytes_to_read = 0;
+    bool has_crc = true;
+
+    switch(command) {
+        case CMD_SINGLE_READ:
+            bytes_to_read = 3;
+            break;
+        case CMD_SINGLE_WRITE:
+            bytes_to_read = 7;
+            break;
+        case CMD_INTERNAL_READ:
+            bytes_to_read = 3;
+            break;
+        case CMD_INTERNAL_WRITE:
+            bytes_to_read = 6;
+            break;
+        case CMD_DMA_READ:
+        case CMD_DMA_WRITE:
+            bytes_to_read = 5;
+            break;
+        case CMD_DMA_EXT_READ:
+        case CMD_DMA_EXT_WRITE:
+            bytes_to_read = 6;
+            break;
+        case CMD_RESET:
+            // cf ff ff ff [crc7]
+            bytes_to_read = 3;
+            break;
+        default:
+            bytes_to_read = 0;
+            has_crc = false;
+            break;
+    }
+
+    if (has_crc && !sim->crc_off) {
+        bytes_to_read++;
+    }
+
+    sim->cmd_len = (uint8_t)bytes_to_read;
+    if (bytes_to_read > 0) {
+        sim->state = SIM_STATE_RECEIVING_COMMAND;
+        sim->transport->read(sim->ctx, sim->cmd_buf + 1, bytes_to_read);
+    } else {
+        // No more bytes to read, process immediately
+        winc_sim_engine_read_done(sim);
+    }
+}
+
+// Version block nm_get_firmware_full_info() reads: rNMI_GP_REG_2 points to
+// a tstrGpRegs, whose u32Firmware_Ota_rev points to a tstrM2mRev, both offsets
+// from NMI_AHB_DATA_MEM_BASE. They sit after the HIF buffer pool.
+#define FW_GP_REGS_OFFSET 0x4000
+#define FW_REV_OFFSET     0x4010
+
+typedef struct {
+    uint32_t chip_id;
+    uint8_t firmware[3];    // Major, minor, patch
+    uint8_t min_driver[3];  // Oldest driver the firmware works with
+    char build_date[12];
+    char build_time[9];
+    uint8_t pad;
+    uint16_t svn_rev;       // 19.6 and later only
+    uint16_t pad2[2];
+} firmware_rev_t;
+
+static void firmware_info_init(winc_sim_t *sim, uint32_t chip_id) {
+    uint32_t gp_regs[2] = { 0, FW_REV_OFFSET };
+    firmware_rev_t rev = {
+        .chip_id = chip_id,
+        .firmware = {19, 7, 7},
+        .min_driver = {19, 3, 0},
+        .build_date = "Jan  1 2024",
+        .build_time = "00:00:00",
+    };
+    uint32_t gp_reg_2 = FW_GP_REGS_OFFSET;
+
+    winc_sim_map_write(sim, NMI_AHB_DATA_MEM_BASE | FW_GP_REGS_OFFSET, gp_regs, sizeof(gp_regs));
+    winc_sim_map_write(sim, NMI_AHB_DATA_MEM_BASE | FW_REV_OFFSET, &rev, sizeof(rev));
+    memcpy(winc_sim_map_ptr(sim, rNMI_GP_REG_2, 4, true), &gp_reg_2, sizeof(gp_reg_2));
+}
+
+void winc_sim_engine_init(winc_sim_t *sim, uint8_t id, const winc_sim_transport_t *transport, void *ctx) {
+    sim->transport = transport;
+    sim->ctx = ctx;
+    sim_log_init(&sim->log, transport->now_us, id);
+    winc_sim_latency_init(sim);
+    sim->state = SIM_STATE_IDLE;
+    sim->crc_off = false;
+    sim->reset_triggered = false;
+
+    // Initialize the memory space
+    winc_sim_map_init(sim);
+    winc_sim_map_hook(sim, CHIPID, NULL, chipid_write);
+    winc_sim_map_hook(sim, NMI_SPI_PROTOCOL_CONFIG, NULL, protocol_config_write);
+    winc_sim_map_hook(sim, NMI_STATE_REG, state_reg_read, NULL);
+    winc_sim_map_hook(sim, BOOTROM_REG, NULL, bootrom_write);
+
+    // Pre-populate some read-only registers with default values
+    uint32_t chip_id = 0x1002b0;
+    memcpy(winc_sim_map_ptr(sim, CHIPID, 4, true), &chip_id, sizeof(chip_id));
+    uint32_t rev_id = 0x4;
+    memcpy(winc_sim_map_ptr(sim, 0x13f4, 4, true), &rev_id, sizeof(rev_id));
+    uint32_t proto_conf = 0x2E;
+    memcpy(winc_sim_map_ptr(sim, NMI_SPI_PROTOCOL_CONFIG, 4, true), &proto_conf, sizeof(proto_conf));
+    sim->packet_size = packet_size_decode(proto_conf);
+    uint32_t state_reg = 0x02532636;
+    memcpy(winc_sim_map_ptr(sim, NMI_STATE_REG, 4, true), &state_reg, sizeof(state_reg));
+    uint32_t wait_for_host = 0x3f00;
+    memcpy(winc_sim_map_ptr(sim, M2M_WAIT_FOR_HOST_REG, 4, true), &wait_for_host, sizeof(wait_for_host));
+    uint32_t reg_1014 = 0x807c082d;
+    memcpy(winc_sim_map_ptr(sim, 0x1014, 4, true), &reg_1014, sizeof(reg_1014));
+    uint32_t bootrom_reg = 0x10add09e;
+    memcpy(winc_sim_map_ptr(sim, BOOTROM_REG, 4, true), &bootrom_reg, sizeof(bootrom_reg));
+    uint32_t pin_mux_0 = 0x31111044;
+    memcpy(winc_sim_map_ptr(sim, NMI_PIN_MUX_0, 4, true), &pin_mux_0, sizeof(pin_mux_0));
+    uint32_t rev_reg = 0x1330134a;
+    memcpy(winc_sim_map_ptr(sim, NMI_REV_REG, 4, true), &rev_reg, sizeof(rev_reg));
+    firmware_info_init(sim, chip_id);
+
+    // Emulated firmware behind the HIF mailbox
+    winc_sim_sched_init(sim);
+    winc_sim_hif_init(sim);
+    winc_sim_wifi_init(sim);
+    winc_sim_socket_init(sim);
+    winc_sim_traffic_init(sim);
+
+    transport->hunt(ctx);
+}
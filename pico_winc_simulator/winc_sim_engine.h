@@ -0,0 +1,111 @@
+#ifndef WINC_SIM_ENGINE_H
+#define WINC_SIM_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "winc_sim_transport.h"
+#include "winc_sim_memmap.h"
+#include "winc_sim_sched.h"
+#include "winc_sim_hif.h"
+#include "winc_sim_wifi.h"
+#include "winc_sim_socket.h"
+#include "winc_sim_traffic.h"
+#include "winc_sim_latency.h"
+#include "winc_sim_cpu.h"
+#include "sim_log.h"
+#include "spi_capture.h"
+
+// Data packet between two 0xFx prefixes, set by the host in bits 4 to 6 of
+// NMI_SPI_PROTOCOL_CONFIG as 256 << code
+#define MIN_SPI_PACKET_SIZE 256
+#define MAX_SPI_PACKET_SIZE 8192
+
+// WINC1500 SPI commands (simplified for simulator)
+#define CMD_SINGLE_READ         0xca
+#define CMD_SINGLE_WRITE        0xc9
+#define CMD_INTERNAL_READ       0xc4
+#define CMD_INTERNAL_WRITE      0xc3
+#define CMD_DMA_WRITE           0xc1
+#define CMD_DMA_READ            0xc2
+#define CMD_DMA_EXT_WRITE       0xc7
+#define CMD_DMA_EXT_READ        0xc8
+#define CMD_RESET               0xcf
+
+// State byte of the data response that follows 0xC3. Anything but 0x00 makes
+// the driver's spi_data_rsp() fail, which sends it through CMD_RESET and a retry.
+#define DATA_RSP_STATE_OK           0x00
+#define DATA_RSP_STATE_CRC_ERROR    0x01
+#define DATA_RSP_STATE_BAD_ADDR     0xFF
+
+// Simulator states
+typedef enum {
+    SIM_STATE_IDLE,
+    SIM_STATE_RECEIVING_COMMAND,    // Transport is reading the command header
+    SIM_STATE_WAITING_DATA_PREFIX,  // DMA write accepted, hunting for the first 0xFx
+    SIM_STATE_RECEIVING_DATA,       // Payload chain is receiving the write data
+    SIM_STATE_SENDING_DATA          // Payload chain is sending the read data
+} simulator_state_t;
+
+// Payload chain limits for CMD_DMA_(EXT_)READ / CMD_DMA_(EXT_)WRITE. A
+// payload is also limited to MAX_DMA_PACKETS packets of the current size,
+// 8 KB with the smallest, the largest transfer the driver asks for.
+#define MAX_DMA_PACKETS 32
+#define MAX_DMA_PAYLOAD_SIZE (16 * MAX_SPI_PACKET_SIZE)
+
+/**
+ * @brief One simulated WINC1500
+ *
+ * Everything the engine and the emulated firmware keep lives here, so
+ * several instances can run side by side, each behind its own transport
+ * context: one per SPI slave on the Pico, one per thread on the host. An
+ * instance is only ever entered from one context at a time.
+ */
+struct winc_sim {
+    const winc_sim_transport_t *transport;
+    void *ctx;                  // Passed to every transport operation
+    winc_sim_cpu_t *cpu;        // CPU accounting of the core, NULL for none
+    spi_capture_t *capture;     // Bytes as the engine sees them, NULL for none
+
+    simulator_state_t state;
+    bool crc_off;
+    bool reset_triggered;
+    uint32_t packet_size;       // Data packet size the host configured
+    uint8_t cmd_buf[16];
+    uint8_t cmd_len;            // Header bytes read after the command byte
+
+    // Payload chain of the DMA command in progress
+    winc_sim_seg_t payload_segs[WINC_SIM_MAX_SEGMENTS];
+    size_t payload_count;
+    uint8_t packet_prefix[MAX_DMA_PACKETS];
+    uint8_t packet_crc[MAX_DMA_PACKETS][4]; // Received CRC16, computed CRC16
+    uint32_t dma_write_addr;
+    uint32_t dma_write_size;
+    bool dma_write_oob;
+
+    sim_log_t log;
+    winc_sim_map_t map;
+    winc_sim_sched_t sched;
+    winc_sim_hif_t hif;
+    winc_sim_wifi_t wifi;
+    winc_sim_socket_t socket;
+    winc_sim_traffic_t traffic;
+    winc_sim_latency_t latency;
+};
+
+/**
+ * @brief Reset the simulated chip and attach it to a transport
+ *
+ * Clears the memory, loads the register defaults and starts hunting for
+ * the first command byte. sim->cpu and sim->capture are left as they are.
+ *
+ * @param id   Instance number, shown in the trace
+ * @param ctx  Context for the transport operations
+ */
+void winc_sim_engine_init(winc_sim_t *sim, uint8_t id, const winc_sim_transport_t *transport, void *ctx);
+
+// Transport events, see winc_sim_transport.h
+void winc_sim_engine_on_byte(winc_sim_t *sim, uint8_t byte);
+void winc_sim_engine_read_done(winc_sim_t *sim);
+void winc_sim_engine_chain_done(winc_sim_t *sim);
+
+#endif // WINC_SIM_ENGINE_H
@@ -0,0 +1,195 @@
+#include <string.h>
+#include "winc1500_registers.h"
+#include "winc_sim_hif.h"
+#include "winc_sim_engine.h"
+#include "sim_log.h"
+
+#define RCV_CTRL_0_INT      (1u << 0) // Message pending for the host
+#define RCV_CTRL_0_RX_DONE  (1u << 1) // Host is done with the message
+#define RCV_CTRL_2_REQUEST  (1u << 1) // Host asks for a buffer
+#define RCV_CTRL_3_SEND     (1u << 1) // Host has filled the buffer
+
+static inline uint32_t buf_addr(uint32_t i) {
+    return WINC_SIM_HIF_POOL_BASE + i * WINC_SIM_HIF_BUF_SIZE;
+}
+
+static int buf_alloc(winc_sim_hif_t *hif) {
+    if (hif->buf_free == 0) {
+        hif->stats.alloc_failures++;
+        return -1;
+    }
+    int i = __builtin_ctz(hif->buf_free);
+    hif->buf_free &= ~(1u << i);
+    return i;
+}
+
+static void buf_release(winc_sim_hif_t *hif, uint32_t addr) {
+    uint32_t offset = addr - WINC_SIM_HIF_POOL_BASE;
+    if (offset < WINC_SIM_HIF_BUF_COUNT * WINC_SIM_HIF_BUF_SIZE && offset % WINC_SIM_HIF_BUF_SIZE == 0) {
+        hif->buf_free |= 1u << (offset / WINC_SIM_HIF_BUF_SIZE);
+    }
+}
+
+// Mailbox registers are updated without running their own hooks
+static void reg_set(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    winc_sim_map_write(sim, addr, &value, 4);
+}
+
+static void post_next(winc_sim_t *sim) {
+    winc_sim_hif_t *hif = &sim->hif;
+    if (hif->tx_posted || hif->tx_count == 0) {
+        return;
+    }
+    uint32_t i = hif->tx_queue[hif->tx_head];
+    reg_set(sim, WIFI_HOST_RCV_CTRL_1, buf_addr(i));
+    reg_set(sim, WIFI_HOST_RCV_CTRL_0, ((uint32_t)hif->tx_size[i] << 2) | RCV_CTRL_0_INT);
+    hif->tx_posted = true;
+    hif->tx_taken = false;
+    hif->stats.irqs++;
+    sim->transport->irq(sim->ctx, true);
+}
+
+static bool rcv_ctrl_0_write(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    winc_sim_hif_t *hif = &sim->hif;
+    if (value & RCV_CTRL_0_RX_DONE) {
+        if (hif->tx_posted) {
+            buf_release(hif, buf_addr(hif->tx_queue[hif->tx_head]));
+            hif->tx_head = (hif->tx_head + 1) % WINC_SIM_HIF_BUF_COUNT;
+            hif->tx_count--;
+            hif->tx_posted = false;
+            hif->stats.responses++;
+        }
+        reg_set(sim, WIFI_HOST_RCV_CTRL_0, 0);
+        post_next(sim);
+        return false;
+    }
+    if (!(value & RCV_CTRL_0_INT)) {
+        // hif_isr() has taken the interrupt
+        if (hif->tx_posted && !hif->tx_taken) {
+            uint64_t wait = sim->transport->now_us() - hif->tx_time[hif->tx_queue[hif->tx_head]];
+            if (wait > hif->stats.wait_max_us) hif->stats.wait_max_us = (uint32_t)wait;
+            hif->stats.wait_total_us += wait;
+            hif->tx_taken = true;
+        }
+        sim->transport->irq(sim->ctx, false);
+    }
+    return true;
+}
+
+static bool rcv_ctrl_2_write(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    if (!(value & RCV_CTRL_2_REQUEST)) {
+        return true;
+    }
+
+    // hif_send() left gid | opcode << 8 | length << 16 in NMI_STATE_REG
+    uint32_t request;
+    uint32_t dma_addr = 0;
+    winc_sim_map_read(sim, NMI_STATE_REG, &request, 4);
+    if ((request >> 16) <= WINC_SIM_HIF_BUF_SIZE) {
+        int i = buf_alloc(&sim->hif);
+        if (i >= 0) {
+            dma_addr = buf_addr(i);
+        }
+    }
+    if (dma_addr == 0) {
+        SIM_LOG(sim, SIM_EVENT_HIF_NO_BUFFER, request, 0);
+    }
+
+    // A zero address makes hif_send() fail with M2M_ERR_MEM_ALLOC
+    reg_set(sim, WIFI_HOST_RCV_CTRL_4, dma_addr);
+    reg_set(sim, WIFI_HOST_RCV_CTRL_2, value & ~RCV_CTRL_2_REQUEST);
+    return false;
+}
+
+static bool rcv_ctrl_3_write(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    winc_sim_hif_t *hif = &sim->hif;
+    if (!(value & RCV_CTRL_3_SEND)) {
+        return true;
+    }
+
+    uint32_t msg = value >> 2;
+    uint8_t hdr[4] = {0};
+    winc_sim_map_read(sim, msg, hdr, sizeof(hdr));
+    uint8_t gid = hdr[0];
+    uint8_t opcode = hdr[1];
+    uint16_t len = (uint16_t)(hdr[2] | (hdr[3] << 8));
+
+    hif->stats.requests++;
+    SIM_LOG(sim, SIM_EVENT_HIF_REQUEST, (gid << 8) | opcode, len);
+    if (gid < WINC_SIM_HIF_GROUP_MAX && hif->handlers[gid] != NULL && len >= WINC_SIM_HIF_HDR_SIZE) {
+        hif->handlers[gid](sim, opcode, msg + WINC_SIM_HIF_HDR_SIZE, (uint16_t)(len - WINC_SIM_HIF_HDR_SIZE));
+    } else {
+        hif->stats.unhandled++;
+    }
+
+    buf_release(hif, msg);
+    reg_set(sim, WIFI_HOST_RCV_CTRL_3, 0);
+    return false;
+}
+
+void winc_sim_hif_init(winc_sim_t *sim) {
+    winc_sim_hif_t *hif = &sim->hif;
+    memset(hif, 0, sizeof(*hif));
+    hif->buf_free = (WINC_SIM_HIF_BUF_COUNT == 32) ? 0xFFFFFFFFu : ((1u << WINC_SIM_HIF_BUF_COUNT) - 1);
+
+    winc_sim_map_hook(sim, WIFI_HOST_RCV_CTRL_0, NULL, rcv_ctrl_0_write);
+    winc_sim_map_hook(sim, WIFI_HOST_RCV_CTRL_2, NULL, rcv_ctrl_2_write);
+    winc_sim_map_hook(sim, WIFI_HOST_RCV_CTRL_3, NULL, rcv_ctrl_3_write);
+    sim->transport->irq(sim->ctx, false);
+}
+
+void winc_sim_hif_register(winc_sim_t *sim, uint8_t gid, winc_sim_hif_handler_t handler) {
+    if (gid < WINC_SIM_HIF_GROUP_MAX) {
+        sim->hif.handlers[gid] = handler;
+    }
+}
+
+bool winc_sim_hif_send(winc_sim_t *sim, uint8_t gid, uint8_t opcode, const void *ctrl, uint16_t ctrl_len,
+                       const void *data, uint16_t data_len, uint16_t data_offset) {
+    winc_sim_hif_t *hif = &sim->hif;
+    uint32_t size = WINC_SIM_HIF_HDR_SIZE + (data != NULL ? (uint32_t)data_offset + data_len : ctrl_len);
+    if (size > WINC_SIM_HIF_MAX_MSG_SIZE) {
+        return false;
+    }
+    int i = buf_alloc(hif);
+    if (i < 0) {
+        SIM_LOG(sim, SIM_EVENT_HIF_RESPONSE_DROPPED, (gid << 8) | opcode, size);
+        return false;
+    }
+
+    uint32_t addr = buf_addr(i);
+    uint8_t hdr[WINC_SIM_HIF_HDR_SIZE] = {gid, opcode, (uint8_t)size, (uint8_t)(size >> 8)};
+    winc_sim_map_write(sim, addr, hdr, sizeof(hdr));
+    if (ctrl != NULL && ctrl_len > 0) {
+        winc_sim_map_write(sim, addr + WINC_SIM_HIF_HDR_SIZE, ctrl, ctrl_len);
+    }
+    if (data != NULL && data_len > 0) {
+        winc_sim_map_write(sim, addr + WINC_SIM_HIF_HDR_SIZE + data_offset, data, data_len);
+    }
+
+    hif->tx_queue[(hif->tx_head + hif->tx_count) % WINC_SIM_HIF_BUF_COUNT] = (uint8_t)i;
+    hif->tx_size[i] = (uint16_t)size;
+    hif->tx_time[i] = sim->transport->now_us();
+    hif->tx_count++;
+    if (hif->tx_count > hif->stats.queue_max) {
+        hif->stats.queue_max = hif->tx_count;
+    }
+    post_next(sim);
+    return true;
+}
+
+uint32_t winc_sim_hif_free_buffers(const winc_sim_t *sim) {
+    return (uint32_t)__builtin_popcount(sim->hif.buf_free);
+}
+
+uint32_t winc_sim_hif_pending_us(winc_sim_t *sim) {
+    winc_sim_hif_t *hif = &sim->hif;
+    if (!hif->tx_posted || hif->tx_taken) {
+        return 0;
+    }
+    return (uint32_t)(sim->transport->now_us() - hif->tx_time[hif->tx_queue[hif->tx_head]]);
+}
+
+void winc_sim_hif_get_stats(const winc_sim_t *sim, winc_sim_hif_stats_t *out) {
+    *out = sim->hif.stats;
+}
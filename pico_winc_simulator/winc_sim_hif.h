@@ -0,0 +1,114 @@
+#ifndef WINC_SIM_HIF_H
+#define WINC_SIM_HIF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "winc1500_registers.h"
+#include "winc_sim_transport.h"
+
+typedef struct winc_sim winc_sim_t;
+
+// Host interface (HIF) mailbox of the emulated firmware, see m2m_hif.c:
+//  - request:  host writes the HIF header word to NMI_STATE_REG and sets bit 1
+//              of WIFI_HOST_RCV_CTRL_2, the firmware allocates a buffer, clears
+//              the bit and leaves the buffer address in WIFI_HOST_RCV_CTRL_4
+//  - send:     host DMAs the message into the buffer and writes
+//              (addr << 2) | 2 to WIFI_HOST_RCV_CTRL_3, the firmware parses it
+//  - response: firmware puts the message address in WIFI_HOST_RCV_CTRL_1 and
+//              (size << 2) | 1 in WIFI_HOST_RCV_CTRL_0 and asserts the IRQ line;
+//              the host clears bit 0 (IRQ released), reads the message and
+//              sets bit 1 (RX done), which frees the buffer for the next one
+
+// Group IDs of tstrHifHdr.u8Gid
+#define WINC_SIM_HIF_GROUP_WIFI 1
+#define WINC_SIM_HIF_GROUP_IP   2
+#define WINC_SIM_HIF_GROUP_HIF  3
+#define WINC_SIM_HIF_GROUP_OTA  4
+#define WINC_SIM_HIF_GROUP_SSL  5
+#define WINC_SIM_HIF_GROUP_MAX  8
+
+// tstrHifHdr plus 4 bytes of padding (M2M_HIF_HDR_OFFSET)
+#define WINC_SIM_HIF_HDR_SIZE 8
+// Largest message including the header (M2M_HIF_MAX_PACKET_SIZE)
+#define WINC_SIM_HIF_MAX_MSG_SIZE (1600 - 4)
+
+// Firmware buffer pool in simulated RAM, shared by requests and responses
+#define WINC_SIM_HIF_POOL_BASE  NMI_AHB_DATA_MEM_BASE
+#define WINC_SIM_HIF_BUF_SIZE   2048
+#define WINC_SIM_HIF_BUF_COUNT  8
+
+typedef struct {
+    uint32_t requests;          // Messages received from the host
+    uint32_t responses;         // Messages delivered to the host (RX done)
+    uint32_t alloc_failures;    // Buffer requests or responses refused, pool empty
+    uint32_t unhandled;         // Requests for a group without a handler
+    uint32_t queue_max;         // Deepest response queue seen
+    uint32_t irqs;              // Interrupts raised, one per message posted
+    uint32_t wait_max_us;       // Longest a message waited from queued to the host taking its interrupt
+    uint64_t wait_total_us;     // Sum of those waits, over responses for the average
+} winc_sim_hif_stats_t;
+
+/**
+ * @brief Handler for the requests of one group
+ *
+ * @param opcode   tstrHifHdr.u8Opcode, bit 7 (data packet) included
+ * @param addr     Address of the payload (after the header) in simulated RAM
+ * @param len      Payload length
+ */
+typedef void (*winc_sim_hif_handler_t)(winc_sim_t *sim, uint8_t opcode, uint32_t addr, uint16_t len);
+
+#if WINC_SIM_HIF_BUF_COUNT > 32
+#error "WINC_SIM_HIF_BUF_COUNT must fit the free mask"
+#endif
+
+// Mailbox of one instance
+typedef struct {
+    winc_sim_hif_handler_t handlers[WINC_SIM_HIF_GROUP_MAX];
+
+    // Buffer pool, bit i set when buffer i is free
+    uint32_t buf_free;
+
+    // Responses waiting for the host, the head one is posted once the host is
+    // done with the previous message
+    uint8_t tx_queue[WINC_SIM_HIF_BUF_COUNT];
+    uint16_t tx_size[WINC_SIM_HIF_BUF_COUNT];
+    uint64_t tx_time[WINC_SIM_HIF_BUF_COUNT];  // When the message was queued
+    uint32_t tx_head;
+    uint32_t tx_count;
+    bool tx_posted;
+    bool tx_taken;  // The host has cleared the interrupt of the posted message
+
+    winc_sim_hif_stats_t stats;
+} winc_sim_hif_t;
+
+/**
+ * @brief Reset the mailbox and hook its registers
+ *
+ * Called by winc_sim_engine_init() after the memory map has been cleared.
+ */
+void winc_sim_hif_init(winc_sim_t *sim);
+
+// Route the requests of a group to a handler, NULL drops them
+void winc_sim_hif_register(winc_sim_t *sim, uint8_t gid, winc_sim_hif_handler_t handler);
+
+/**
+ * @brief Queue a message for the host, same layout as the driver's hif_send()
+ *
+ * The control buffer follows the header, the data buffer (if any) starts
+ * data_offset bytes after the header.
+ *
+ * @return false if the message is too long or no buffer is free
+ */
+bool winc_sim_hif_send(winc_sim_t *sim, uint8_t gid, uint8_t opcode, const void *ctrl, uint16_t ctrl_len,
+                       const void *data, uint16_t data_len, uint16_t data_offset);
+
+// Buffers left in the pool
+uint32_t winc_sim_hif_free_buffers(const winc_sim_t *sim);
+
+// How long the posted message has waited for the host to take its interrupt,
+// 0 if there is none or the host has it
+uint32_t winc_sim_hif_pending_us(winc_sim_t *sim);
+
+void winc_sim_hif_get_stats(const winc_sim_t *sim, winc_sim_hif_stats_t *stats);
+
+#endif // WINC_SIM_HIF_H
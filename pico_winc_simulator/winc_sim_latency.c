@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <string.h>
+#include "winc_sim_latency.h"
+#include "winc_sim_engine.h"
+
+static const struct {
+    uint8_t command;
+    const char *name;
+} commands[] = {
+    { CMD_SINGLE_READ,   "SINGLE_READ" },
+    { CMD_SINGLE_WRITE,  "SINGLE_WRITE" },
+    { CMD_INTERNAL_READ, "INTERNAL_READ" },
+    { CMD_INTERNAL_WRITE, "INTERNAL_WRITE" },
+    { CMD_DMA_READ,      "DMA_READ" },
+    { CMD_DMA_WRITE,     "DMA_WRITE" },
+    { CMD_DMA_EXT_READ,  "DMA_EXT_READ" },
+    { CMD_DMA_EXT_WRITE, "DMA_EXT_WRITE" },
+    { CMD_RESET,         "RESET" },
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+#define UNKNOWN_INDEX COMMAND_COUNT
+
+_Static_assert(COMMAND_COUNT + 1 == WINC_SIM_LATENCY_COMMANDS, "One histogram set per command plus unknown");
+
+static inline uint32_t now(const winc_sim_transport_t *transport) {
+    if (transport->cycles) {
+        return transport->cycles();
+    }
+    return (uint32_t)transport->now_us();
+}
+
+static uint32_t command_index(uint8_t command) {
+    for (uint32_t i = 0; i < COMMAND_COUNT; i++) {
+        if (commands[i].command == command) return i;
+    }
+    return UNKNOWN_INDEX;
+}
+
+static void record(winc_sim_t *sim, winc_sim_latency_phase_t phase) {
+    winc_sim_latency_t *l = &sim->latency;
+    uint32_t mask = sim->transport->cycles ? sim->transport->cycles_mask : UINT32_MAX;
+    uint32_t elapsed = (now(sim->transport) - l->start) & mask;
+    winc_sim_latency_hist_t *h = &l->hists[l->current][phase];
+
+    uint32_t bucket = elapsed < 2 ? 0 : 31 - (uint32_t)__builtin_clz(elapsed);
+    if (bucket >= WINC_SIM_LATENCY_BUCKETS) bucket = WINC_SIM_LATENCY_BUCKETS - 1;
+    h->buckets[bucket]++;
+    h->count++;
+    h->sum += elapsed;
+    if (elapsed > h->max) h->max = elapsed;
+}
+
+void winc_sim_latency_init(winc_sim_t *sim) {
+    winc_sim_latency_reset(sim);
+}
+
+void winc_sim_latency_command(winc_sim_t *sim, uint8_t command) {
+    winc_sim_latency_t *l = &sim->latency;
+    l->start = now(sim->transport);
+    l->current = (uint8_t)command_index(command);
+    l->active = true;
+    l->responded = false;
+}
+
+void winc_sim_latency_header(winc_sim_t *sim) {
+    if (sim->latency.active) record(sim, WINC_SIM_LATENCY_HEADER);
+}
+
+void winc_sim_latency_response(winc_sim_t *sim) {
+    if (sim->latency.active && !sim->latency.responded) {
+        sim->latency.responded = true;
+        record(sim, WINC_SIM_LATENCY_RESPONSE);
+    }
+}
+
+void winc_sim_latency_end(winc_sim_t *sim) {
+    if (sim->latency.active) {
+        record(sim, WINC_SIM_LATENCY_TOTAL);
+        sim->latency.active = false;
+    }
+}
+
+bool winc_sim_latency_get(const winc_sim_t *sim, uint8_t command, winc_sim_latency_hist_t out[WINC_SIM_LATENCY_PHASES]) {
+    uint32_t i = command_index(command);
+    memcpy(out, sim->latency.hists[i], sizeof(sim->latency.hists[i]));
+    return i != UNKNOWN_INDEX;
+}
+
+uint32_t winc_sim_latency_ns(const winc_sim_t *sim, uint32_t cycles) {
+    if (sim->transport->cycles == NULL) {
+        return cycles * 1000u;
+    }
+    return (uint32_t)((uint64_t)cycles * 1000u / sim->transport->cycles_per_us);
+}
+
+void winc_sim_latency_reset(winc_sim_t *sim) {
+    memset(sim->latency.hists, 0, sizeof(sim->latency.hists));
+    sim->latency.active = false;
+}
+
+void winc_sim_latency_print(const winc_sim_t *sim) {
+    static const char *phase_names[WINC_SIM_LATENCY_PHASES] = { "header", "response", "total" };
+
+    printf("Engine latency per command (ns; histogram as upper bound:count)\n");
+    for (uint32_t i = 0; i <= COMMAND_COUNT; i++) {
+        const winc_sim_latency_hist_t *hists = sim->latency.hists[i];
+        if (hists[WINC_SIM_LATENCY_HEADER].count == 0 && hists[WINC_SIM_LATENCY_TOTAL].count == 0) continue;
+
+        for (uint32_t p = 0; p < WINC_SIM_LATENCY_PHASES; p++) {
+            const winc_sim_latency_hist_t *h = &hists[p];
+            if (h->count == 0) continue;
+            printf("  %-14s %-8s %8lu  avg %8lu  max %8lu  |",
+                   i < COMMAND_COUNT ? commands[i].name : "unknown", phase_names[p], (unsigned long)h->count,
+                   (unsigned long)winc_sim_latency_ns(sim, (uint32_t)(h->sum / h->count)),
+                   (unsigned long)winc_sim_latency_ns(sim, h->max));
+            for (uint32_t b = 0; b < WINC_SIM_LATENCY_BUCKETS; b++) {
+                if (h->buckets[b] == 0) continue;
+                if (b == WINC_SIM_LATENCY_BUCKETS - 1) {
+                    printf(" more:%lu", (unsigned long)h->buckets[b]);
+                } else {
+                    printf(" %lu:%lu", (unsigned long)winc_sim_latency_ns(sim, 2u << b), (unsigned long)h->buckets[b]);
+                }
+            }
+            printf("\n");
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef WINC_SIM_LATENCY_H
+#define WINC_SIM_LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "winc_sim_transport.h"
+
+typedef struct winc_sim winc_sim_t;
+
+// Per-command latency of the engine. Each transaction is stamped when its
+// command byte arrives, when the header has been read, when the first
+// response byte is queued and when the engine hunts again. The intervals
+// from the command byte go into a histogram per command:
+//  - header    command byte to header complete (host clocking, DMA read)
+//  - response  command byte to first response byte, what the host's
+//              spi_cmd_rsp() polls for
+//  - total     command byte to the engine hunting again, payloads included
+//
+// Buckets are powers of two of the transport's cycle counter: bucket i holds
+// intervals below 2^(i+1) cycles, the last one everything longer.
+
+#define WINC_SIM_LATENCY_BUCKETS 20
+
+// Commands the engine knows plus one slot shared by all unknown opcodes
+#define WINC_SIM_LATENCY_COMMANDS 10
+
+typedef enum {
+    WINC_SIM_LATENCY_HEADER,
+    WINC_SIM_LATENCY_RESPONSE,
+    WINC_SIM_LATENCY_TOTAL,
+    WINC_SIM_LATENCY_PHASES
+} winc_sim_latency_phase_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t max;           // Cycles
+    uint64_t sum;           // Cycles
+    uint32_t buckets[WINC_SIM_LATENCY_BUCKETS];
+} winc_sim_latency_hist_t;
+
+// Histograms of one instance
+typedef struct {
+    winc_sim_latency_hist_t hists[WINC_SIM_LATENCY_COMMANDS][WINC_SIM_LATENCY_PHASES];
+
+    // Transaction in flight
+    bool active;
+    bool responded;
+    uint32_t start;
+    uint8_t current;
+} winc_sim_latency_t;
+
+/**
+ * @brief Clear the histograms
+ *
+ * Called by winc_sim_engine_init(). The clock is the instance's transport.
+ */
+void winc_sim_latency_init(winc_sim_t *sim);
+
+// Engine side, in transaction order. response() only counts its first call.
+void winc_sim_latency_command(winc_sim_t *sim, uint8_t command);
+void winc_sim_latency_header(winc_sim_t *sim);
+void winc_sim_latency_response(winc_sim_t *sim);
+void winc_sim_latency_end(winc_sim_t *sim);
+
+/**
+ * @brief Copy the histograms of one command
+ *
+ * @return false if the command has none (an opcode the engine does not know
+ *         shares the histograms of all unknown ones)
+ */
+bool winc_sim_latency_get(const winc_sim_t *sim, uint8_t command, winc_sim_latency_hist_t out[WINC_SIM_LATENCY_PHASES]);
+
+// Convert counter cycles to nanoseconds
+uint32_t winc_sim_latency_ns(const winc_sim_t *sim, uint32_t cycles);
+
+void winc_sim_latency_reset(winc_sim_t *sim);
+
+// Print the commands seen so far, one line per phase
+void winc_sim_latency_print(const winc_sim_t *sim);
+
+#endif // WINC_SIM_LATENCY_H
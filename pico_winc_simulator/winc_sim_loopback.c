@@ -0,0 +1,346 @@
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "winc_sim_loopback.h"
+#include "winc_sim_engine.h"
+#include "winc_sim_sched.h"
+#include "winc_crc.h"
+#include "sim_log.h"
+
+// In-process transport for the command engine. MISO bytes come from a ring
+// that write()/send_chain() fill by copying, MOSI bytes are handed to whatever
+// the engine is currently waiting for. Engine callbacks are never made from
+// inside a transport operation: completions are latched in pending_event and
+// delivered from the rw loop, the same way the DMA and PIO IRQs do on the Pico.
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void tx_push(winc_sim_loopback_t *lb, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        size_t idx = lb->tx_head % WINC_SIM_LOOPBACK_TX_SIZE;
+        size_t chunk = WINC_SIM_LOOPBACK_TX_SIZE - idx;
+        size_t space = WINC_SIM_LOOPBACK_TX_SIZE - (lb->tx_head - lb->tx_tail);
+        if (chunk > len) chunk = len;
+        if (chunk > space) chunk = space;
+        if (chunk == 0) {
+            SIM_LOG(&lb->sim, SIM_EVENT_LOOPBACK_TX_OVERFLOW, len, 0);
+            return;
+        }
+        memcpy(&lb->tx_ring[idx], buf, chunk);
+        lb->tx_head += chunk;
+        buf += chunk;
+        len -= chunk;
+    }
+}
+
+// Bytes not queued by the simulator read as the PIO's 0x00 padding
+static void tx_pop(winc_sim_loopback_t *lb, uint8_t *buf, size_t len) {
+    while (len > 0) {
+        size_t idx = lb->tx_tail % WINC_SIM_LOOPBACK_TX_SIZE;
+        size_t chunk = WINC_SIM_LOOPBACK_TX_SIZE - idx;
+        size_t avail = lb->tx_head - lb->tx_tail;
+        if (chunk > len) chunk = len;
+        if (chunk > avail) chunk = avail;
+        if (chunk == 0) {
+            if (buf) memset(buf, 0, len);
+            return;
+        }
+        if (buf) {
+            memcpy(buf, &lb->tx_ring[idx], chunk);
+            buf += chunk;
+        }
+        lb->tx_tail += chunk;
+        len -= chunk;
+    }
+}
+
+static void lb_write(void *ctx, const uint8_t *buf, size_t len) {
+    tx_push(ctx, buf, len);
+}
+
+static void lb_read(void *ctx, uint8_t *buf, size_t len) {
+    winc_sim_loopback_t *lb = ctx;
+    lb->rx_mode = WINC_SIM_LOOPBACK_RX_READ;
+    lb->rx_buf = buf;
+    lb->rx_len = len;
+    lb->rx_pos = 0;
+}
+
+static void lb_send_chain(void *ctx, const winc_sim_seg_t *segs, size_t count) {
+    winc_sim_loopback_t *lb = ctx;
+    lb->tx_crc = WINC_CRC16_SEED;
+    for (size_t i = 0; i < count; i++) {
+        if (segs[i].flags & WINC_SIM_SEG_CRC16) {
+            uint8_t crc[2] = {(uint8_t)(lb->tx_crc >> 8), (uint8_t)lb->tx_crc};
+            tx_push(lb, crc, 2);
+            lb->tx_crc = WINC_CRC16_SEED;
+            continue;
+        }
+        if (segs[i].flags & WINC_SIM_SEG_CRC_DATA) {
+            lb->tx_crc = winc_crc16_update(lb->tx_crc, segs[i].addr, segs[i].len);
+        }
+        tx_push(lb, segs[i].addr, segs[i].len);
+    }
+    lb->rx_mode = WINC_SIM_LOOPBACK_RX_NONE;
+    lb->pending_event = WINC_SIM_LOOPBACK_EVENT_CHAIN_DONE;
+}
+
+static void lb_recv_chain(void *ctx, const winc_sim_seg_t *segs, size_t count) {
+    winc_sim_loopback_t *lb = ctx;
+    if (count > WINC_SIM_MAX_SEGMENTS) count = WINC_SIM_MAX_SEGMENTS;
+    memcpy(lb->rx_segs, segs, count * sizeof(winc_sim_seg_t));
+    lb->rx_seg_count = count;
+    lb->rx_seg = 0;
+    lb->rx_crc = WINC_CRC16_SEED;
+    lb->rx_pos = 0;
+    lb->rx_mode = WINC_SIM_LOOPBACK_RX_CHAIN;
+}
+
+static void lb_hunt(void *ctx) {
+    winc_sim_loopback_t *lb = ctx;
+    lb->rx_mode = WINC_SIM_LOOPBACK_RX_HUNT;
+}
+
+static void lb_irq(void *ctx, bool asserted) {
+    winc_sim_loopback_t *lb = ctx;
+    if (asserted && !lb->irq_level) {
+        lb->irq_edge = true;
+    }
+    lb->irq_level = asserted;
+}
+
+static uint64_t lb_now_us(void) {
+    return now_ns() / 1000u;
+}
+
+// Nanoseconds, the latency histograms resolve the engine's software cost
+static uint32_t lb_cycles(void) {
+    return (uint32_t)now_ns();
+}
+
+// Nothing to arm, winc_sim_loopback_rw() and winc_sim_loopback_poll() run the
+// scheduler every time
+static void lb_timer(void *ctx, uint64_t due_us) {
+}
+
+static const winc_sim_transport_t loopback_transport = {
+    .write = lb_write,
+    .read = lb_read,
+    .send_chain = lb_send_chain,
+    .recv_chain = lb_recv_chain,
+    .hunt = lb_hunt,
+    .irq = lb_irq,
+    .now_us = lb_now_us,
+    .timer = lb_timer,
+    .cycles = lb_cycles,
+    .cycles_per_us = 1000,
+    .cycles_mask = UINT32_MAX,
+};
+
+static void run_pending(winc_sim_loopback_t *lb) {
+    if (lb->pending_event == WINC_SIM_LOOPBACK_EVENT_NONE) {
+        return;
+    }
+
+    uint64_t start = now_ns();
+    while (lb->pending_event != WINC_SIM_LOOPBACK_EVENT_NONE) {
+        winc_sim_loopback_event_t event = lb->pending_event;
+        lb->pending_event = WINC_SIM_LOOPBACK_EVENT_NONE;
+        switch (event) {
+            case WINC_SIM_LOOPBACK_EVENT_BYTE:
+                winc_sim_engine_on_byte(&lb->sim, lb->pending_byte);
+                break;
+            case WINC_SIM_LOOPBACK_EVENT_READ_DONE:
+                winc_sim_engine_read_done(&lb->sim);
+                break;
+            case WINC_SIM_LOOPBACK_EVENT_CHAIN_DONE:
+                winc_sim_engine_chain_done(&lb->sim);
+                break;
+            default:
+                break;
+        }
+    }
+    lb->stats.engine_ns += now_ns() - start;
+}
+
+static void rx_crc_update(winc_sim_loopback_t *lb, const uint8_t *mosi, size_t len) {
+    static const uint8_t zeros[64];
+
+    if (mosi) {
+        lb->rx_crc = winc_crc16_update(lb->rx_crc, mosi, len);
+        return;
+    }
+    while (len > 0) {
+        size_t chunk = len > sizeof(zeros) ? sizeof(zeros) : len;
+        lb->rx_crc = winc_crc16_update(lb->rx_crc, zeros, chunk);
+        len -= chunk;
+    }
+}
+
+// Hand MOSI bytes to the current receiver. Returns how many were consumed;
+// stops right after the byte that completes it so the event runs in order.
+static size_t rx_feed(winc_sim_loopback_t *lb, const uint8_t *mosi, size_t len) {
+    size_t used = 0;
+
+    switch (lb->rx_mode) {
+        case WINC_SIM_LOOPBACK_RX_HUNT:
+            if (mosi == NULL) {
+                return len; // Only zeros
+            }
+            while (used < len) {
+                uint8_t byte = mosi[used++];
+                if (byte != 0) {
+                    lb->rx_mode = WINC_SIM_LOOPBACK_RX_NONE;
+                    lb->pending_byte = byte;
+                    lb->pending_event = WINC_SIM_LOOPBACK_EVENT_BYTE;
+                    break;
+                }
+            }
+            return used;
+
+        case WINC_SIM_LOOPBACK_RX_READ: {
+            size_t chunk = lb->rx_len - lb->rx_pos;
+            if (chunk > len) chunk = len;
+            if (mosi) {
+                memcpy(lb->rx_buf + lb->rx_pos, mosi, chunk);
+            } else {
+                memset(lb->rx_buf + lb->rx_pos, 0, chunk);
+            }
+            lb->rx_pos += chunk;
+            if (lb->rx_pos == lb->rx_len) {
+                lb->rx_mode = WINC_SIM_LOOPBACK_RX_NONE;
+                lb->pending_event = WINC_SIM_LOOPBACK_EVENT_READ_DONE;
+            }
+            return chunk;
+        }
+
+        case WINC_SIM_LOOPBACK_RX_CHAIN:
+            while (used < len && lb->rx_seg < lb->rx_seg_count) {
+                winc_sim_seg_t *seg = &lb->rx_segs[lb->rx_seg];
+                size_t chunk = seg->len - lb->rx_pos;
+                if (chunk > len - used) chunk = len - used;
+                if (!(seg->flags & WINC_SIM_SEG_DISCARD)) {
+                    if (mosi) {
+                        memcpy(seg->addr + lb->rx_pos, mosi + used, chunk);
+                    } else {
+                        memset(seg->addr + lb->rx_pos, 0, chunk);
+                    }
+                }
+                if (seg->flags & WINC_SIM_SEG_CRC_DATA) {
+                    rx_crc_update(lb, mosi ? mosi + used : NULL, chunk);
+                }
+                lb->rx_pos += chunk;
+                used += chunk;
+                if (lb->rx_pos == seg->len) {
+                    if (seg->flags & WINC_SIM_SEG_CRC16) {
+                        seg->addr[2] = (uint8_t)(lb->rx_crc >> 8);
+                        seg->addr[3] = (uint8_t)lb->rx_crc;
+                        lb->rx_crc = WINC_CRC16_SEED;
+                    }
+                    lb->rx_seg++;
+                    lb->rx_pos = 0;
+                }
+            }
+            if (lb->rx_seg == lb->rx_seg_count) {
+                lb->rx_mode = WINC_SIM_LOOPBACK_RX_NONE;
+                lb->pending_event = WINC_SIM_LOOPBACK_EVENT_CHAIN_DONE;
+            }
+            return used;
+
+        case WINC_SIM_LOOPBACK_RX_NONE:
+        default:
+            return len; // Nobody is listening, same as a disabled RX IRQ
+    }
+}
+
+static void deliver_irq(winc_sim_loopback_t *lb) {
+    if (lb->irq_edge) {
+        lb->irq_edge = false;
+        lb->stats.irqs++;
+        if (lb->irq_handler != NULL) {
+            lb->irq_handler();
+        }
+    }
+}
+
+void winc_sim_loopback_rw(winc_sim_loopback_t *lb, const uint8_t *mosi, uint8_t *miso, size_t len) {
+    size_t pos = 0;
+    uint64_t start = now_ns();
+
+    winc_sim_sched_run(&lb->sim);
+    run_pending(lb);
+    while (pos < len) {
+        size_t used = rx_feed(lb, mosi ? mosi + pos : NULL, len - pos);
+        // MISO is clocked out together with the MOSI bytes just consumed,
+        // before the simulator reacts to them
+        tx_pop(lb, miso ? miso + pos : NULL, used);
+        pos += used;
+        run_pending(lb);
+    }
+
+    if (miso != NULL && lb->fault_bytes != 0 && lb->sck_hz > lb->fault_above_hz) {
+        for (size_t i = 0; i < len; i++) {
+            if (++lb->fault_count == lb->fault_bytes) {
+                lb->fault_count = 0;
+                miso[i] ^= 0x01;
+            }
+        }
+    }
+
+    lb->stats.transfers++;
+    lb->stats.bytes += len;
+    lb->stats.rw_ns += now_ns() - start;
+
+    deliver_irq(lb);
+}
+
+void winc_sim_loopback_set_clock(winc_sim_loopback_t *lb, uint32_t hz) {
+    lb->sck_hz = hz;
+}
+
+void winc_sim_loopback_set_faults(winc_sim_loopback_t *lb, uint32_t above_hz, uint32_t every_bytes) {
+    lb->fault_above_hz = above_hz;
+    lb->fault_bytes = every_bytes;
+    lb->fault_count = 0;
+}
+
+void winc_sim_loopback_poll(winc_sim_loopback_t *lb) {
+    winc_sim_sched_run(&lb->sim);
+    deliver_irq(lb);
+}
+
+void winc_sim_loopback_set_irq_handler(winc_sim_loopback_t *lb, void (*handler)(void)) {
+    lb->irq_handler = handler;
+}
+
+bool winc_sim_loopback_irq_asserted(const winc_sim_loopback_t *lb) {
+    return lb->irq_level;
+}
+
+void winc_sim_loopback_get_stats(const winc_sim_loopback_t *lb, winc_sim_loopback_stats_t *out) {
+    *out = lb->stats;
+}
+
+void winc_sim_loopback_reset_stats(winc_sim_loopback_t *lb) {
+    memset(&lb->stats, 0, sizeof(lb->stats));
+}
+
+void winc_sim_loopback_init(winc_sim_loopback_t *lb, uint8_t id) {
+    lb->tx_head = 0;
+    lb->tx_tail = 0;
+    lb->rx_mode = WINC_SIM_LOOPBACK_RX_NONE;
+    lb->pending_event = WINC_SIM_LOOPBACK_EVENT_NONE;
+    lb->irq_level = false;
+    lb->irq_edge = false;
+    lb->sck_hz = 0;
+    lb->fault_bytes = 0;
+    lb->fault_count = 0;
+    lb->sim.cpu = NULL;
+    lb->sim.capture = NULL;
+    winc_sim_loopback_reset_stats(lb);
+    winc_sim_engine_init(&lb->sim, id, &loopback_transport, lb);
+}
@@ -0,0 +1,136 @@
+#ifndef WINC_SIM_LOOPBACK_H
+#define WINC_SIM_LOOPBACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "winc_sim_engine.h"
+
+// Bytes the simulator can queue for MISO before the host clocks them out.
+// Must hold the largest DMA read payload including prefixes and CRCs.
+#define WINC_SIM_LOOPBACK_TX_SIZE (256 * 1024)
+
+// Time and traffic that went through the loopback, for per-layer benchmarks
+typedef struct {
+    uint64_t transfers;     // winc_sim_loopback_rw() calls
+    uint64_t bytes;         // Full-duplex bytes clocked
+    uint64_t rw_ns;         // Time spent in winc_sim_loopback_rw(), engine included
+    uint64_t engine_ns;     // Time spent in the engine callbacks
+    uint64_t irqs;          // Interrupt edges delivered to the host
+} winc_sim_loopback_stats_t;
+
+typedef enum {
+    WINC_SIM_LOOPBACK_RX_NONE,
+    WINC_SIM_LOOPBACK_RX_HUNT,      // Skip zeros, deliver the next non-zero byte
+    WINC_SIM_LOOPBACK_RX_READ,      // Fill rx_buf
+    WINC_SIM_LOOPBACK_RX_CHAIN      // Fill rx_segs
+} winc_sim_loopback_rx_mode_t;
+
+typedef enum {
+    WINC_SIM_LOOPBACK_EVENT_NONE,
+    WINC_SIM_LOOPBACK_EVENT_BYTE,
+    WINC_SIM_LOOPBACK_EVENT_READ_DONE,
+    WINC_SIM_LOOPBACK_EVENT_CHAIN_DONE
+} winc_sim_loopback_event_t;
+
+// One simulated chip on its own in-process bus. Instances share nothing, so
+// each can be driven from its own thread.
+typedef struct winc_sim_loopback {
+    winc_sim_t sim;
+
+    uint8_t tx_ring[WINC_SIM_LOOPBACK_TX_SIZE];
+    size_t tx_head;
+    size_t tx_tail;
+
+    winc_sim_loopback_rx_mode_t rx_mode;
+    uint8_t *rx_buf;
+    size_t rx_len;
+    size_t rx_pos;
+    winc_sim_seg_t rx_segs[WINC_SIM_MAX_SEGMENTS];
+    size_t rx_seg_count;
+    size_t rx_seg;
+
+    // Running data CRC16, the software stand-in for the DMA sniffer
+    uint16_t tx_crc;
+    uint16_t rx_crc;
+
+    winc_sim_loopback_event_t pending_event;
+    uint8_t pending_byte;
+
+    // Interrupt line, a falling edge (assert) is delivered to the host once
+    // the transfer that caused it has finished
+    bool irq_level;
+    bool irq_edge;
+    void (*irq_handler)(void);
+
+    // Marginal link, see winc_sim_loopback_set_faults()
+    uint32_t sck_hz;
+    uint32_t fault_above_hz;
+    uint32_t fault_bytes;
+    uint32_t fault_count;
+
+    winc_sim_loopback_stats_t stats;
+} winc_sim_loopback_t;
+
+/**
+ * @brief Reset the simulated chip and attach it to the in-process transport
+ *
+ * Used by the host bus wrapper instead of a real SPI master, so the unmodified
+ * driver and the simulator engine run in the same process.
+ *
+ * @param id  Instance number, shown in the trace
+ */
+void winc_sim_loopback_init(winc_sim_loopback_t *lb, uint8_t id);
+
+/**
+ * @brief Clock one full-duplex SPI transfer through the simulator
+ *
+ * @param mosi Bytes sent by the host, NULL to send zeros
+ * @param miso Bytes returned by the simulator, NULL to ignore them
+ * @param len  Transfer length
+ */
+void winc_sim_loopback_rw(winc_sim_loopback_t *lb, const uint8_t *mosi, uint8_t *miso, size_t len);
+
+/**
+ * @brief SCK rate of the host's transfers
+ *
+ * The loopback moves bytes without a clock. The rate only matters to the
+ * fault model, the host bus wrapper passes on the one in use.
+ */
+void winc_sim_loopback_set_clock(winc_sim_loopback_t *lb, uint32_t hz);
+
+/**
+ * @brief Model a marginal link, for tests and benchmarks
+ *
+ * While the clock is above above_hz, one MISO bit is flipped every
+ * every_bytes bytes the host reads, as a board that does not hold the rate
+ * would. Off after winc_sim_loopback_init().
+ *
+ * @param every_bytes Distance between bit errors, 0 turns the model off
+ */
+void winc_sim_loopback_set_faults(winc_sim_loopback_t *lb, uint32_t above_hz, uint32_t every_bytes);
+
+/**
+ * @brief Give the simulated firmware time to run its due events
+ *
+ * The loopback has no thread of its own: delayed replies (network latency,
+ * bandwidth, timeouts) go out from here or from the next transfer. Call it
+ * wherever the application waits for an event.
+ */
+void winc_sim_loopback_poll(winc_sim_loopback_t *lb);
+
+/**
+ * @brief Host interrupt handler for the simulated IRQ line
+ *
+ * Called on every assert (falling edge on the wire), after the transfer
+ * during which the simulator raised it. Stands in for the GPIO IRQ.
+ */
+void winc_sim_loopback_set_irq_handler(winc_sim_loopback_t *lb, void (*handler)(void));
+
+// Current level of the IRQ line, true while the simulator asserts it
+bool winc_sim_loopback_irq_asserted(const winc_sim_loopback_t *lb);
+
+void winc_sim_loopback_get_stats(const winc_sim_loopback_t *lb, winc_sim_loopback_stats_t *stats);
+void winc_sim_loopback_reset_stats(winc_sim_loopback_t *lb);
+
+#endif // WINC_SIM_LOOPBACK_H
@@ -0,0 +1,207 @@
+#include <string.h>
+#include "winc1500_registers.h"
+#include "winc_sim_memmap.h"
+#include "winc_sim_engine.h"
+#include "config/conf_simulator.h"
+#include "sim_log.h"
+
+#define REG_BLOCK(start, block) { (start), sizeof(((winc_sim_map_t *)0)->block), offsetof(winc_sim_map_t, block), false }
+#define RAM_REGION(start, end)  { (start), (end) - (start), 0, true }
+
+// Sorted by base and non-overlapping. The register blocks that sit inside the
+// RAM range cut it into several pieces.
+static const winc_sim_region_t regions[] = {
+    REG_BLOCK(0x00000, clockless_regs),
+    RAM_REGION(0x00100, 0x01000),
+    REG_BLOCK(0x01000, periph_regs),
+    RAM_REGION(0x02000, 0x0e800),
+    REG_BLOCK(0x0e800, spi_regs),
+    RAM_REGION(0x0e900, 0xc0000),
+    REG_BLOCK(0xc0000, bootrom_regs),
+    RAM_REGION(0xc0100, WINC_SIM_RAM_END),
+    REG_BLOCK(WIFI_HOST_RCV_CTRL_4, host_rcv_regs),
+};
+
+// Pages shared with a register block waste the part the registers cover
+static const uint8_t zero_page[WINC_SIM_MAP_PAGE_SIZE];
+
+static uint8_t *page_alloc(winc_sim_map_t *map) {
+    if (map->free_count == 0) {
+        map->alloc_failures++;
+        return NULL;
+    }
+    uint8_t *page = map->page_pool[map->free_pages[--map->free_count]];
+    memset(page, 0, WINC_SIM_MAP_PAGE_SIZE);
+    return page;
+}
+
+#define REGION_COUNT (sizeof(regions) / sizeof(regions[0]))
+#define NO_REGION    0xFF
+
+static inline uint32_t hook_hash(uint32_t addr) {
+    return ((addr >> 2) * 2654435761u) % WINC_SIM_MAP_HOOK_SLOTS;
+}
+
+static winc_sim_map_hook_slot_t *find_hook(winc_sim_map_t *map, uint32_t addr) {
+    if (map->hook_count == 0) return NULL;
+    for (uint32_t i = hook_hash(addr), n = 0; n < WINC_SIM_MAP_HOOK_SLOTS;
+         i = (i + 1) % WINC_SIM_MAP_HOOK_SLOTS, n++) {
+        if (!map->hooks[i].used) return NULL;
+        if (map->hooks[i].addr == addr) return &map->hooks[i];
+    }
+    return NULL;
+}
+
+void winc_sim_map_init(winc_sim_t *sim) {
+    winc_sim_map_t *map = &sim->map;
+
+    memset(map->clockless_regs, 0, sizeof(map->clockless_regs));
+    memset(map->periph_regs, 0, sizeof(map->periph_regs));
+    memset(map->spi_regs, 0, sizeof(map->spi_regs));
+    memset(map->bootrom_regs, 0, sizeof(map->bootrom_regs));
+    memset(map->host_rcv_regs, 0, sizeof(map->host_rcv_regs));
+
+    memset(map->ram_pages, 0, sizeof(map->ram_pages));
+    for (uint32_t i = 0; i < SIMULATOR_PAGE_POOL_PAGES; i++) {
+        map->free_pages[i] = (uint16_t)(SIMULATOR_PAGE_POOL_PAGES - 1 - i);
+    }
+    map->free_count = SIMULATOR_PAGE_POOL_PAGES;
+    map->alloc_failures = 0;
+
+    memset(map->hooks, 0, sizeof(map->hooks));
+    map->hook_count = 0;
+
+    // First region that ends inside or after each page, NO_REGION if none
+    // starts before the page ends. A lookup is one index load plus a short
+    // forward walk for the few pages that hold more than one region.
+    uint32_t r = 0;
+    for (uint32_t page = 0; page < WINC_SIM_MAP_PAGES; page++) {
+        uint32_t start = page << WINC_SIM_MAP_PAGE_SHIFT;
+        uint32_t end = start + WINC_SIM_MAP_PAGE_SIZE;
+        while (r < REGION_COUNT && regions[r].base + regions[r].size <= start) {
+            r++;
+        }
+        map->page_index[page] = (r < REGION_COUNT && regions[r].base < end) ? (uint8_t)r : NO_REGION;
+    }
+}
+
+uint32_t winc_sim_map_span(winc_sim_t *sim, uint32_t addr, uint32_t size, bool write, uint8_t **ptr) {
+    winc_sim_map_t *map = &sim->map;
+    if ((addr >> WINC_SIM_MAP_ADDR_BITS) != 0) return 0;
+
+    uint32_t r = map->page_index[addr >> WINC_SIM_MAP_PAGE_SHIFT];
+    if (r == NO_REGION) return 0;
+
+    while (addr - regions[r].base >= regions[r].size) {
+        if (addr < regions[r].base || ++r == REGION_COUNT) return 0;
+    }
+
+    uint32_t len = regions[r].size - (addr - regions[r].base);
+    if (len > size) len = size;
+
+    if (!regions[r].paged) {
+        *ptr = (uint8_t *)map + regions[r].mem_offset + (addr - regions[r].base);
+        return len;
+    }
+
+    uint32_t offset = addr & (WINC_SIM_MAP_PAGE_SIZE - 1);
+    uint8_t **page = &map->ram_pages[addr >> WINC_SIM_MAP_PAGE_SHIFT];
+    if (len > WINC_SIM_MAP_PAGE_SIZE - offset) len = WINC_SIM_MAP_PAGE_SIZE - offset;
+
+    if (*page == NULL) {
+        if (!write) {
+            *ptr = (uint8_t *)&zero_page[offset];
+            return len;
+        }
+        *page = page_alloc(map);
+        if (*page == NULL) {
+            SIM_LOG(sim, SIM_EVENT_PAGE_POOL_EXHAUSTED, addr, SIMULATOR_PAGE_POOL_PAGES);
+            return 0;
+        }
+    }
+    *ptr = *page + offset;
+    return len;
+}
+
+uint8_t *winc_sim_map_ptr(winc_sim_t *sim, uint32_t addr, uint32_t size, bool write) {
+    if (size == 0) return NULL;
+    uint8_t *ptr = NULL;
+    return winc_sim_map_span(sim, addr, size, write, &ptr) == size ? ptr : NULL;
+}
+
+bool winc_sim_map_read(winc_sim_t *sim, uint32_t addr, void *buf, uint32_t len) {
+    uint8_t *dst = buf;
+    while (len > 0) {
+        uint8_t *ptr;
+        uint32_t n = winc_sim_map_span(sim, addr, len, false, &ptr);
+        if (n == 0) return false;
+        memcpy(dst, ptr, n);
+        dst += n;
+        addr += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool winc_sim_map_write(winc_sim_t *sim, uint32_t addr, const void *buf, uint32_t len) {
+    const uint8_t *src = buf;
+    while (len > 0) {
+        uint8_t *ptr;
+        uint32_t n = winc_sim_map_span(sim, addr, len, true, &ptr);
+        if (n == 0) return false;
+        memcpy(ptr, src, n);
+        src += n;
+        addr += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool winc_sim_map_read32(winc_sim_t *sim, uint32_t addr, uint32_t *value) {
+    uint8_t *mem = winc_sim_map_ptr(sim, addr, 4, false);
+    if (mem == NULL) return false;
+
+    memcpy(value, mem, 4);
+    winc_sim_map_hook_slot_t *h = find_hook(&sim->map, addr);
+    if (h != NULL && h->read != NULL) {
+        h->read(sim, addr, value);
+    }
+    return true;
+}
+
+bool winc_sim_map_write32(winc_sim_t *sim, uint32_t addr, uint32_t value) {
+    winc_sim_map_hook_slot_t *h = find_hook(&sim->map, addr);
+    if (h != NULL && h->write != NULL && !h->write(sim, addr, value)) {
+        return winc_sim_map_ptr(sim, addr, 4, false) != NULL;
+    }
+
+    uint8_t *mem = winc_sim_map_ptr(sim, addr, 4, true);
+    if (mem == NULL) return false;
+    memcpy(mem, &value, 4);
+    return true;
+}
+
+bool winc_sim_map_hook(winc_sim_t *sim, uint32_t addr, winc_sim_read_hook_t read, winc_sim_write_hook_t write) {
+    winc_sim_map_t *map = &sim->map;
+    winc_sim_map_hook_slot_t *h = find_hook(map, addr);
+    if (h == NULL) {
+        if (map->hook_count == WINC_SIM_MAP_MAX_HOOKS) return false;
+        uint32_t i = hook_hash(addr);
+        while (map->hooks[i].used) {
+            i = (i + 1) % WINC_SIM_MAP_HOOK_SLOTS;
+        }
+        h = &map->hooks[i];
+        h->used = true;
+        h->addr = addr;
+        map->hook_count++;
+    }
+    h->read = read;
+    h->write = write;
+    return true;
+}
+
+void winc_sim_map_get_stats(const winc_sim_t *sim, winc_sim_map_stats_t *stats) {
+    stats->pages_total = SIMULATOR_PAGE_POOL_PAGES;
+    stats->pages_used = SIMULATOR_PAGE_POOL_PAGES - sim->map.free_count;
+    stats->alloc_failures = sim->map.alloc_failures;
+}
@@ -0,0 +1,141 @@
+#ifndef WINC_SIM_MEMMAP_H
+#define WINC_SIM_MEMMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "config/conf_simulator.h"
+
+typedef struct winc_sim winc_sim_t;
+
+// Addresses on the bus are 24 bits (SINGLE/DMA commands carry three bytes)
+#define WINC_SIM_MAP_ADDR_BITS  24
+#define WINC_SIM_MAP_PAGE_SHIFT 12
+#define WINC_SIM_MAP_PAGE_SIZE  (1u << WINC_SIM_MAP_PAGE_SHIFT)
+#define WINC_SIM_MAP_PAGES      (1u << (WINC_SIM_MAP_ADDR_BITS - WINC_SIM_MAP_PAGE_SHIFT))
+
+// Simulated RAM covers [0, WINC_SIM_RAM_END) apart from the register blocks.
+// It is sparse: pages come from a pool of SIMULATOR_PAGE_POOL_PAGES on first write.
+#define WINC_SIM_RAM_END 0x100000
+
+// Maximum number of registers with side effects
+#define WINC_SIM_MAP_MAX_HOOKS 32
+
+// One contiguous piece of the simulated address space. Register blocks live
+// at mem_offset in winc_sim_map_t, the paged RAM pieces have paged set.
+typedef struct {
+    uint32_t base;
+    uint32_t size;
+    uint32_t mem_offset;
+    bool paged;
+} winc_sim_region_t;
+
+typedef struct {
+    uint32_t pages_total;    // Pool size
+    uint32_t pages_used;     // Pages allocated since the last init
+    uint32_t alloc_failures; // Writes refused because the pool was empty
+} winc_sim_map_stats_t;
+
+// Called after the register value has been fetched from memory; may replace it
+typedef void (*winc_sim_read_hook_t)(winc_sim_t *sim, uint32_t addr, uint32_t *value);
+// Called before the value is stored; return false to keep it out of memory
+typedef bool (*winc_sim_write_hook_t)(winc_sim_t *sim, uint32_t addr, uint32_t value);
+
+typedef struct {
+    uint32_t addr;
+    winc_sim_read_hook_t read;
+    winc_sim_write_hook_t write;
+    bool used;
+} winc_sim_map_hook_slot_t;
+
+// Open-addressed hash of hooked register addresses
+#define WINC_SIM_MAP_HOOK_SLOTS (WINC_SIM_MAP_MAX_HOOKS * 2)
+
+// Address space of one instance
+typedef struct {
+    // Register blocks
+    uint8_t clockless_regs[256];
+    uint8_t periph_regs[4096];
+    uint8_t spi_regs[256];
+    uint8_t bootrom_regs[256];
+    uint8_t host_rcv_regs[256];
+
+    // Sparse RAM: one slot per page of [0, WINC_SIM_RAM_END), NULL until the
+    // page is first written
+    uint8_t *ram_pages[WINC_SIM_RAM_END >> WINC_SIM_MAP_PAGE_SHIFT];
+
+    // Fixed pool with a free stack, allocation is a pop and a memset
+    uint8_t page_pool[SIMULATOR_PAGE_POOL_PAGES][WINC_SIM_MAP_PAGE_SIZE];
+    uint16_t free_pages[SIMULATOR_PAGE_POOL_PAGES];
+    uint32_t free_count;
+    uint32_t alloc_failures;
+
+    // Region lookup per page, see winc_sim_map_init()
+    uint8_t page_index[WINC_SIM_MAP_PAGES];
+
+    winc_sim_map_hook_slot_t hooks[WINC_SIM_MAP_HOOK_SLOTS];
+    uint32_t hook_count;
+} winc_sim_map_t;
+
+/**
+ * @brief Clear all regions, return every page to the pool and drop the hooks
+ */
+void winc_sim_map_init(winc_sim_t *sim);
+
+/**
+ * @brief Largest contiguous piece of [addr, addr+size) starting at addr
+ *
+ * Pieces never cross a region or page boundary, so DMA can use them as one
+ * segment. For reads an unallocated page yields the shared zero page, which
+ * must not be written through. For writes the page is allocated.
+ *
+ * @param ptr Receives the pointer to addr
+ * @return Length of the piece, 0 if addr is unmapped or the page pool is empty
+ */
+uint32_t winc_sim_map_span(winc_sim_t *sim, uint32_t addr, uint32_t size, bool write, uint8_t **ptr);
+
+/**
+ * @brief Pointer to [addr, addr+size), see winc_sim_map_span()
+ *
+ * @return NULL for an empty range, or unless the whole range is one piece
+ */
+uint8_t *winc_sim_map_ptr(winc_sim_t *sim, uint32_t addr, uint32_t size, bool write);
+
+/**
+ * @brief Copy between the simulated address space and a local buffer
+ *
+ * Used by the emulated firmware for messages that span pages. No hooks run.
+ *
+ * @return false if part of the range is unmapped or no page is left for it
+ */
+bool winc_sim_map_read(winc_sim_t *sim, uint32_t addr, void *buf, uint32_t len);
+bool winc_sim_map_write(winc_sim_t *sim, uint32_t addr, const void *buf, uint32_t len);
+
+/**
+ * @brief Register read (SINGLE_READ / INTERNAL_READ), runs the read hook
+ *
+ * @return false if addr is unmapped
+ */
+bool winc_sim_map_read32(winc_sim_t *sim, uint32_t addr, uint32_t *value);
+
+/**
+ * @brief Register write (SINGLE_WRITE / INTERNAL_WRITE), runs the write hook
+ *
+ * @return false if addr is unmapped or no page is left for it
+ */
+bool winc_sim_map_write32(winc_sim_t *sim, uint32_t addr, uint32_t value);
+
+/**
+ * @brief Attach side effects to one 32-bit register
+ *
+ * Either hook may be NULL. Registering the same address again replaces its
+ * hooks.
+ *
+ * @return false if the hook table is full
+ */
+bool winc_sim_map_hook(winc_sim_t *sim, uint32_t addr, winc_sim_read_hook_t read, winc_sim_write_hook_t write);
+
+// Page pool usage
+void winc_sim_map_get_stats(const winc_sim_t *sim, winc_sim_map_stats_t *stats);
+
+#endif // WINC_SIM_MEMMAP_H
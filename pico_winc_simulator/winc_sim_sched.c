@@ -0,0 +1,69 @@
+#include "winc_sim_sched.h"
+#include "winc_sim_engine.h"
+#include "sim_log.h"
+
+void winc_sim_sched_init(winc_sim_t *sim) {
+    sim->sched.event_count = 0;
+}
+
+uint64_t winc_sim_sched_now(winc_sim_t *sim) {
+    return sim->transport->now_us();
+}
+
+bool winc_sim_sched_at(winc_sim_t *sim, uint64_t due_us, winc_sim_event_fn_t fn, uint32_t a, uint32_t b) {
+    winc_sim_sched_t *s = &sim->sched;
+    if (s->event_count == WINC_SIM_SCHED_MAX_EVENTS) {
+        SIM_LOG(sim, SIM_EVENT_EVENT_TABLE_FULL, a, b);
+        return false;
+    }
+
+    uint32_t i = s->event_count++;
+    while (i > 0 && s->events[i - 1].due_us > due_us) {
+        s->events[i] = s->events[i - 1];
+        i--;
+    }
+    s->events[i] = (winc_sim_sched_event_t){ due_us, fn, a, b };
+
+    if (i == 0) {
+        sim->transport->timer(sim->ctx, due_us);
+    }
+    return true;
+}
+
+void winc_sim_sched_after(winc_sim_t *sim, uint32_t delay_us, winc_sim_event_fn_t fn, uint32_t a, uint32_t b) {
+    if (delay_us == 0) {
+        fn(sim, a, b);
+        return;
+    }
+    winc_sim_sched_at(sim, sim->transport->now_us() + delay_us, fn, a, b);
+}
+
+void winc_sim_sched_cancel(winc_sim_t *sim, winc_sim_event_fn_t fn, uint32_t a) {
+    winc_sim_sched_t *s = &sim->sched;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < s->event_count; i++) {
+        if (s->events[i].fn != fn || s->events[i].a != a) {
+            s->events[kept++] = s->events[i];
+        }
+    }
+    s->event_count = kept;
+}
+
+void winc_sim_sched_run(winc_sim_t *sim) {
+    winc_sim_sched_t *s = &sim->sched;
+    uint64_t now = sim->transport->now_us();
+
+    // An event may add events, including ones that are already due
+    while (s->event_count > 0 && s->events[0].due_us <= now) {
+        winc_sim_sched_event_t ev = s->events[0];
+        s->event_count--;
+        for (uint32_t i = 0; i < s->event_count; i++) {
+            s->events[i] = s->events[i + 1];
+        }
+        ev.fn(sim, ev.a, ev.b);
+    }
+
+    if (s->event_count > 0) {
+        sim->transport->timer(sim->ctx, s->events[0].due_us);
+    }
+}
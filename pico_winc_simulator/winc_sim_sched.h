@@ -0,0 +1,68 @@
+#ifndef WINC_SIM_SCHED_H
+#define WINC_SIM_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "winc_sim_transport.h"
+
+typedef struct winc_sim winc_sim_t;
+
+// Deferred work of the emulated firmware (network latency, bandwidth, timeouts).
+// Events run in the same context as the engine: from the transport's timer on
+// the Pico, from winc_sim_loopback_rw()/winc_sim_loopback_poll() on the host.
+
+#define WINC_SIM_SCHED_MAX_EVENTS 32
+
+typedef void (*winc_sim_event_fn_t)(winc_sim_t *sim, uint32_t a, uint32_t b);
+
+typedef struct {
+    uint64_t due_us;
+    winc_sim_event_fn_t fn;
+    uint32_t a;
+    uint32_t b;
+} winc_sim_sched_event_t;
+
+typedef struct {
+    // Sorted by due time, the next event first. The table is small enough
+    // that an insertion sort beats a heap.
+    winc_sim_sched_event_t events[WINC_SIM_SCHED_MAX_EVENTS];
+    uint32_t event_count;
+} winc_sim_sched_t;
+
+/**
+ * @brief Drop all pending events
+ *
+ * Called by winc_sim_engine_init().
+ */
+void winc_sim_sched_init(winc_sim_t *sim);
+
+// Current time of the transport's clock
+uint64_t winc_sim_sched_now(winc_sim_t *sim);
+
+/**
+ * @brief Run fn(sim, a, b) once the clock reaches due_us
+ *
+ * Events with the same due time run in the order they were added. A due time
+ * that has already passed runs on the next winc_sim_sched_run().
+ *
+ * @return false if the event table is full
+ */
+bool winc_sim_sched_at(winc_sim_t *sim, uint64_t due_us, winc_sim_event_fn_t fn, uint32_t a, uint32_t b);
+
+/**
+ * @brief Run fn(sim, a, b) delay_us from now, or right away if delay_us is 0
+ *
+ * A zero delay calls fn before returning, so a reply it sends goes out in the
+ * host's current transaction.
+ */
+void winc_sim_sched_after(winc_sim_t *sim, uint32_t delay_us, winc_sim_event_fn_t fn, uint32_t a, uint32_t b);
+
+// Drop the pending events that would call fn(sim, a, ...)
+void winc_sim_sched_cancel(winc_sim_t *sim, winc_sim_event_fn_t fn, uint32_t a);
+
+/**
+ * @brief Run every event that is due and re-arm the transport's timer
+ */
+void winc_sim_sched_run(winc_sim_t *sim);
+
+#endif // WINC_SIM_SCHED_H
@@ -0,0 +1,444 @@
+#include <stddef.h>
+#include <string.h>
+#include "winc_sim_socket.h"
+#include "winc_sim_engine.h"
+#include "winc_sim_hif.h"
+#include "winc_sim_memmap.h"
+#include "winc_sim_sched.h"
+#include "config/conf_simulator.h"
+#include "sim_log.h"
+
+// Opcodes of the IP group (m2m_socket_host_if.h)
+#define SOCKET_CMD_BIND     0x41
+#define SOCKET_CMD_CONNECT  0x44
+#define SOCKET_CMD_SEND     0x45
+#define SOCKET_CMD_RECV     0x46
+#define SOCKET_CMD_SENDTO   0x47
+#define SOCKET_CMD_RECVFROM 0x48
+#define SOCKET_CMD_CLOSE    0x49
+#define SOCKET_CMD_DATA_PKT 0x80 // M2M_REQ_DATA_PKT
+
+#define SOCK_ERR_NO_ERROR     0
+#define SOCK_ERR_CONN_ABORTED -12
+#define SOCK_ERR_TIMEOUT      -13
+#define SOCK_ERR_BUFFER_FULL  -14
+
+// Where the host puts TCP send data from now on, reported by connect. The
+// driver only uses it for TLS sockets.
+#define TCP_APP_DATA_OFFSET 88
+
+#define RECV_NO_TIMEOUT 0xFFFFFFFFu
+
+// Request and reply layouts as they sit in the HIF buffers
+
+typedef struct {
+    winc_sim_sockaddr_t addr;
+    int8_t sock;
+    uint8_t pad;
+    uint16_t session;
+} bind_cmd_t;
+
+typedef struct {
+    int8_t sock;
+    int8_t status;
+    uint16_t session;
+} bind_reply_t;
+
+typedef struct {
+    winc_sim_sockaddr_t addr;
+    int8_t sock;
+    uint8_t ssl_flags;
+    uint16_t session;
+} connect_cmd_t;
+
+typedef struct {
+    int8_t sock;
+    int8_t error;
+    uint16_t app_data_offset;
+} connect_reply_t;
+
+typedef struct {
+    int8_t sock;
+    uint8_t pad;
+    uint16_t data_size;
+    winc_sim_sockaddr_t addr;
+    uint16_t session;
+    uint16_t pad2;
+} send_cmd_t;
+
+typedef struct {
+    int8_t sock;
+    uint8_t pad;
+    int16_t sent;
+    uint16_t session;
+    uint16_t pad2;
+} send_reply_t;
+
+// Drivers before 19.6.4 send the first 8 bytes only, without buf_len
+typedef struct {
+    uint32_t timeout_ms;
+    int8_t sock;
+    uint8_t pad;
+    uint16_t session;
+    uint16_t buf_len;
+    uint16_t pad2;
+} recv_cmd_t;
+
+typedef struct {
+    winc_sim_sockaddr_t addr;
+    int16_t status;
+    uint16_t data_offset;
+    int8_t sock;
+    uint8_t pad;
+    uint16_t session;
+} recv_reply_t;
+
+typedef struct {
+    int8_t sock;
+    uint8_t pad;
+    uint16_t session;
+} close_cmd_t;
+
+_Static_assert(sizeof(send_cmd_t) == 16, "tstrSendCmd is 16 bytes");
+_Static_assert(sizeof(recv_reply_t) == 16, "tstrRecvReply is 16 bytes");
+
+#define RECV_CMD_MIN_SIZE 8
+
+typedef enum {
+    SERVICE_NONE,
+    SERVICE_ECHO,
+    SERVICE_DISCARD,
+    SERVICE_CHARGEN
+} service_t;
+
+// Deferred events name their socket by id and generation
+static inline uint32_t event_ref(const winc_sim_t *sim, const winc_sim_sock_t *s) {
+    return (uint32_t)(s - sim->socket.sockets) | (s->gen << 8);
+}
+
+static winc_sim_sock_t *event_socket(winc_sim_t *sim, uint32_t ref) {
+    winc_sim_sock_t *s = &sim->socket.sockets[ref & 0xFF];
+    return (s->used && s->gen == (ref >> 8)) ? s : NULL;
+}
+
+static winc_sim_sock_t *request_socket(winc_sim_t *sim, int8_t sock) {
+    if (sock < 0 || sock >= WINC_SIM_SOCKET_MAX) {
+        return NULL;
+    }
+    return &sim->socket.sockets[sock];
+}
+
+// Time to put len bytes on the link, queued behind earlier data. Returns the
+// delay from now until the last byte is through.
+static uint32_t link_transfer(winc_sim_t *sim, uint32_t len) {
+    winc_sim_socket_t *sk = &sim->socket;
+    if (sk->net.bandwidth_kbps == 0) {
+        return 0;
+    }
+    uint64_t now = winc_sim_sched_now(sim);
+    uint64_t start = sk->link_free_us > now ? sk->link_free_us : now;
+    sk->link_free_us = start + (uint64_t)len * 8000u / sk->net.bandwidth_kbps;
+    return (uint32_t)(sk->link_free_us - now);
+}
+
+static service_t service_for_port(uint16_t port_be) {
+    uint16_t port = (uint16_t)((port_be >> 8) | (port_be << 8));
+    switch (port) {
+        case WINC_SIM_SOCKET_PORT_ECHO:    return SERVICE_ECHO;
+        case WINC_SIM_SOCKET_PORT_DISCARD: return SERVICE_DISCARD;
+        case WINC_SIM_SOCKET_PORT_CHARGEN: return SERVICE_CHARGEN;
+        default:                           return SERVICE_NONE;
+    }
+}
+
+static void socket_open(winc_sim_sock_t *s, uint16_t session) {
+    if (!s->used || s->session != session) {
+        uint32_t gen = s->gen;
+        memset(s, 0, sizeof(*s));
+        s->gen = gen;
+        s->used = true;
+        s->session = session;
+    }
+}
+
+// RFC 864: lines of 72 printable characters, each one starting a character
+// further along than the line before
+static void chargen_fill(uint8_t *buf, uint32_t len, uint32_t pos) {
+    for (uint32_t i = 0; i < len; i++, pos++) {
+        uint32_t line = pos / 74;
+        uint32_t col = pos % 74;
+        if (col < 72) {
+            buf[i] = (uint8_t)(' ' + (line + col) % 95);
+        } else {
+            buf[i] = (col == 72) ? '\r' : '\n';
+        }
+    }
+}
+
+static void recv_timeout(winc_sim_t *sim, uint32_t ref, uint32_t seq);
+
+static bool recv_reply(winc_sim_t *sim, winc_sim_sock_t *s, int16_t status, const uint8_t *data, uint16_t len) {
+    recv_reply_t reply = {
+        .addr = s->peer,
+        .status = status,
+        .data_offset = sizeof(recv_reply_t),
+        .sock = (int8_t)(s - sim->socket.sockets),
+        .session = s->session,
+    };
+    if (!winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_IP, s->recv_opcode, &reply, sizeof(reply),
+                           data, len, sizeof(recv_reply_t))) {
+        return false;
+    }
+    s->recv_pending = false;
+    winc_sim_sched_cancel(sim, recv_timeout, event_ref(sim, s));
+    return true;
+}
+
+// Answer an outstanding recv with echo data that has arrived
+static void echo_deliver(winc_sim_t *sim, winc_sim_sock_t *s) {
+    winc_sim_socket_t *sk = &sim->socket;
+    if (!s->recv_pending || s->rx_ready == 0) {
+        return;
+    }
+
+    uint32_t len = s->rx_ready;
+    if (len > s->recv_len) len = s->recv_len;
+    for (uint32_t i = 0; i < len; i++) {
+        sk->xfer_buf[i] = s->rx_ring[(s->rx_tail + i) % WINC_SIM_SOCKET_RX_SIZE];
+    }
+    s->rx_tail += len;
+    s->rx_ready -= len;
+    sk->stats.rx_bytes += len;
+    recv_reply(sim, s, (int16_t)len, sk->xfer_buf, (uint16_t)len);
+}
+
+static void connect_done(winc_sim_t *sim, uint32_t ref, uint32_t error) {
+    winc_sim_sock_t *s = event_socket(sim, ref);
+    if (s == NULL) return;
+
+    connect_reply_t reply = {
+        .sock = (int8_t)(ref & 0xFF),
+        .error = (int8_t)error,
+        .app_data_offset = TCP_APP_DATA_OFFSET,
+    };
+    winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_IP, SOCKET_CMD_CONNECT, &reply, sizeof(reply), NULL, 0, 0);
+}
+
+// b: opcode << 16 | bytes sent
+static void send_done(winc_sim_t *sim, uint32_t ref, uint32_t b) {
+    winc_sim_sock_t *s = event_socket(sim, ref);
+    if (s == NULL) return;
+
+    send_reply_t reply = {
+        .sock = (int8_t)(ref & 0xFF),
+        .sent = (int16_t)(b & 0xFFFF),
+        .session = s->session,
+    };
+    winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_IP, (uint8_t)(b >> 16), &reply, sizeof(reply), NULL, 0, 0);
+}
+
+static void echo_arrived(winc_sim_t *sim, uint32_t ref, uint32_t len) {
+    winc_sim_sock_t *s = event_socket(sim, ref);
+    if (s == NULL) return;
+
+    s->rx_ready += len;
+    echo_deliver(sim, s);
+}
+
+static void chargen_ready(winc_sim_t *sim, uint32_t ref, uint32_t seq) {
+    winc_sim_socket_t *sk = &sim->socket;
+    winc_sim_sock_t *s = event_socket(sim, ref);
+    if (s == NULL || !s->recv_pending || s->recv_seq != seq) return;
+
+    uint16_t len = s->recv_len;
+    chargen_fill(sk->xfer_buf, len, s->chargen_pos);
+    s->chargen_pos += len;
+    sk->stats.rx_bytes += len;
+    recv_reply(sim, s, (int16_t)len, sk->xfer_buf, len);
+}
+
+static void recv_timeout(winc_sim_t *sim, uint32_t ref, uint32_t seq) {
+    winc_sim_sock_t *s = event_socket(sim, ref);
+    if (s == NULL || !s->recv_pending || s->recv_seq != seq) return;
+
+    sim->socket.stats.recv_timeouts++;
+    recv_reply(sim, s, SOCK_ERR_TIMEOUT, NULL, 0);
+}
+
+static void handle_bind(winc_sim_t *sim, uint32_t addr) {
+    bind_cmd_t cmd;
+    winc_sim_map_read(sim, addr, &cmd, sizeof(cmd));
+    winc_sim_sock_t *s = request_socket(sim, cmd.sock);
+    if (s == NULL) return;
+
+    socket_open(s, cmd.session);
+    bind_reply_t reply = { .sock = cmd.sock, .status = SOCK_ERR_NO_ERROR, .session = cmd.session };
+    winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_IP, SOCKET_CMD_BIND, &reply, sizeof(reply), NULL, 0, 0);
+}
+
+static void handle_connect(winc_sim_t *sim, uint32_t addr) {
+    winc_sim_socket_t *sk = &sim->socket;
+    connect_cmd_t cmd;
+    winc_sim_map_read(sim, addr, &cmd, sizeof(cmd));
+    winc_sim_sock_t *s = request_socket(sim, cmd.sock);
+    if (s == NULL) return;
+
+    socket_open(s, cmd.session);
+    s->peer = cmd.addr;
+    s->service = service_for_port(cmd.addr.port);
+
+    int8_t error = SOCK_ERR_NO_ERROR;
+    if (s->service == SERVICE_NONE) {
+        error = SOCK_ERR_CONN_ABORTED;
+        sk->stats.refused++;
+    } else {
+        sk->stats.connects++;
+    }
+    winc_sim_sched_after(sim, sk->net.latency_us, connect_done, event_ref(sim, s), (uint32_t)(uint8_t)error);
+}
+
+static void handle_send(winc_sim_t *sim, uint8_t opcode, uint32_t addr, uint16_t len) {
+    winc_sim_socket_t *sk = &sim->socket;
+    send_cmd_t cmd;
+    winc_sim_map_read(sim, addr, &cmd, sizeof(cmd));
+    winc_sim_sock_t *s = request_socket(sim, cmd.sock);
+    if (s == NULL || cmd.data_size > WINC_SIM_SOCKET_MAX_DATA || cmd.data_size > len) return;
+
+    socket_open(s, cmd.session);
+    if (opcode == SOCKET_CMD_SENDTO) {
+        s->peer = cmd.addr;
+        s->service = service_for_port(cmd.addr.port);
+    }
+
+    // The data sits at the end of the message, after the driver's headroom
+    uint32_t data = addr + len - cmd.data_size;
+    int16_t sent = (int16_t)cmd.data_size;
+    uint32_t tx_us = link_transfer(sim, cmd.data_size);
+    sk->stats.tx_bytes += cmd.data_size;
+
+    if (s->service == SERVICE_ECHO) {
+        uint32_t space = WINC_SIM_SOCKET_RX_SIZE - (s->rx_head - s->rx_tail);
+        if (cmd.data_size > space) {
+            sk->stats.tx_dropped += cmd.data_size;
+            sent = SOCK_ERR_BUFFER_FULL;
+        } else {
+            for (uint32_t done = 0; done < cmd.data_size; ) {
+                uint32_t idx = s->rx_head % WINC_SIM_SOCKET_RX_SIZE;
+                uint32_t chunk = WINC_SIM_SOCKET_RX_SIZE - idx;
+                if (chunk > cmd.data_size - done) chunk = cmd.data_size - done;
+                winc_sim_map_read(sim, data + done, &s->rx_ring[idx], chunk);
+                s->rx_head += chunk;
+                done += chunk;
+            }
+        }
+    }
+
+    winc_sim_sched_after(sim, tx_us, send_done, event_ref(sim, s), ((uint32_t)opcode << 16) | (uint16_t)sent);
+    if (s->service == SERVICE_ECHO && sent > 0) {
+        winc_sim_sched_after(sim, tx_us + sk->net.latency_us, echo_arrived, event_ref(sim, s), (uint32_t)sent);
+    }
+}
+
+static void handle_recv(winc_sim_t *sim, uint8_t opcode, uint32_t addr, uint16_t len) {
+    recv_cmd_t cmd = { .buf_len = WINC_SIM_SOCKET_MAX_DATA };
+    if (len < RECV_CMD_MIN_SIZE) return;
+    // An 8 byte request leaves buf_len at its default
+    winc_sim_map_read(sim, addr, &cmd, len < offsetof(recv_cmd_t, pad2) ? RECV_CMD_MIN_SIZE : offsetof(recv_cmd_t, pad2));
+    winc_sim_sock_t *s = request_socket(sim, cmd.sock);
+    if (s == NULL) return;
+
+    socket_open(s, cmd.session);
+    s->recv_pending = true;
+    s->recv_opcode = opcode;
+    s->recv_len = cmd.buf_len;
+    if (s->recv_len == 0 || s->recv_len > WINC_SIM_SOCKET_MAX_DATA) {
+        s->recv_len = WINC_SIM_SOCKET_MAX_DATA;
+    }
+    s->recv_seq++;
+
+    if (s->service == SERVICE_CHARGEN) {
+        winc_sim_sched_after(sim, link_transfer(sim, s->recv_len), chargen_ready, event_ref(sim, s), s->recv_seq);
+        return;
+    }
+
+    echo_deliver(sim, s);
+    if (s->recv_pending && cmd.timeout_ms != RECV_NO_TIMEOUT) {
+        winc_sim_sched_at(sim, winc_sim_sched_now(sim) + (uint64_t)cmd.timeout_ms * 1000u,
+                          recv_timeout, event_ref(sim, s), s->recv_seq);
+    }
+}
+
+static void handle_close(winc_sim_t *sim, uint32_t addr) {
+    close_cmd_t cmd;
+    winc_sim_map_read(sim, addr, &cmd, sizeof(cmd));
+    winc_sim_sock_t *s = request_socket(sim, cmd.sock);
+    if (s == NULL) return;
+
+    // No reply, the driver forgets the socket right away. Its pending events
+    // find the generation changed and do nothing.
+    s->used = false;
+    s->gen++;
+}
+
+static void socket_request(winc_sim_t *sim, uint8_t opcode, uint32_t addr, uint16_t len) {
+    opcode &= ~SOCKET_CMD_DATA_PKT;
+    switch (opcode) {
+        case SOCKET_CMD_BIND:
+            handle_bind(sim, addr);
+            break;
+        case SOCKET_CMD_CONNECT:
+            handle_connect(sim, addr);
+            break;
+        case SOCKET_CMD_SEND:
+        case SOCKET_CMD_SENDTO:
+            handle_send(sim, opcode, addr, len);
+            break;
+        case SOCKET_CMD_RECV:
+        case SOCKET_CMD_RECVFROM:
+            handle_recv(sim, opcode, addr, len);
+            break;
+        case SOCKET_CMD_CLOSE:
+            handle_close(sim, addr);
+            break;
+        default:
+            sim->socket.stats.unhandled++;
+            SIM_LOG(sim, SIM_EVENT_UNHANDLED_IP, opcode, len);
+            break;
+    }
+}
+
+bool winc_sim_socket_inject(winc_sim_t *sim, uint16_t len) {
+    winc_sim_socket_t *sk = &sim->socket;
+    for (uint32_t i = 0; i < WINC_SIM_SOCKET_MAX; i++) {
+        winc_sim_sock_t *s = &sk->sockets[i];
+        if (!s->used || !s->recv_pending) continue;
+
+        if (len == 0) len = 1;
+        if (len > s->recv_len) len = s->recv_len;
+        chargen_fill(sk->xfer_buf, len, s->chargen_pos);
+        if (!recv_reply(sim, s, (int16_t)len, sk->xfer_buf, len)) {
+            return false;
+        }
+        s->chargen_pos += len;
+        sk->stats.rx_bytes += len;
+        return true;
+    }
+    return false;
+}
+
+void winc_sim_socket_init(winc_sim_t *sim) {
+    winc_sim_socket_t *sk = &sim->socket;
+    memset(sk, 0, sizeof(*sk));
+    sk->net.latency_us = SIMULATOR_NET_LATENCY_US;
+    sk->net.bandwidth_kbps = SIMULATOR_NET_BANDWIDTH_KBPS;
+    winc_sim_hif_register(sim, WINC_SIM_HIF_GROUP_IP, socket_request);
+}
+
+void winc_sim_socket_set_net(winc_sim_t *sim, const winc_sim_net_t *model) {
+    sim->socket.net = *model;
+    sim->socket.link_free_us = 0;
+}
+
+void winc_sim_socket_get_stats(const winc_sim_t *sim, winc_sim_socket_stats_t *out) {
+    *out = sim->socket.stats;
+}
@@ -0,0 +1,109 @@
+#ifndef WINC_SIM_SOCKET_H
+#define WINC_SIM_SOCKET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct winc_sim winc_sim_t;
+
+// Socket layer of the emulated firmware, the peer of m2m_ip_cb() in socket.c.
+// There is no network behind it: a connect or sendto picks one of the
+// in-simulator services by destination port, whatever the IP address.
+//  - echo     every byte sent comes back, UDP datagram boundaries are not kept
+//  - discard  bytes sent are acknowledged and dropped
+//  - chargen  recv() always has data, the RFC 864 line pattern
+// Any other port refuses the connection.
+#define WINC_SIM_SOCKET_PORT_ECHO    7
+#define WINC_SIM_SOCKET_PORT_DISCARD 9
+#define WINC_SIM_SOCKET_PORT_CHARGEN 19
+
+// Socket ids as allocated by the driver (TCP_SOCK_MAX + UDP_SOCK_MAX)
+#define WINC_SIM_SOCKET_MAX 11
+
+// Echo data a socket can hold before the host receives it
+#define WINC_SIM_SOCKET_RX_SIZE 2048
+
+// Largest payload per send or recv (SOCKET_BUFFER_MAX_LENGTH)
+#define WINC_SIM_SOCKET_MAX_DATA 1400
+
+// Network model. Zero latency and zero bandwidth (unlimited) answer every
+// request while the host is still in its SPI transaction.
+typedef struct {
+    uint32_t latency_us;     // Round trip to the services, added to connect and echo
+    uint32_t bandwidth_kbps; // Shared link rate for sent and generated data, 0 = unlimited
+} winc_sim_net_t;
+
+typedef struct {
+    uint32_t connects;       // Connections accepted
+    uint32_t refused;        // Connections to a port without a service
+    uint32_t tx_bytes;       // Bytes the host sent
+    uint32_t rx_bytes;       // Bytes delivered to the host
+    uint32_t tx_dropped;     // Echo bytes dropped, socket buffer full
+    uint32_t recv_timeouts;  // recv() calls that timed out
+    uint32_t unhandled;      // Requests of the IP group that are not emulated
+} winc_sim_socket_stats_t;
+
+// Address as it sits in the HIF messages
+typedef struct {
+    uint16_t family;
+    uint16_t port;      // Network byte order
+    uint32_t ip;
+} winc_sim_sockaddr_t;
+
+typedef struct {
+    bool used;
+    uint8_t service;
+    uint16_t session;
+    uint32_t gen;           // Bumped on close, deferred events check it
+    winc_sim_sockaddr_t peer;
+
+    // Echo data for the host, [rx_tail, rx_head) is queued and the first
+    // rx_ready bytes of it have made the round trip
+    uint8_t rx_ring[WINC_SIM_SOCKET_RX_SIZE];
+    uint32_t rx_head;
+    uint32_t rx_tail;
+    uint32_t rx_ready;
+
+    // Outstanding RECV or RECVFROM
+    bool recv_pending;
+    uint8_t recv_opcode;
+    uint16_t recv_len;
+    uint32_t recv_seq;
+
+    uint32_t chargen_pos;
+} winc_sim_sock_t;
+
+// Socket layer of one instance
+typedef struct {
+    winc_sim_sock_t sockets[WINC_SIM_SOCKET_MAX];
+    winc_sim_net_t net;
+    uint64_t link_free_us;  // When the shared link is done with earlier data
+    winc_sim_socket_stats_t stats;
+    uint8_t xfer_buf[WINC_SIM_SOCKET_MAX_DATA];
+} winc_sim_socket_t;
+
+/**
+ * @brief Reset all sockets and register the IP group handler
+ *
+ * Called by winc_sim_engine_init() after winc_sim_hif_init(). The network
+ * model starts from SIMULATOR_NET_LATENCY_US and SIMULATOR_NET_BANDWIDTH_KBPS.
+ */
+void winc_sim_socket_init(winc_sim_t *sim);
+
+// Change the network model, applies to requests received from now on
+void winc_sim_socket_set_net(winc_sim_t *sim, const winc_sim_net_t *net);
+
+/**
+ * @brief Data arrives from the network unasked
+ *
+ * Answers the outstanding recv of the lowest numbered socket that has one with
+ * len bytes of the chargen pattern (capped to its buffer), whatever service
+ * the socket is connected to. Used by the traffic generator.
+ *
+ * @return false if no socket is waiting in recv or no HIF buffer is free
+ */
+bool winc_sim_socket_inject(winc_sim_t *sim, uint16_t len);
+
+void winc_sim_socket_get_stats(const winc_sim_t *sim, winc_sim_socket_stats_t *stats);
+
+#endif // WINC_SIM_SOCKET_H
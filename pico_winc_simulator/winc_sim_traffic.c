@@ -0,0 +1,142 @@
+#include <string.h>
+#include "winc_sim_traffic.h"
+#include "winc_sim_engine.h"
+#include "winc_sim_hif.h"
+#include "winc_sim_sched.h"
+#include "winc_sim_socket.h"
+#include "winc_sim_wifi.h"
+#include "config/conf_simulator.h"
+#include "sim_log.h"
+
+// HIF buffers the generator leaves for the host's requests. Without them a
+// flood fills the pool and the host cannot even post the recv() that would
+// let it drain.
+#define RESERVED_BUFFERS 2
+
+// xorshift32
+static uint32_t next_random(winc_sim_traffic_t *t) {
+    t->rng ^= t->rng << 13;
+    t->rng ^= t->rng >> 17;
+    t->rng ^= t->rng << 5;
+    return t->rng;
+}
+
+static uint64_t tick_due(const winc_sim_traffic_t *t, uint64_t n) {
+    return t->start_us + n * t->cfg.burst * 1000000u / t->cfg.rate_hz;
+}
+
+static void check_stall(winc_sim_t *sim) {
+    winc_sim_traffic_t *t = &sim->traffic;
+    uint32_t waiting = winc_sim_hif_pending_us(sim);
+    if (waiting < t->cfg.stall_us) {
+        return;
+    }
+
+    winc_sim_hif_stats_t hif;
+    winc_sim_hif_get_stats(sim, &hif);
+    if (hif.irqs != t->stall_irq) {
+        t->stall_irq = hif.irqs;
+        t->stats.stalls++;
+        SIM_LOG(sim, SIM_EVENT_HOST_IRQ_PENDING, hif.irqs, waiting);
+    }
+}
+
+static void generate_one(winc_sim_t *sim) {
+    winc_sim_traffic_t *t = &sim->traffic;
+    bool recv = next_random(t) % 100u < t->cfg.recv_percent;
+    uint16_t len = t->cfg.min_size;
+    if (t->cfg.max_size > t->cfg.min_size) {
+        len += (uint16_t)(next_random(t) % (uint32_t)(t->cfg.max_size - t->cfg.min_size + 1));
+    }
+
+    if (winc_sim_hif_free_buffers(sim) <= RESERVED_BUFFERS) {
+        t->stats.dropped_full++;
+    } else if (!recv) {
+        if (winc_sim_wifi_send_time(sim)) t->stats.wifi_events++;
+        else t->stats.dropped_full++;
+    } else if (winc_sim_socket_inject(sim, len)) {
+        t->stats.recv_events++;
+        t->stats.recv_bytes += len;
+    } else {
+        t->stats.dropped_no_recv++;
+    }
+}
+
+static void traffic_tick(winc_sim_t *sim, uint32_t unused_a, uint32_t unused_b) {
+    winc_sim_traffic_t *t = &sim->traffic;
+    if (!t->running) return;
+
+    t->stats.ticks++;
+    check_stall(sim);
+    for (uint32_t i = 0; i < t->cfg.burst; i++) {
+        generate_one(sim);
+    }
+
+    uint64_t now = winc_sim_sched_now(sim);
+    if (t->cfg.duration_us && now - t->stats.started_us >= t->cfg.duration_us) {
+        t->running = false;
+        return;
+    }
+
+    // Behind by more than a tick: skip ahead instead of catching up in one
+    // go. The next tick is at least 1 us out so winc_sim_sched_run() returns.
+    uint64_t due = tick_due(t, ++t->tick_n);
+    if (due + (tick_due(t, 1) - t->start_us) < now) {
+        t->stats.late_ticks++;
+        t->start_us = now;
+        t->tick_n = 1;
+        due = tick_due(t, 1);
+        if (due <= now) due = now + 1;
+    }
+    winc_sim_sched_at(sim, due, traffic_tick, 0, 0);
+}
+
+void winc_sim_traffic_init(winc_sim_t *sim) {
+    memset(&sim->traffic, 0, sizeof(sim->traffic));
+}
+
+void winc_sim_traffic_start(winc_sim_t *sim, const winc_sim_traffic_cfg_t *c) {
+    static const winc_sim_traffic_cfg_t defaults = {
+        .rate_hz = SIMULATOR_TRAFFIC_RATE_HZ,
+        .burst = SIMULATOR_TRAFFIC_BURST,
+        .recv_percent = SIMULATOR_TRAFFIC_RECV_PERCENT,
+        .min_size = SIMULATOR_TRAFFIC_MIN_SIZE,
+        .max_size = SIMULATOR_TRAFFIC_MAX_SIZE,
+        .stall_us = SIMULATOR_TRAFFIC_STALL_US,
+        .duration_us = 0,
+        .seed = 1,
+    };
+    winc_sim_traffic_t *t = &sim->traffic;
+
+    winc_sim_traffic_stop(sim);
+    t->cfg = c ? *c : defaults;
+    if (t->cfg.rate_hz == 0) {
+        return;
+    }
+    if (t->cfg.burst == 0) t->cfg.burst = 1;
+    if (t->cfg.max_size < t->cfg.min_size) t->cfg.max_size = t->cfg.min_size;
+    if (t->cfg.stall_us == 0) t->cfg.stall_us = UINT32_MAX;
+    t->rng = t->cfg.seed ? t->cfg.seed : 1;
+
+    memset(&t->stats, 0, sizeof(t->stats));
+    t->start_us = winc_sim_sched_now(sim);
+    t->stats.started_us = t->start_us;
+    t->tick_n = 0;
+    t->stall_irq = 0;
+    t->running = true;
+    SIM_LOG(sim, SIM_EVENT_TRAFFIC_STARTED, t->cfg.rate_hz, t->cfg.burst);
+    winc_sim_sched_at(sim, t->start_us, traffic_tick, 0, 0);
+}
+
+void winc_sim_traffic_stop(winc_sim_t *sim) {
+    sim->traffic.running = false;
+    winc_sim_sched_cancel(sim, traffic_tick, 0);
+}
+
+bool winc_sim_traffic_running(const winc_sim_t *sim) {
+    return sim->traffic.running;
+}
+
+void winc_sim_traffic_get_stats(const winc_sim_t *sim, winc_sim_traffic_stats_t *out) {
+    *out = sim->traffic.stats;
+}
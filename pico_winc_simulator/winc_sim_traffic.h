@@ -0,0 +1,80 @@
+#ifndef WINC_SIM_TRAFFIC_H
+#define WINC_SIM_TRAFFIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct winc_sim winc_sim_t;
+
+// Traffic the host did not ask for, to stress the driver's receive path
+// (isr(), hif_handle_isr() and the u8Interrupt count in m2m_hif.c). Events
+// come in bursts at a fixed rate, each one either
+//  - socket data: answers the host's outstanding recv (winc_sim_socket_inject)
+//    with min_size..max_size bytes, as if a peer had sent them
+//  - a WIFI event: RESP_GET_SYS_TIME as after an SNTP update
+//    (winc_sim_wifi_send_time)
+// Every event is one HIF message and raises the IRQ line once. Events the
+// firmware cannot place, no recv posted or no HIF buffer free, are dropped
+// and counted, like a real chip dropping frames. Two buffers stay free for
+// the host's own requests.
+
+typedef struct {
+    uint32_t rate_hz;         // Events per second, 0 stops the generator
+    uint32_t burst;           // Events generated back to back per tick
+    uint32_t recv_percent;    // Share of socket data, the rest are WIFI events
+    uint16_t min_size;        // Socket data per event, picked uniformly
+    uint16_t max_size;
+    uint32_t stall_us;        // A message not taken this long counts as a lost interrupt
+    uint32_t duration_us;     // Stop by itself after this long, 0 runs until stopped
+    uint32_t seed;            // Mix and sizes come from a PRNG, same seed same sequence
+} winc_sim_traffic_cfg_t;
+
+typedef struct {
+    uint32_t ticks;           // Bursts run
+    uint32_t late_ticks;      // Ticks the generator fell behind on and skipped
+    uint32_t recv_events;     // Socket data delivered to the HIF queue
+    uint32_t wifi_events;     // WIFI events delivered to the HIF queue
+    uint32_t recv_bytes;
+    uint32_t dropped_no_recv; // Socket data with no recv posted by the host
+    uint32_t dropped_full;    // Events with no HIF buffer free
+    uint32_t stalls;          // Messages the host left waiting longer than stall_us
+    uint64_t started_us;
+} winc_sim_traffic_stats_t;
+
+// Generator of one instance
+typedef struct {
+    winc_sim_traffic_cfg_t cfg;
+    winc_sim_traffic_stats_t stats;
+    bool running;
+    uint32_t rng;
+
+    // Ticks are due at start_us + n * period, so the rate does not drift with
+    // the time each tick takes
+    uint64_t start_us;
+    uint64_t tick_n;
+    uint32_t stall_irq;     // Interrupt already counted as stalled
+} winc_sim_traffic_t;
+
+/**
+ * @brief Stop the generator and clear its statistics
+ *
+ * Called by winc_sim_engine_init(). The engine starts the generator with the
+ * SIMULATOR_TRAFFIC_* defaults when the host starts the firmware, if
+ * SIMULATOR_TRAFFIC_RATE_HZ is not 0.
+ */
+void winc_sim_traffic_init(winc_sim_t *sim);
+
+/**
+ * @brief Start or retune the generator
+ *
+ * @param cfg  NULL for the SIMULATOR_TRAFFIC_* defaults. A rate of 0 stops.
+ */
+void winc_sim_traffic_start(winc_sim_t *sim, const winc_sim_traffic_cfg_t *cfg);
+
+void winc_sim_traffic_stop(winc_sim_t *sim);
+
+bool winc_sim_traffic_running(const winc_sim_t *sim);
+
+void winc_sim_traffic_get_stats(const winc_sim_t *sim, winc_sim_traffic_stats_t *stats);
+
+#endif // WINC_SIM_TRAFFIC_H
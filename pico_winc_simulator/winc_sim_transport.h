@@ -0,0 +1,70 @@
+#ifndef WINC_SIM_TRANSPORT_H
+#define WINC_SIM_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Maximum number of segments in one payload chain
+#define WINC_SIM_MAX_SEGMENTS 128
+
+// Segment flags
+#define WINC_SIM_SEG_DISCARD  (1u << 0) // RX only: drop the bytes instead of storing them
+#define WINC_SIM_SEG_CRC_DATA (1u << 1) // Bytes are covered by the running data CRC16
+// CRC slot closing a packet, len 2. TX: the running CRC16 is sent high byte
+// first, addr is unused. RX: the host's two CRC bytes land in addr[0..1] and
+// the running CRC16 is stored high byte first in addr[2..3]. Either way the
+// running CRC16 is reseeded for the next packet.
+#define WINC_SIM_SEG_CRC16    (1u << 2)
+
+// One contiguous piece of a payload chain (prefix byte, data block or CRC slot)
+typedef struct {
+    uint8_t *addr;
+    uint32_t len;
+    uint32_t flags;
+} winc_sim_seg_t;
+
+/**
+ * @brief Byte-stream transport between the host's SPI master and the engine
+ *
+ * The engine in winc_sim_engine.c only talks to the bus through these
+ * operations, so it runs the same on the PIO/DMA slave (winc_simulator_app.c)
+ * and in-process on a workstation (winc_sim_loopback.c). One table can serve
+ * several simulator instances: every operation but the clocks gets the
+ * context the instance was initialised with.
+ *
+ * Completion is reported back asynchronously:
+ *  - a non-zero byte seen while hunting  -> winc_sim_engine_on_byte()
+ *  - read() has filled its buffer        -> winc_sim_engine_read_done()
+ *  - send_chain()/recv_chain() finished  -> winc_sim_engine_chain_done()
+ * None of these may be called from inside the transport operation itself.
+ * irq(), now_us(), timer() and cycles() are the exceptions: they never call
+ * back into the engine.
+ */
+typedef struct {
+    // Queue a short response for the host to clock out on MISO
+    void (*write)(void *ctx, const uint8_t *buf, size_t len);
+    // Receive exactly len bytes from MOSI into buf
+    void (*read)(void *ctx, uint8_t *buf, size_t len);
+    // Stream a list of segments out on MISO, the running CRC16 starts seeded
+    void (*send_chain)(void *ctx, const winc_sim_seg_t *segs, size_t count);
+    // Receive a list of segments from MOSI, the running CRC16 starts seeded
+    void (*recv_chain)(void *ctx, const winc_sim_seg_t *segs, size_t count);
+    // Skip zero bytes and deliver the next non-zero byte
+    void (*hunt)(void *ctx);
+    // Drive the interrupt line to the host (active low on the wire)
+    void (*irq)(void *ctx, bool asserted);
+    // Free-running microsecond clock for the modelled delays, shared by all
+    // instances
+    uint64_t (*now_us)(void);
+    // Call winc_sim_sched_run() once now_us() reaches due_us, replacing any
+    // earlier request
+    void (*timer)(void *ctx, uint64_t due_us);
+    // Fine-grained counter for the per-transaction latencies, counting up and
+    // wrapping at cycles_mask. NULL falls back to now_us().
+    uint32_t (*cycles)(void);
+    uint32_t cycles_per_us;
+    uint32_t cycles_mask;
+} winc_sim_transport_t;
+
+#endif // WINC_SIM_TRANSPORT_H
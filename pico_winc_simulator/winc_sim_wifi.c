@@ -0,0 +1,390 @@
+#include <string.h>
+#include "winc_sim_wifi.h"
+#include "winc_sim_engine.h"
+#include "winc_sim_hif.h"
+#include "winc_sim_memmap.h"
+#include "winc_sim_sched.h"
+#include "config/conf_simulator.h"
+#include "sim_log.h"
+
+#define SEC_OPEN    1 // M2M_WIFI_SEC_OPEN
+#define SEC_WPA_PSK 2 // M2M_WIFI_SEC_WPA_PSK
+
+#define WIFI_DISCONNECTED 0 // tenuM2mConnState
+#define WIFI_CONNECTED    1
+
+#define ERR_NONE      0 // tenuM2mConnChangedErrcode
+#define ERR_SCAN_FAIL 1 // No AP with that SSID
+#define ERR_AUTH_FAIL 3 // Wrong security type or passphrase
+
+#define CH_ALL    255 // M2M_WIFI_CH_ALL
+#define CH_COUNT  14
+
+#define SSID_MAX  32
+#define PSK_MAX   64
+
+#define REQ_DATA_PKT 0x80 // M2M_REQ_DATA_PKT
+
+// Request and reply layouts as they sit in the HIF buffers
+
+// tstrM2MScan. 19.6 and later number the channel from 1, older drivers from
+// 0; a single channel scan follows the newer numbering.
+typedef struct {
+    uint8_t channel;
+    uint8_t pad[3];
+} scan_cmd_t;
+
+typedef struct {
+    uint8_t num_aps;
+    int8_t state;
+    uint8_t pad[2];
+} scan_done_t;
+
+typedef struct {
+    uint8_t index;
+    uint8_t pad[3];
+} scan_result_cmd_t;
+
+typedef struct {
+    uint8_t index;
+    int8_t rssi;
+    uint8_t auth;
+    uint8_t channel;
+    uint8_t bssid[6];
+    char ssid[SSID_MAX + 1];
+    uint8_t pad;
+} scan_result_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t error;
+    uint8_t pad[2];
+} state_changed_t;
+
+// tstrM2mWifiConnect, channel numbered from 0
+typedef struct {
+    char psk[PSK_MAX + 1];
+    uint8_t sec_type;
+    uint8_t pad[2];
+    uint16_t channel;
+    char ssid[SSID_MAX + 1];
+    uint8_t no_save;
+    uint8_t pad2[4];
+} conn_legacy_cmd_t;
+
+// tstrM2mWifiConnHdr, channel numbered from 0. WPA PSK credentials follow
+// as a tstrM2mWifiPsk.
+typedef struct {
+    uint16_t cred_size;
+    uint8_t store_flags;
+    uint8_t channel;
+    uint8_t ssid_len;
+    char ssid[SSID_MAX];
+    uint8_t options;
+    uint8_t bssid[6];
+    uint8_t auth;
+    uint8_t rsv[3];
+} conn_hdr_t;
+
+typedef struct {
+    uint8_t len;
+    char passphrase[PSK_MAX];
+} conn_psk_t;
+
+// tstrM2MIPConfig of drivers from 19.6 on, which added the alternate DNS
+typedef struct {
+    uint8_t ip[4];
+    uint8_t gateway[4];
+    uint8_t dns[4];
+    uint8_t alt_dns[4];
+    uint8_t netmask[4];
+    uint32_t lease_s;
+} ip_config_t;
+
+// tstrM2MIPConfig of older drivers
+typedef struct {
+    uint8_t ip[4];
+    uint8_t gateway[4];
+    uint8_t dns[4];
+    uint8_t netmask[4];
+    uint32_t lease_s;
+} ip_config_legacy_t;
+
+// tstrSystemTime
+typedef struct {
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t pad;
+} sys_time_t;
+
+_Static_assert(sizeof(sys_time_t) == 8, "tstrSystemTime is 8 bytes");
+_Static_assert(sizeof(winc_sim_conn_info_t) == 48, "tstrM2MConnInfo is 48 bytes");
+_Static_assert(sizeof(scan_result_t) == 44, "tstrM2mWifiscanResult is 44 bytes");
+_Static_assert(sizeof(conn_legacy_cmd_t) == 108, "tstrM2mWifiConnect is 108 bytes");
+_Static_assert(sizeof(conn_hdr_t) == 48, "tstrM2mWifiConnHdr is 48 bytes");
+_Static_assert(sizeof(ip_config_t) == 24, "tstrM2MIPConfig is 24 bytes");
+_Static_assert(sizeof(ip_config_legacy_t) == 20, "Old tstrM2MIPConfig is 20 bytes");
+
+// Visible from the default position, the station's own AP last so a host
+// that walks the results one by one pays for all of them
+static const winc_sim_ap_t default_aps[] = {
+    { "neighbour",      {0x02, 0x00, 0x00, 0x00, 0x01, 0x01}, SEC_WPA_PSK, 1,  -71, "not-your-network" },
+    { "cafe-guest",     {0x02, 0x00, 0x00, 0x00, 0x01, 0x02}, SEC_OPEN,    11, -80, NULL },
+    { "printer-direct", {0x02, 0x00, 0x00, 0x00, 0x01, 0x03}, SEC_WPA_PSK, 3,  -63, "printer-pin" },
+    { SIMULATOR_WIFI_SSID, {0xf8, 0xf0, 0x05, 0x00, 0x00, 0x01}, SEC_WPA_PSK, 6, -40, SIMULATOR_WIFI_PASSPHRASE },
+};
+
+// Lease the emulated DHCP server hands out
+static const uint8_t lease_ip[4] = {192, 168, 1, 100};
+static const uint8_t lease_gateway[4] = {192, 168, 1, 1};
+static const uint8_t lease_netmask[4] = {255, 255, 255, 0};
+#define LEASE_TIME_S 86400
+
+static void send_state(winc_sim_t *sim, uint8_t state, uint8_t error) {
+    state_changed_t msg = { .state = state, .error = error };
+    winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_WIFI, WINC_SIM_WIFI_RESP_CON_STATE_CHANGED,
+                      &msg, sizeof(msg), NULL, 0, 0);
+}
+
+static void scan_done(winc_sim_t *sim, uint32_t channel, uint32_t unused) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    (void)unused;
+    w->scan_count = 0;
+    for (uint32_t i = 0; i < w->ap_count && w->scan_count < UINT8_MAX; i++) {
+        if (channel == CH_ALL || w->aps[i].channel == channel) {
+            w->scan_list[w->scan_count++] = (uint8_t)i;
+        }
+    }
+    w->scan_busy = false;
+    w->stats.scans++;
+
+    scan_done_t msg = { .num_aps = w->scan_count, .state = 0 };
+    winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_WIFI, WINC_SIM_WIFI_RESP_SCAN_DONE, &msg, sizeof(msg), NULL, 0, 0);
+}
+
+static void handle_scan(winc_sim_t *sim, uint32_t addr) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    scan_cmd_t cmd;
+    winc_sim_map_read(sim, addr, &cmd, sizeof(cmd));
+    if (w->scan_busy) return;
+
+    w->scan_busy = true;
+    uint32_t channels = (cmd.channel == CH_ALL) ? CH_COUNT : 1;
+    winc_sim_sched_after(sim, w->timing.scan_channel_us * channels, scan_done, cmd.channel, 0);
+}
+
+static void handle_scan_result(winc_sim_t *sim, uint32_t addr) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    scan_result_cmd_t cmd;
+    winc_sim_map_read(sim, addr, &cmd, sizeof(cmd));
+    if (cmd.index >= w->scan_count) return;
+
+    const winc_sim_ap_t *ap = &w->aps[w->scan_list[cmd.index]];
+    scan_result_t msg = {
+        .index = cmd.index,
+        .rssi = ap->rssi,
+        .auth = ap->auth,
+        .channel = ap->channel,
+    };
+    memcpy(msg.bssid, ap->bssid, sizeof(msg.bssid));
+    strncpy(msg.ssid, ap->ssid, SSID_MAX);
+    w->stats.scan_results++;
+    winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_WIFI, WINC_SIM_WIFI_RESP_SCAN_RESULT, &msg, sizeof(msg), NULL, 0, 0);
+}
+
+static void dhcp_done(winc_sim_t *sim, uint32_t unused_a, uint32_t unused_b) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    (void)unused_a;
+    (void)unused_b;
+    if (!w->station_connected) return;
+
+    w->station_has_ip = true;
+    w->stats.leases++;
+    if (w->station_legacy) {
+        ip_config_legacy_t msg = { .lease_s = LEASE_TIME_S };
+        memcpy(msg.ip, lease_ip, 4);
+        memcpy(msg.gateway, lease_gateway, 4);
+        memcpy(msg.dns, lease_gateway, 4);
+        memcpy(msg.netmask, lease_netmask, 4);
+        winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_WIFI, WINC_SIM_WIFI_REQ_DHCP_CONF, &msg, sizeof(msg), NULL, 0, 0);
+    } else {
+        ip_config_t msg = { .lease_s = LEASE_TIME_S };
+        memcpy(msg.ip, lease_ip, 4);
+        memcpy(msg.gateway, lease_gateway, 4);
+        memcpy(msg.dns, lease_gateway, 4);
+        memcpy(msg.netmask, lease_netmask, 4);
+        winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_WIFI, WINC_SIM_WIFI_REQ_DHCP_CONF, &msg, sizeof(msg), NULL, 0, 0);
+    }
+}
+
+static void connect_done(winc_sim_t *sim, uint32_t unused, uint32_t error) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    (void)unused;
+    if (error != ERR_NONE) {
+        w->station_ap = NULL;
+        w->stats.connect_failures++;
+        send_state(sim, WIFI_DISCONNECTED, (uint8_t)error);
+        return;
+    }
+
+    w->station_connected = true;
+    w->stats.connects++;
+    send_state(sim, WIFI_CONNECTED, ERR_NONE);
+    winc_sim_sched_after(sim, w->timing.dhcp_us, dhcp_done, 0, 0);
+}
+
+// Drop the current association and anything still pending for it
+static void station_reset(winc_sim_t *sim) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    winc_sim_sched_cancel(sim, connect_done, 0);
+    winc_sim_sched_cancel(sim, dhcp_done, 0);
+    w->station_ap = NULL;
+    w->station_connected = false;
+    w->station_has_ip = false;
+}
+
+// channel is numbered from 0 as both connect layouts carry it
+static void start_connect(winc_sim_t *sim, const char *ssid, uint32_t ssid_len, uint32_t channel, uint8_t auth,
+                          const char *passphrase, uint32_t passphrase_len, bool legacy) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    uint32_t error = ERR_SCAN_FAIL;
+
+    station_reset(sim);
+    w->station_legacy = legacy;
+    for (uint32_t i = 0; i < w->ap_count; i++) {
+        const winc_sim_ap_t *ap = &w->aps[i];
+        if (strlen(ap->ssid) != ssid_len || memcmp(ap->ssid, ssid, ssid_len) != 0) continue;
+        if (channel != CH_ALL && channel + 1 != ap->channel) continue;
+
+        error = ERR_AUTH_FAIL;
+        if (auth != ap->auth) continue;
+        if (auth == SEC_WPA_PSK &&
+            (strlen(ap->passphrase) != passphrase_len || memcmp(ap->passphrase, passphrase, passphrase_len) != 0)) {
+            continue;
+        }
+        w->station_ap = ap;
+        error = ERR_NONE;
+        break;
+    }
+    winc_sim_sched_after(sim, w->timing.connect_us, connect_done, 0, error);
+}
+
+static void handle_connect_legacy(winc_sim_t *sim, uint32_t addr) {
+    conn_legacy_cmd_t cmd;
+    winc_sim_map_read(sim, addr, &cmd, sizeof(cmd));
+    cmd.psk[PSK_MAX] = '\0';
+    cmd.ssid[SSID_MAX] = '\0';
+    start_connect(sim, cmd.ssid, strlen(cmd.ssid), cmd.channel, cmd.sec_type, cmd.psk, strlen(cmd.psk), true);
+}
+
+static void handle_connect(winc_sim_t *sim, uint32_t addr, uint16_t len) {
+    conn_hdr_t hdr;
+    conn_psk_t psk = { 0 };
+    winc_sim_map_read(sim, addr, &hdr, sizeof(hdr));
+    if (hdr.ssid_len > SSID_MAX) return;
+
+    if (hdr.auth == SEC_WPA_PSK && len >= sizeof(hdr) + sizeof(psk)) {
+        winc_sim_map_read(sim, addr + sizeof(hdr), &psk, sizeof(psk));
+        if (psk.len > PSK_MAX) psk.len = PSK_MAX;
+    }
+    start_connect(sim, hdr.ssid, hdr.ssid_len, hdr.channel, hdr.auth, psk.passphrase, psk.len, false);
+}
+
+static void handle_disconnect(winc_sim_t *sim) {
+    bool was_joining = sim->wifi.station_ap != NULL;
+    station_reset(sim);
+    if (was_joining) {
+        send_state(sim, WIFI_DISCONNECTED, ERR_NONE);
+    }
+}
+
+static void send_conn_info(winc_sim_t *sim) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    winc_sim_conn_info_t info = { 0 };
+    if (w->station_connected) {
+        strncpy(info.ssid, w->station_ap->ssid, SSID_MAX);
+        info.sec_type = w->station_ap->auth;
+        memcpy(info.mac_addr, w->station_ap->bssid, sizeof(info.mac_addr));
+        info.rssi = w->station_ap->rssi;
+        info.channel = w->station_ap->channel;
+        if (w->station_has_ip) {
+            memcpy(info.ip_addr, lease_ip, 4);
+        }
+    }
+    winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_WIFI, WINC_SIM_WIFI_RESP_CONN_INFO, &info, sizeof(info), NULL, 0, 0);
+}
+
+static void wifi_request(winc_sim_t *sim, uint8_t opcode, uint32_t addr, uint16_t len) {
+    switch (opcode & ~REQ_DATA_PKT) {
+        case WINC_SIM_WIFI_REQ_GET_CONN_INFO:
+            send_conn_info(sim);
+            break;
+        case WINC_SIM_WIFI_REQ_SCAN:
+            handle_scan(sim, addr);
+            break;
+        case WINC_SIM_WIFI_REQ_SCAN_RESULT:
+            handle_scan_result(sim, addr);
+            break;
+        case WINC_SIM_WIFI_REQ_CONNECT:
+            handle_connect_legacy(sim, addr);
+            break;
+        case WINC_SIM_WIFI_REQ_CONN:
+            handle_connect(sim, addr, len);
+            break;
+        case WINC_SIM_WIFI_REQ_DISCONNECT:
+            handle_disconnect(sim);
+            break;
+        default:
+            sim->wifi.stats.unhandled++;
+            SIM_LOG(sim, SIM_EVENT_UNHANDLED_WIFI, opcode, len);
+            break;
+    }
+}
+
+void winc_sim_wifi_init(winc_sim_t *sim) {
+    winc_sim_wifi_t *w = &sim->wifi;
+    memset(w, 0, sizeof(*w));
+    w->aps = default_aps;
+    w->ap_count = sizeof(default_aps) / sizeof(default_aps[0]);
+    w->timing.scan_channel_us = SIMULATOR_WIFI_SCAN_CHANNEL_US;
+    w->timing.connect_us = SIMULATOR_WIFI_CONNECT_US;
+    w->timing.dhcp_us = SIMULATOR_WIFI_DHCP_US;
+    winc_sim_hif_register(sim, WINC_SIM_HIF_GROUP_WIFI, wifi_request);
+}
+
+void winc_sim_wifi_set_aps(winc_sim_t *sim, const winc_sim_ap_t *table, uint8_t count) {
+    if (table == NULL) {
+        table = default_aps;
+        count = sizeof(default_aps) / sizeof(default_aps[0]);
+    }
+    sim->wifi.aps = table;
+    sim->wifi.ap_count = count;
+    sim->wifi.scan_count = 0;
+    station_reset(sim);
+}
+
+void winc_sim_wifi_set_timing(winc_sim_t *sim, const winc_sim_wifi_timing_t *t) {
+    sim->wifi.timing = *t;
+}
+
+bool winc_sim_wifi_send_time(winc_sim_t *sim) {
+    // Days only roll over within January, the host just needs a valid time
+    uint64_t s = winc_sim_sched_now(sim) / 1000000u;
+    sys_time_t t = {
+        .year = 2026,
+        .month = 1,
+        .day = (uint8_t)(1 + (s / 86400u) % 31u),
+        .hour = (uint8_t)((s / 3600u) % 24u),
+        .minute = (uint8_t)((s / 60u) % 60u),
+        .second = (uint8_t)(s % 60u),
+    };
+    return winc_sim_hif_send(sim, WINC_SIM_HIF_GROUP_WIFI, WINC_SIM_WIFI_RESP_GET_SYS_TIME, &t, sizeof(t), NULL, 0, 0);
+}
+
+void winc_sim_wifi_get_stats(const winc_sim_t *sim, winc_sim_wifi_stats_t *out) {
+    *out = sim->wifi.stats;
+}
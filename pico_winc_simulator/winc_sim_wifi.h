@@ -0,0 +1,116 @@
+#ifndef WINC_SIM_WIFI_H
+#define WINC_SIM_WIFI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct winc_sim winc_sim_t;
+
+// tenuM2mConfigCmd / tenuM2mStaCmd opcodes of the WIFI group handled so far
+#define WINC_SIM_WIFI_REQ_GET_CONN_INFO      5
+#define WINC_SIM_WIFI_RESP_CONN_INFO         6
+#define WINC_SIM_WIFI_REQ_SCAN               16
+#define WINC_SIM_WIFI_RESP_SCAN_DONE         17
+#define WINC_SIM_WIFI_REQ_SCAN_RESULT        18
+#define WINC_SIM_WIFI_RESP_SCAN_RESULT       19
+#define WINC_SIM_WIFI_REQ_CONNECT            40 // Drivers before 19.6, tstrM2mWifiConnect
+#define WINC_SIM_WIFI_REQ_DISCONNECT         43
+#define WINC_SIM_WIFI_RESP_CON_STATE_CHANGED 44
+#define WINC_SIM_WIFI_REQ_DHCP_CONF          50
+#define WINC_SIM_WIFI_REQ_CONN               59 // 19.6 and later, tstrM2mWifiConnHdr
+#define WINC_SIM_WIFI_RESP_GET_SYS_TIME      27 // Also sent unasked once SNTP has synced
+
+// tstrM2MConnInfo as the driver expects it on the wire
+typedef struct {
+    char ssid[33];
+    uint8_t sec_type;
+    uint8_t ip_addr[4];
+    uint8_t mac_addr[6];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t pad[2];
+} winc_sim_conn_info_t;
+
+// One access point the emulated radio can see. Scans report the table in
+// order, so the position of an AP decides how many results the host walks
+// before it finds it.
+typedef struct {
+    const char *ssid;
+    uint8_t bssid[6];
+    uint8_t auth;            // tenuM2mSecType: 1 open, 2 WPA PSK
+    uint8_t channel;         // 1 to 14
+    int8_t rssi;
+    const char *passphrase;  // WPA PSK passphrase, NULL for open APs
+} winc_sim_ap_t;
+
+// Air time model. All zero answers every request while the host is still in
+// its SPI transaction.
+typedef struct {
+    uint32_t scan_channel_us; // Dwell per scanned channel, a full scan covers 14
+    uint32_t connect_us;      // Connect request to CON_STATE_CHANGED
+    uint32_t dhcp_us;         // Connected to REQ_DHCP_CONF
+} winc_sim_wifi_timing_t;
+
+typedef struct {
+    uint32_t scans;            // Scans completed
+    uint32_t scan_results;     // Results delivered to the host
+    uint32_t connects;         // Associations
+    uint32_t connect_failures; // Connects to an unknown SSID or with the wrong passphrase
+    uint32_t leases;           // DHCP leases handed out
+    uint32_t unhandled;        // Requests of the WIFI group that are not emulated
+} winc_sim_wifi_stats_t;
+
+// Radio and station of one instance
+typedef struct {
+    const winc_sim_ap_t *aps;
+    uint8_t ap_count;
+    winc_sim_wifi_timing_t timing;
+    winc_sim_wifi_stats_t stats;
+
+    // Results of the last completed scan, as indices into aps
+    uint8_t scan_list[UINT8_MAX];
+    uint8_t scan_count;
+    bool scan_busy;
+
+    // Station: the AP being joined or joined, and which tstrM2MIPConfig
+    // layout the driver that asked expects
+    const winc_sim_ap_t *station_ap;
+    bool station_connected;
+    bool station_has_ip;
+    bool station_legacy;
+} winc_sim_wifi_t;
+
+/**
+ * @brief Reset the station and register the WIFI group handler
+ *
+ * Called by winc_sim_engine_init() after winc_sim_hif_init(). The AP table
+ * starts with SIMULATOR_WIFI_SSID among a few neighbours, the timing from
+ * the SIMULATOR_WIFI_*_US defaults.
+ */
+void winc_sim_wifi_init(winc_sim_t *sim);
+
+/**
+ * @brief Replace the AP table
+ *
+ * The table is not copied and must stay valid. NULL restores the default.
+ * Forgets the last scan and drops the station's association without telling
+ * the host.
+ */
+void winc_sim_wifi_set_aps(winc_sim_t *sim, const winc_sim_ap_t *aps, uint8_t count);
+
+// Change the air time model, applies to requests received from now on
+void winc_sim_wifi_set_timing(winc_sim_t *sim, const winc_sim_wifi_timing_t *timing);
+
+/**
+ * @brief Send the host a RESP_GET_SYS_TIME it did not ask for
+ *
+ * What the firmware does after each SNTP update. The time counts up from
+ * 2026-01-01 with the transport's clock. Used by the traffic generator.
+ *
+ * @return false if no HIF buffer is free
+ */
+bool winc_sim_wifi_send_time(winc_sim_t *sim);
+
+void winc_sim_wifi_get_stats(const winc_sim_t *sim, winc_sim_wifi_stats_t *stats);
+
+#endif // WINC_SIM_WIFI_H
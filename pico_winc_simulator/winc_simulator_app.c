@@ -4,418 +4,279 @@
 #include "hardware/clocks.h" // Added for set_sys_clock_khz
 #include "hardware/irq.h"
 #include "hardware/sync.h"
-#include "winc1500_registers.h"
+#include "hardware/structs/systick.h"
 #include "winc_simulator_app.h"
 #include "pio_spi.h"
 #include "winc_dma.h"
-
-#define MAX_SPI_PACKET_SIZE 8192
-
-
-// Global WINC memory simulation
-uint8_t winc_memory[WINC_MEM_SIZE];
-uint8_t clockless_regs[256];
-uint8_t periph_regs[4096];
-uint8_t spi_regs[256];
-uint8_t bootrom_regs[256];
-
-// CRC state
-bool crc_off = false;
-bool reset_triggered = false;
-
-// Function to get a pointer to the correct memory location, with OOB checks
-uint8_t* get_memory_ptr(uint32_t addr, uint32_t size) {
-    if ((addr + size) <= 0x100) { // clockless_regs
-        return &clockless_regs[addr];
-    } else if (addr >= 0x1000 && (addr + size) <= 0x2000) { // periph_regs
-        return &periph_regs[addr - 0x1000];
-    } else if (addr >= 0xe800 && (addr + size) <= 0xe900) { // spi_regs
-        return &spi_regs[addr - 0xe800];
-    } else if (addr >= 0xc0000 && (addr + size) <= 0xc0100) { // bootrom_regs
-        return &bootrom_regs[addr - 0xc0000];
-    } else if ((addr + size) <= WINC_MEM_SIZE) { // winc_memory
-        return &winc_memory[addr];
-    }
-    SIM_LOG(SIM_LOG_TYPE_COMMAND, "OOB unknown region", addr, size);
-    return NULL;
+#include "winc_sim_sched.h"
+#include "winc_sim_latency.h"
+#include "winc_sim_cpu.h"
+#include "config/conf_simulator.h"
+
+#define SYS_CLOCK_KHZ 125000
+
+// PIO/DMA transport for the command engine in winc_sim_engine.c.
+// The RX IRQ is only enabled while the engine hunts for a non-zero byte,
+// every other transfer is done by DMA with the IRQ disabled.
+//
+// Each instance has its own PIO block, DMA channels and IRQ pin; the
+// transport's ctx is the sim_instance_t.
+
+typedef struct {
+    winc_sim_t sim;
+    pio_spi_t spi;
+    winc_dma_t dma;
+    uint irq_pin;
+    alarm_id_t sched_alarm;
+#if SIMULATOR_CAPTURE_ENABLE
+    spi_capture_t capture;
+#endif
+} sim_instance_t;
+
+static sim_instance_t instances[SIMULATOR_INSTANCES];
+
+// The counters of this core, shared by all instances
+static winc_sim_cpu_t cpu;
+
+static void pio_transport_write(void *ctx, const uint8_t *buf, size_t len) {
+    sim_instance_t *inst = ctx;
+    pio_spi_write_blocking(&inst->spi, (uint8_t *)buf, len);
 }
 
-
-// Function to write 2 dummy CRC bytes if CRC is not off (used for read responses)
-void spi_write_dummy_crc_if_needed_on_read() {
-    if (!crc_off) {
-        uint8_t dummy_crc[2] = {0};
-        pio_spi_write_blocking(dummy_crc, 2);
-    }
+static void pio_read_complete_callback(void *ctx) {
+    sim_instance_t *inst = ctx;
+    winc_sim_engine_read_done(&inst->sim);
 }
 
-// Function to read and discard 2 dummy CRC bytes if CRC is not off (used for write commands)
-void spi_read_dummy_crc_if_needed_on_write() {
-    if (!crc_off) {
-        uint8_t dummy_crc[2] = {0};
-        pio_spi_read_blocking(dummy_crc, 2);
-    }
+static void pio_transport_read(void *ctx, uint8_t *buf, size_t len) {
+    sim_instance_t *inst = ctx;
+    // Disable RX IRQ to prevent re-entry during DMA
+    pio_spi_set_rx_irq_enabled(&inst->spi, false);
+    winc_dma_read(&inst->dma, buf, len);
 }
 
-// Function to send data with CRC (if CRC is not off)
-void spi_send_data_with_crc(uint8_t *data, uint32_t size) {
-    pio_spi_write_blocking(data, size);
-    spi_write_dummy_crc_if_needed_on_read();
+static void pio_chain_complete_callback(void *ctx) {
+    sim_instance_t *inst = ctx;
+    // Dummy bytes clocked in while the chain ran must not look like a command
+    pio_spi_drain_rx_fifo(&inst->spi);
+    winc_sim_engine_chain_done(&inst->sim);
 }
 
-// Function to receive data with CRC (if CRC is not off)
-void spi_receive_data_and_crc(uint8_t *data, uint32_t size) {
-    pio_spi_read_blocking(data, size);
-    spi_read_dummy_crc_if_needed_on_write();
+static void pio_transport_send_chain(void *ctx, const winc_sim_seg_t *segs, size_t count) {
+    sim_instance_t *inst = ctx;
+    pio_spi_set_rx_irq_enabled(&inst->spi, false);
+    winc_dma_send_chain(&inst->dma, segs, count, pio_chain_complete_callback);
 }
 
-static uint8_t cmd_buf[16];
-
-void winc_process_command() {
-    uint8_t command = cmd_buf[0];
-    uint8_t response_buf[5]; // Buffer for command echo + 4 bytes data/status
-
-    response_buf[0] = command; // Prepend command to response buffer
-
-    switch(command) {
-        case CMD_SINGLE_READ: {
-            // Address and CRC already read into cmd_buf[1]...
-            uint32_t addr = (cmd_buf[1] << 16) | (cmd_buf[2] << 8) | cmd_buf[3];
-            uint8_t *mem_ptr = get_memory_ptr(addr, 4);
-
-            if (mem_ptr == NULL) {
-                response_buf[1] = 0xFF; // Respond with status byte (error)
-                pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-                break;
-            }
-
-            if (addr == NMI_STATE_REG && reset_triggered) {
-                uint32_t state_reg = 0x02532636;
-                // Send command echo, status byte, and 0xF3 prefix
-                uint8_t single_read_prefix[3] = {command, 0x00, 0xF3};
-                pio_spi_write_blocking(single_read_prefix, 3);
-                // Send data
-                spi_send_data_with_crc((uint8_t*)&state_reg, 4);
-                SIM_LOG(SIM_LOG_TYPE_COMMAND, "SINGLE_READ (reset)", addr, state_reg);
-                reset_triggered = false; // Clear the flag
-                break;
-            }
+static void pio_transport_recv_chain(void *ctx, const winc_sim_seg_t *segs, size_t count) {
+    sim_instance_t *inst = ctx;
+    pio_spi_set_rx_irq_enabled(&inst->spi, false);
+    winc_dma_recv_chain(&inst->dma, segs, count, pio_chain_complete_callback);
+}
 
-            // Send command echo, status byte, and 0xF3 prefix
-            uint8_t single_read_prefix[3] = {command, 0x00, 0xF3};
-            pio_spi_write_blocking(single_read_prefix, 3);
+static void pio_transport_hunt(void *ctx) {
+    sim_instance_t *inst = ctx;
+    pio_spi_set_rx_irq_enabled(&inst->spi, true);
+}
 
-            // Send data
-            spi_send_data_with_crc(mem_ptr, 4);
+// IRQN is active low, the pins are set up by winc_simulator_app_main()
+static void pio_transport_irq(void *ctx, bool asserted) {
+    sim_instance_t *inst = ctx;
+    gpio_put(inst->irq_pin, !asserted);
+}
 
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, "SINGLE_READ", addr, *(uint32_t*)(mem_ptr));
-            break;
-        }
-        case CMD_SINGLE_WRITE: {
-            // Data is in cmd_buf[4]...[7]
-            uint32_t addr = (cmd_buf[1] << 16) | (cmd_buf[2] << 8) | cmd_buf[3];
-            uint32_t data_val = (cmd_buf[4] << 24) | (cmd_buf[5] << 16) | (cmd_buf[6] << 8) | cmd_buf[7];
-
-            if (addr == CHIPID) {
-                SIM_LOG(SIM_LOG_TYPE_COMMAND, "Software Reset", 0, 0);
-                reset_triggered = true;
-                // Don't actually write to CHIPID
-                response_buf[1] = 0x00; // Respond with status byte (0x00 for success)
-                pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-                break;
-            }
-            
-            uint8_t *mem_ptr = get_memory_ptr(addr, 4);
-            if(mem_ptr == NULL) {
-                response_buf[1] = 0xFF; // Respond with status byte (error)
-                pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-                break;
-            }
-            
-            memcpy(mem_ptr, &data_val, 4);
+static uint64_t pio_transport_now_us(void) {
+    return time_us_64();
+}
 
-            response_buf[1] = 0x00; // Respond with status byte (0x00 for success)
-            pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, "SINGLE_WRITE", addr, data_val);
-            break;
-        }
-        case CMD_INTERNAL_READ: {
-            // Address in cmd_buf[1]..[2]
-            uint32_t addr = (cmd_buf[1] << 8) | cmd_buf[2];
-            if(cmd_buf[1] & 0x80) addr &= ~0x8000;
-
-            uint8_t *mem_ptr = get_memory_ptr(addr, 4);
-            if(mem_ptr == NULL) {
-                response_buf[1] = 0xFF; // Respond with status byte (error)
-                pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-                break;
-            }
+// SysTick of this core at the system clock. It is 24 bits wide and counts
+// down, so it wraps every 134 ms; no transaction takes that long.
+static uint32_t pio_transport_cycles(void) {
+    return 0x00FFFFFFu - systick_hw->cvr;
+}
 
-            // Send command echo, status byte, and 0xF3 prefix
-            uint8_t internal_read_prefix[3] = {command, 0x00, 0xF3};
-            pio_spi_write_blocking(internal_read_prefix, 3);
+// Alarm pool created on this core, so the scheduler runs at the same IRQ
+// priority and on the same core as the PIO and DMA handlers and never
+// preempts the engine. One alarm per instance.
+static alarm_pool_t *sched_pool;
+
+static int64_t sched_alarm_callback(alarm_id_t id, void *user_data) {
+    sim_instance_t *inst = user_data;
+    winc_sim_cpu_enter(&cpu, WINC_SIM_CPU_TIMER);
+    inst->sched_alarm = 0;
+    winc_sim_sched_run(&inst->sim);
+    winc_sim_cpu_exit(&cpu);
+    return 0;
+}
 
-            // Send data
-            spi_send_data_with_crc(mem_ptr, 4);
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, "INTERNAL_READ", addr, *(uint32_t*)(mem_ptr));
-            break;
-        }
-        case CMD_INTERNAL_WRITE: {
-            // Address cmd_buf[1]..[2], Data cmd_buf[3]..[6]
-            uint32_t addr = (cmd_buf[1] << 8) | (cmd_buf[2]);
-            if(cmd_buf[1] & 0x80) addr &= ~0x8000;
-            uint32_t data_val = (cmd_buf[3] << 24) | (cmd_buf[4] << 16) | (cmd_buf[5] << 8) | cmd_buf[6];
-
-            if (addr == NMI_SPI_PROTOCOL_CONFIG) {
-                if ((data_val & 0xc) == 0) {
-                    crc_off = true;
-                    SIM_LOG(SIM_LOG_TYPE_COMMAND, "CRC turned off", 0, 0);
-                }
-            }
-            
-            uint8_t *mem_ptr = get_memory_ptr(addr, 4);
-            if(mem_ptr == NULL) {
-                response_buf[1] = 0xFF; // Respond with status byte (error)
-                pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-                break;
-            }
-            
-            memcpy(mem_ptr, &data_val, 4);
-            response_buf[1] = 0x00; // Respond with status byte (0x00 for success)
-            pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, "INTERNAL_WRITE", addr, data_val);
-            break;
-        }
-        case CMD_DMA_READ:
-        case CMD_DMA_EXT_READ: {
-            uint32_t addr = (cmd_buf[1] << 16) | (cmd_buf[2] << 8) | cmd_buf[3];
-            uint32_t total_size;
-            if (command == CMD_DMA_READ) {
-                total_size = (cmd_buf[4] << 8) | cmd_buf[5];
-            } else { // CMD_DMA_EXT_READ
-                total_size = (cmd_buf[4] << 16) | (cmd_buf[5] << 8) | cmd_buf[6];
-            }
+static void pio_transport_timer(void *ctx, uint64_t due_us) {
+    sim_instance_t *inst = ctx;
+    if (inst->sched_alarm > 0) {
+        alarm_pool_cancel_alarm(sched_pool, inst->sched_alarm);
+    }
+    inst->sched_alarm = alarm_pool_add_alarm_at(sched_pool, from_us_since_boot(due_us),
+                                                sched_alarm_callback, inst, true);
+}
 
-            uint8_t *mem_ptr = get_memory_ptr(addr, total_size);
-            if(mem_ptr == NULL) {
-                response_buf[1] = 0xFF; // Respond with status byte (error)
-                pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-                SIM_LOG(SIM_LOG_TYPE_COMMAND, "OOB DMA read", addr, total_size);
-                break;
-            }
+static const winc_sim_transport_t pio_transport = {
+    .write = pio_transport_write,
+    .read = pio_transport_read,
+    .send_chain = pio_transport_send_chain,
+    .recv_chain = pio_transport_recv_chain,
+    .hunt = pio_transport_hunt,
+    .irq = pio_transport_irq,
+    .now_us = pio_transport_now_us,
+    .timer = pio_transport_timer,
+    .cycles = pio_transport_cycles,
+    .cycles_per_us = SYS_CLOCK_KHZ / 1000,
+    .cycles_mask = 0x00FFFFFFu,
+};
+
+static void spi_interrupt(sim_instance_t *inst) {
+    winc_sim_cpu_enter(&cpu, WINC_SIM_CPU_PIO_ISR);
+    uint8_t byte = pio_spi_get_non_zero_byte(&inst->spi);
+    if (byte != 0) { // Zero: host might be still reading the response
+        winc_sim_engine_on_byte(&inst->sim, byte);
+    }
+    winc_sim_cpu_exit(&cpu);
+}
 
-            // Send command echo and status byte
-            response_buf[1] = 0x00;
-            pio_spi_write_blocking(response_buf, 2);
-
-            uint32_t remaining_size = total_size;
-            uint32_t bytes_read = 0;
-
-            while (remaining_size > 0) {
-                uint32_t chunk_size = (remaining_size > MAX_SPI_PACKET_SIZE) ? MAX_SPI_PACKET_SIZE : remaining_size;
-                
-                uint8_t prefix_byte = remaining_size <= MAX_SPI_PACKET_SIZE ? 0xF3 : bytes_read ? 0xF2 : 0xF1;
-                pio_spi_write_blocking(&prefix_byte, 1);
-                
-                // Send data from memory
-                spi_send_data_with_crc(mem_ptr + bytes_read, chunk_size);
-                
-                remaining_size -= chunk_size;
-                bytes_read += chunk_size;
-            }
+// The PIO IRQ handlers take no argument, one per PIO block
+static void pio0_interrupt_handler(void) {
+    spi_interrupt(&instances[0]);
+}
 
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, (command == CMD_DMA_READ) ? "DMA_READ" : "DMA_EXT_READ", addr, total_size);
-            break;
-        }
-        case CMD_DMA_WRITE:
-        case CMD_DMA_EXT_WRITE: {
-            uint32_t addr = (cmd_buf[1] << 16) | (cmd_buf[2] << 8) | cmd_buf[3];
-            uint32_t total_size;
-            if (command == CMD_DMA_WRITE) {
-                total_size = (cmd_buf[4] << 8) | cmd_buf[5];
-            } else { // CMD_DMA_EXT_WRITE
-                total_size = (cmd_buf[4] << 16) | (cmd_buf[5] << 8) | cmd_buf[6];
-            }
+#if SIMULATOR_INSTANCES > 1
+static void pio1_interrupt_handler(void) {
+    spi_interrupt(&instances[1]);
+}
+#endif
+
+static void instance_init(sim_instance_t *inst, uint8_t id, PIO pio, uint mosi_pin, uint miso_pin,
+                          uint irq_pin, irq_handler_t handler) {
+    inst->irq_pin = irq_pin;
+    inst->sched_alarm = 0;
+    gpio_init(irq_pin);
+    gpio_put(irq_pin, 1);
+    gpio_set_dir(irq_pin, GPIO_OUT);
+
+    winc_sim_engine_init(&inst->sim, id, &pio_transport, inst);
+    inst->sim.cpu = &cpu;
+#if SIMULATOR_CAPTURE_ENABLE
+    spi_capture_init(&inst->capture, pio_transport_now_us, SPI_CAPTURE_STREAM_SIM(id));
+    inst->sim.capture = &inst->capture;
+#endif
+
+    winc_dma_init(&inst->dma, &inst->spi, &cpu, pio_read_complete_callback, inst);
+    pio_spi_slave_init(&inst->spi, pio, mosi_pin, miso_pin, handler);
+}
 
-            uint32_t remaining_size = total_size;
-            uint32_t bytes_written = 0;
-            bool oob_error = false;
-
-            while (remaining_size > 0) {
-                uint8_t prefix_byte;
-                do {
-                    pio_spi_read_blocking(&prefix_byte, 1);
-                } while (prefix_byte == 0);
-
-                if ((prefix_byte & 0xF0) != 0xF0) {
-                    SIM_LOG(SIM_LOG_TYPE_COMMAND, "Unexpected DMA prefix", prefix_byte, 0);
-                }
-
-                uint32_t chunk_size = (remaining_size > MAX_SPI_PACKET_SIZE) ? MAX_SPI_PACKET_SIZE : remaining_size;
-
-                uint8_t* mem_ptr = get_memory_ptr(addr + bytes_written, chunk_size);
-                if (mem_ptr == NULL || oob_error) {
-                    if (!oob_error) { // Log only on the first OOB occurrence
-                        SIM_LOG(SIM_LOG_TYPE_COMMAND, "OOB DMA write", addr + bytes_written, chunk_size);
-                        oob_error = true;
-                    }
-                    // Discard the chunk
-                    uint8_t dummy_buf[256];
-                    uint32_t discard_remaining = chunk_size;
-                    while(discard_remaining > 0) {
-                        uint32_t read_size = (discard_remaining > sizeof(dummy_buf)) ? sizeof(dummy_buf) : discard_remaining;
-                        pio_spi_read_blocking(dummy_buf, read_size);
-                        discard_remaining -= read_size;
-                    }
-                } else {
-                    // Read data into memory
-                    pio_spi_read_blocking(mem_ptr, chunk_size);
-                }
-
-                // After every chunk, there is a CRC
-                spi_read_dummy_crc_if_needed_on_write();
-                
-                remaining_size -= chunk_size;
-                bytes_written += chunk_size;
-            }
+#define LOG_PROCESS_INTERVAL 100 // Process log queue every 100 transactions
 
-            // After the loop, send the response
-            if (oob_error) {
-                response_buf[1] = 0xFF; // Error
-            } else {
-                response_buf[1] = 0x00; // Success
-            }
-            pio_spi_write_blocking(response_buf, 2);
+// Wakes the main loop at least once per SysTick wrap, so no interval the
+// CPU accounting measures is longer than the counter
+#define CPU_TICK_MS 100
 
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, (command == CMD_DMA_WRITE) ? "DMA_WRITE" : "DMA_EXT_WRITE", addr, total_size);
-            break;
-        }
-        case CMD_RESET: {
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, "CMD_RESET", 0, 0);
-            response_buf[1] = 0x00; // Respond with status byte (0x00 for success)
-            pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-            break;
-        }
-        default: {
-            // Consume remaining bytes if any were expected but not read
-            // Actually for unknown command we don't know length, so we assume 0 additional bytes
-            // But in original code we read 8 bytes dummy.
-            // Since we are here after reading just the command byte, we might want to read dummy bytes?
-            // But we can't really know how many.
-            // Let's just send error response.
-            response_buf[1] = 0xFF; // Error status
-            pio_spi_write_blocking(response_buf, 2); // Write command + 1 byte status
-            SIM_LOG(SIM_LOG_TYPE_COMMAND, "Unknown Command", command, 0);
-            break;
-        }
-    }
-}
+static repeating_timer_t cpu_timer;
+static volatile uint32_t cpu_ticks;
 
-void winc_dma_complete_callback(void) {
-    winc_process_command();
-    // Re-enable RX IRQ
-    pio_spi_set_rx_irq_enabled(true);
+static bool cpu_timer_callback(repeating_timer_t *timer) {
+    winc_sim_cpu_enter(&cpu, WINC_SIM_CPU_TIMER);
+    cpu_ticks++;
+    winc_sim_cpu_exit(&cpu);
+    return true;
 }
 
-void winc_spi_interrupt_handler(void) {
-    uint8_t command = pio_spi_get_non_zero_byte();
-    if (command == 0) return; // Host might be still reading the response
-
-    cmd_buf[0] = command;
-    size_t bytes_to_read = 0;
-    bool has_crc = true;
-
-    switch(command) {
-        case CMD_SINGLE_READ:
-            bytes_to_read = 3;
-            break;
-        case CMD_SINGLE_WRITE:
-            bytes_to_read = 7;
-            break;
-        case CMD_INTERNAL_READ:
-            bytes_to_read = 3;
-            break;
-        case CMD_INTERNAL_WRITE:
-            bytes_to_read = 6;
-            break;
-        case CMD_DMA_READ:
-        case CMD_DMA_WRITE:
-            bytes_to_read = 5;
-            break;
-        case CMD_DMA_EXT_READ:
-        case CMD_DMA_EXT_WRITE:
-            bytes_to_read = 6;
-            break;
-        case CMD_RESET:
-            bytes_to_read = 0;
-            has_crc = false;
-            break;
-        default:
-            // Unknown command, maybe read some dummy bytes?
-            // Original code read 8 bytes.
-            bytes_to_read = 8;
-            has_crc = false;
-            break;
-    }
-
-    if (has_crc && !crc_off) {
-        bytes_to_read++;
-    }
+static void cpu_report(winc_sim_cpu_stats_t *prev) {
+    winc_sim_cpu_stats_t cur;
+    uint32_t irq = save_and_disable_interrupts();
+    winc_sim_cpu_get_stats(&cpu, &cur);
+    restore_interrupts(irq);
 
-    if (bytes_to_read > 0) {
-        // Disable RX IRQ to prevent re-entry during DMA
-        pio_spi_set_rx_irq_enabled(false);
-        winc_dma_read(cmd_buf + 1, bytes_to_read);
-    } else {
-        // No more bytes to read, process immediately
-        winc_process_command();
-    }
+    winc_sim_cpu_print(&cur, prev);
+    *prev = cur;
 }
 
+int winc_simulator_app_main() {
+    set_sys_clock_khz(SYS_CLOCK_KHZ, true); // Set system clock to 125 MHz
+    stdio_init_all();
 
+    systick_hw->rvr = 0x00FFFFFFu;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5; // Enabled, processor clock, no interrupt
 
-#define LOG_PROCESS_INTERVAL 100 // Process log queue every 100 transactions
+    winc_sim_cpu_init(&cpu, &pio_transport);
+    sched_pool = alarm_pool_create(SIMULATOR_ALARM_NUM, WINC_SIM_SCHED_MAX_EVENTS * SIMULATOR_INSTANCES);
 
-int winc_simulator_app_main() {
-    set_sys_clock_khz(125000, true); // Set system clock to 125 MHz
-    stdio_init_all();
+    // Instance 0 traces as plain "[SIMULATOR]", so a single one looks as before
+    instance_init(&instances[0], 0, pio0, MOSI_PIN, MISO_PIN, IRQ_PIN, pio0_interrupt_handler);
+#if SIMULATOR_INSTANCES > 1
+    instance_init(&instances[1], 1, pio1, SIM2_MOSI_PIN, SIM2_MISO_PIN, SIM2_IRQ_PIN, pio1_interrupt_handler);
+#endif
 
-    // Initialize the memory space
-    memset(winc_memory, 0, WINC_MEM_SIZE);
-    memset(clockless_regs, 0, sizeof(clockless_regs));
-    memset(periph_regs, 0, sizeof(periph_regs));
-    memset(spi_regs, 0, sizeof(spi_regs));
-    memset(bootrom_regs, 0, sizeof(bootrom_regs));
-
-    // Pre-populate some read-only registers with default values
-    uint32_t chip_id = 0x1002b0;
-    memcpy(get_memory_ptr(CHIPID, 4), &chip_id, sizeof(chip_id));
-    uint32_t rev_id = 0x4;
-    memcpy(get_memory_ptr(0x13f4, 4), &rev_id, sizeof(rev_id));
-    uint32_t proto_conf = 0x2E;
-    memcpy(get_memory_ptr(NMI_SPI_PROTOCOL_CONFIG, 4), &proto_conf, sizeof(proto_conf));
-    uint32_t state_reg = 0x02532636;
-    memcpy(get_memory_ptr(NMI_STATE_REG, 4), &state_reg, sizeof(state_reg));
-    uint32_t wait_for_host = 0x3f00;
-    memcpy(get_memory_ptr(M2M_WAIT_FOR_HOST_REG, 4), &wait_for_host, sizeof(wait_for_host));
-    uint32_t reg_1014 = 0x807c082d;
-    memcpy(get_memory_ptr(0x1014, 4), &reg_1014, sizeof(reg_1014));
-    uint32_t bootrom_reg = 0x10add09e;
-    memcpy(get_memory_ptr(BOOTROM_REG, 4), &bootrom_reg, sizeof(bootrom_reg));
-    uint32_t pin_mux_0 = 0x31111044;
-    memcpy(get_memory_ptr(NMI_PIN_MUX_0, 4), &pin_mux_0, sizeof(pin_mux_0));
-    uint32_t rev_reg = 0x1330134a;
-    memcpy(get_memory_ptr(NMI_REV_REG, 4), &rev_reg, sizeof(rev_reg));
-
-    winc_dma_init(winc_dma_complete_callback);
-    pio_spi_slave_init(winc_spi_interrupt_handler);
-
-    printf("Pico WINC1500 Simulator Initialized. Waiting for SPI commands.\n");
+    alarm_pool_add_repeating_timer_ms(sched_pool, CPU_TICK_MS, cpu_timer_callback, NULL, &cpu_timer);
+
+    printf("Pico WINC1500 Simulator Initialized, %d instance(s). Waiting for SPI commands.\n", SIMULATOR_INSTANCES);
 
     // We will now be interrupt driven. The main loop can just sleep.
+    uint32_t pages_reported[SIMULATOR_INSTANCES] = {0};
+    winc_sim_cpu_stats_t cpu_reported = {0};
+#if SIMULATOR_CPU_REPORT_MS > 0
+    uint32_t cpu_report_tick = 0;
+#endif
     while (true) {
-        __wfi(); // Wait for interrupt
-        printf("Woke up from interrupt\n");
+        // Interrupts stay masked across the WFI. It still wakes on a pending
+        // one, and the handler only runs once the idle time is stamped.
+        uint32_t irq = save_and_disable_interrupts();
+        winc_sim_cpu_enter(&cpu, WINC_SIM_CPU_IDLE);
+        __wfi();
+        winc_sim_cpu_exit(&cpu);
+        restore_interrupts(irq);
+
+        // The only consumer of the trace rings, also in COMBINED builds
+        for (int i = 0; i < SIMULATOR_INSTANCES; i++) {
+            sim_log_drain(&instances[i].sim.log, SIM_LOG_RING_SIZE);
+#if SIMULATOR_CAPTURE_ENABLE
+            spi_capture_drain(&instances[i].capture, SPI_CAPTURE_RING_SIZE);
+#endif
+        }
+
+        // Over USB stdio: 'l' prints the latency histograms, 'c' the CPU
+        // use since the last report, 'r' clears both
+        int c = getchar_timeout_us(0);
+        if (c == 'l') {
+            for (int i = 0; i < SIMULATOR_INSTANCES; i++) {
+                winc_sim_latency_print(&instances[i].sim);
+            }
+        } else if (c == 'c') {
+            cpu_report(&cpu_reported);
+        } else if (c == 'r') {
+            for (int i = 0; i < SIMULATOR_INSTANCES; i++) {
+                winc_sim_latency_reset(&instances[i].sim);
+            }
+            irq = save_and_disable_interrupts();
+            winc_sim_cpu_reset(&cpu);
+            restore_interrupts(irq);
+            memset(&cpu_reported, 0, sizeof(cpu_reported));
+        }
+
+#if SIMULATOR_CPU_REPORT_MS > 0
+        if (cpu_ticks - cpu_report_tick >= SIMULATOR_CPU_REPORT_MS / CPU_TICK_MS) {
+            cpu_report_tick = cpu_ticks;
+            cpu_report(&cpu_reported);
+        }
+#endif
+
+        for (int i = 0; i < SIMULATOR_INSTANCES; i++) {
+            winc_sim_map_stats_t pages;
+            winc_sim_map_get_stats(&instances[i].sim, &pages);
+            if (pages.pages_used != pages_reported[i]) {
+                pages_reported[i] = pages.pages_used;
+                printf("Simulator %d pages: %lu of %lu used, %lu allocation failures\n", i,
+                       (unsigned long)pages.pages_used, (unsigned long)pages.pages_total,
+                       (unsigned long)pages.alloc_failures);
+            }
+        }
     }
 
     return 0;
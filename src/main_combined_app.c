@@ -3,6 +3,9 @@
 #include "pico_winc_simulator/winc_simulator_app.h"
 
 void core1_entry() {
+    // Lets the driver park this core while it writes flash (nm_bsp_spi_cal_store(),
+    // CONF_WINC_SPI_CAL_STORE)
+    multicore_lockout_victim_init();
     winc_simulator_app_main();
 }
 
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_log.h"
+
+// Decodes the simulator's raw trace (SIMULATOR_LOG_RAW) from a console
+// capture: "#L <32 hex digits>" lines become text, everything else passes
+// through unchanged. Further simulator instances write "#L<n> ", each with
+// its own sequence numbers.
+//
+//   sim_log_decode < capture.txt
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int parse_record(const char *hex, sim_log_record_t *record)
+{
+    uint8_t bytes[sizeof(sim_log_record_t)];
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hi < 0 ? -1 : hex_value(hex[2 * i + 1]);
+        if (lo < 0) return -1;
+        bytes[i] = (uint8_t)(hi << 4 | lo);
+    }
+    // The records are little endian, like the hosts this runs on
+    memcpy(record, bytes, sizeof(*record));
+    return 0;
+}
+
+// "#L " or "#L<n> ", returns the record's hex or NULL
+static const char *parse_prefix(const char *line, unsigned *instance)
+{
+    const char *raw = strstr(line, "#L");
+    if (raw == NULL) return NULL;
+    raw += 2;
+    if (*raw == ' ') {
+        *instance = 0;
+        return raw + 1;
+    }
+    char *end;
+    unsigned long n = strtoul(raw, &end, 10);
+    if (end == raw || *end != ' ' || n == 0 || n > UINT8_MAX) return NULL;
+    *instance = (unsigned)n;
+    return end + 1;
+}
+
+int main(void)
+{
+    char line[512];
+    char text[128];
+    unsigned long records = 0, gaps = 0;
+    static bool seen[UINT8_MAX + 1];
+    static uint16_t next_seq[UINT8_MAX + 1];
+
+    while (fgets(line, sizeof(line), stdin)) {
+        sim_log_record_t record;
+        unsigned instance;
+        const char *raw = parse_prefix(line, &instance);
+        if (raw == NULL || parse_record(raw, &record) != 0) {
+            fputs(line, stdout);
+            continue;
+        }
+        if (seen[instance] && record.seq != next_seq[instance]) {
+            unsigned missing = (uint16_t)(record.seq - next_seq[instance]);
+            if (instance) {
+                printf("[SIMULATOR %u] ... %u records missing\n", instance, missing);
+            } else {
+                printf("[SIMULATOR] ... %u records missing\n", missing);
+            }
+            gaps++;
+        }
+        seen[instance] = true;
+        next_seq[instance] = (uint16_t)(record.seq + 1);
+        records++;
+        sim_log_format(&record, (uint8_t)instance, text, sizeof(text));
+        printf("%s\n", text);
+    }
+    fprintf(stderr, "%lu records, %lu gaps\n", records, gaps);
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "bsp/include/nm_bsp.h"
+#include "bsp/include/nm_bsp_host.h"
+#include "common/include/nm_common.h"
+#include "bus_wrapper/include/nm_bus_wrapper.h"
+#include "driver/source/nmbus.h"
+#include "winc_sim_loopback.h"
+#include "spi_capture.h"
+
+// Replays an SPI capture (spi_capture.h) at full speed. The "#C<stream>"
+// lines of a console capture are put back together, then every transfer
+// is clocked through a freshly reset simulator, either through the host
+// bus wrapper as the driver would (nm_bus_ioctl(), the default) or straight
+// into the loopback (-e). MISO is compared with what was captured.
+//
+//   spi_replay [-s stream] [-n passes] [-e] < capture.txt
+//
+// Stream 0 is the driver's nm_spi_rw(), 1 the first simulator instance.
+
+#define MISMATCHES_SHOWN 5
+
+typedef struct {
+    const spi_capture_header_t *header;
+    const uint8_t *mosi;
+    const uint8_t *miso;
+} record_t;
+
+static uint8_t *stream_buf;
+static size_t stream_len;
+static size_t stream_cap;
+
+static record_t *records;
+static size_t record_count;
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Appends the stream's bytes from stdin, returns -1 at the first lost line
+static int read_stream(unsigned stream)
+{
+    char line[512];
+    while (fgets(line, sizeof(line), stdin)) {
+        const char *raw = strstr(line, "#C");
+        unsigned s, offset;
+        int n;
+        if (raw == NULL || sscanf(raw, "#C%u %x %n", &s, &offset, &n) != 2 || s != stream) continue;
+        if (offset != (uint32_t)stream_len) {
+            fprintf(stderr, "Stream %u: bytes %zu to %u lost, replaying what came before\n", stream,
+                    stream_len, offset);
+            return -1;
+        }
+        for (const char *hex = raw + n; hex_value(hex[0]) >= 0 && hex_value(hex[1]) >= 0; hex += 2) {
+            if (stream_len == stream_cap) {
+                stream_cap = stream_cap ? stream_cap * 2 : 65536;
+                stream_buf = realloc(stream_buf, stream_cap);
+                if (stream_buf == NULL) return -1;
+            }
+            stream_buf[stream_len++] = (uint8_t)(hex_value(hex[0]) << 4 | hex_value(hex[1]));
+        }
+    }
+    return 0;
+}
+
+// Splits the stream into records, a truncated last one is left out
+static void index_records(void)
+{
+    size_t cap = 0;
+    for (size_t pos = 0; pos + sizeof(spi_capture_header_t) <= stream_len; ) {
+        const spi_capture_header_t *h = (const spi_capture_header_t *)&stream_buf[pos];
+        size_t body = pos + sizeof(*h);
+        size_t end = body + (size_t)h->len * (((h->flags & SPI_CAPTURE_MOSI) ? 1 : 0) + ((h->flags & SPI_CAPTURE_MISO) ? 1 : 0));
+        if (end > stream_len) break;
+
+        if (record_count == cap) {
+            cap = cap ? cap * 2 : 4096;
+            records = realloc(records, cap * sizeof(*records));
+            if (records == NULL) exit(EXIT_FAILURE);
+        }
+        record_t *r = &records[record_count++];
+        r->header = h;
+        r->mosi = (h->flags & SPI_CAPTURE_MOSI) ? &stream_buf[body] : NULL;
+        r->miso = (h->flags & SPI_CAPTURE_MISO) ? &stream_buf[end - h->len] : NULL;
+        pos = end;
+    }
+}
+
+static uint64_t clock_ns(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void transfer(int engine, winc_sim_loopback_t *lb, const uint8_t *mosi, uint8_t *miso, uint16_t len)
+{
+    if (engine) {
+        winc_sim_loopback_rw(lb, mosi, miso, len);
+    } else {
+        tstrNmSpiRw strRw = { (uint8 *)mosi, miso, len };
+        nm_bus_ioctl(NM_BUS_IOCTL_RW, &strRw);
+    }
+    winc_sim_loopback_poll(lb);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned stream = SPI_CAPTURE_STREAM_DRIVER;
+    unsigned passes = 1;
+    int engine = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            stream = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            passes = (unsigned)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-e") == 0) {
+            engine = 1;
+        } else {
+            fprintf(stderr, "usage: %s [-s stream] [-n passes] [-e] < capture.txt\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (passes == 0) passes = 1;
+
+    read_stream(stream);
+    index_records();
+    if (record_count == 0) {
+        fprintf(stderr, "No records for stream %u\n", stream);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t bytes = 0;
+    uint32_t gaps = 0;
+    uint32_t span_us = records[record_count - 1].header->time_us - records[0].header->time_us;
+    for (size_t i = 0; i < record_count; i++) {
+        bytes += records[i].header->len;
+        if (records[i].header->flags & SPI_CAPTURE_GAP) gaps++;
+    }
+    printf("Stream %u: %zu transfers, %llu bytes over %u us as captured", stream, record_count,
+           (unsigned long long)bytes, (unsigned)span_us);
+    if (span_us > 0) {
+        printf(" (%.0f transfers/s, %.2f MB/s)", record_count * 1e6 / span_us, bytes / (double)span_us);
+    }
+    printf("\n");
+    if (gaps) {
+        printf("  %u gaps where the capture dropped transfers, expect mismatches after them\n", (unsigned)gaps);
+    }
+
+    winc_sim_loopback_t *lb = nm_bsp_host_loopback();
+    if (!engine) {
+        nm_bsp_init();
+    }
+
+    static uint8_t miso[65536];
+    uint64_t wall_ns = 0, cpu_ns = 0, engine_ns = 0;
+    uint32_t mismatches = 0;
+
+    for (unsigned pass = 0; pass < passes; pass++) {
+        // Every pass starts from a chip fresh out of reset
+        if (engine) {
+            winc_sim_loopback_init(lb, 0);
+        } else {
+            nm_bus_iface_init(NULL);
+        }
+        winc_sim_loopback_reset_stats(lb);
+
+        uint64_t wall = clock_ns(CLOCK_MONOTONIC);
+        uint64_t cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+        for (size_t i = 0; i < record_count; i++) {
+            const record_t *r = &records[i];
+            uint16_t len = r->header->len;
+            transfer(engine, lb, r->mosi, miso, len);
+            if (r->miso && memcmp(miso, r->miso, len) != 0) {
+                if (mismatches++ < MISMATCHES_SHOWN && pass == 0) {
+                    size_t at = 0;
+                    while (miso[at] == r->miso[at]) at++;
+                    printf("  transfer %zu: MISO differs at byte %zu, %02x instead of %02x\n", i, at,
+                           miso[at], r->miso[at]);
+                }
+            }
+        }
+        cpu_ns += clock_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+        wall_ns += clock_ns(CLOCK_MONOTONIC) - wall;
+
+        winc_sim_loopback_stats_t stats;
+        winc_sim_loopback_get_stats(lb, &stats);
+        engine_ns += stats.engine_ns;
+
+        if (!engine) {
+            nm_bus_iface_deinit();
+        }
+    }
+
+    uint64_t transfers = (uint64_t)record_count * passes;
+    printf("Replayed %u time(s) %s: %.0f transfers/s, %.2f MB/s, %.0f ns CPU per transfer (%.0f%% in the engine)\n",
+           passes, engine ? "into the engine" : "through the bus wrapper",
+           transfers * 1e9 / wall_ns, bytes * passes * 1e3 / wall_ns, (double)cpu_ns / transfers,
+           cpu_ns ? 100.0 * engine_ns / cpu_ns : 0.0);
+    printf("  %u of %llu transfers with different MISO\n", (unsigned)mismatches, (unsigned long long)transfers);
+
+    free(records);
+    free(stream_buf);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}